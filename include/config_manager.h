@@ -1,6 +1,7 @@
 #ifndef CONFIG_MANAGER_H
 #define CONFIG_MANAGER_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 // Application configuration stored in NVS
@@ -20,8 +21,10 @@ struct AppConfig {
     char dexcom_username[64];
     char dexcom_password[64];
     bool dexcom_us;            // true=US (share2), false=international (shareous1)
+    char dexcom_base_url[96];  // scheme://host[:port] override, empty = Dexcom cloud for the region
 
     int poll_interval_sec;     // default 60, min 15
+    bool http_gzip;            // offer gzip on fetches, default true
 
     // Display
     uint8_t brightness;        // 0-255, default 40
@@ -54,6 +57,7 @@ struct AppConfig {
     uint32_t color_in_range;     // default 0x34A853 (green)
     uint32_t color_high;         // default 0xFBBC04 (orange/yellow)
     uint32_t color_urgent_high;  // default 0xEA4335 (red)
+    bool color_gradient;         // blend between range colors, default false
 
     // Clock & weather display colors
     uint32_t color_clock;        // default 0x00FFFF (cyan)
@@ -74,6 +78,7 @@ struct AppConfig {
     char weather_city[64];      // "City,CC" format, default "New York,US"
     bool weather_use_f;         // true=Fahrenheit, false=Celsius, default true
     int weather_poll_min;       // update interval, default 15, min 5
+    char weather_base_url[96];  // scheme://host[:port] override, empty = api.openweathermap.org
 
     // Date display on time screen
     bool date_on_time_screen;  // default true
@@ -111,15 +116,64 @@ struct AppConfig {
     char countdown_name[16];   // event name, default ""
     unsigned long countdown_target; // unix timestamp, default 0
 
+    // LAN sharing: one clock polls the cloud, the others take its readings
+    int lan_share_mode;        // 0=off, 1=auto (elect), 2=always fetch, 3=listen only, default 0
+    char lan_share_key[33];    // shared secret that signs the packets, default ""
+
+    // MQTT bridge to a home-automation broker
+    bool mqtt_enabled;         // default false
+    char mqtt_uri[96];         // e.g. "mqtt://192.168.1.10:1883", default ""
+    char mqtt_username[32];    // default ""
+    char mqtt_password[64];    // default ""
+    char mqtt_topic[48];       // topic prefix, default "sugarclock"
+
+    // Logging
+    int log_level;             // 1=error, 2=warn, 3=info, 4=debug, default 3
+
     // Config validity marker
     uint32_t magic;            // 0xGLUC to verify config is initialized
 };
 
+// Settings are grouped into sections, each versioned on its own so the web
+// API can serve and patch one group at a time
+enum ConfigSection {
+    CFG_WIFI,          // wifi_ssid, wifi_password
+    CFG_SOURCE,        // data source, server, Dexcom, poll interval, gzip
+    CFG_DISPLAY,       // brightness, units, default screen, night mode, auto-cycle, stale timeout
+    CFG_TIME,          // timezone, 24h, date on the time screen
+    CFG_THEME,         // glucose thresholds and colors
+    CFG_ALERTS,
+    CFG_WEATHER,
+    CFG_TIMER,         // pomodoro, stopwatch, countdown
+    CFG_NOTIFY,
+    CFG_SYSMON,
+    CFG_LAN,
+    CFG_MQTT,
+    CFG_SYSTEM,        // log level
+    CFG_SECTION_COUNT
+};
+
+#define CFG_BIT(s)  (1UL << (s))
+#define CFG_ALL     (CFG_BIT(CFG_SECTION_COUNT) - 1)
+
 // Initialize config manager - loads from NVS or writes defaults
 void config_init();
 
-// Save current config to NVS
-void config_save();
+// Save current config to NVS. Only keys whose value differs from what NVS
+// holds are written; returns the sections that changed (CFG_BIT mask).
+uint32_t config_save();
+
+// Section names as used in /api/config/<section>
+const char* config_section_name(ConfigSection s);
+bool config_section_find(const char* name, ConfigSection* out);
+
+// Quoted ETag for the given sections: changes whenever a save changes one
+// of them, and across reboots
+void config_etag(uint32_t sections, char* out, size_t len);
+
+// Move the ETag of sections changed in RAM without a save, so a
+// conditional GET doesn't answer 304 with the old values
+void config_touch(uint32_t sections);
 
 // Reset to factory defaults
 void config_reset();
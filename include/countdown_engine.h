@@ -6,9 +6,6 @@
 // Initialize countdown engine
 void countdown_init();
 
-// Countdown loop (lightweight - just uses time)
-void countdown_loop();
-
 // Get remaining seconds until target (negative if past)
 long countdown_get_remaining_sec();
 
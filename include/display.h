@@ -18,9 +18,9 @@ void display_set_brightness(uint8_t brightness);
 // Get current brightness
 uint8_t display_get_brightness();
 
-// Draw glucose value centered on matrix with specified color
-// color is a 16-bit RGB565 color for GFX compatibility
-void display_draw_glucose(int value, uint16_t color);
+// Draw preformatted glucose text (see glucose_lut.h), centered together
+// with the trend arrow area; color is a 16-bit RGB565 color for GFX
+void display_draw_glucose(const char* text, int text_width, uint16_t color);
 
 // Draw general text at position
 void display_draw_text(const char* text, int x, int y, uint16_t color);
@@ -0,0 +1,58 @@
+#ifndef DNS_CACHE_H
+#define DNS_CACHE_H
+
+#include <stdint.h>
+#include <WiFi.h>
+
+// Resolver cache in front of the HTTP clients (Dexcom, the custom server,
+// OpenWeatherMap). net_begin() resolves through it and connects to the
+// cached address, so a poll pays for DNS only when an entry has expired.
+// When the resolver fails, an expired address is served for up to
+// DNS_CACHE_STALE_MS. Entries still in use are refreshed by a low-priority
+// scheduler job shortly before they expire.
+//
+// lwIP doesn't hand out record TTLs, so entries live for DNS_CACHE_TTL_MS
+// (well under the TTLs these hosts publish).
+
+#define DNS_CACHE_SLOTS       4
+#define DNS_CACHE_TTL_MS      (5UL * 60UL * 1000UL)
+#define DNS_CACHE_STALE_MS    (24UL * 3600UL * 1000UL)
+#define DNS_CACHE_RETRY_MS    (30UL * 1000UL)        // after a failed lookup
+#define DNS_CACHE_AHEAD_MS    (60UL * 1000UL)        // refresh this long before expiry
+#define DNS_CACHE_IDLE_MS     (3600UL * 1000UL)      // not refreshed once unused this long
+
+enum DnsResult {
+    DNS_HIT,          // fresh entry
+    DNS_RESOLVED,     // looked up
+    DNS_STALE,        // lookup failed, expired entry served
+    DNS_FAILED,
+    DNS_RESULT_COUNT
+};
+
+struct DnsCacheEntry {
+    char host[64];
+    uint32_t ip;
+    unsigned long resolved_ms;     // last successful lookup
+    unsigned long expires_ms;      // stale from here on
+    unsigned long retry_ms;        // no lookup before this after a failure (0 = none)
+    unsigned long last_used_ms;
+    bool valid;
+};
+
+void dns_cache_init();
+
+// Request a refresh for entries about to expire (main loop)
+void dns_cache_loop();
+
+// Resolve a host name (IP literals pass straight through)
+bool dns_cache_resolve(const char* host, IPAddress& out);
+
+int dns_cache_count();
+// Copy of the i-th valid entry; false past the last one. Safe from any task.
+bool dns_cache_entry(int i, DnsCacheEntry* out);
+unsigned long dns_cache_results(DnsResult r);
+
+// Name used in JSON and metrics ("hit", "resolved", "stale", "failed")
+const char* dns_result_name(DnsResult r);
+
+#endif // DNS_CACHE_H
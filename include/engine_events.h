@@ -0,0 +1,24 @@
+#ifndef ENGINE_EVENTS_H
+#define ENGINE_EVENTS_H
+
+// Things that can change which screen the display engine shows. The engine
+// only re-evaluates its state when one of these has been posted (or one of
+// its own deadlines passes), so every input to that decision must post.
+enum EngineEvent {
+    ENGINE_EV_READING,        // new reading (fetch, LAN share, test push)
+    ENGINE_EV_FETCH_FAILED,
+    ENGINE_EV_WIFI,           // connected or lost
+    ENGINE_EV_NOTIFY,         // a notification appeared or the last one went
+    ENGINE_EV_CONFIG,         // settings saved
+    ENGINE_EV_PROVISIONING,   // Improv started or finished
+    ENGINE_EV_USER,           // mode toggled, auto-cycled, forced or cleared
+    ENGINE_EV_TIMER,          // boot, WiFi grace or staleness deadline
+    ENGINE_EV_COUNT
+};
+
+// Safe from any task
+void engine_post_event(EngineEvent ev);
+
+const char* engine_event_name(EngineEvent ev);
+
+#endif // ENGINE_EVENTS_H
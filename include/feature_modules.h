@@ -0,0 +1,41 @@
+#ifndef FEATURE_MODULES_H
+#define FEATURE_MODULES_H
+
+#include "metrics.h"
+
+// Optional feature engines. Each is on by default; a build drops one with
+// -DFEATURE_X=0 and leaves its source out (see env:glucose_only), which
+// also removes its screens, buttons and web routes.
+
+#ifndef FEATURE_WEATHER
+#define FEATURE_WEATHER 1
+#endif
+#ifndef FEATURE_TIMER
+#define FEATURE_TIMER 1        // pomodoro timer and stopwatch
+#endif
+#ifndef FEATURE_SYSMON
+#define FEATURE_SYSMON 1
+#endif
+#ifndef FEATURE_COUNTDOWN
+#define FEATURE_COUNTDOWN 1
+#endif
+
+// One entry per engine compiled in, in a constant table (feature_modules.cpp)
+struct FeatureModule {
+    const char* name;
+    void (*init)();
+    void (*loop)();            // nullptr: nothing to do per loop
+    bool (*active)();          // nullptr: always; otherwise loop() runs only while true
+    MetricSubsystem metric;    // where loop() time is accounted
+};
+
+void features_init();
+
+// Run the loops of active modules, each timed into its subsystem; returns
+// now so it chains like metrics_subsystem_done()
+unsigned long features_loop(unsigned long start_us);
+
+int features_count();
+const FeatureModule& features_get(int i);
+
+#endif // FEATURE_MODULES_H
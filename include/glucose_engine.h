@@ -19,7 +19,18 @@ enum DisplayState {
     STATE_STALE_WARNING,
     STATE_NO_DATA,
     STATE_NO_WIFI,
-    STATE_NO_CFG
+    STATE_NO_CFG,
+    STATE_PROVISIONING       // Improv credentials received, joining WiFi
+};
+
+// Display state changes, newest last, with the events that caused them
+#define ENGINE_LOG_SLOTS 32
+
+struct EngineTransition {
+    uint32_t uptime_ms;
+    uint8_t from;         // DisplayState
+    uint8_t to;
+    uint16_t reasons;     // bit per EngineEvent (engine_events.h)
 };
 
 // Glucose thresholds for color coding
@@ -49,6 +60,14 @@ DisplayState engine_get_user_mode();
 // Get state name string
 const char* engine_state_name(DisplayState state);
 
+// Transition log (0 = oldest) and how often the state has been re-evaluated
+int engine_transition_count();
+bool engine_get_transition(int i, EngineTransition* out);
+unsigned long engine_evaluation_count();
+
+// False for screens whose feature is compiled out (see feature_modules.h)
+bool engine_state_built_in(DisplayState state);
+
 // Force a specific display state (for server override)
 void engine_force_state(DisplayState state);
 
@@ -58,6 +77,12 @@ void engine_clear_force();
 // Set message text for MESSAGE_DISPLAY state
 void engine_set_message(const char* msg);
 
+// Current message text
+const char* engine_get_message();
+
+// Render one frame of the given state without evaluating transitions (render benchmark)
+void engine_render_frame(DisplayState state);
+
 // Set the preferred default mode (glucose or time)
 void engine_set_default_mode(DisplayState mode);
 
@@ -73,6 +98,13 @@ void engine_rebuild_toggle_order();
 // Reset the auto-cycle timer (call on manual button press to restart countdown)
 void engine_reset_auto_cycle();
 
+// How soon a screen comes up: 0 if it is showing, ULONG_MAX if auto-cycle
+// won't reach it (lets data for a screen be fetched just ahead of it)
+unsigned long engine_ms_until_shown(DisplayState state);
+
+// Inside the configured night-mode hours
+bool engine_is_night_mode();
+
 // Context-sensitive right button action
 void engine_right_button_action();
 
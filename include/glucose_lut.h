@@ -0,0 +1,33 @@
+#ifndef GLUCOSE_LUT_H
+#define GLUCOSE_LUT_H
+
+#include <stdint.h>
+
+// Everything the glucose screen needs for a reading, precomputed for the
+// whole CGM range: the range color (solid and blended), the digits in the
+// configured unit and their width in pixels. The table is rebuilt on the
+// first lookup after the thresholds, colors or unit change.
+
+#define GLUCOSE_LUT_MIN   40    // Dexcom reports LOW below this
+#define GLUCOSE_LUT_MAX   400   // and HIGH above
+
+struct GlucoseLutEntry {
+    uint16_t color;      // range color, display_color() format
+    uint16_t gradient;   // blended between neighbouring range colors
+    char text[6];        // "142" or "7.9"
+    uint8_t width;       // text width in pixels (6 per glyph)
+};
+
+// Entry for a reading; values outside the table are formatted on the spot
+const GlucoseLutEntry& glucose_lut_get(int mg_dl);
+
+// Solid or blended color, as configured
+uint16_t glucose_lut_color(const GlucoseLutEntry& e);
+
+// Signed delta in the configured unit ("+5", "-0.3"); returns its length
+int glucose_lut_format_delta(int delta_mg_dl, char* buf, int len);
+
+// Times the table has been built (bench and debug)
+unsigned long glucose_lut_builds();
+
+#endif // GLUCOSE_LUT_H
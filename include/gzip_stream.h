@@ -0,0 +1,68 @@
+#ifndef GZIP_STREAM_H
+#define GZIP_STREAM_H
+
+#include <Arduino.h>
+
+// Inflates a gzip (RFC 1952) response body as it is read, so a compressed
+// body goes straight into deserializeJson() and is never held whole.
+// Compressed input is pulled off the socket GZIP_IN_CHUNK bytes at a time
+// and output is handed out of deflate's 32 KB history window, the one
+// buffer the format requires. The decoder is miniz's tinfl from the ESP32
+// ROM, so it costs no flash. Everything lives in one heap block that is
+// freed with the stream.
+
+#define GZIP_IN_CHUNK     512
+#define GZIP_HEAP_BYTES   46000     // decoder tables + 32 KB window + input chunk
+#define GZIP_TIMEOUT_MS   10000     // longest wait for more compressed input
+
+class GzipStream : public Stream {
+public:
+    // wire_len: compressed length (Content-Length), or -1 if unknown
+    GzipStream(Stream& src, int wire_len);
+    ~GzipStream();
+    GzipStream(const GzipStream&) = delete;
+    GzipStream& operator=(const GzipStream&) = delete;
+
+    // False if the decoder couldn't be allocated or the data isn't gzip
+    bool ok() const { return state_ && !failed_; }
+
+    // Copy the first len - 1 decoded bytes to buf as they come out
+    void tee(char* buf, size_t len);
+
+    // Read to the end of the body and check its CRC-32 and length
+    bool finish();
+
+    size_t wire_bytes() const { return wire_bytes_; }
+    size_t body_bytes() const { return body_bytes_; }
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t readBytes(char* buf, size_t len) override;
+    size_t write(uint8_t) override { return 0; }
+
+private:
+    struct State;
+
+    bool fill();                  // inflate more output; false at the end
+    bool refill();                // more compressed input; false at the end
+    int next_byte();              // one compressed byte, -1 at the end
+    bool skip_header();
+
+    Stream& src_;
+    State* state_;
+    int wire_left_;               // -1 = unknown
+    size_t in_pos_ = 0, in_len_ = 0;
+    size_t out_pos_ = 0, out_end_ = 0;   // unread output in the window
+    size_t win_next_ = 0;                // where the decoder writes next
+    bool in_eof_ = false;
+    bool done_ = false;
+    bool failed_ = false;
+    uint32_t crc_ = 0;
+    size_t wire_bytes_ = 0;
+    size_t body_bytes_ = 0;
+    char* tee_ = nullptr;
+    size_t tee_len_ = 0, tee_used_ = 0;
+};
+
+#endif // GZIP_STREAM_H
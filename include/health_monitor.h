@@ -0,0 +1,47 @@
+#ifndef HEALTH_MONITOR_H
+#define HEALTH_MONITOR_H
+
+#include <stdint.h>
+
+// Long-uptime health: heap and largest free block sampled into a small
+// ring (24 h at the default interval), plus the stack high-water mark of
+// every task we know by name. The boot sample is kept separately so slow
+// heap growth over months stays visible after the ring has wrapped.
+
+#define HEALTH_SAMPLE_MS    (15UL * 60UL * 1000UL)
+#define HEALTH_RING_SLOTS   96
+#define HEALTH_FIRST_MS     (2UL * 60UL * 1000UL)   // boot sample, once WiFi and TLS have settled
+
+struct HealthSample {
+    uint32_t uptime_sec;
+    uint32_t free_heap;
+    uint32_t largest_block;
+    uint32_t min_free_heap;
+};
+
+struct HealthTask {
+    const char* name;
+    uint32_t stack_free_min;    // bytes never touched, lowest seen (0 = not seen yet)
+    bool running;
+};
+
+// Remember the loop task (call from setup)
+void health_init();
+
+// Take a sample every HEALTH_SAMPLE_MS
+void health_loop();
+
+// Take a sample now (also used by the soak scenario)
+void health_sample_now();
+
+// Fragmentation in percent: how much of the free heap is not in the largest block
+uint8_t health_frag_pct(const HealthSample& s);
+
+int health_sample_count();
+bool health_get_sample(int i, HealthSample* out);   // 0 = oldest
+bool health_get_boot_sample(HealthSample* out);
+
+int health_task_count();
+const HealthTask& health_get_task(int i);
+
+#endif // HEALTH_MONITOR_H
@@ -13,6 +13,7 @@ struct GlucoseReading {
     unsigned long timestamp;    // server timestamp (epoch seconds)
     unsigned long received_at_ms; // millis() when received
     bool valid;                 // true if successfully parsed
+    bool from_cache;            // restored from RTC memory after a reset, not yet refreshed
 };
 
 // History entry for graph
@@ -54,7 +55,15 @@ int http_get_delta();
 // Get history buffer (returns count, fills array)
 int http_get_history(GlucoseHistoryEntry* out, int max_count);
 
-// Force an immediate glucose fetch (for testing), returns true on success
-bool http_force_fetch();
+// Replace the current reading without touching history, counters or the
+// RTC cache (render benchmark fixtures)
+void http_set_reading(const GlucoseReading& reading);
+
+// Adopt a reading published by the LAN leader (see lan_share.h). age_ms is
+// the time since the leader's last successful poll. Older readings are ignored.
+void http_apply_shared_reading(int glucose, TrendType trend, unsigned long timestamp, unsigned long age_ms);
+
+// True if http_init() restored the last reading from RTC memory (soft/watchdog reset)
+bool http_is_warm_start();
 
 #endif // HTTP_CLIENT_H
@@ -1,6 +1,15 @@
 #ifndef IMPROV_SERIAL_H
 #define IMPROV_SERIAL_H
 
+#include <stdint.h>
+
+// Provisioning progress (credentials received -> connecting -> restart)
+enum ImprovPhase {
+    IMPROV_IDLE,
+    IMPROV_CONNECTING,
+    IMPROV_PROVISIONED   // connected and saved, restarting shortly
+};
+
 // Initialize Improv Wi-Fi serial handler
 void improv_init();
 
@@ -10,4 +19,10 @@ void improv_loop();
 // Check if Improv is currently provisioning
 bool improv_is_active();
 
+// Current provisioning phase
+ImprovPhase improv_get_phase();
+
+// Elapsed share of the connect timeout, 0-100 (for the progress display)
+uint8_t improv_connect_progress();
+
 #endif // IMPROV_SERIAL_H
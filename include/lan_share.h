@@ -0,0 +1,61 @@
+#ifndef LAN_SHARE_H
+#define LAN_SHARE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "http_client.h"
+
+// LAN sharing: one clock (the leader) polls the glucose source and
+// multicasts every reading to the others, which take it instead of
+// polling themselves. Packets are signed with HMAC-SHA256 over a key
+// shared by the household's clocks and carry the sender's wall-clock send
+// time: both sides need NTP, and a packet sent outside LAN_MAX_SKEW_S of
+// the receiver's clock, or not after the last one from that sender, is a
+// replay and dropped.
+//
+// Modes (cfg.lan_share_mode):
+//   1 auto   - listen first; lead if nobody else does, the lowest id wins
+//   2 leader - always poll and publish
+//   3 follow - never publish; poll only while the leader is silent
+
+#define LAN_GROUP_IP        239, 255, 71, 71
+#define LAN_PORT            47117
+#define LAN_PACKET_LEN      32
+#define LAN_MAX_SKEW_S      15      // accepted send-time difference between clocks
+#define LAN_LISTEN_MS       10000   // auto mode: wait for a leader before claiming
+#define LAN_HEARTBEAT_MS    30000   // leader repeats the current reading
+#define LAN_SILENCE_MS      90000   // follower gives up on a quiet leader
+
+enum LanRole {
+    LAN_ROLE_OFF,
+    LAN_ROLE_LISTENING,
+    LAN_ROLE_LEADER,
+    LAN_ROLE_FOLLOWER
+};
+
+// Initialize (role follows the config once WiFi is up)
+void lan_share_init();
+
+// Call every loop iteration; joins the group once WiFi is up
+void lan_share_loop();
+
+// False while a leader is supplying readings (http_loop skips its poll)
+bool lan_share_should_poll();
+
+// Publish the current reading after a successful poll (leaders only)
+void lan_share_publish();
+
+LanRole lan_share_get_role();
+const char* lan_share_role_name();
+uint32_t lan_share_leader_id();           // sender id of the leader being followed
+unsigned long lan_share_packets_received();
+unsigned long lan_share_packets_rejected(); // bad signature or version, or a replay
+
+// Encode a signed reading packet. polled_at is the sender's last
+// successful poll and sent_at the send time, both epoch seconds; the
+// receiver works out the reading's age from polled_at on its own clock.
+// Returns LAN_PACKET_LEN.
+size_t lan_share_encode(uint8_t* out, uint32_t sender_id, const GlucoseReading& reading,
+                        uint32_t polled_at, uint32_t sent_at, const char* key);
+
+#endif // LAN_SHARE_H
@@ -0,0 +1,68 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <stdint.h>
+
+// Leveled logger. LOG_x() formats "[TAG] message" into a lock-free ring in
+// RAM and returns; a low-priority task drains the ring to Serial, so a full
+// UART never stalls the caller. /api/logs reads the same ring.
+//
+// Calls above LOG_BUILD_LEVEL are compiled out; the rest are filtered at
+// runtime by logger_set_level() (cfg.log_level) before any formatting.
+
+enum LogLevel : uint8_t {
+    LOG_LEVEL_NONE,
+    LOG_LEVEL_ERROR,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_DEBUG
+};
+
+#ifndef LOG_BUILD_LEVEL
+#define LOG_BUILD_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+#define LOG_RING_SLOTS   64     // power of two
+#define LOG_LINE_MAX     120    // including "[TAG] " and the terminator
+#define LOG_DRAIN_MS     20
+
+struct LogEntry {
+    uint32_t seq;               // increases by one per line, never reused
+    uint32_t ms;                // millis() when logged
+    uint8_t level;
+    char text[LOG_LINE_MAX];
+};
+
+extern volatile uint8_t logger_runtime_level;
+
+#define LOG_AT(level, tag, ...) do { \
+    if ((level) <= LOG_BUILD_LEVEL && (level) <= logger_runtime_level) logger_write(level, tag, __VA_ARGS__); \
+} while (0)
+
+#define LOG_E(tag, ...) LOG_AT(LOG_LEVEL_ERROR, tag, __VA_ARGS__)
+#define LOG_W(tag, ...) LOG_AT(LOG_LEVEL_WARN, tag, __VA_ARGS__)
+#define LOG_I(tag, ...) LOG_AT(LOG_LEVEL_INFO, tag, __VA_ARGS__)
+#define LOG_D(tag, ...) LOG_AT(LOG_LEVEL_DEBUG, tag, __VA_ARGS__)
+
+// Start the drain task (lines logged earlier wait in the ring)
+void logger_init();
+
+void logger_write(LogLevel level, const char* tag, const char* fmt, ...) __attribute__((format(printf, 3, 4)));
+
+void logger_set_level(LogLevel level);
+LogLevel logger_get_level();
+const char* logger_level_name(uint8_t level);
+
+// Copy the entry at *seq, or the oldest one still held if it was
+// overwritten, and advance *seq past it. False once caught up.
+bool logger_next(uint32_t* seq, LogEntry* out);
+
+uint32_t logger_head_seq();       // sequence number of the next line
+uint32_t logger_oldest_seq();     // oldest line still in the ring
+unsigned long logger_dropped();   // lines overwritten before reaching Serial
+
+// Called from the drain task for every line after it is written to Serial
+// (the web server streams them over SSE). Must not log.
+void logger_set_sink(void (*sink)(const LogEntry& entry));
+
+#endif // LOGGER_H
@@ -0,0 +1,63 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "perf_stats.h"
+
+// Static registry behind GET /metrics (Prometheus text format 0.0.4).
+// Updates are lock-free atomic adds so they are safe from any task; the
+// exposition is generated line by line into the response buffer.
+
+enum MetricCounter {
+    METRIC_LED_PUSHES,      // frames sent to the matrix
+    METRIC_NVS_WRITES,      // config saves and other NVS commits
+    METRIC_LOOP_STALLS,     // loops over PERF_STALL_MS
+    METRIC_COUNTER_COUNT
+};
+
+// Main loop stages, timed by metrics_subsystem_done()
+enum MetricSubsystem {
+    METRIC_SUB_WIFI,
+    METRIC_SUB_IMPROV,
+    METRIC_SUB_LAN,
+    METRIC_SUB_HTTP,
+    METRIC_SUB_MQTT,
+    METRIC_SUB_WEATHER,
+    METRIC_SUB_TIME,
+    METRIC_SUB_BUTTONS,
+    METRIC_SUB_SENSORS,
+    METRIC_SUB_FEATURES,   // buzzer, timer, notify, sysmon, countdown
+    METRIC_SUB_ENGINE,     // state machine and rendering
+    METRIC_SUB_OTA,
+    METRIC_SUB_COUNT
+};
+
+void metrics_inc(MetricCounter c);
+
+// Add the time since start_us to a subsystem; returns now so calls chain
+unsigned long metrics_subsystem_done(MetricSubsystem sub, unsigned long start_us);
+
+// Histogram observations (perf_stats forwards its samples here)
+void metrics_observe_loop(unsigned long loop_us);
+void metrics_observe_fetch(PerfSource src, unsigned long duration_ms, int http_code);
+
+// Resolver lookups (time spent in DNS) and DNS cache outcomes (a DnsResult)
+void metrics_observe_dns(unsigned long duration_ms, bool ok);
+void metrics_dns_result(int result);
+
+// Position in the exposition, one per response
+struct MetricsCursor {
+    uint16_t family;
+    uint16_t line;
+    char pending[160];     // line that did not fit in the previous chunk
+    uint8_t pending_len;
+    uint8_t pending_off;
+};
+
+void metrics_cursor_init(MetricsCursor& cur);
+
+// Fill buf with the next part of the exposition; 0 when done
+size_t metrics_render(MetricsCursor& cur, uint8_t* buf, size_t max_len);
+
+#endif // METRICS_H
@@ -0,0 +1,34 @@
+#ifndef MQTT_BRIDGE_H
+#define MQTT_BRIDGE_H
+
+#include <stdint.h>
+
+// MQTT link to a home-automation broker over one persistent connection
+// (ESP-IDF esp-mqtt, which runs in its own task).
+//
+// Published, retained, only when the value changes (<base> = cfg.mqtt_topic):
+//   <base>/glucose   mg/dL          <base>/trend   "Flat", "Rising", ...
+//   <base>/delta     mg/dL          <base>/state   display state name
+//   <base>/status    "online" / "offline" (last will)
+// Subscribed:
+//   <base>/notify    text, or {"text":..,"duration_sec":..,"urgent":..}
+//   <base>/sysmon    {"label":..,"value":..,"max":..}
+//   <base>/command   next | prev | snooze | dismiss | clear | restart
+
+#define MQTT_BACKOFF_MIN_MS   2000
+#define MQTT_BACKOFF_MAX_MS   120000
+#define MQTT_INBOX_DEPTH      6
+#define MQTT_PAYLOAD_MAX      192
+
+// Start the client if enabled (call after wifi_init)
+void mqtt_init();
+
+// Reconnect backoff, inbound messages and change-driven publishing
+void mqtt_loop();
+
+bool mqtt_is_connected();
+unsigned long mqtt_messages_published();
+unsigned long mqtt_messages_received();
+unsigned long mqtt_messages_dropped();     // inbox full or payload too large
+
+#endif // MQTT_BRIDGE_H
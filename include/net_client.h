@@ -0,0 +1,55 @@
+#ifndef NET_CLIENT_H
+#define NET_CLIENT_H
+
+#include "tls_client.h"
+#include <HTTPClient.h>
+#include <ArduinoJson.h>
+
+// Where a response came from, for the body byte counts
+enum NetSource {
+    NET_SRC_DEXCOM,
+    NET_SRC_SERVER,       // custom URL / Nightscout
+    NET_SRC_WEATHER,
+    NET_SRC_COUNT
+};
+
+struct NetBodyStats {
+    unsigned long responses;
+    unsigned long gzipped;       // responses that came compressed
+    uint64_t wire_bytes;         // body bytes as received
+    uint64_t body_bytes;         // after inflating
+};
+
+// Begin an HTTP request on the transport matching the URL scheme:
+// plain TCP for http:// (local stand-in servers such as tools/mock_server.py),
+// TLS (see tls_client.h) for everything else. The host is
+// resolved through the DNS cache and the client connected here, so a
+// false return also covers resolver and connect failures.
+// Both clients must outlive the request.
+bool net_begin(HTTPClient& http, WiFiClient& plain, TlsClient& tls,
+               const char* url, uint32_t socket_timeout_sec);
+
+// True if the URL uses plain http://
+bool net_is_plain_http(const char* url);
+
+// Call before GET/POST when the body will be read with net_read_json() or
+// net_read_text(). Offers gzip when enabled in the config and the heap can
+// hold the inflater (GZIP_HEAP_BYTES on top of NET_HEAP_RESERVE), and
+// collects Content-Encoding plus also_collect (e.g. "Cache-Control").
+void net_request_headers(HTTPClient& http, const char* also_collect = nullptr);
+
+// Parse the response body, inflating it as it streams in if it came
+// gzipped. The first snapshot_len - 1 decoded bytes go to snapshot.
+DeserializationError net_read_json(HTTPClient& http, NetSource src, JsonDocument& doc,
+                                   char* snapshot, size_t snapshot_len,
+                                   JsonDocument* filter = nullptr);
+
+// The first len - 1 bytes of the body as text (error responses)
+void net_read_text(HTTPClient& http, NetSource src, char* buf, size_t len);
+
+const NetBodyStats& net_body_stats(NetSource src);
+
+// Name used in JSON and metrics ("dexcom", "server", "weather")
+const char* net_source_name(NetSource src);
+
+#endif // NET_CLIENT_H
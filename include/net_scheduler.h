@@ -0,0 +1,76 @@
+#ifndef NET_SCHEDULER_H
+#define NET_SCHEDULER_H
+
+#include <stdint.h>
+
+// Every outbound HTTP(S) request goes through here. Modules register a job
+// (the blocking fetch) and ask for it when it is due; the main loop runs
+// pending jobs one per pass, highest priority first, with a gap between
+// starts so two schedules landing together don't stall the display twice
+// in a row. A job only starts while a TLS session slot is free and the
+// largest free heap block can hold one more mbedTLS context (~40 KB on a
+// no-PSRAM ESP32). Jobs only ever run on the loop task: a force-fetch from
+// the web UI marks the job due and polls for the result of the next run
+// to finish, so one already in flight answers it.
+
+// Lower value runs first
+enum NetJob {
+    NET_JOB_GLUCOSE,
+    NET_JOB_WEATHER,      // current conditions
+    NET_JOB_FORECAST,     // queued by a weather run, so each pass blocks once
+    NET_JOB_DNS,          // refresh of cached host addresses
+    NET_JOB_COUNT
+};
+
+#ifndef NET_MAX_TLS_SESSIONS
+#define NET_MAX_TLS_SESSIONS  1
+#endif
+#define NET_TLS_SESSION_BYTES 40000   // mbedTLS context + record buffers
+#define NET_HEAP_RESERVE      16384   // left for the web server and JSON
+#define NET_JOB_GAP_MS        2000    // between scheduled job starts
+
+// Returns true on success
+typedef bool (*NetJobFn)();
+
+struct NetJobStats {
+    unsigned long runs;
+    unsigned long failures;
+    unsigned long coalesced;     // requests answered by a run already pending or in flight
+    unsigned long deferred;      // passes a due job waited on the session or heap budget
+    unsigned long last_ms;
+};
+
+void net_sched_init();
+
+// Run due jobs (main loop)
+void net_sched_loop();
+
+void net_sched_register(NetJob job, NetJobFn fn);
+
+// Mark a job due; it runs on a later net_sched_loop() pass. Safe from any task.
+void net_sched_request(NetJob job);
+
+enum NetResult {
+    NET_RESULT_PENDING,
+    NET_RESULT_OK,
+    NET_RESULT_FAILED,
+};
+
+// Mark a job due and return a ticket for net_sched_result() (force-fetch
+// from the web UI). Never blocks; safe from any task.
+uint32_t net_sched_force(NetJob job);
+
+// Outcome of the first run of job to finish after the ticket was taken
+NetResult net_sched_result(NetJob job, uint32_t ticket);
+
+// Session slots the heap allows right now (0..NET_MAX_TLS_SESSIONS)
+int net_sched_sessions_allowed();
+
+int net_sched_active();
+bool net_sched_pending(NetJob job);
+const NetJobStats& net_sched_stats(NetJob job);
+
+// Name used in JSON output ("glucose", "weather", "forecast", "dns")
+const char* net_sched_job_name(NetJob job);
+
+#endif // NET_SCHEDULER_H
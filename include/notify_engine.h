@@ -3,25 +3,41 @@
 
 #include <stdint.h>
 
+// Notifications queue up (32 entries, 127 characters each) and are shown
+// in rotation, urgent ones first. Each stays up for one marquee pass.
+#define NOTIFY_SCROLL_MS_PER_PX 100
+
 // Initialize notification engine
 void notify_init();
 
 // Notification loop - expires old notifications
 void notify_loop();
 
-// Push a new notification
-void notify_push(const char* text, int duration_sec = 60, bool urgent = false);
+// Push a new notification (safe from any task). Returns false if the queue
+// is full; urgent notifications make room by dropping the normal one
+// closest to expiry.
+bool notify_push(const char* text, int duration_sec = 60, bool urgent = false);
 
 // Check if there's an active notification to display
 bool notify_has_active();
 
-// Get current notification text
+// Get current notification text (a copy, valid until the next call)
 const char* notify_get_text();
 
 // Check if current notification is urgent
 bool notify_is_urgent();
 
+// How long the current notification has been on screen (scroll position)
+unsigned long notify_shown_ms();
+
+// Notifications queued, and pushes refused or dropped for lack of room
+int notify_count();
+unsigned long notify_rejected_count();
+
 // Dismiss current notification
 void notify_dismiss();
 
+// Dismiss all notifications
+void notify_clear();
+
 #endif // NOTIFY_ENGINE_H
@@ -0,0 +1,62 @@
+#ifndef OTA_UPDATE_H
+#define OTA_UPDATE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Over-the-air updates streamed from the web server into the inactive app
+// slot (firmware), the LittleFS partition (filesystem) or the web UI bundle
+// partition (www). Images may be gzip-compressed; they are inflated on the
+// fly and SHA-256 checked.
+//
+// A new firmware is "pending" until it has run for OTA_HEALTHY_MS with the
+// network up. If it resets OTA_MAX_BOOT_ATTEMPTS times before that, the
+// previous slot is booted again.
+
+#define OTA_HEALTHY_MS         60000
+#define OTA_MAX_BOOT_ATTEMPTS  3
+
+enum OtaTarget {
+    OTA_FIRMWARE,
+    OTA_FILESYSTEM,
+    OTA_WEB_BUNDLE
+};
+
+enum OtaState {
+    OTA_IDLE,
+    OTA_RECEIVING,
+    OTA_SUCCESS,     // image written and verified, restart to apply
+    OTA_FAILED
+};
+
+// Boot attempt accounting and rollback; call early in setup()
+void ota_init();
+
+// Confirms a pending firmware once it has proven healthy
+void ota_loop();
+
+// Start an update. expected_sha256 is the hex digest of the uncompressed
+// image, or nullptr to rely on the app image's own checksum (firmware only).
+bool ota_begin(OtaTarget target, const char* expected_sha256);
+
+// Feed the next chunk of the upload (compressed or not)
+bool ota_write(const uint8_t* data, size_t len);
+
+// Finish, verify and (firmware) select the new slot for the next boot
+bool ota_end();
+
+// Drop a partial update
+void ota_abort();
+
+OtaState ota_get_state();
+OtaTarget ota_get_target();
+const char* ota_target_name(OtaTarget t);     // "firmware", "filesystem", "www"
+const char* ota_last_error();
+size_t ota_bytes_received();     // upload bytes
+size_t ota_bytes_written();      // image bytes after inflating
+
+// Running slot label ("app0"/"app1") and whether it is still on probation
+const char* ota_running_partition();
+bool ota_is_pending_verify();
+
+#endif // OTA_UPDATE_H
@@ -0,0 +1,46 @@
+#ifndef PERF_STATS_H
+#define PERF_STATS_H
+
+#include <stdint.h>
+
+// Blocking network fetches, timed end to end (connect + TLS + transfer + parse)
+enum PerfSource {
+    PERF_GLUCOSE,
+    PERF_WEATHER,
+    PERF_SOURCE_COUNT
+};
+
+struct PerfFetchStats {
+    unsigned long count;
+    unsigned long failures;     // fetches that did not return HTTP 200
+    unsigned long last_ms;
+    unsigned long max_ms;
+    unsigned long total_ms;
+    int last_code;
+};
+
+// Loops longer than this count as a stall (the display visibly freezes)
+#define PERF_STALL_MS 100
+
+// Record one main loop pass (microseconds)
+void perf_loop_sample(unsigned long loop_us);
+
+// Record one fetch
+void perf_fetch_sample(PerfSource src, unsigned long duration_ms, int http_code);
+
+// Loop stats since the last perf_reset()
+unsigned long perf_loop_count();
+unsigned long perf_loop_max_us();
+unsigned long perf_loop_avg_us();
+unsigned long perf_loop_stalls();
+
+// Fetch stats since the last perf_reset()
+const PerfFetchStats& perf_fetch_stats(PerfSource src);
+
+// Name used in JSON output ("glucose", "weather")
+const char* perf_source_name(PerfSource src);
+
+// Clear all counters (e.g. at the start of a benchmark run)
+void perf_reset();
+
+#endif // PERF_STATS_H
@@ -0,0 +1,60 @@
+#ifndef RATE_LIMIT_H
+#define RATE_LIMIT_H
+
+#include <stdint.h>
+
+// Admission control for the web API. Each client IP gets a token bucket
+// per route class, so a script flooding /api/notify doesn't starve a
+// dashboard polling /api/status. On top of that, the responses in flight
+// are capped by free heap (RATE_RESPONSE_BYTES each above RATE_HEAP_FLOOR,
+// at most RATE_INFLIGHT_MAX), so a burst can't use up the AsyncTCP slots
+// and the heap the setup UI needs. Turned-away requests get a 429 (client
+// over its rate) or 503 (device busy) with Retry-After.
+// Static files aren't gated, so the UI itself keeps loading.
+
+enum RateClass {
+    RATE_STATUS,      // read-only API polled by dashboards
+    RATE_CONFIG,      // config writes, restart, display control
+    RATE_INGEST,      // notify and sysmon pushes
+    RATE_TEST,        // test endpoints that trigger an outbound fetch
+    RATE_CLASS_COUNT
+};
+
+enum Admission {
+    ADMIT_OK,
+    ADMIT_LIMITED,    // client over its rate for this class: 429
+    ADMIT_BUSY,       // too many responses in flight for the heap: 503
+};
+
+#define RATE_CLIENT_SLOTS        8
+#define RATE_INFLIGHT_MAX        8
+#define RATE_HEAP_FLOOR          24576
+#define RATE_RESPONSE_BYTES      6144      // AsyncTCP buffers + a JSON response
+#define RATE_INFLIGHT_TIMEOUT_MS 30000     // slot reclaimed if never released
+
+struct RateClassStats {
+    unsigned long admitted;
+    unsigned long limited;
+    unsigned long busy;
+};
+
+void rate_limit_init();
+
+// Charge a request from ip to its bucket and take an in-flight slot.
+// On ADMIT_OK, *slot is to be passed to rate_limit_release() once the
+// response is done; otherwise *retry_after_sec says when to come back.
+Admission rate_limit_admit(uint32_t ip, RateClass cls, int* slot, uint32_t* retry_after_sec);
+
+void rate_limit_release(int slot);
+
+int rate_limit_inflight();
+
+// Responses the heap allows in flight right now (0..RATE_INFLIGHT_MAX)
+int rate_limit_inflight_cap();
+
+const RateClassStats& rate_limit_stats(RateClass cls);
+
+// Name used in JSON output ("status", "config", "ingest", "test")
+const char* rate_class_name(RateClass cls);
+
+#endif // RATE_LIMIT_H
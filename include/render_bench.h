@@ -0,0 +1,65 @@
+#ifndef RENDER_BENCH_H
+#define RENDER_BENCH_H
+
+#include <stdint.h>
+
+// Render micro-benchmark: CPU cycles per frame for every display state and
+// for the individual draw primitives. Runs on the main loop (the only task
+// allowed to touch the LED buffer) with fixed fixture data, so results are
+// comparable between builds.
+
+#define BENCH_WARMUP_FRAMES   5
+#define BENCH_FRAMES          20
+#define BENCH_REGRESSION_PCT  15   // median slower than baseline by more than this = regression
+#define BENCH_NOISE_CYCLES    240  // ...and by at least 1 us at 240 MHz
+#define BENCH_BASELINE_PATH   "/bench_baseline.json"
+
+enum BenchKind {
+    BENCH_KIND_STATE,
+    BENCH_KIND_PRIMITIVE
+};
+
+enum BenchStatus {
+    BENCH_IDLE,
+    BENCH_PENDING,
+    BENCH_DONE
+};
+
+struct BenchResult {
+    const char* name;
+    BenchKind kind;
+    uint32_t avg_cycles;
+    uint32_t median_cycles;     // compared against the baseline (robust to interrupts)
+    uint32_t max_cycles;
+    uint32_t baseline_cycles;   // baseline median, 0 = no baseline for this case
+    bool regressed;
+};
+
+// Ask the main loop to run the suite (safe from web server callbacks).
+// With save_baseline the results also become the new stored baseline.
+void bench_request(bool save_baseline);
+
+// Run a pending request; call from loop()
+void bench_loop();
+
+// Run the suite now, returns the number of regressions
+int bench_run();
+
+BenchStatus bench_get_status();
+
+// Results of the last run
+int bench_result_count();
+const BenchResult& bench_get_result(int index);
+int bench_regression_count();
+
+// CPU clock the cycle counts refer to
+uint32_t bench_cpu_mhz();
+
+// Baseline in LittleFS (loaded automatically before each run)
+bool bench_load_baseline();
+bool bench_save_baseline();
+
+// Set one baseline entry by case name (host simulator keeps its own file)
+void bench_set_baseline(const char* name, uint32_t cycles);
+
+#endif // RENDER_BENCH_H
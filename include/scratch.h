@@ -0,0 +1,53 @@
+#ifndef SCRATCH_H
+#define SCRATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <ArduinoJson.h>
+
+// Bump arenas for per-request and per-fetch scratch memory (JSON documents,
+// packet buffers). A ScratchScope marks its task's arena and rewinds it on
+// exit, so nothing is freed piecemeal and the heap is not fragmented by
+// short-lived blocks. Requests that don't fit fall back to the heap.
+//
+// There is one arena per task that uses scratch memory, so no locking:
+// the Arduino loop task gets scratch_loop, every other task (AsyncTCP,
+// which runs the web handlers) gets scratch_web.
+
+#define SCRATCH_LOOP_SIZE  2048   // fetch parsing, MQTT inbox, Improv packets
+#define SCRATCH_WEB_SIZE   4096   // web handler JSON, history snapshot
+
+struct ScratchArena {
+    const char* name;
+    uint8_t* base;
+    size_t size;
+    size_t used;
+    size_t high_water;
+    unsigned long overflows;   // requests that went to the heap instead
+};
+
+extern ScratchArena scratch_loop;
+extern ScratchArena scratch_web;
+
+// Remember which task is the loop task (call first thing in setup)
+void scratch_init();
+
+class ScratchScope {
+public:
+    ScratchScope();            // the calling task's arena
+    ~ScratchScope();
+    ScratchScope(const ScratchScope&) = delete;
+    ScratchScope& operator=(const ScratchScope&) = delete;
+
+    // 8-byte aligned; nullptr when the arena is full
+    void* alloc(size_t size);
+
+    // Declare the document after the scope: JsonDocument doc(scope.json());
+    ArduinoJson::Allocator* json();
+
+private:
+    ScratchArena& arena_;
+    size_t mark_;
+};
+
+#endif // SCRATCH_H
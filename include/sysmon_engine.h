@@ -6,9 +6,6 @@
 // Initialize system monitor
 void sysmon_init();
 
-// System monitor loop - checks for stale data
-void sysmon_loop();
-
 // Push new data from computer
 void sysmon_push(const char* label, int value, int max_val);
 
@@ -0,0 +1,68 @@
+#ifndef TLS_CLIENT_H
+#define TLS_CLIENT_H
+
+#include <stdint.h>
+#include <WiFi.h>
+#include <WiFiClient.h>
+
+// Lean TLS transport for the outbound fetches, in place of WiFiClientSecure.
+// Our responses are a few hundred bytes up to ~30 KB, so the session:
+//  - asks for a 4 KB maximum fragment length (RFC 6066), so servers that
+//    support it send small records; where mbedTLS is built with variable
+//    buffer lengths the record buffers shrink to match
+//  - offers ECDHE-ECDSA suites first, AES-GCM over CBC (AES is in hardware)
+//  - draws randomness from the hardware RNG instead of a per-session
+//    entropy pool and DRBG
+//  - skips certificate verification, as setInsecure() did before
+// Handshake time and the most heap each connection held are kept per host.
+
+#define TLS_MAX_FRAG_LEN  4096
+#define TLS_HOST_SLOTS    4
+
+struct TlsHostStats {
+    char host[64];
+    unsigned long handshakes;
+    unsigned long failures;
+    unsigned long last_handshake_ms;
+    unsigned long max_handshake_ms;
+    uint32_t peak_heap_bytes;     // most heap one connection held, handshake or transfer
+    uint16_t max_frag;            // record size the server agreed to (16384 = no MFL)
+    char suite[48];               // last negotiated ciphersuite
+    unsigned long last_used_ms;
+};
+
+class TlsClient : public WiFiClient {
+public:
+    TlsClient();
+    ~TlsClient();
+
+    // TCP connect to ip, then handshake with host as SNI; 1 on success
+    int connect(IPAddress ip, uint16_t port, const char* host, uint32_t timeout_ms);
+
+    // What HTTPClient uses of WiFiClient
+    size_t write(uint8_t b);
+    size_t write(const uint8_t* buf, size_t size);
+    int available();
+    int read();
+    int read(uint8_t* buf, size_t size);
+    int peek();
+    void flush();
+    void stop();
+    uint8_t connected();
+
+private:
+    struct Session;
+    void sample_heap();
+
+    Session* session_ = nullptr;    // mbedTLS state, only while connected
+    WiFiClient tcp_;
+    char host_[64];
+    uint32_t heap_before_ = 0;      // free heap before the session was set up
+    uint32_t heap_low_ = 0;         // lowest free heap seen while it was up
+    int peeked_ = -1;
+};
+
+int tls_host_count();
+const TlsHostStats& tls_host_stats(int i);
+
+#endif // TLS_CLIENT_H
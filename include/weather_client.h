@@ -1,19 +1,37 @@
 #ifndef WEATHER_CLIENT_H
 #define WEATHER_CLIENT_H
 
+#include <stdint.h>
+
 struct WeatherReading {
     float temp;
     char description[32];
     int humidity;
     int condition_id;
+    float wind_ms;          // m/s whatever the display units
+    int wind_deg;           // direction the wind blows from
     unsigned long received_at_ms;
     bool valid;
 };
 
+// One 3-hour step of the OWM forecast
+#define WEATHER_FORECAST_SLOTS 16   // two days
+
+struct WeatherForecastSlot {
+    uint32_t time;          // Unix seconds
+    float temp;
+    int condition_id;
+    char description[12];
+    float wind_ms;
+    int wind_deg;
+};
+
 // Initialize weather client
 void weather_init();
 
-// Non-blocking polling loop
+// Non-blocking loop. Fetches only when the weather screen is about to be
+// shown and the cached data has expired (Cache-Control max-age); in between
+// the reading follows the cached forecast.
 void weather_loop();
 
 // Get the latest weather reading
@@ -22,8 +40,12 @@ const WeatherReading& weather_get_reading();
 // Check if weather data has been received
 bool weather_has_data();
 
-// Force an immediate weather fetch (for testing), returns true on success
-bool weather_force_fetch();
+// Cached forecast slots (0 when none)
+int weather_forecast_count();
+const WeatherForecastSlot& weather_get_forecast(int i);
+
+// Requests made to the weather API since boot
+unsigned long weather_api_call_count();
 
 // Get the last HTTP status code from weather fetch
 int weather_get_last_http_code();
@@ -34,6 +56,9 @@ const char* weather_get_last_response();
 // Inject mock weather data for testing animations (condition_id: 200=thunder, 300=drizzle, 500=rain, 600=snow)
 void weather_set_mock(float temp, const char* desc, int condition_id);
 
+// Replace the current reading as-is (render benchmark fixtures and restore)
+void weather_set_reading(const WeatherReading& reading);
+
 // Register a callback invoked just before a blocking weather fetch
 // (used by the engine to clear animations before the HTTP call blocks)
 typedef void (*WeatherPreFetchCallback)();
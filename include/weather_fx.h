@@ -0,0 +1,32 @@
+#ifndef WEATHER_FX_H
+#define WEATHER_FX_H
+
+#include <stdint.h>
+#include "weather_client.h"
+
+// Particle animation behind the weather screen: rain, drizzle, snow and
+// thunderstorms, drifted by the wind. Particles are fixed-point and stored
+// as parallel arrays; one emitter per condition sets rate, speed, wobble and
+// lightning, scaled by the reported intensity.
+//
+// Budget: a full frame (update + draw of all WEATHER_FX_MAX_PARTICLES)
+// should stay under WEATHER_FX_BUDGET_CYCLES; the render benchmark's
+// "weather_fx_full" case measures it and logs a warning when it doesn't.
+
+#define WEATHER_FX_MAX_PARTICLES  64
+#define WEATHER_FX_FRAME_MS       33      // ~30 fps while the weather screen is up
+#define WEATHER_FX_BUDGET_CYCLES  48000   // 0.2 ms at 240 MHz
+
+// Advance by the time since the last frame and draw the particles.
+// Returns true while a lightning flash should cover the screen.
+bool weather_fx_frame(const WeatherReading& wx, unsigned long now_ms);
+
+// Drop all particles
+void weather_fx_clear();
+
+// Spawn the condition's particles up to the limit, spread over the screen (bench)
+void weather_fx_fill(const WeatherReading& wx);
+
+int weather_fx_count();
+
+#endif // WEATHER_FX_H
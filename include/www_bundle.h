@@ -0,0 +1,46 @@
+#ifndef WWW_BUNDLE_H
+#define WWW_BUNDLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// The web UI as one pre-compressed bundle in the raw "www" partition
+// (packed by tools/www_pack.py, format described there). The partition is
+// memory-mapped once at boot and responses are sent straight from the
+// mapping: no filesystem mount, no metadata walk, no copy through a cache.
+// Without a valid bundle the web server falls back to LittleFS /www/.
+
+#define WWW_PARTITION_LABEL "www"
+#define WWW_MAGIC           0x42575757    // "WWWB" little-endian
+#define WWW_VERSION         1
+#define WWW_PATH_MAX        48
+#define WWW_FLAG_GZIP       0x01
+
+struct WwwAsset {
+    const uint8_t* data;          // in mapped flash
+    uint32_t len;
+    uint32_t crc;                 // of the stored bytes, used as the ETag
+    const char* content_type;
+    bool gzip;                    // stored gzip-compressed
+};
+
+// Map and check the bundle (header, index bounds, CRC). False if the
+// partition is missing, empty or damaged.
+bool www_bundle_init();
+
+bool www_bundle_ready();
+
+// Asset for a URL path; "/" and paths ending in "/" get their index.html
+bool www_bundle_find(const char* path, WwwAsset* out);
+
+// Stop serving before the partition is rewritten (OTA). The mapping stays,
+// so responses already streaming from it don't fault, but the erase
+// rewrites the bytes under them and they finish with garbage. After a
+// failed update, www_bundle_init() serves the bundle again if the erase
+// hadn't reached it yet.
+void www_bundle_suspend();
+
+int www_bundle_count();
+uint32_t www_bundle_bytes();
+
+#endif // WWW_BUNDLE_H
@@ -98,7 +98,7 @@ echo "--- Copying pre-built firmware binaries ---"
 PIO_BUILD="$REPO_ROOT/.pio/build/esp32dev"
 
 if [ -d "$PIO_BUILD" ]; then
-    for BIN in bootloader.bin partitions.bin firmware.bin; do
+    for BIN in bootloader.bin partitions.bin firmware.bin www.bin; do
         if [ -f "$PIO_BUILD/$BIN" ]; then
             cp "$PIO_BUILD/$BIN" "$FIRMWARE_DIR/$BIN"
             echo "Copied $BIN"
@@ -40,6 +40,50 @@ final class FirmwareManager {
         }
     }
 
+    // MARK: - Partition table
+
+    /// A data partition's place in flash, as the bundled partitions.bin lays it out.
+    struct Partition {
+        let offset: UInt32
+        let size: UInt32
+    }
+
+    /// Reads the bundled partition table, keyed by label. Images are flashed
+    /// where this table puts them, so the app follows whichever layout the
+    /// bundled firmware was built with.
+    ///
+    /// Each entry is 32 bytes: magic 0xAA 0x50, type, subtype, offset (LE),
+    /// size (LE), a 16-byte label and flags. The table ends at the first
+    /// entry without the magic (the MD5 entry or erased flash).
+    static func readPartitionTable() throws -> [String: Partition] {
+        guard let fwDir = firmwareDir,
+              let data = FileManager.default.contents(atPath: fwDir + "/partitions.bin") else {
+            throw FirmwareError.missingResource("partitions.bin")
+        }
+        let bytes = [UInt8](data)
+        func u32(_ at: Int) -> UInt32 {
+            UInt32(bytes[at]) | UInt32(bytes[at + 1]) << 8 |
+                UInt32(bytes[at + 2]) << 16 | UInt32(bytes[at + 3]) << 24
+        }
+
+        var table: [String: Partition] = [:]
+        var pos = 0
+        while pos + 32 <= bytes.count, bytes[pos] == 0xAA, bytes[pos + 1] == 0x50 {
+            let label = bytes[(pos + 12)..<(pos + 28)].prefix { $0 != 0 }
+            table[String(decoding: label, as: UTF8.self)] = Partition(offset: u32(pos + 4), size: u32(pos + 8))
+            pos += 32
+        }
+        return table
+    }
+
+    /// The LittleFS partition ("spiffs" in partitions_custom.csv).
+    static func filesystemPartition() throws -> Partition {
+        guard let fs = try readPartitionTable()["spiffs"] else {
+            throw FirmwareError.missingResource("spiffs partition in partitions.bin")
+        }
+        return fs
+    }
+
     // MARK: - LittleFS image building
 
     /// Builds a LittleFS image containing the web UI and a config.json overlay.
@@ -78,12 +122,12 @@ final class FirmwareManager {
         try jsonData.write(to: URL(fileURLWithPath: configPath))
         onOutput?("Wrote config.json\n")
 
-        // Run mklittlefs
-        // Partition size from partitions_custom.csv: 0x1F0000 = 2031616 bytes
+        // Run mklittlefs, sized to the bundled table's filesystem partition
+        let fs = try filesystemPartition()
         let outputPath = NSTemporaryDirectory() + "sugarclock_littlefs.bin"
         let result = await ProcessRunner.run(
             command: mklittlefs,
-            arguments: ["-c", tmpDir, "-s", "2031616", "-b", "4096", "-p", "256", outputPath]
+            arguments: ["-c", tmpDir, "-s", String(fs.size), "-b", "4096", "-p", "256", outputPath]
         ) { text in
             onOutput?(text)
         }
@@ -100,12 +144,13 @@ final class FirmwareManager {
 
     /// Flashes all firmware partitions to the device in a single esptool command.
     ///
-    /// Flash layout (from partitions_custom.csv):
+    /// Flash layout:
     ///   0x1000  — bootloader.bin
     ///   0x8000  — partitions.bin
     ///   0xe000  — boot_app0.bin
     ///   0x10000 — firmware.bin
-    ///   0x210000 — littlefs.bin
+    ///   spiffs  — littlefs.bin, at the offset in partitions.bin
+    ///   www     — www.bin, when both it and the partition are bundled
     @MainActor
     static func flashDevice(
         port: String,
@@ -133,21 +178,32 @@ final class FirmwareManager {
             }
         }
 
+        let table = try readPartitionTable()
+        let fs = try filesystemPartition()
+        func hex(_ v: UInt32) -> String { "0x" + String(v, radix: 16) }
+
+        var arguments = [
+            "--chip", "esp32",
+            "--port", port,
+            "--baud", "115200",
+            "write_flash",
+            "--flash_mode", "dio",
+            "--flash_size", "4MB",
+            "0x1000",   bootloader,
+            "0x8000",   partitions,
+            "0xe000",   bootApp0,
+            "0x10000",  firmware,
+            hex(fs.offset), littlefsPath,
+        ]
+        // Without the bundle the firmware serves the web UI from LittleFS
+        let webBundle = fwDir + "/www.bin"
+        if let www = table["www"], fm.fileExists(atPath: webBundle) {
+            arguments += [hex(www.offset), webBundle]
+        }
+
         let result = await ProcessRunner.run(
             command: esptool,
-            arguments: [
-                "--chip", "esp32",
-                "--port", port,
-                "--baud", "115200",
-                "write_flash",
-                "--flash_mode", "dio",
-                "--flash_size", "4MB",
-                "0x1000",   bootloader,
-                "0x8000",   partitions,
-                "0xe000",   bootApp0,
-                "0x10000",  firmware,
-                "0x210000", littlefsPath,
-            ]
+            arguments: arguments
         ) { text in
             onOutput?(text)
         }
@@ -0,0 +1,101 @@
+#ifndef SIM_SCENARIO_H
+#define SIM_SCENARIO_H
+
+// Scenario helpers: drive the device on the virtual clock, record the
+// display state sequence and check it against expectations.
+
+#include <stdint.h>
+#include <vector>
+#include <initializer_list>
+#include <esp_system.h>
+#include <HTTPClient.h>
+#include "glucose_engine.h"
+
+#define SIM_MIN(m)  ((uint64_t)(m) * 60ULL * 1000ULL)
+#define SIM_HOUR(h) ((uint64_t)(h) * 3600ULL * 1000ULL)
+#define SIM_SEC(s)  ((uint64_t)(s) * 1000ULL)
+
+struct StateChange {
+    uint64_t at_ms;
+    DisplayState state;
+};
+
+// One scheduled glitch in the fake CGM server
+struct CgmOutage {
+    uint64_t start_ms;
+    uint64_t end_ms;
+    int code;                 // HTTP status to return, or negative for transport failure
+};
+
+// Fake Nightscout-style server: a new reading every 5 minutes following a
+// slow sine around `base_mg_dl`, with scripted outages and per-call latency.
+struct CgmFeed {
+    int base_mg_dl = 120;
+    int swing_mg_dl = 40;
+    unsigned long latency_ms = 300;
+    std::vector<CgmOutage> outages;
+};
+
+class Scenario {
+public:
+    explicit Scenario(const char* name);
+
+    // Configure a WiFi + custom-URL device with auto-cycle off, then boot it
+    void boot_default();
+    void boot();
+
+    // Soft reset: RTC memory and NVS survive, setup() runs again
+    void reboot(esp_reset_reason_t reason);
+
+    // Serve readings from `feed`
+    void serve(const CgmFeed& feed);
+
+    // Advance the virtual clock, running the main loop every step_ms
+    void run_for(uint64_t ms);
+    void run_until(uint64_t at_ms);
+
+    // Schedule radio link changes
+    void wifi_down_between(uint64_t start_ms, uint64_t end_ms);
+
+    // Expectations (failures are reported and counted, the scenario continues)
+    void expect_sequence(std::initializer_list<DisplayState> expected);
+    void expect_state_at(uint64_t at_ms, DisplayState state);
+    void expect_change_within(DisplayState state, uint64_t from_ms, uint64_t to_ms);
+    void expect(bool cond, const char* what);
+
+    const std::vector<StateChange>& changes() const { return changes_; }
+    uint64_t steps() const { return steps_; }
+    int failures() const { return failures_; }
+
+    uint64_t step_ms = 50;
+
+private:
+    void tick();
+    DisplayState state_at(uint64_t at_ms) const;
+
+    const char* name_;
+    std::vector<StateChange> changes_;
+    std::vector<CgmOutage> wifi_outages_;
+    uint64_t steps_ = 0;
+    int failures_ = 0;
+};
+
+// Value the fake feed reports at a given time (for frame assertions)
+int cgm_feed_value(const CgmFeed& feed, uint64_t at_ms);
+
+// The feed's answer to a request at the current virtual time
+SimHttpResponse cgm_respond(const CgmFeed& feed);
+
+typedef void (*ScenarioFn)(Scenario& s);
+
+struct ScenarioDef {
+    const char* name;
+    const char* description;
+    ScenarioFn fn;
+};
+
+// Registry defined in scenarios.cpp
+extern const ScenarioDef SCENARIOS[];
+extern const int SCENARIO_COUNT;
+
+#endif // SIM_SCENARIO_H
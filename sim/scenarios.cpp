@@ -0,0 +1,1010 @@
+// Scenario catalogue. Each one scripts a stretch of device life on the
+// virtual clock and checks the resulting display state sequence.
+
+#include "scenario.h"
+#include "sim.h"
+#include "config_manager.h"
+#include "http_client.h"
+#include "timer_engine.h"
+#include "notify_engine.h"
+#include "lan_share.h"
+#include "metrics.h"
+#include "logger.h"
+#include "perf_stats.h"
+#include "scratch.h"
+#include "health_monitor.h"
+#include "glucose_lut.h"
+#include "engine_events.h"
+#include "sysmon_engine.h"
+#include "weather_client.h"
+#include "weather_fx.h"
+#include "time_engine.h"
+#include "net_scheduler.h"
+#include "dns_cache.h"
+#include "tls_client.h"
+#include "net_client.h"
+#include "rate_limit.h"
+#include "www_bundle.h"
+#include <esp32/rom/crc.h>
+#include <esp_partition.h>
+#include <Preferences.h>
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+// Cold boot with a healthy server: marquee, then the glucose screen
+static void boot_to_glucose(Scenario& s) {
+    CgmFeed feed;
+    s.serve(feed);
+    s.boot_default();
+    s.run_for(SIM_MIN(2));
+
+    s.expect_sequence({ STATE_BOOT, STATE_GLUCOSE_DISPLAY });
+    s.expect_change_within(STATE_GLUCOSE_DISPLAY, SIM_SEC(3), SIM_SEC(4));
+
+    char value[8];
+    snprintf(value, sizeof(value), "%d", cgm_feed_value(feed, sim_clock_ms()));
+    s.expect(strncmp(sim_display_last_frame(), value, strlen(value)) == 0, "frame shows the current reading");
+    s.expect(sim_http_request_count() == 2, "one poll per minute");
+}
+
+// A full day: server errors, a transport outage long enough for NO DATA,
+// and a WiFi drop, each followed by recovery
+static void day_with_outages(Scenario& s) {
+    CgmFeed feed;
+    feed.outages.push_back({ SIM_HOUR(2), SIM_HOUR(2) + SIM_MIN(7), 500 });
+    feed.outages.push_back({ SIM_HOUR(6), SIM_HOUR(6) + SIM_MIN(20), HTTPC_ERROR_CONNECTION_REFUSED });
+    s.serve(feed);
+    s.wifi_down_between(SIM_HOUR(12), SIM_HOUR(12) + SIM_MIN(5));
+    s.boot_default();
+    s.run_until(SIM_HOUR(24));
+
+    s.expect_sequence({
+        STATE_BOOT, STATE_GLUCOSE_DISPLAY,
+        STATE_STALE_WARNING, STATE_GLUCOSE_DISPLAY,
+        STATE_STALE_WARNING, STATE_NO_DATA, STATE_GLUCOSE_DISPLAY,
+        STATE_NO_WIFI, STATE_GLUCOSE_DISPLAY,
+    });
+    // Five failed polls (one per minute) before STALE, ten before NO DATA
+    s.expect_change_within(STATE_STALE_WARNING, SIM_HOUR(2) + SIM_MIN(4), SIM_HOUR(2) + SIM_MIN(6));
+    s.expect_change_within(STATE_NO_DATA, SIM_HOUR(6) + SIM_MIN(9), SIM_HOUR(6) + SIM_MIN(11));
+    // Recovery on the first poll after each outage
+    s.expect_change_within(STATE_GLUCOSE_DISPLAY, SIM_HOUR(2) + SIM_MIN(7), SIM_HOUR(2) + SIM_MIN(8));
+    s.expect_change_within(STATE_GLUCOSE_DISPLAY, SIM_HOUR(6) + SIM_MIN(20), SIM_HOUR(6) + SIM_MIN(21));
+    s.expect_change_within(STATE_GLUCOSE_DISPLAY, SIM_HOUR(12) + SIM_MIN(5), SIM_HOUR(12) + SIM_MIN(5) + SIM_SEC(1));
+
+    // State is re-evaluated per event (about one per poll), not per frame
+    s.expect(engine_evaluation_count() < 2 * 24 * 60 + 100, "evaluated on events only");
+    EngineTransition t;
+    bool wifi_logged = false;
+    for (int i = 0; engine_get_transition(i, &t); i++) {
+        if (t.to == STATE_NO_WIFI) wifi_logged = (t.reasons & (1u << ENGINE_EV_WIFI)) != 0;
+    }
+    s.expect(wifi_logged, "transition log names the WiFi drop");
+}
+
+// Auto-cycle walks the toggle order on its interval
+static void auto_cycle(Scenario& s) {
+    CgmFeed feed;
+    s.serve(feed);
+    s.boot_default();
+    AppConfig& cfg = config_get();
+    cfg.auto_cycle_enabled = true;
+    cfg.auto_cycle_sec = 10;
+    s.run_for(SIM_SEC(35));
+
+    s.expect_state_at(SIM_SEC(5), STATE_GLUCOSE_DISPLAY);
+    s.expect_state_at(SIM_SEC(12), STATE_TREND_DISPLAY);
+    s.expect_state_at(SIM_SEC(22), STATE_TIME_DISPLAY);
+    s.expect_state_at(SIM_SEC(32), STATE_GLUCOSE_DISPLAY);
+}
+
+// High alert beeps every 10 s until snoozed, then stays quiet for the snooze window
+static void alert_snooze(Scenario& s) {
+    CgmFeed feed;
+    feed.base_mg_dl = 300;
+    feed.swing_mg_dl = 0;
+    s.serve(feed);
+    s.boot_default();
+    AppConfig& cfg = config_get();
+    cfg.alert_enabled = true;
+    cfg.alert_high = 250;
+    cfg.alert_snooze_min = 15;
+
+    s.run_for(SIM_SEC(61));
+    unsigned long before_snooze = sim_buzzer_beep_count();
+    s.expect(before_snooze >= 6 && before_snooze <= 7, "beeps every 10 s while alerting");
+
+    engine_snooze_alerts();
+    s.run_for(SIM_MIN(14));
+    s.expect(sim_buzzer_beep_count() == before_snooze, "silent while snoozed");
+
+    s.run_for(SIM_MIN(2));
+    s.expect(sim_buzzer_beep_count() > before_snooze, "alerts resume after the snooze");
+}
+
+// Pomodoro with two sessions: work, break, work, long break, work
+static void pomodoro(Scenario& s) {
+    CgmFeed feed;
+    s.serve(feed);
+    s.boot_default();
+    AppConfig& cfg = config_get();
+    cfg.timer_sessions = 2;
+    timer_toggle_start_pause();
+
+    const struct { uint64_t at_ms; TimerState state; } checkpoints[] = {
+        { SIM_MIN(24), TIMER_RUNNING },
+        { SIM_MIN(26), TIMER_BREAK },
+        { SIM_MIN(31), TIMER_RUNNING },
+        { SIM_MIN(56), TIMER_LONG_BREAK },
+        { SIM_MIN(71), TIMER_RUNNING },
+    };
+    for (const auto& cp : checkpoints) {
+        s.run_until(cp.at_ms);
+        char what[48];
+        snprintf(what, sizeof(what), "timer state %d at %llu min", (int)cp.state,
+                 (unsigned long long)(cp.at_ms / SIM_MIN(1)));
+        s.expect(timer_get_state() == cp.state, what);
+    }
+    s.expect(sim_buzzer_beep_count() == 12, "three beeps per phase change");
+}
+
+// Notifications preempt the user mode and hand it back on expiry
+static void notify_expiry(Scenario& s) {
+    CgmFeed feed;
+    s.serve(feed);
+    s.boot_default();
+    s.run_for(SIM_SEC(10));
+
+    notify_push("Hello", 30);
+    s.run_for(SIM_SEC(40));
+
+    s.expect_sequence({ STATE_BOOT, STATE_GLUCOSE_DISPLAY, STATE_NOTIFY_DISPLAY, STATE_GLUCOSE_DISPLAY });
+    s.expect_change_within(STATE_GLUCOSE_DISPLAY, SIM_SEC(40), SIM_SEC(41));
+}
+
+// Soft reset with the access point gone: the cached reading is shown
+// immediately and NO WIFI only appears once the grace period runs out
+static void warm_restart(Scenario& s) {
+    CgmFeed feed;
+    s.serve(feed);
+    s.boot_default();
+    s.run_for(SIM_MIN(10));
+
+    s.wifi_down_between(sim_clock_ms(), SIM_HOUR(1));
+    uint64_t reset_at = sim_clock_ms();
+    s.reboot(ESP_RST_SW);
+    s.expect(http_get_reading().from_cache, "reading restored from RTC memory");
+    s.run_for(SIM_MIN(1));
+
+    s.expect_sequence({ STATE_BOOT, STATE_GLUCOSE_DISPLAY, STATE_NO_WIFI });
+    s.expect_change_within(STATE_NO_WIFI, reset_at + SIM_SEC(20), reset_at + SIM_SEC(21));
+}
+
+// A home-automation burst: every notification is queued and shown in
+// rotation, an urgent one jumps ahead, and the screen clears as they expire
+static void notify_burst(Scenario& s) {
+    CgmFeed feed;
+    s.serve(feed);
+    s.boot_default();
+    s.run_for(SIM_SEC(10));
+
+    char text[32];
+    for (int i = 0; i < 20; i++) {
+        snprintf(text, sizeof(text), "Door %d", i);
+        s.expect(notify_push(text, 60 + i), "burst accepted");
+    }
+    s.expect(notify_count() == 20, "all 20 queued");
+    s.expect(strcmp(notify_get_text(), "Door 19") == 0, "newest shown first");
+
+    // Each stays up for one marquee pass (7.4 s for "Door 19")
+    s.run_for(SIM_SEC(8));
+    s.expect(strcmp(notify_get_text(), "Door 18") == 0, "rotation moves on");
+
+    notify_push("Leak", 20, true);
+    s.run_for(SIM_SEC(10));
+    s.expect(notify_is_urgent() && strcmp(notify_get_text(), "Leak") == 0, "urgent shown ahead of the rest");
+    s.run_for(SIM_SEC(12));
+    s.expect(!notify_is_urgent(), "rotation resumes after urgent expiry");
+
+    s.run_for(SIM_SEC(60));
+    s.expect(notify_count() == 0, "all expired");
+    s.expect_sequence({ STATE_BOOT, STATE_GLUCOSE_DISPLAY, STATE_NOTIFY_DISPLAY, STATE_GLUCOSE_DISPLAY });
+    s.expect_change_within(STATE_GLUCOSE_DISPLAY, SIM_SEC(89), SIM_SEC(90));
+}
+
+// Auto-mode LAN sharing: while another clock leads, readings come from its
+// multicast and this one never polls; forged and replayed packets are
+// ignored; when the leader goes quiet this clock takes over polling and
+// publishing.
+static void lan_follower(Scenario& s) {
+    CgmFeed feed;
+    s.serve(feed);
+    config_init();
+    AppConfig& cfg = config_get();
+    cfg.lan_share_mode = 1;
+    strncpy(cfg.lan_share_key, "household-secret", sizeof(cfg.lan_share_key) - 1);
+    config_save();
+    s.boot_default();
+
+    GlucoseReading r = {};
+    r.trend = TREND_FLAT;
+    uint8_t pkt[LAN_PACKET_LEN], captured[LAN_PACKET_LEN];
+    const uint32_t leader = 0x00000001;  // lower than ours, so it keeps the job
+    for (int i = 0; i < 10; i++) {
+        uint32_t now = (uint32_t)time(nullptr);
+        r.glucose = 150 + i;
+        r.timestamp = now - 30;
+        lan_share_encode(pkt, leader, r, now - 2, now, "household-secret");
+        sim_udp_inject(pkt, sizeof(pkt));
+        if (i == 3) memcpy(captured, pkt, sizeof(pkt));
+        if (i == 5) {
+            sim_udp_inject(pkt, sizeof(pkt));  // same packet again
+            lan_share_encode(pkt, leader, r, now, now, "wrong-key");
+            pkt[12] = 40;  // forged urgent low
+            sim_udp_inject(pkt, sizeof(pkt));
+        }
+        s.run_for(SIM_MIN(1));
+    }
+
+    s.expect(lan_share_get_role() == LAN_ROLE_FOLLOWER, "following the leader");
+    s.expect(sim_http_request_count() == 0, "no cloud polls while following");
+    s.expect(http_get_reading().glucose == 159, "display shows the leader's value");
+    s.expect(lan_share_packets_rejected() == 2, "duplicate and forged packets rejected");
+    unsigned long age = http_time_since_last_reading();
+    s.expect(age >= SIM_SEC(61) && age <= SIM_SEC(63), "age from the leader's poll time");
+
+    // Leader silent, a captured packet replayed every 30 s: take over after
+    // LAN_SILENCE_MS anyway and start publishing
+    for (int i = 0; i < 6; i++) {
+        sim_udp_inject(captured, sizeof(captured));
+        s.run_for(SIM_SEC(30));
+        if (i == 0) {
+            s.expect(http_get_reading().glucose == 159, "replay doesn't change the reading");
+            s.expect(http_time_since_last_reading() >= age + SIM_SEC(30), "replay doesn't reset the age");
+        }
+    }
+    s.expect(lan_share_packets_rejected() == 8, "replays rejected");
+    s.expect(lan_share_get_role() == LAN_ROLE_LEADER, "took over as leader");
+    s.expect(sim_http_request_count() > 0, "polling again");
+    uint8_t sent[LAN_PACKET_LEN];
+    s.expect(sim_udp_sent_count() > 0 && sim_udp_last_sent(sent, sizeof(sent)) == LAN_PACKET_LEN,
+             "publishing readings");
+    s.expect_sequence({ STATE_BOOT, STATE_GLUCOSE_DISPLAY });
+}
+
+// Improv RPC "send WiFi settings" packet, as ESP Web Tools sends it
+static void feed_improv_credentials(const char* ssid, const char* password) {
+    uint8_t pkt[128] = { 'I', 'M', 'P', 'R', 'O', 'V', 1, 0x03 };
+    uint8_t ssid_len = strlen(ssid), pass_len = strlen(password);
+    int pos = 9;
+    pkt[pos++] = 0x01;                          // CMD_WIFI_SETTINGS
+    pkt[pos++] = 2 + ssid_len + pass_len;
+    pkt[pos++] = ssid_len;
+    memcpy(pkt + pos, ssid, ssid_len);
+    pos += ssid_len;
+    pkt[pos++] = pass_len;
+    memcpy(pkt + pos, password, pass_len);
+    pos += pass_len;
+    pkt[8] = pos - 9;
+    uint8_t checksum = 0;
+    for (int i = 6; i < pos; i++) checksum += pkt[i];
+    pkt[pos++] = checksum;
+    sim_serial_feed(pkt, pos);
+}
+
+// Web-installer provisioning on an unconfigured clock: a failed attempt
+// times out back to setup, a good one saves and restarts. The display
+// keeps animating throughout instead of freezing for the connect.
+static void improv_provisioning(Scenario& s) {
+    s.boot();
+    s.run_for(SIM_SEC(5));
+
+    s.wifi_down_between(sim_clock_ms(), sim_clock_ms() + SIM_SEC(30));
+    feed_improv_credentials("wrongnet", "password");
+    unsigned long frames = sim_display_show_count();
+    s.run_for(SIM_SEC(20));
+    s.expect(sim_display_show_count() - frames > 100, "rendering continued while connecting");
+    s.expect(!config_has_wifi(), "failed credentials not saved");
+
+    s.run_for(SIM_SEC(15));
+    feed_improv_credentials("simnet", "password");
+    s.run_for(500);
+    s.expect(sim_restart_count() == 0, "reply goes out before the restart");
+    s.run_for(SIM_SEC(5));
+
+    s.expect_sequence({ STATE_BOOT, STATE_NO_CFG, STATE_PROVISIONING, STATE_NO_CFG, STATE_PROVISIONING });
+    s.expect_change_within(STATE_NO_CFG, SIM_SEC(20), SIM_SEC(21));
+    s.expect(config_has_wifi() && strcmp(config_get().wifi_ssid, "simnet") == 0, "credentials saved");
+    s.expect(sim_restart_count() > 0, "restart requested");
+}
+
+// Render /metrics with the given chunk size, the way the web server does
+static std::string scrape_metrics(size_t chunk) {
+    MetricsCursor cur;
+    metrics_cursor_init(cur);
+    std::string out;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = metrics_render(cur, buf, chunk)) > 0) out.append((const char*)buf, n);
+    return out;
+}
+
+// Value of the sample whose name and labels are `series`, or -1
+static long metric_value(const std::string& text, const char* series) {
+    std::string key = std::string("\n") + series + " ";
+    size_t pos = text.find(key);
+    return pos == std::string::npos ? -1 : strtol(text.c_str() + pos + key.size(), NULL, 10);
+}
+
+// Drop the heap gauges, which move between two scrapes (the sim's heap
+// model sees the scrape's own allocations)
+static std::string without_heap_samples(const std::string& text) {
+    std::string out;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t end = text.find('\n', pos);
+        end = end == std::string::npos ? text.size() : end + 1;
+        if (text.compare(pos, 15, "sugarclock_heap") != 0) out.append(text, pos, end - pos);
+        pos = end;
+    }
+    return out;
+}
+
+// Scrape after polls with a server outage: the exposition is the same at
+// any chunk size and the counters match what the device did
+static void metrics_scrape(Scenario& s) {
+    CgmFeed feed;
+    feed.outages.push_back({ SIM_MIN(2), SIM_MIN(5), 500 });
+    s.serve(feed);
+    s.boot_default();
+    s.run_for(SIM_MIN(10));
+
+    std::string full = scrape_metrics(4096);
+    s.expect(without_heap_samples(scrape_metrics(7)) == without_heap_samples(full), "chunked output matches");
+    s.expect(full.back() == '\n', "ends with a newline");
+
+    const PerfFetchStats& fs = perf_fetch_stats(PERF_GLUCOSE);
+    s.expect(fs.failures > 0, "outage produced failed polls");
+    s.expect(metric_value(full, "sugarclock_fetch_failures_total{source=\"glucose\"}") == (long)fs.failures,
+             "failure counter matches");
+    s.expect(metric_value(full, "sugarclock_fetch_duration_seconds_count{source=\"glucose\",status=\"ok\"}") ==
+             (long)(fs.count - fs.failures), "successful polls in the latency histogram");
+    s.expect(metric_value(full, "sugarclock_fetch_duration_seconds_bucket{source=\"glucose\",status=\"ok\",le=\"0.25\"}") == 0 &&
+             metric_value(full, "sugarclock_fetch_duration_seconds_bucket{source=\"glucose\",status=\"ok\",le=\"0.5\"}") ==
+             (long)(fs.count - fs.failures), "300 ms polls land in the 0.5 s bucket");
+    s.expect(metric_value(full, "sugarclock_led_pushes_total") == (long)sim_display_show_count(),
+             "LED pushes counted");
+    s.expect(metric_value(full, "sugarclock_reading_age_seconds") < 60, "reading age under a poll interval");
+}
+
+// A late reader of the log ring gets the newest LOG_RING_SLOTS lines in
+// order; lines below the runtime level never enter the ring
+static void log_ring(Scenario& s) {
+    CgmFeed feed;
+    s.serve(feed);
+    s.boot_default();
+    s.run_for(SIM_MIN(3));
+
+    logger_set_level(LOG_LEVEL_INFO);
+    uint32_t before = logger_head_seq();
+    LOG_D("SIM", "filtered");
+    s.expect(logger_head_seq() == before, "debug line filtered at INFO");
+
+    for (int i = 0; i < LOG_RING_SLOTS * 2; i++) LOG_I("SIM", "line %d", i);
+
+    uint32_t seq = 0;
+    LogEntry e;
+    int count = 0;
+    bool in_order = true;
+    char expect_text[32];
+    while (logger_next(&seq, &e)) {
+        snprintf(expect_text, sizeof(expect_text), "[SIM] line %d", LOG_RING_SLOTS + count);
+        if (strcmp(e.text, expect_text) != 0) in_order = false;
+        count++;
+    }
+    s.expect(count == LOG_RING_SLOTS, "reader sees one ring's worth");
+    s.expect(in_order, "oldest retained line first, in order");
+    s.expect(seq == logger_head_seq(), "reader caught up");
+}
+
+static void scratch_arena(Scenario& s) {
+    CgmFeed feed;
+    s.serve(feed);
+    s.boot_default();
+    s.run_for(SIM_HOUR(2));
+    s.expect(scratch_loop.used == 0, "fetches leave the loop arena rewound");
+    s.expect(scratch_loop.overflows == 0, "no fetch spilled to the heap");
+
+    ScratchScope scope;
+    ArduinoJson::Allocator* json = scope.json();
+    size_t mark = scratch_loop.used;
+    uint8_t* p = (uint8_t*)json->allocate(100);
+    s.expect(p && scratch_loop.used > mark, "JSON block comes from the arena");
+    s.expect(json->reallocate(p, 400) == p, "newest block grows in place");
+    uint8_t* pinned = (uint8_t*)scope.alloc(16);
+    uint8_t* moved = (uint8_t*)json->reallocate(p, 800);
+    s.expect(moved && moved != p && moved > pinned, "older block moves when it must grow");
+    size_t before = scratch_loop.used;
+    json->deallocate(moved);
+    s.expect(scratch_loop.used < before, "newest block released in place");
+
+    unsigned long overflows = scratch_loop.overflows;
+    void* big = json->allocate(SCRATCH_LOOP_SIZE * 2);
+    s.expect(big && scratch_loop.overflows == overflows + 1, "oversized block falls back to the heap");
+    json->deallocate(big);
+    {
+        ScratchScope inner;
+        inner.alloc(64);
+    }
+    s.expect(scratch_loop.used == (size_t)(pinned + 16 - scratch_loop.base), "inner scope rewinds to its mark");
+}
+
+// Switching to mmol/L rebuilds the glucose table once; frames after that
+// are lookups
+static void mmol_units(Scenario& s) {
+    CgmFeed feed;
+    s.serve(feed);
+    s.boot_default();
+    s.run_for(SIM_MIN(2));
+    unsigned long builds = glucose_lut_builds();
+
+    config_get().use_mmol = true;
+    s.run_for(SIM_SEC(30));
+    int mg = http_get_reading().glucose;
+    char value[16];
+    int tenths = (mg * 10000 + 9009) / 18018;
+    snprintf(value, sizeof(value), "%d.%d", tenths / 10, tenths % 10);
+    s.expect(strncmp(sim_display_last_frame(), value, strlen(value)) == 0, "frame shows mmol/L");
+    s.expect(glucose_lut_builds() == builds + 1, "one rebuild for the unit change");
+
+    char delta[8];
+    glucose_lut_format_delta(-6, delta, sizeof(delta));
+    s.expect(strcmp(delta, "-0.3") == 0, "delta in mmol/L");
+    s.expect(strcmp(glucose_lut_get(400).text, "22.2") == 0, "top of range fits");
+    s.expect(strcmp(glucose_lut_get(39).text, "2.2") == 0, "below the table formatted on the spot");
+
+    AppConfig& cfg = config_get();
+    cfg.color_gradient = true;
+    const GlucoseLutEntry& low = glucose_lut_get((cfg.thresh_urgent_low + cfg.thresh_low) / 2);
+    s.expect(glucose_lut_color(low) == low.color, "blend pinned mid-band");
+    const GlucoseLutEntry& mid = glucose_lut_get((cfg.thresh_low + cfg.thresh_high) / 2);
+    s.expect(mid.gradient == mid.color, "in-range solid in the middle");
+    s.expect(glucose_lut_builds() == builds + 2, "one rebuild for the blend setting");
+}
+
+// Heavy thunderstorm on the weather screen: 30 fps, the particle budget
+// fills without overflowing, lightning flashes every few seconds
+static void weather_storm(Scenario& s) {
+    CgmFeed feed;
+    s.serve(feed);
+    s.boot_default();
+    s.run_for(SIM_SEC(10));
+    weather_set_mock(18.0f, "Thunderstorm", 212);
+    WeatherReading wx = weather_get_reading();
+    wx.wind_ms = 10.0f;
+    wx.wind_deg = 90;
+    weather_set_reading(wx);
+    engine_force_state(STATE_WEATHER_DISPLAY);
+    s.step_ms = 1;
+    s.run_for(SIM_SEC(1));
+
+    unsigned long shows = sim_display_show_count();
+    int peak = 0, flashes = 0;
+    for (int i = 0; i < 200; i++) {
+        s.run_for(50);
+        if (weather_fx_count() > peak) peak = weather_fx_count();
+        if (strcmp(sim_display_last_frame(), "<fill>") == 0) flashes++;
+    }
+    unsigned long frames = sim_display_show_count() - shows;
+    s.expect(frames >= 280 && frames <= 320, "about 30 frames per second");
+    s.expect(peak > 32 && peak <= WEATHER_FX_MAX_PARTICLES, "storm fills most of the particle budget");
+    s.expect(flashes >= 2, "lightning flashes");
+    engine_clear_force();
+}
+
+// Fake OpenWeatherMap: current conditions cached for 10 minutes, a forecast
+// warming 3 degrees per 3-hour slot cached for 3 hours
+static SimHttpResponse owm_respond(const SimHttpRequest& req, const CgmFeed& feed) {
+    if (strstr(req.url, "/data/2.5/weather")) {
+        return { 200, "{\"weather\":[{\"id\":800,\"main\":\"Clear\"}],"
+                      "\"main\":{\"temp\":10.0,\"humidity\":60},\"wind\":{\"speed\":3,\"deg\":270}}",
+                 200, { { "Cache-Control", "max-age=600" } } };
+    }
+    if (strstr(req.url, "/data/2.5/forecast")) {
+        unsigned long slot = ((unsigned long)time(nullptr) / 10800 + 1) * 10800;
+        std::string body = "{\"cnt\":16,\"list\":[";
+        for (int i = 0; i < 16; i++) {
+            char item[160];
+            snprintf(item, sizeof(item),
+                     "%s{\"dt\":%lu,\"main\":{\"temp\":%d},\"weather\":[{\"id\":500,\"main\":\"Rain\"}],"
+                     "\"wind\":{\"speed\":5,\"deg\":90}}",
+                     i ? "," : "", slot + i * 10800UL, 13 + 3 * i);
+            body += item;
+        }
+        body += "]}";
+        return { 200, body, 300, { { "Cache-Control", "max-age=10800" } } };
+    }
+    return cgm_respond(feed);
+}
+
+// Weather is fetched only ahead of its screen: nothing while it isn't in
+// rotation or at night, current conditions plus forecast just before it
+// comes up, then the forecast carries it for hours
+static void weather_on_demand(Scenario& s) {
+    CgmFeed feed;
+    sim_http_set_handler([feed](const SimHttpRequest& req) { return owm_respond(req, feed); });
+    s.boot_default();
+    AppConfig& cfg = config_get();
+    cfg.weather_enabled = true;
+    strncpy(cfg.weather_api_key, "simkey", sizeof(cfg.weather_api_key) - 1);
+    s.run_for(SIM_HOUR(1));
+    s.expect(weather_api_call_count() == 0, "no weather requests while the screen is not in rotation");
+
+    // Glucose, trend, time, weather: weather is 30 s away right after a step
+    cfg.auto_cycle_enabled = true;
+    cfg.auto_cycle_sec = 10;
+    bool ready_when_shown = false;
+    for (int i = 0; i < 2000 && engine_get_state() != STATE_WEATHER_DISPLAY; i++) {
+        s.run_for(50);
+        ready_when_shown = weather_has_data();
+    }
+    s.expect(engine_get_state() == STATE_WEATHER_DISPLAY, "auto-cycle reaches the weather screen");
+    s.expect(ready_when_shown, "weather is fetched before its screen comes up");
+    s.expect(weather_api_call_count() == 2, "one current and one forecast request");
+    s.expect(weather_forecast_count() == WEATHER_FORECAST_SLOTS, "forecast slots cached");
+    float first_temp = weather_get_reading().temp;
+
+    s.run_for(SIM_MIN(150));
+    s.expect(weather_api_call_count() == 2, "no requests while the forecast is fresh");
+    s.expect(weather_get_reading().temp > first_temp + 3.0f, "shown temperature follows the forecast");
+    s.expect(strcmp(weather_get_reading().description, "Rain") == 0, "condition follows the forecast");
+
+    s.run_for(SIM_HOUR(6));
+    unsigned long calls = weather_api_call_count();
+    s.expect(calls <= 8, "forecast max-age spaces the requests hours apart");
+
+    // Night mode from now on: the screen still cycles but nobody looks
+    cfg.night_mode_enabled = true;
+    cfg.night_start_hour = time_get_hour();
+    cfg.night_end_hour = (time_get_hour() + 12) % 24;
+    s.run_for(SIM_HOUR(10));
+    s.expect(weather_api_call_count() == calls, "no weather requests during night mode");
+}
+
+// Weather and glucose due together run one per pass, glucose first and a
+// gap apart; a request during a run is answered by it; nothing starts while
+// the heap can't hold another TLS session
+static void net_scheduler(Scenario& s) {
+    CgmFeed feed;
+    std::vector<std::pair<uint64_t, char>> calls;
+    bool rerequest = true;
+    sim_http_set_handler([&](const SimHttpRequest& req) {
+        bool wx = strstr(req.url, "/data/2.5/") != nullptr;
+        calls.push_back({ sim_clock_ms(), wx ? 'W' : 'G' });
+        if (!wx && rerequest) net_sched_request(NET_JOB_GLUCOSE);
+        return owm_respond(req, feed);
+    });
+    s.boot_default();
+    AppConfig& cfg = config_get();
+    cfg.weather_enabled = true;
+    strncpy(cfg.weather_api_key, "simkey", sizeof(cfg.weather_api_key) - 1);
+    s.run_for(SIM_SEC(30));
+
+    calls.clear();
+    unsigned long glucose_runs = net_sched_stats(NET_JOB_GLUCOSE).runs;
+    net_sched_request(NET_JOB_WEATHER);
+    net_sched_request(NET_JOB_GLUCOSE);
+    s.run_for(SIM_SEC(10));
+    s.expect(calls.size() == 3 && calls[0].second == 'G', "glucose goes first");
+    s.expect(calls.size() == 3 && calls[1].first - calls[0].first >= NET_JOB_GAP_MS,
+             "weather starts a gap after glucose");
+    s.expect(calls.size() == 3 && calls[2].first - calls[1].first >= NET_JOB_GAP_MS,
+             "forecast runs on a later pass than the current conditions");
+    s.expect(net_sched_stats(NET_JOB_GLUCOSE).runs == glucose_runs + 1,
+             "request made during the glucose fetch didn't run it again");
+    s.expect(net_sched_stats(NET_JOB_GLUCOSE).coalesced >= 1, "coalesced request counted");
+    rerequest = false;
+
+    // Eat the heap down to below one session's worth
+    std::vector<void*> hog;
+    while (net_sched_sessions_allowed() > 0 && hog.size() < 64) {
+        void* p = malloc(8192);
+        memset(p, 0xA5, 8192);
+        hog.push_back(p);
+    }
+    calls.clear();
+    unsigned long deferred = net_sched_stats(NET_JOB_GLUCOSE).deferred;
+    net_sched_request(NET_JOB_GLUCOSE);
+    s.run_for(SIM_SEC(5));
+    s.expect(net_sched_sessions_allowed() == 0, "heap below the TLS budget");
+    s.expect(calls.empty(), "no fetch without room for a TLS session");
+    s.expect(net_sched_stats(NET_JOB_GLUCOSE).deferred > deferred, "deferral counted");
+
+    for (void* p : hog) free(p);
+    s.run_for(SIM_SEC(5));
+    s.expect(calls.size() == 1, "deferred fetch runs once the heap is back");
+}
+
+// Polls resolve from the cache: the first lookup is the only one a poll
+// waits for, later ones are background refreshes. During a resolver outage
+// the last address keeps the polls going.
+static void dns_cache(Scenario& s) {
+    CgmFeed feed;
+    s.serve(feed);
+    sim_dns_set_latency(300);
+    s.boot_default();
+    s.run_for(SIM_MIN(30));
+    s.expect(dns_cache_count() == 1, "one host cached");
+    s.expect(dns_cache_results(DNS_RESOLVED) == 1, "only the first poll waited on the resolver");
+    s.expect(dns_cache_results(DNS_HIT) >= 25, "later polls hit the cache");
+    s.expect(sim_dns_lookup_count() >= 5, "entry refreshed in the background");
+    s.expect(sim_dns_lookup_count() <= 10, "refreshes spaced by the TTL");
+
+    int failures = http_get_failure_count();
+    unsigned long lookups = sim_dns_lookup_count();
+    sim_dns_set_failing(true);
+    s.run_for(SIM_MIN(30));
+    s.expect(http_get_failure_count() == failures, "polls keep working on the stale address");
+    s.expect(dns_cache_results(DNS_STALE) > 0, "stale address served");
+    s.expect(http_time_since_last_reading() < SIM_MIN(2), "readings stay fresh");
+    s.expect(sim_dns_lookup_count() - lookups <= 70, "failed lookups back off");
+
+    sim_dns_set_failing(false);
+    s.run_for(SIM_MIN(2));
+    DnsCacheEntry e;
+    s.expect(dns_cache_entry(0, &e) && millis() - e.resolved_ms < SIM_MIN(2), "entry refreshed once the resolver is back");
+}
+
+// Every poll's TLS session is accounted to its host: one handshake per
+// fetch, the agreed record size and the suite
+static void tls_hosts(Scenario& s) {
+    CgmFeed feed;
+    s.serve(feed);
+    s.boot_default();
+    s.run_for(SIM_MIN(30));
+    s.expect(tls_host_count() == 1, "one host seen");
+    const TlsHostStats& t = tls_host_stats(0);
+    s.expect(t.handshakes >= 25, "a handshake per poll");
+    s.expect(t.failures == 0, "no failed handshakes");
+    s.expect(t.max_frag == TLS_MAX_FRAG_LEN, "server agreed to small records");
+    s.expect(strstr(t.suite, "ECDHE") != nullptr, "ECDHE suite negotiated");
+
+    unsigned long handshakes = t.handshakes;
+    s.wifi_down_between(sim_clock_ms(), sim_clock_ms() + SIM_MIN(5));
+    s.run_for(SIM_MIN(5));
+    s.expect(t.handshakes == handshakes, "no sessions while the link is down");
+}
+
+// Body as a gzip member, the way a web server's gzip filter sends it
+static std::string gzip_body(const std::string& body) {
+    z_stream z = {};
+    deflateInit2(&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+    std::string out(deflateBound(&z, body.size()), '\0');
+    z.next_in = (Bytef*)body.data();
+    z.avail_in = (uInt)body.size();
+    z.next_out = (Bytef*)&out[0];
+    z.avail_out = (uInt)out.size();
+    deflate(&z, Z_FINISH);
+    out.resize(z.total_out);
+    deflateEnd(&z);
+    return out;
+}
+
+// What the web UI's test button does: force the job, then let the loop run it
+static bool force_fetch(Scenario& s, NetJob job) {
+    uint32_t ticket = net_sched_force(job);
+    for (int i = 0; i < 100; i++) {
+        NetResult res = net_sched_result(job, ticket);
+        if (res != NET_RESULT_PENDING) return res == NET_RESULT_OK;
+        s.run_for(100);
+    }
+    return false;
+}
+
+// Weather and glucose bodies come gzipped when the client offers it, like
+// behind nginx (bodies under 256 bytes stay plain); the fetches get the
+// same data, the forecast over far fewer bytes, and a damaged body is rejected
+static void gzip_bodies(Scenario& s) {
+    static int offered, damaged;
+    offered = damaged = 0;
+    CgmFeed feed;
+    sim_http_set_handler([feed](const SimHttpRequest& req) {
+        SimHttpResponse resp = owm_respond(req, feed);
+        if (strstr(req.accept_encoding, "gzip")) offered++;
+        if (!strstr(req.accept_encoding, "gzip") || resp.code != 200 || resp.body.size() < 256) return resp;
+        resp.body = gzip_body(resp.body);
+        resp.headers["Content-Encoding"] = "gzip";
+        if (damaged) resp.body[resp.body.size() - 6] ^= 0x55;   // CRC-32 in the trailer
+        return resp;
+    });
+    s.boot_default();
+    AppConfig& cfg = config_get();
+    cfg.weather_enabled = true;
+    strncpy(cfg.weather_api_key, "simkey", sizeof(cfg.weather_api_key) - 1);
+    s.run_for(SIM_MIN(10));
+    s.expect(offered > 0, "gzip offered");
+    s.expect(http_get_reading().valid, "glucose from plain small bodies");
+    s.expect(net_body_stats(NET_SRC_SERVER).gzipped == 0, "small bodies not compressed");
+
+    s.expect(force_fetch(s, NET_JOB_WEATHER), "weather fetched");
+    s.expect(force_fetch(s, NET_JOB_FORECAST), "forecast fetched");
+    const NetBodyStats& wx = net_body_stats(NET_SRC_WEATHER);
+    s.expect(weather_forecast_count() == WEATHER_FORECAST_SLOTS, "forecast parsed from the inflated stream");
+    s.expect(wx.gzipped == 1, "forecast came gzipped");
+    s.expect(wx.wire_bytes * 3 < wx.body_bytes, "forecast at under a third of its size on the wire");
+
+    damaged = 1;
+    force_fetch(s, NET_JOB_WEATHER);
+    force_fetch(s, NET_JOB_FORECAST);
+    s.expect(weather_forecast_count() == 0, "forecast with a bad CRC rejected");
+    s.expect(strstr(weather_get_last_response(), "parse error") != nullptr, "rejection reported");
+    damaged = 0;
+
+    cfg.http_gzip = false;
+    offered = 0;
+    s.run_for(SIM_MIN(5));
+    s.expect(force_fetch(s, NET_JOB_WEATHER), "weather fetched without gzip");
+    s.expect(force_fetch(s, NET_JOB_FORECAST), "forecast fetched without gzip");
+    s.expect(offered == 0, "gzip not offered once disabled");
+    s.expect(weather_forecast_count() == WEATHER_FORECAST_SLOTS, "forecast parsed from a plain body");
+    s.expect(wx.gzipped == 2, "no further gzipped bodies");
+}
+
+// A script flooding /api/notify is held to its rate while a dashboard on
+// another address and the flooder's own status polls still get through;
+// responses in flight are capped and a slot that is never released comes back
+// (web_server.cpp isn't in the native build, so this drives admit() directly)
+static void rate_limit(Scenario& s) {
+    const uint32_t script = 0x0A00000A, dashboard = 0x0A000014;
+    int slot;
+    uint32_t retry;
+    rate_limit_init();
+    s.boot_default();
+
+    int admitted = 0, limited = 0;
+    for (int i = 0; i < 100; i++) {
+        Admission a = rate_limit_admit(script, RATE_INGEST, &slot, &retry);
+        if (a == ADMIT_OK) {
+            admitted++;
+            rate_limit_release(slot);
+        } else if (a == ADMIT_LIMITED) {
+            limited++;
+        }
+    }
+    s.expect(admitted == 10, "burst of 10 admitted");
+    s.expect(limited == 90, "rest of the flood limited");
+    s.expect(retry >= 1, "Retry-After given");
+
+    Admission a = rate_limit_admit(dashboard, RATE_INGEST, &slot, &retry);
+    rate_limit_release(slot);
+    s.expect(a == ADMIT_OK, "other client unaffected");
+    a = rate_limit_admit(script, RATE_STATUS, &slot, &retry);
+    rate_limit_release(slot);
+    s.expect(a == ADMIT_OK, "flooder's status polls use their own bucket");
+
+    s.run_for(SIM_SEC(5));
+    admitted = 0;
+    for (int i = 0; i < 20; i++) {
+        if (rate_limit_admit(script, RATE_INGEST, &slot, &retry) == ADMIT_OK) {
+            admitted++;
+            rate_limit_release(slot);
+        }
+    }
+    s.expect(admitted == 10, "2 per second refill");
+
+    // Hold responses open: the cap turns the next one away as busy
+    int held[RATE_INFLIGHT_MAX];
+    int n = 0;
+    while (n < RATE_INFLIGHT_MAX && rate_limit_admit(dashboard, RATE_STATUS, &held[n], &retry) == ADMIT_OK) n++;
+    s.expect(n == rate_limit_inflight_cap(), "admitted up to the in-flight cap");
+    s.expect(rate_limit_admit(dashboard, RATE_STATUS, &slot, &retry) == ADMIT_BUSY, "503 past the cap");
+    rate_limit_release(held[0]);
+    a = rate_limit_admit(dashboard, RATE_STATUS, &slot, &retry);
+    s.expect(a == ADMIT_OK, "admitted once a response finishes");
+
+    s.run_for(RATE_INFLIGHT_TIMEOUT_MS + 1000);
+    s.expect(rate_limit_admit(dashboard, RATE_STATUS, &slot, &retry) == ADMIT_OK, "leaked slots reclaimed");
+    s.expect(rate_limit_inflight() == 1, "only the new response in flight");
+    s.expect(rate_limit_stats(RATE_INGEST).limited >= 90, "limited requests counted");
+    s.expect(rate_limit_stats(RATE_STATUS).busy == 1, "busy rejection counted");
+}
+
+// Saves write only the keys that changed and report their sections; a
+// section's ETag moves only when one of its keys does (the 304/PATCH logic
+// in web_server.cpp compares against these)
+static void config_sections(Scenario& s) {
+    config_init();
+    AppConfig& cfg = config_get();
+    char all0[40], display0[40], wifi0[40], etag[40];
+    config_etag(CFG_ALL, all0, sizeof(all0));
+    config_etag(CFG_BIT(CFG_DISPLAY), display0, sizeof(display0));
+    config_etag(CFG_BIT(CFG_WIFI), wifi0, sizeof(wifi0));
+
+    unsigned long writes = sim_nvs_write_count();
+    s.expect(config_save() == 0, "unchanged save reports no sections");
+    s.expect(sim_nvs_write_count() == writes, "unchanged save writes nothing");
+
+    cfg.brightness = cfg.brightness == 40 ? 41 : 40;
+    uint32_t changed = config_save();
+    s.expect(changed == CFG_BIT(CFG_DISPLAY), "brightness dirties only display");
+    s.expect(sim_nvs_write_count() == writes + 1, "one key written for one field");
+    config_etag(CFG_BIT(CFG_DISPLAY), etag, sizeof(etag));
+    s.expect(strcmp(etag, display0) != 0, "display ETag moved");
+    config_etag(CFG_BIT(CFG_WIFI), etag, sizeof(etag));
+    s.expect(strcmp(etag, wifi0) == 0, "wifi ETag unchanged");
+    config_etag(CFG_ALL, etag, sizeof(etag));
+    s.expect(strcmp(etag, all0) != 0, "full-document ETag moved");
+
+    writes = sim_nvs_write_count();
+    strncpy(cfg.weather_city, "Oslo,NO", sizeof(cfg.weather_city) - 1);
+    cfg.timer_enabled = !cfg.timer_enabled;
+    changed = config_save();
+    s.expect(changed == (CFG_BIT(CFG_WEATHER) | CFG_BIT(CFG_TIMER)), "two sections dirtied");
+    s.expect(sim_nvs_write_count() == writes + 2, "two keys written");
+
+    ConfigSection sec;
+    s.expect(config_section_find("mqtt", &sec) && sec == CFG_MQTT, "section found by name");
+    s.expect(!config_section_find("bogus", &sec), "unknown section rejected");
+
+    // A reboot keeps the settings but not the ETags
+    config_init();
+    config_etag(CFG_BIT(CFG_WIFI), etag, sizeof(etag));
+    s.expect(strcmp(etag, wifi0) != 0, "ETags change across reboots");
+    s.expect(strcmp(config_get().weather_city, "Oslo,NO") == 0, "saved settings reload");
+}
+
+// A bundle as tools/www_pack.py writes it (file contents stored as given)
+static std::vector<uint8_t> www_pack(const std::vector<std::pair<std::string, std::string>>& files) {
+    auto put32 = [](std::vector<uint8_t>& b, size_t at, uint32_t v) {
+        for (int i = 0; i < 4; i++) b[at + i] = (uint8_t)(v >> (8 * i));
+    };
+    size_t offset = 16 + 64 * files.size();
+    std::vector<uint8_t> b(offset, 0);
+    for (size_t i = 0; i < files.size(); i++) {
+        const std::string& path = files[i].first;
+        const std::string& data = files[i].second;
+        while (b.size() % 4) b.push_back(0);
+        size_t e = 16 + 64 * i;
+        memcpy(&b[e], path.c_str(), path.size());
+        put32(b, e + 48, (uint32_t)b.size());
+        put32(b, e + 52, (uint32_t)data.size());
+        put32(b, e + 56, crc32_le(0, (const uint8_t*)data.data(), data.size()));
+        b[e + 60] = path.find(".css") != std::string::npos ? 2 : 1;
+        b[e + 61] = WWW_FLAG_GZIP;
+        b.insert(b.end(), data.begin(), data.end());
+    }
+    put32(b, 0, WWW_MAGIC);
+    b[4] = WWW_VERSION;
+    b[6] = (uint8_t)files.size();
+    put32(b, 8, (uint32_t)b.size());
+    put32(b, 12, crc32_le(0, b.data() + 16, b.size() - 16));
+    return b;
+}
+
+// The web UI is served from the mapped bundle; a missing, erased or
+// damaged partition is refused (the web server then falls back to LittleFS)
+static void www_bundle(Scenario& s) {
+    s.expect(!www_bundle_init(), "no partition, no bundle");
+    sim_partition_set(WWW_PARTITION_LABEL, 0x20000, nullptr, 0);
+    s.expect(!www_bundle_init(), "erased partition refused");
+
+    std::vector<uint8_t> b = www_pack({ { "/index.html", "<html>clock</html>" },
+                                        { "/style.css", "body{}" } });
+    sim_partition_set(WWW_PARTITION_LABEL, 0x20000, b.data(), b.size());
+    s.expect(www_bundle_init(), "bundle mapped");
+    s.expect(www_bundle_count() == 2 && www_bundle_bytes() == b.size(), "index read");
+
+    WwwAsset a;
+    s.expect(www_bundle_find("/", &a) && a.len == 18 && memcmp(a.data, "<html>", 6) == 0, "/ serves index.html");
+    s.expect(strcmp(a.content_type, "text/html") == 0 && a.gzip, "type and encoding from the index");
+    s.expect(www_bundle_find("/style.css", &a) && strcmp(a.content_type, "text/css") == 0, "css found");
+    s.expect(a.crc == crc32_le(0, (const uint8_t*)"body{}", 6), "ETag is the stored CRC");
+    s.expect(!www_bundle_find("/missing.html", &a), "unknown path not found");
+
+    www_bundle_suspend();
+    s.expect(!www_bundle_find("/", &a), "nothing served while suspended");
+
+    b[b.size() - 1] ^= 0x01;
+    sim_partition_set(WWW_PARTITION_LABEL, 0x20000, b.data(), b.size());
+    s.expect(!www_bundle_init(), "damaged bundle refused");
+}
+
+// One request of each kind the web UI and integrations make, calling what
+// the handlers call (web_server.cpp itself isn't part of the native build)
+static void soak_requests(int hour) {
+    AppConfig& cfg = config_get();
+    if (hour % 6 == 0) {
+        cfg.brightness = cfg.brightness == 40 ? 60 : 40;
+        config_save();
+    }
+    char text[32];
+    snprintf(text, sizeof(text), "soak %d", hour);
+    notify_push(text, 10, false);
+    sysmon_push("CPU", (hour * 7) % 100, 100);
+    scrape_metrics(1024);
+
+    GlucoseHistoryEntry entries[GLUCOSE_HISTORY_SIZE];
+    http_get_history(entries, GLUCOSE_HISTORY_SIZE);
+
+    static uint32_t log_seq = 0;
+    LogEntry e;
+    while (logger_next(&log_seq, &e)) {}
+}
+
+// Two weeks of polls, daily server and transport outages, WiFi drops every
+// third day and hourly requests: the heap must not creep once warmed up
+static void soak_two_weeks(Scenario& s) {
+    const int days = 14;
+    CgmFeed feed;
+    for (int d = 0; d < days; d++) {
+        uint64_t day = SIM_HOUR(24) * d;
+        feed.outages.push_back({ day + SIM_HOUR(3), day + SIM_HOUR(3) + SIM_MIN(8), 500 });
+        feed.outages.push_back({ day + SIM_HOUR(15), day + SIM_HOUR(15) + SIM_MIN(25), HTTPC_ERROR_CONNECTION_REFUSED });
+        if (d % 3 == 2) s.wifi_down_between(day + SIM_HOUR(20), day + SIM_HOUR(20) + SIM_MIN(10));
+    }
+    s.serve(feed);
+    s.step_ms = 200;
+    s.boot_default();
+
+    uint32_t warm_free = 0;
+    size_t warm_changes = 0;
+    for (int h = 0; h < days * 24; h++) {
+        s.run_for(SIM_HOUR(1));
+        soak_requests(h);
+        if (h == 47) {
+            warm_free = ESP.getFreeHeap();
+            warm_changes = s.changes().capacity();
+        }
+    }
+
+    // The harness's own state log grows with every display change; leave it out
+    long harness = (long)((s.changes().capacity() - warm_changes) * sizeof(StateChange));
+    long growth = (long)warm_free - (long)ESP.getFreeHeap() - harness;
+    char what[64];
+    snprintf(what, sizeof(what), "heap after day 2 vs day 14 within 1 KB (%ld B)", growth);
+    s.expect(growth < 1024, what);
+
+    s.expect(health_sample_count() == HEALTH_RING_SLOTS, "health ring full");
+    HealthSample first, last, boot;
+    health_get_sample(0, &first);
+    health_get_sample(HEALTH_RING_SLOTS - 1, &last);
+    s.expect(last.uptime_sec - first.uptime_sec == (HEALTH_RING_SLOTS - 1) * HEALTH_SAMPLE_MS / 1000,
+             "samples evenly spaced, oldest first");
+    s.expect(health_get_boot_sample(&boot) && boot.uptime_sec < 600, "boot sample kept after wrap");
+    s.expect(last.largest_block <= last.free_heap && last.min_free_heap <= last.free_heap, "heap figures consistent");
+    s.expect(sim_http_request_count() > (unsigned long)days * 24 * 50, "polled throughout");
+}
+
+const ScenarioDef SCENARIOS[] = {
+    { "boot_to_glucose",  "cold boot, marquee, first reading",               boot_to_glucose },
+    { "day_with_outages", "24 h with server errors, NO DATA and a WiFi drop", day_with_outages },
+    { "auto_cycle",       "auto-cycle through glucose, trend and time",       auto_cycle },
+    { "alert_snooze",     "high alert beeps, snooze silences for 15 min",     alert_snooze },
+    { "pomodoro",         "two-session pomodoro with long break",             pomodoro },
+    { "notify_expiry",    "notification preempts and expires",                notify_expiry },
+    { "warm_restart",     "soft reset shows cached reading without WiFi",     warm_restart },
+    { "notify_burst",     "20 queued notifications rotate, urgent first",     notify_burst },
+    { "lan_follower",     "follow a LAN leader, take over when it goes quiet", lan_follower },
+    { "improv_provisioning", "web-installer WiFi setup fails, then succeeds", improv_provisioning },
+    { "metrics_scrape",   "Prometheus exposition after an outage",           metrics_scrape },
+    { "log_ring",         "log ring wraps, late reader gets newest lines",    log_ring },
+    { "scratch_arena",    "fetch scratch rewinds, JSON blocks grow in place", scratch_arena },
+    { "mmol_units",       "mmol/L on the matrix, glucose table rebuilt once", mmol_units },
+    { "weather_storm",    "30 fps storm animation within the particle budget", weather_storm },
+    { "weather_on_demand", "weather fetched just ahead of its screen, forecast cached", weather_on_demand },
+    { "net_scheduler",    "outbound fetches prioritized, staggered and within the TLS budget", net_scheduler },
+    { "dns_cache",        "polls resolve from the cache and survive a resolver outage", dns_cache },
+    { "tls_hosts",        "per-host TLS handshake and heap accounting",       tls_hosts },
+    { "gzip_bodies",      "gzip bodies inflated into the parser, bytes saved per source", gzip_bodies },
+    { "rate_limit",       "per-client buckets and in-flight cap on the web API", rate_limit },
+    { "config_sections",  "config saves write dirty keys only, per-section ETags", config_sections },
+    { "www_bundle",       "web UI served from the mapped bundle partition",   www_bundle },
+    { "soak_two_weeks",   "two weeks of polls, outages and requests, no heap creep", soak_two_weeks },
+};
+
+const int SCENARIO_COUNT = sizeof(SCENARIOS) / sizeof(SCENARIOS[0]);
@@ -0,0 +1,202 @@
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+// ============================================
+// Minimal Arduino core shim for the host simulation build.
+// Time comes from the virtual clock in sim_clock, so the engines run
+// unmodified against millis() while scenarios advance time at will.
+// ============================================
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <strings.h>
+#include <limits.h>
+#include <math.h>
+#include <time.h>
+#include <sys/time.h>
+#include <string>
+#include <algorithm>
+#include <type_traits>
+
+#include "sim_clock.h"
+
+#define IRAM_ATTR
+#define RTC_NOINIT_ATTR
+#define RTC_DATA_ATTR
+#define PROGMEM
+
+#define LOW     0
+#define HIGH    1
+#define INPUT   0x01
+#define OUTPUT  0x03
+#define INPUT_PULLUP 0x05
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+// --- Time ---
+inline unsigned long millis() { return (unsigned long)sim_clock_ms(); }
+inline unsigned long micros() { return (unsigned long)(sim_clock_ms() * 1000ULL); }
+inline void delay(unsigned long ms) { sim_clock_advance(ms); }
+inline void yield() {}
+
+// --- Math helpers (Arduino defines these as macros; templates avoid double evaluation) ---
+template <typename A, typename B>
+inline typename std::common_type<A, B>::type min(A a, B b) { return (b < a) ? b : a; }
+template <typename A, typename B>
+inline typename std::common_type<A, B>::type max(A a, B b) { return (a < b) ? b : a; }
+template <typename T, typename L, typename H>
+inline T constrain(T x, L lo, H hi) { return x < (T)lo ? (T)lo : (x > (T)hi ? (T)hi : x); }
+inline long map(long x, long in_min, long in_max, long out_min, long out_max) {
+    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+// --- Deterministic PRNG (scenarios must replay identically) ---
+void randomSeed(unsigned long seed);
+long random(long max_exclusive);
+long random(long min_inclusive, long max_exclusive);
+
+// --- GPIO / ADC / LEDC ---
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t val);
+int analogRead(uint8_t pin);
+inline void analogReadResolution(uint8_t) {}
+enum adc_attenuation_t { ADC_0db, ADC_2_5db, ADC_6db, ADC_11db };
+inline void analogSetAttenuation(adc_attenuation_t) {}
+double ledcSetup(uint8_t channel, double freq, uint8_t resolution_bits);
+void ledcAttachPin(uint8_t pin, uint8_t channel);
+void ledcWrite(uint8_t channel, uint32_t duty);
+
+// --- String (subset used by the firmware) ---
+class String {
+public:
+    String() {}
+    String(const char* s) : s_(s ? s : "") {}
+    String(const std::string& s) : s_(s) {}
+    String(int v) : s_(std::to_string(v)) {}
+    String(unsigned int v) : s_(std::to_string(v)) {}
+    String(long v) : s_(std::to_string(v)) {}
+    String(unsigned long v) : s_(std::to_string(v)) {}
+
+    const char* c_str() const { return s_.c_str(); }
+    unsigned int length() const { return (unsigned int)s_.size(); }
+    bool isEmpty() const { return s_.empty(); }
+    void reserve(unsigned int n) { s_.reserve(n); }
+
+    void trim() {
+        size_t a = s_.find_first_not_of(" \t\r\n");
+        size_t b = s_.find_last_not_of(" \t\r\n");
+        s_ = (a == std::string::npos) ? "" : s_.substr(a, b - a + 1);
+    }
+    void replace(const char* from, const char* to) {
+        std::string f(from), t(to);
+        if (f.empty()) return;
+        size_t pos = 0;
+        while ((pos = s_.find(f, pos)) != std::string::npos) {
+            s_.replace(pos, f.size(), t);
+            pos += t.size();
+        }
+    }
+    int indexOf(const char* needle) const {
+        size_t p = s_.find(needle);
+        return p == std::string::npos ? -1 : (int)p;
+    }
+    String substring(unsigned int from, unsigned int to) const { return String(s_.substr(from, to - from)); }
+    String substring(unsigned int from) const { return String(s_.substr(from)); }
+    bool startsWith(const char* p) const { return s_.compare(0, strlen(p), p) == 0; }
+    long toInt() const { return strtol(s_.c_str(), nullptr, 10); }
+
+    String& operator+=(const char* s) { s_ += s; return *this; }
+    String& operator+=(const String& s) { s_ += s.s_; return *this; }
+    String& operator+=(char c) { s_ += c; return *this; }
+    bool concat(const char* s, size_t n) { s_.append(s, n); return true; }
+    bool operator==(const char* s) const { return s_ == s; }
+    bool operator==(const String& s) const { return s_ == s.s_; }
+    bool operator!=(const char* s) const { return s_ != s; }
+    char operator[](unsigned int i) const { return s_[i]; }
+
+    // ArduinoJson's Writer/Reader hooks
+    size_t write(uint8_t c) { s_ += (char)c; return 1; }
+    size_t write(const uint8_t* buf, size_t n) { s_.append((const char*)buf, n); return n; }
+
+private:
+    std::string s_;
+};
+
+inline String operator+(const String& a, const char* b) { String r(a); r += b; return r; }
+inline String operator+(const String& a, const String& b) { String r(a); r += b; return r; }
+
+// --- Stream / Print (for code that reads bodies through a Stream) ---
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buf, size_t n) {
+        size_t i = 0;
+        for (; i < n; i++) write(buf[i]);
+        return i;
+    }
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    virtual size_t readBytes(char* buf, size_t n) {
+        size_t i = 0;
+        while (i < n) {
+            int c = read();
+            if (c < 0) break;
+            buf[i++] = (char)c;
+        }
+        return i;
+    }
+    size_t readBytes(uint8_t* buf, size_t n) { return readBytes((char*)buf, n); }
+    void setTimeout(unsigned long) {}
+};
+
+// --- Serial: log lines go to stdout only when the scenario runner asks for them ---
+class SimSerial : public Stream {
+public:
+    void begin(unsigned long) {}
+    size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+    size_t println(const char* s = "");
+    size_t println(const String& s) { return println(s.c_str()); }
+    size_t print(const char* s);
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buf, size_t n) override;
+    int available() override;
+    int read() override;
+    int peek() override;
+    void flush() {}
+    int availableForWrite() { return 128; }
+    operator bool() const { return true; }
+};
+extern SimSerial Serial;
+
+// --- ESP object ---
+class SimEsp {
+public:
+    uint32_t getFreeHeap();
+    uint32_t getMinFreeHeap();
+    uint32_t getMaxAllocHeap();
+    uint32_t getHeapSize() { return 327680; }
+    uint32_t getCycleCount();
+    uint64_t getEfuseMac() { return 0x010C5C0200ULL << 8; }
+    void restart();
+};
+extern SimEsp ESP;
+
+inline uint32_t getCpuFrequencyMhz() { return 240; }
+
+// --- Wall clock (driven by the virtual clock once "NTP" has synced) ---
+bool getLocalTime(struct tm* info, uint32_t ms = 5000);
+void configTzTime(const char* tz, const char* server1, const char* server2 = nullptr, const char* server3 = nullptr);
+
+#endif // SIM_ARDUINO_H
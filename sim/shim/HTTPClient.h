@@ -0,0 +1,82 @@
+#ifndef SIM_HTTP_CLIENT_H
+#define SIM_HTTP_CLIENT_H
+
+#include <Arduino.h>
+#include <WiFiClientSecure.h>
+#include <map>
+
+#define HTTP_CODE_OK                    200
+#define HTTP_CODE_NOT_MODIFIED          304
+#define HTTP_CODE_INTERNAL_SERVER_ERROR 500
+#define HTTPC_ERROR_CONNECTION_REFUSED  (-1)
+#define HTTPC_ERROR_READ_TIMEOUT        (-11)
+
+// Request/response pair handed to the scenario's fake server
+struct SimHttpRequest {
+    const char* method;
+    const char* url;
+    const char* body;
+    const char* accept_encoding;   // "" unless the client offered one
+};
+
+struct SimHttpResponse {
+    int code;                 // HTTP status, or negative HTTPC_ERROR_* for transport failures
+    std::string body;
+    unsigned long latency_ms; // advanced on the virtual clock: the call blocks like the real one
+    std::map<std::string, std::string> headers;   // e.g. {"Cache-Control", "max-age=600"}
+};
+
+// The response body as the raw socket stream (getStreamPtr())
+class SimBodyStream : public Stream {
+public:
+    void reset(const std::string* body) { body_ = body; pos_ = 0; }
+    int available() override { return body_ ? (int)(body_->size() - pos_) : 0; }
+    int read() override { return available() > 0 ? (uint8_t)(*body_)[pos_++] : -1; }
+    int peek() override { return available() > 0 ? (uint8_t)(*body_)[pos_] : -1; }
+    size_t write(uint8_t) override { return 0; }
+
+private:
+    const std::string* body_ = nullptr;
+    size_t pos_ = 0;
+};
+
+// HTTPClient with the same blocking semantics as the ESP32 one; every
+// request is answered by the handler installed with sim_http_set_handler().
+class HTTPClient {
+public:
+    bool begin(WiFiClient& client, const char* url);
+    bool begin(WiFiClient& client, const String& url) { return begin(client, url.c_str()); }
+    void end() {}
+    void setTimeout(uint16_t ms) { timeout_ms_ = ms; }
+    void setConnectTimeout(int32_t) {}
+    void setReuse(bool) {}
+    void useHTTP10(bool) {}
+    void addHeader(const String& name, const String& value) { addHeader(name.c_str(), value.c_str()); }
+    void addHeader(const char* name, const char* value) {
+        if (strcasecmp(name, "Accept-Encoding") == 0) accept_encoding_ = value;
+    }
+    void collectHeaders(const char* keys[], size_t count) { (void)keys; (void)count; }
+    String header(const char* name) {
+        auto it = response_.headers.find(name);
+        return String(it == response_.headers.end() ? "" : it->second.c_str());
+    }
+
+    int GET();
+    int POST(const String& body);
+    int POST(const char* body) { return POST(String(body)); }
+
+    String getString() { return String(response_.body); }
+    Stream* getStreamPtr() { return &body_stream_; }
+    int getSize() { return (int)response_.body.size(); }
+
+private:
+    int send(const char* method, const char* body);
+
+    std::string url_;
+    std::string accept_encoding_;
+    SimBodyStream body_stream_;
+    uint16_t timeout_ms_ = 5000;
+    SimHttpResponse response_ = { 0, "", 0, {} };
+};
+
+#endif // SIM_HTTP_CLIENT_H
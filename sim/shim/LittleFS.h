@@ -0,0 +1,32 @@
+#ifndef SIM_LITTLEFS_H
+#define SIM_LITTLEFS_H
+
+#include <Arduino.h>
+
+// No filesystem image in the simulation: mounts fail and nothing exists
+class File : public Stream {
+public:
+    operator bool() const { return false; }
+    void close() {}
+    size_t size() const { return 0; }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    size_t write(uint8_t) override { return 0; }
+    size_t write(const uint8_t*, size_t) override { return 0; }
+};
+
+class SimLittleFS {
+public:
+    bool begin(bool format_on_fail = false) { (void)format_on_fail; return false; }
+    void end() {}
+    bool exists(const char*) { return false; }
+    File open(const char*, const char* mode = "r") { (void)mode; return File(); }
+    bool remove(const char*) { return false; }
+    size_t usedBytes() { return 0; }
+    size_t totalBytes() { return 0; }
+};
+
+extern SimLittleFS LittleFS;
+
+#endif // SIM_LITTLEFS_H
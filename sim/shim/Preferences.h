@@ -0,0 +1,39 @@
+#ifndef SIM_PREFERENCES_H
+#define SIM_PREFERENCES_H
+
+#include <Arduino.h>
+
+// In-memory NVS. Contents persist across config_init() calls within one
+// process, so scenarios can simulate a reboot with saved settings.
+class Preferences {
+public:
+    bool begin(const char* name, bool read_only = false);
+    void end() {}
+    bool clear();
+    bool remove(const char* key);
+    bool isKey(const char* key);
+
+    size_t putInt(const char* key, int32_t v);
+    size_t putUInt(const char* key, uint32_t v);
+    size_t putUChar(const char* key, uint8_t v);
+    size_t putBool(const char* key, bool v);
+    size_t putULong(const char* key, uint32_t v);
+    size_t putString(const char* key, const char* v);
+    size_t putBytes(const char* key, const void* v, size_t len);
+
+    int32_t getInt(const char* key, int32_t def = 0);
+    uint32_t getUInt(const char* key, uint32_t def = 0);
+    uint8_t getUChar(const char* key, uint8_t def = 0);
+    bool getBool(const char* key, bool def = false);
+    uint32_t getULong(const char* key, uint32_t def = 0);
+    size_t getString(const char* key, char* buf, size_t len);
+    size_t getBytes(const char* key, void* buf, size_t len);
+
+private:
+    std::string ns_;
+};
+
+// Number of NVS writes since start (for scenarios that check write amplification)
+unsigned long sim_nvs_write_count();
+
+#endif // SIM_PREFERENCES_H
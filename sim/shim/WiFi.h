@@ -0,0 +1,91 @@
+#ifndef SIM_WIFI_H
+#define SIM_WIFI_H
+
+#include <Arduino.h>
+#include <vector>
+
+typedef enum {
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum { WIFI_OFF = 0, WIFI_STA = 1, WIFI_AP = 2, WIFI_AP_STA = 3 } wifi_mode_t;
+
+// Event API subset: the sim raises GOT_IP / DISCONNECTED on link changes
+typedef enum {
+    ARDUINO_EVENT_WIFI_STA_DISCONNECTED,
+    ARDUINO_EVENT_WIFI_STA_GOT_IP,
+    ARDUINO_EVENT_MAX
+} arduino_event_id_t;
+
+enum {
+    WIFI_REASON_ASSOC_LEAVE = 8,
+    WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT = 15,
+    WIFI_REASON_NO_AP_FOUND = 201,
+    WIFI_REASON_AUTH_FAIL = 202,
+    WIFI_REASON_HANDSHAKE_TIMEOUT = 204
+};
+
+typedef union {
+    struct { uint8_t reason; } wifi_sta_disconnected;
+} arduino_event_info_t;
+
+typedef void (*WiFiEventFuncCb)(arduino_event_id_t event, arduino_event_info_t info);
+
+class IPAddress {
+public:
+    IPAddress() : b_{0, 0, 0, 0} {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : b_{a, b, c, d} {}
+    IPAddress(uint32_t v) { memcpy(b_, &v, 4); }
+    operator uint32_t() const { uint32_t v; memcpy(&v, b_, 4); return v; }
+    bool fromString(const char* s) {
+        unsigned a, b, c, d;
+        char tail;
+        if (sscanf(s, "%u.%u.%u.%u%c", &a, &b, &c, &d, &tail) != 4) return false;
+        if (a > 255 || b > 255 || c > 255 || d > 255) return false;
+        *this = IPAddress(a, b, c, d);
+        return true;
+    }
+    uint8_t operator[](int i) const { return b_[i]; }
+    uint8_t& operator[](int i) { return b_[i]; }
+    String toString() const {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%u.%u.%u.%u", b_[0], b_[1], b_[2], b_[3]);
+        return String(buf);
+    }
+private:
+    uint8_t b_[4];
+};
+
+// Station/AP radio whose link state is scripted by the scenario
+// (sim_wifi_set_link()); begin() only records the credentials.
+class SimWiFi {
+public:
+    wl_status_t status();
+    bool mode(wifi_mode_t m) { mode_ = m; return true; }
+    wifi_mode_t getMode() const { return mode_; }
+    wl_status_t begin(const char* ssid, const char* pass = nullptr);
+    bool disconnect(bool wifi_off = false) { (void)wifi_off; return true; }
+    bool setAutoReconnect(bool) { return true; }
+    bool softAP(const char*, const char* pass = nullptr) { (void)pass; return true; }
+    bool softAPdisconnect(bool wifi_off = false) { (void)wifi_off; return true; }
+    IPAddress softAPIP() { return IPAddress(192, 168, 4, 1); }
+    int onEvent(WiFiEventFuncCb cb, arduino_event_id_t event = ARDUINO_EVENT_MAX);
+    IPAddress localIP();
+    IPAddress dnsIP(uint8_t i = 0) { (void)i; return IPAddress(192, 168, 1, 1); }
+    int hostByName(const char* host, IPAddress& out);   // 1 on success
+    int8_t RSSI();
+    String macAddress() { return String("02:00:00:5C:0C:01"); }
+    const char* SSID() { return ssid_.c_str(); }
+private:
+    wifi_mode_t mode_ = WIFI_OFF;
+    std::string ssid_;
+};
+
+extern SimWiFi WiFi;
+
+#endif // SIM_WIFI_H
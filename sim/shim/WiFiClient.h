@@ -0,0 +1,17 @@
+#ifndef SIM_WIFI_CLIENT_H
+#define SIM_WIFI_CLIENT_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+
+// Transport placeholders: the fake HTTPClient never touches the socket
+class WiFiClient {
+public:
+    virtual ~WiFiClient() {}
+    void setTimeout(uint32_t) {}
+    int connect(IPAddress, uint16_t, int32_t = 0);   // 1 while the link is up
+    void stop() {}
+    bool connected() { return false; }
+};
+
+#endif // SIM_WIFI_CLIENT_H
@@ -0,0 +1,17 @@
+#ifndef SIM_WIFI_CLIENT_SECURE_H
+#define SIM_WIFI_CLIENT_SECURE_H
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+
+class WiFiClientSecure : public WiFiClient {
+public:
+    void setInsecure() {}
+    int connect(IPAddress ip, uint16_t port, const char*, const char*, const char*, const char*) {
+        return WiFiClient::connect(ip, port);
+    }
+    void setCACert(const char*) {}
+    void setHandshakeTimeout(unsigned long) {}
+};
+
+#endif // SIM_WIFI_CLIENT_SECURE_H
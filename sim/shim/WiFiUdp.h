@@ -0,0 +1,24 @@
+#ifndef SIM_WIFIUDP_H
+#define SIM_WIFIUDP_H
+
+#include <WiFi.h>
+#include <vector>
+
+// Multicast socket on the scripted network: the scenario injects inbound
+// datagrams (sim_udp_inject()) and reads back what the firmware sent.
+class WiFiUDP {
+public:
+    uint8_t beginMulticast(IPAddress group, uint16_t port);
+    void stop() { open_ = false; rx_.clear(); }
+    int parsePacket();
+    int read(uint8_t* buf, size_t len);
+    int beginPacket(IPAddress ip, uint16_t port) { (void)ip; (void)port; tx_.clear(); return 1; }
+    size_t write(const uint8_t* buf, size_t len) { tx_.insert(tx_.end(), buf, buf + len); return len; }
+    int endPacket();
+private:
+    bool open_ = false;
+    std::vector<uint8_t> rx_;
+    std::vector<uint8_t> tx_;
+};
+
+#endif // SIM_WIFIUDP_H
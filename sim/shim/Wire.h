@@ -0,0 +1,20 @@
+#ifndef SIM_WIRE_H
+#define SIM_WIRE_H
+
+#include <stdint.h>
+
+// I2C bus with nothing attached (no DS1307 RTC in the simulation)
+class TwoWire {
+public:
+    bool begin(int sda = -1, int scl = -1) { (void)sda; (void)scl; return true; }
+    void beginTransmission(uint8_t) {}
+    uint8_t endTransmission(bool stop = true) { (void)stop; return 2; } // address NACK
+    size_t write(uint8_t) { return 1; }
+    uint8_t requestFrom(int, int) { return 0; }
+    int available() { return 0; }
+    int read() { return -1; }
+};
+
+extern TwoWire Wire;
+
+#endif // SIM_WIRE_H
@@ -0,0 +1,16 @@
+#ifndef SIM_ROM_CRC_H
+#define SIM_ROM_CRC_H
+
+#include <stdint.h>
+
+// Bit-for-bit equivalent of the ESP32 ROM crc32_le()
+static inline uint32_t crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len) {
+    crc = ~crc;
+    while (len--) {
+        crc ^= *buf++;
+        for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+    }
+    return ~crc;
+}
+
+#endif // SIM_ROM_CRC_H
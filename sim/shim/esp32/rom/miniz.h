@@ -0,0 +1,57 @@
+#ifndef SIM_ROM_MINIZ_H
+#define SIM_ROM_MINIZ_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <zlib.h>
+
+// The ESP32 ROM's tinfl_decompress() on top of host zlib: raw deflate into
+// a caller-owned circular 32 KB window, same status codes
+
+#define TINFL_LZ_DICT_SIZE         32768
+#define TINFL_FLAG_HAS_MORE_INPUT  2
+
+typedef enum {
+    TINFL_STATUS_BAD_PARAM = -3,
+    TINFL_STATUS_ADLER32_MISMATCH = -2,
+    TINFL_STATUS_FAILED = -1,
+    TINFL_STATUS_DONE = 0,
+    TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+    TINFL_STATUS_HAS_MORE_OUTPUT = 2
+} tinfl_status;
+
+struct tinfl_decompressor {
+    z_stream z;
+    bool open;
+};
+
+static inline void tinfl_init(tinfl_decompressor* r) {
+    memset(r, 0, sizeof(*r));
+}
+
+static inline tinfl_status tinfl_decompress(tinfl_decompressor* r, const uint8_t* in, size_t* in_size,
+                                            uint8_t* out_start, uint8_t* out_next, size_t* out_size,
+                                            uint32_t flags) {
+    (void)out_start;
+    if (!r->open) {
+        if (inflateInit2(&r->z, -15) != Z_OK) return TINFL_STATUS_FAILED;
+        r->open = true;
+    }
+    r->z.next_in = (Bytef*)in;
+    r->z.avail_in = (uInt)*in_size;
+    r->z.next_out = out_next;
+    r->z.avail_out = (uInt)*out_size;
+    int ret = inflate(&r->z, Z_NO_FLUSH);
+    *in_size -= r->z.avail_in;
+    *out_size -= r->z.avail_out;
+    if (ret == Z_STREAM_END || (ret != Z_OK && ret != Z_BUF_ERROR)) {
+        inflateEnd(&r->z);
+        r->open = false;
+        return ret == Z_STREAM_END ? TINFL_STATUS_DONE : TINFL_STATUS_FAILED;
+    }
+    if (r->z.avail_out == 0) return TINFL_STATUS_HAS_MORE_OUTPUT;
+    return (flags & TINFL_FLAG_HAS_MORE_INPUT) ? TINFL_STATUS_NEEDS_MORE_INPUT : TINFL_STATUS_FAILED;
+}
+
+#endif // SIM_ROM_MINIZ_H
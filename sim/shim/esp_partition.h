@@ -0,0 +1,50 @@
+#ifndef SIM_ESP_PARTITION_H
+#define SIM_ESP_PARTITION_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Partition lookup and flash mmap, backed by buffers a scenario fills in
+
+typedef int esp_err_t;
+#ifndef ESP_OK
+#define ESP_OK    0
+#define ESP_FAIL  -1
+#endif
+
+typedef enum {
+    ESP_PARTITION_TYPE_APP = 0x00,
+    ESP_PARTITION_TYPE_DATA = 0x01,
+} esp_partition_type_t;
+
+typedef enum {
+    ESP_PARTITION_SUBTYPE_ANY = 0xff,
+} esp_partition_subtype_t;
+
+typedef enum {
+    SPI_FLASH_MMAP_DATA,
+    SPI_FLASH_MMAP_INST,
+} spi_flash_mmap_memory_t;
+
+typedef uint32_t spi_flash_mmap_handle_t;
+
+typedef struct {
+    esp_partition_type_t type;
+    uint8_t subtype;
+    uint32_t address;
+    uint32_t size;
+    char label[17];
+} esp_partition_t;
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char* label);
+esp_err_t esp_partition_mmap(const esp_partition_t* part, size_t offset, size_t size,
+                             spi_flash_mmap_memory_t memory, const void** out_ptr,
+                             spi_flash_mmap_handle_t* out_handle);
+
+// Create a data partition of size bytes holding data, the rest erased
+// (0xFF). Later calls rewrite it in place: like mapped flash, the buffer
+// keeps its address.
+void sim_partition_set(const char* label, uint32_t size, const void* data, size_t len);
+
+#endif // SIM_ESP_PARTITION_H
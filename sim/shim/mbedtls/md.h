@@ -0,0 +1,107 @@
+#ifndef SIM_MBEDTLS_MD_H
+#define SIM_MBEDTLS_MD_H
+
+// Just enough of mbedtls/md.h for HMAC-SHA256 (same digests as the ESP32)
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+typedef enum { MBEDTLS_MD_SHA256 = 6 } mbedtls_md_type_t;
+typedef struct { mbedtls_md_type_t type; } mbedtls_md_info_t;
+
+static inline const mbedtls_md_info_t* mbedtls_md_info_from_type(mbedtls_md_type_t type) {
+    static const mbedtls_md_info_t sha256 = { MBEDTLS_MD_SHA256 };
+    return type == MBEDTLS_MD_SHA256 ? &sha256 : nullptr;
+}
+
+struct SimSha256 {
+    uint32_t h[8];
+    uint8_t buf[64];
+    uint64_t len;
+    size_t fill;
+};
+
+static inline uint32_t sim_sha256_rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+static inline void sim_sha256_block(SimSha256& s, const uint8_t* p) {
+    static const uint32_t K[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+    };
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) w[i] = (uint32_t)p[i * 4] << 24 | p[i * 4 + 1] << 16 | p[i * 4 + 2] << 8 | p[i * 4 + 3];
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = sim_sha256_rotr(w[i - 15], 7) ^ sim_sha256_rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = sim_sha256_rotr(w[i - 2], 17) ^ sim_sha256_rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t a = s.h[0], b = s.h[1], c = s.h[2], d = s.h[3], e = s.h[4], f = s.h[5], g = s.h[6], h = s.h[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = h + (sim_sha256_rotr(e, 6) ^ sim_sha256_rotr(e, 11) ^ sim_sha256_rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+        uint32_t t2 = (sim_sha256_rotr(a, 2) ^ sim_sha256_rotr(a, 13) ^ sim_sha256_rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g; g = f; f = e; e = d + t1; d = c; c = b; b = a; a = t1 + t2;
+    }
+    s.h[0] += a; s.h[1] += b; s.h[2] += c; s.h[3] += d; s.h[4] += e; s.h[5] += f; s.h[6] += g; s.h[7] += h;
+}
+
+static inline void sim_sha256_init(SimSha256& s) {
+    static const uint32_t H0[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+    memcpy(s.h, H0, sizeof(H0));
+    s.len = 0;
+    s.fill = 0;
+}
+
+static inline void sim_sha256_update(SimSha256& s, const uint8_t* p, size_t n) {
+    s.len += n;
+    while (n--) {
+        s.buf[s.fill++] = *p++;
+        if (s.fill == 64) { sim_sha256_block(s, s.buf); s.fill = 0; }
+    }
+}
+
+static inline void sim_sha256_finish(SimSha256& s, uint8_t* out) {
+    uint64_t bits = s.len * 8;
+    uint8_t pad = 0x80;
+    sim_sha256_update(s, &pad, 1);
+    pad = 0;
+    while (s.fill != 56) sim_sha256_update(s, &pad, 1);
+    for (int i = 7; i >= 0; i--) { uint8_t b = bits >> (i * 8); sim_sha256_update(s, &b, 1); }
+    for (int i = 0; i < 8; i++) {
+        out[i * 4] = s.h[i] >> 24; out[i * 4 + 1] = s.h[i] >> 16; out[i * 4 + 2] = s.h[i] >> 8; out[i * 4 + 3] = s.h[i];
+    }
+}
+
+static inline int mbedtls_md_hmac(const mbedtls_md_info_t*, const unsigned char* key, size_t keylen,
+                                  const unsigned char* input, size_t ilen, unsigned char* output) {
+    uint8_t k[64] = { 0 };
+    if (keylen > 64) {
+        SimSha256 s;
+        sim_sha256_init(s);
+        sim_sha256_update(s, key, keylen);
+        sim_sha256_finish(s, k);
+    } else {
+        memcpy(k, key, keylen);
+    }
+    uint8_t pad[64], inner[32];
+    SimSha256 s;
+    for (int i = 0; i < 64; i++) pad[i] = k[i] ^ 0x36;
+    sim_sha256_init(s);
+    sim_sha256_update(s, pad, 64);
+    sim_sha256_update(s, input, ilen);
+    sim_sha256_finish(s, inner);
+    for (int i = 0; i < 64; i++) pad[i] = k[i] ^ 0x5c;
+    sim_sha256_init(s);
+    sim_sha256_update(s, pad, 64);
+    sim_sha256_update(s, inner, 32);
+    sim_sha256_finish(s, output);
+    return 0;
+}
+
+#endif // SIM_MBEDTLS_MD_H
@@ -0,0 +1,19 @@
+#ifndef SIM_CLOCK_H
+#define SIM_CLOCK_H
+
+#include <stdint.h>
+
+// Virtual clock backing millis()/delay() in the host simulation.
+// Nothing advances it implicitly except delay() and the scenario runner,
+// so runs are fully deterministic.
+
+// Current virtual time in milliseconds since simulated power-on
+uint64_t sim_clock_ms();
+
+// Advance virtual time (delay() and blocking fake HTTP calls use this)
+void sim_clock_advance(uint64_t ms);
+
+// Reset virtual time to zero (new scenario)
+void sim_clock_reset();
+
+#endif // SIM_CLOCK_H
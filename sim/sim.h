@@ -0,0 +1,85 @@
+#ifndef SIM_H
+#define SIM_H
+
+// ============================================
+// Host simulation harness: scripted world around the unmodified engines.
+// Everything here is test-side control; firmware code only ever sees the
+// Arduino shim (millis(), WiFi, HTTPClient, ...).
+// ============================================
+
+#include <stdint.h>
+#include <functional>
+#include "sim_clock.h"
+#include <HTTPClient.h>
+#include <esp_system.h>
+
+// --- World reset ---
+
+// Reset clock, radio, fake server, NVS, GPIO and display capture
+void sim_reset();
+
+// --- WiFi ---
+
+// Set whether the access point is reachable (status() follows after begin())
+void sim_wifi_set_link(bool up);
+
+// --- LAN multicast ---
+
+// Queue a datagram for the firmware's multicast socket
+void sim_udp_inject(const uint8_t* data, size_t len);
+
+// Datagrams the firmware sent, and a copy of the last one
+unsigned long sim_udp_sent_count();
+size_t sim_udp_last_sent(uint8_t* out, size_t max_len);
+
+// --- Serial input (bytes the firmware will read from Serial) ---
+void sim_serial_feed(const uint8_t* data, size_t len);
+
+// --- Fake HTTP ---
+
+typedef std::function<SimHttpResponse(const SimHttpRequest&)> SimHttpHandler;
+
+// Install the fake server answering every HTTPClient request
+void sim_http_set_handler(SimHttpHandler handler);
+
+// Number of requests issued since reset
+unsigned long sim_http_request_count();
+
+// --- Fake resolver (WiFi.hostByName) ---
+
+// Make every lookup fail, as during a resolver outage
+void sim_dns_set_failing(bool failing);
+
+// Virtual time each lookup blocks for
+void sim_dns_set_latency(unsigned long ms);
+
+// Lookups issued since reset
+unsigned long sim_dns_lookup_count();
+
+// --- Reset reason reported by esp_reset_reason() ---
+void sim_set_reset_reason(esp_reset_reason_t reason);
+
+// --- Buttons (active LOW) ---
+void sim_button_set(uint8_t pin, bool pressed);
+
+// --- Buzzer: count of beep onsets seen on the LEDC channel ---
+unsigned long sim_buzzer_beep_count();
+
+// --- Display capture ---
+
+// Text drawn in the most recently shown frame, e.g. "120|<trend 2>"
+const char* sim_display_last_frame();
+
+// Number of display_show() calls since reset
+unsigned long sim_display_show_count();
+
+// Number of ESP.restart() requests since reset
+unsigned long sim_restart_count();
+
+// Print firmware Serial output to stdout
+void sim_set_verbose(bool verbose);
+
+// Wall-clock epoch the fake NTP reports at virtual time zero
+void sim_set_epoch_base(uint32_t epoch);
+
+#endif // SIM_H
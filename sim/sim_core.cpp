@@ -0,0 +1,509 @@
+// Implementation of the Arduino shim and the scenario-side controls in sim.h
+#include "sim.h"
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <HTTPClient.h>
+#include <Preferences.h>
+#include <LittleFS.h>
+#include <esp_partition.h>
+#include <Wire.h>
+#include "hardware_pins.h"
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+// --- Virtual clock ---
+
+static uint64_t clock_ms = 0;
+
+uint64_t sim_clock_ms() { return clock_ms; }
+void sim_clock_advance(uint64_t ms) { clock_ms += ms; }
+void sim_clock_reset() { clock_ms = 0; }
+
+// --- World state ---
+
+static bool verbose = false;
+static bool wifi_link_up = true;
+static bool wifi_started = false;
+static bool ntp_configured = false;
+static uint32_t epoch_base = 1767225600; // 2026-01-01 00:00:00 UTC
+static esp_reset_reason_t reset_reason = ESP_RST_POWERON;
+static SimHttpHandler http_handler;
+static unsigned long http_requests = 0;
+static bool dns_failing = false;
+static unsigned long dns_latency_ms = 0;
+static unsigned long dns_lookups = 0;
+static unsigned long restarts = 0;
+static unsigned long nvs_writes = 0;
+static bool button_pressed[40];
+static bool buzzer_on = false;
+static unsigned long buzzer_beeps = 0;
+static uint32_t prng_state = 0x9E3779B9u;
+static std::map<std::string, std::string> nvs;
+static std::deque<uint8_t> serial_rx;
+static std::deque<std::vector<uint8_t>> udp_rx;
+static std::vector<uint8_t> udp_last_tx;
+static unsigned long udp_tx_count = 0;
+
+struct WiFiEventHandler {
+    WiFiEventFuncCb cb;
+    arduino_event_id_t event;
+};
+static std::vector<WiFiEventHandler> wifi_handlers;
+
+void sim_display_reset();
+
+void sim_reset() {
+    clock_ms = 0;
+    wifi_link_up = true;
+    wifi_started = false;
+    ntp_configured = false;
+    reset_reason = ESP_RST_POWERON;
+    http_handler = nullptr;
+    http_requests = 0;
+    dns_failing = false;
+    dns_latency_ms = 0;
+    dns_lookups = 0;
+    restarts = 0;
+    nvs_writes = 0;
+    memset(button_pressed, 0, sizeof(button_pressed));
+    buzzer_on = false;
+    buzzer_beeps = 0;
+    prng_state = 0x9E3779B9u;
+    nvs.clear();
+    serial_rx.clear();
+    udp_rx.clear();
+    udp_last_tx.clear();
+    udp_tx_count = 0;
+    wifi_handlers.clear();
+    sim_display_reset();
+}
+
+static void wifi_raise(arduino_event_id_t event, uint8_t reason) {
+    arduino_event_info_t info = {};
+    info.wifi_sta_disconnected.reason = reason;
+    for (const WiFiEventHandler& h : wifi_handlers) {
+        if (h.event == ARDUINO_EVENT_MAX || h.event == event) h.cb(event, info);
+    }
+}
+
+void sim_wifi_set_link(bool up) {
+    if (up == wifi_link_up) return;
+    wifi_link_up = up;
+    if (!wifi_started || (WiFi.getMode() != WIFI_STA && WiFi.getMode() != WIFI_AP_STA)) return;
+    if (up) wifi_raise(ARDUINO_EVENT_WIFI_STA_GOT_IP, 0);
+    else wifi_raise(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, WIFI_REASON_NO_AP_FOUND);
+}
+
+void sim_udp_inject(const uint8_t* data, size_t len) { udp_rx.emplace_back(data, data + len); }
+unsigned long sim_udp_sent_count() { return udp_tx_count; }
+
+size_t sim_udp_last_sent(uint8_t* out, size_t max_len) {
+    size_t n = udp_last_tx.size() < max_len ? udp_last_tx.size() : max_len;
+    memcpy(out, udp_last_tx.data(), n);
+    return n;
+}
+
+void sim_serial_feed(const uint8_t* data, size_t len) { serial_rx.insert(serial_rx.end(), data, data + len); }
+void sim_http_set_handler(SimHttpHandler handler) { http_handler = handler; }
+unsigned long sim_http_request_count() { return http_requests; }
+void sim_dns_set_failing(bool failing) { dns_failing = failing; }
+void sim_dns_set_latency(unsigned long ms) { dns_latency_ms = ms; }
+unsigned long sim_dns_lookup_count() { return dns_lookups; }
+void sim_set_reset_reason(esp_reset_reason_t reason) { reset_reason = reason; }
+void sim_button_set(uint8_t pin, bool pressed) { if (pin < 40) button_pressed[pin] = pressed; }
+unsigned long sim_buzzer_beep_count() { return buzzer_beeps; }
+unsigned long sim_restart_count() { return restarts; }
+void sim_set_verbose(bool v) { verbose = v; }
+void sim_set_epoch_base(uint32_t epoch) { epoch_base = epoch; }
+unsigned long sim_nvs_write_count() { return nvs_writes; }
+
+esp_reset_reason_t esp_reset_reason() { return reset_reason; }
+
+// --- PRNG (xorshift32, seeded per reset so scenarios replay exactly) ---
+
+void randomSeed(unsigned long seed) { prng_state = seed ? (uint32_t)seed : 1u; }
+
+static uint32_t prng_next() {
+    uint32_t x = prng_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    prng_state = x;
+    return x;
+}
+
+long random(long max_exclusive) {
+    if (max_exclusive <= 0) return 0;
+    return (long)(prng_next() % (uint32_t)max_exclusive);
+}
+
+long random(long min_inclusive, long max_exclusive) {
+    if (max_exclusive <= min_inclusive) return min_inclusive;
+    return min_inclusive + random(max_exclusive - min_inclusive);
+}
+
+// --- GPIO / ADC / LEDC ---
+
+void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t, uint8_t) {}
+
+int digitalRead(uint8_t pin) {
+    return (pin < 40 && button_pressed[pin]) ? LOW : HIGH;
+}
+
+int analogRead(uint8_t pin) {
+    if (pin == PIN_LDR) return 2048;
+    if (pin == PIN_BATTERY) return 2300;
+    return 0;
+}
+
+double ledcSetup(uint8_t, double freq, uint8_t) { return freq; }
+void ledcAttachPin(uint8_t, uint8_t) {}
+
+void ledcWrite(uint8_t, uint32_t duty) {
+    bool on = duty > 0;
+    if (on && !buzzer_on) buzzer_beeps++;
+    buzzer_on = on;
+}
+
+// --- Serial ---
+
+SimSerial Serial;
+
+size_t SimSerial::printf(const char* fmt, ...) {
+    char buf[512];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    if (verbose) fprintf(stdout, "%8.3f %s", clock_ms / 1000.0, buf);
+    return n > 0 ? (size_t)n : 0;
+}
+
+size_t SimSerial::println(const char* s) {
+    if (verbose) fprintf(stdout, "%8.3f %s\n", clock_ms / 1000.0, s);
+    return strlen(s) + 1;
+}
+
+size_t SimSerial::print(const char* s) {
+    if (verbose) fputs(s, stdout);
+    return strlen(s);
+}
+
+size_t SimSerial::write(uint8_t) { return 1; }
+size_t SimSerial::write(const uint8_t*, size_t n) { return n; }
+int SimSerial::available() { return (int)serial_rx.size(); }
+
+int SimSerial::read() {
+    if (serial_rx.empty()) return -1;
+    uint8_t b = serial_rx.front();
+    serial_rx.pop_front();
+    return b;
+}
+
+int SimSerial::peek() { return serial_rx.empty() ? -1 : serial_rx.front(); }
+
+// --- ESP ---
+
+SimEsp ESP;
+
+// Device heap model: whatever the firmware holds on the host heap beyond
+// what it held at the first query comes off a 200 KB heap, so leaks show
+// up as falling free heap. Free chunks stranded inside glibc's arena stand
+// in for fragmentation. Without glibc the figures stay fixed.
+#define SIM_HEAP_FREE 200000
+
+static size_t heap_baseline = 0;
+static uint32_t heap_min_free = SIM_HEAP_FREE;
+
+uint32_t SimEsp::getFreeHeap() {
+#ifdef __GLIBC__
+    struct mallinfo2 mi = mallinfo2();
+    if (heap_baseline == 0) heap_baseline = mi.uordblks;
+    long used = (long)mi.uordblks - (long)heap_baseline;
+    if (used < 0) used = 0;
+    if (used > SIM_HEAP_FREE) used = SIM_HEAP_FREE;
+    uint32_t free_heap = SIM_HEAP_FREE - (uint32_t)used;
+#else
+    uint32_t free_heap = SIM_HEAP_FREE;
+#endif
+    if (free_heap < heap_min_free) heap_min_free = free_heap;
+    return free_heap;
+}
+
+uint32_t SimEsp::getMinFreeHeap() {
+    getFreeHeap();
+    return heap_min_free;
+}
+
+uint32_t SimEsp::getMaxAllocHeap() {
+    uint32_t free_heap = getFreeHeap();
+#ifdef __GLIBC__
+    struct mallinfo2 mi = mallinfo2();
+    size_t stranded = mi.fordblks > mi.keepcost ? mi.fordblks - mi.keepcost : 0;
+    return stranded < free_heap ? free_heap - (uint32_t)stranded : 0;
+#else
+    return free_heap * 3 / 4;
+#endif
+}
+
+uint32_t SimEsp::getCycleCount() {
+    // 240 MHz equivalent of the host's monotonic clock
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 240000000ULL + (uint64_t)ts.tv_nsec * 240ULL / 1000ULL);
+}
+
+void SimEsp::restart() { restarts++; }
+
+// --- Wall clock ---
+
+// Interposes libc's time(): the ESP32 system clock keeps counting across
+// soft resets, and before the first NTP sync it counts up from zero.
+extern "C" time_t time(time_t* out) {
+    time_t now = (time_t)(clock_ms / 1000);
+    if (ntp_configured) now += (time_t)epoch_base;
+    if (out) *out = now;
+    return now;
+}
+
+bool getLocalTime(struct tm* info, uint32_t) {
+    if (!ntp_configured) return false;
+    time_t now = time(nullptr);
+    localtime_r(&now, info);
+    return true;
+}
+
+void configTzTime(const char* tz, const char*, const char*, const char*) {
+    setenv("TZ", tz ? tz : "UTC0", 1);
+    tzset();
+    if (wifi_link_up) ntp_configured = true;
+}
+
+// --- WiFi ---
+
+SimWiFi WiFi;
+
+wl_status_t SimWiFi::status() {
+    if (mode_ != WIFI_STA && mode_ != WIFI_AP_STA) return WL_DISCONNECTED;
+    if (!wifi_started) return WL_IDLE_STATUS;
+    return wifi_link_up ? WL_CONNECTED : WL_DISCONNECTED;
+}
+
+wl_status_t SimWiFi::begin(const char* ssid, const char*) {
+    ssid_ = ssid ? ssid : "";
+    wifi_started = true;
+    if (status() == WL_CONNECTED) wifi_raise(ARDUINO_EVENT_WIFI_STA_GOT_IP, 0);
+    return status();
+}
+
+int SimWiFi::onEvent(WiFiEventFuncCb cb, arduino_event_id_t event) {
+    wifi_handlers.push_back({ cb, event });
+    return (int)wifi_handlers.size();
+}
+
+IPAddress SimWiFi::localIP() {
+    return status() == WL_CONNECTED ? IPAddress(192, 168, 1, 50) : IPAddress();
+}
+
+// Every host resolves to a fixed address derived from its name
+int SimWiFi::hostByName(const char* host, IPAddress& out) {
+    dns_lookups++;
+    clock_ms += dns_latency_ms;
+    if (!wifi_link_up || dns_failing) return 0;
+    uint32_t h = 2166136261u;
+    for (const char* p = host; *p; p++) h = (h ^ (uint8_t)*p) * 16777619u;
+    out = IPAddress(10, (h >> 16) & 0xFF, (h >> 8) & 0xFF, (h & 0xFE) | 1);
+    return 1;
+}
+
+int WiFiClient::connect(IPAddress, uint16_t, int32_t) { return wifi_link_up ? 1 : 0; }
+
+int8_t SimWiFi::RSSI() { return status() == WL_CONNECTED ? -55 : 0; }
+
+// --- UDP ---
+
+uint8_t WiFiUDP::beginMulticast(IPAddress, uint16_t) {
+    open_ = WiFi.status() == WL_CONNECTED;
+    return open_;
+}
+
+int WiFiUDP::parsePacket() {
+    // Datagrams sent while the link was down are simply lost
+    if (!open_ || !wifi_link_up || udp_rx.empty()) return 0;
+    rx_ = udp_rx.front();
+    udp_rx.pop_front();
+    return (int)rx_.size();
+}
+
+int WiFiUDP::read(uint8_t* buf, size_t len) {
+    size_t n = rx_.size() < len ? rx_.size() : len;
+    memcpy(buf, rx_.data(), n);
+    rx_.clear();
+    return (int)n;
+}
+
+int WiFiUDP::endPacket() {
+    if (!open_ || !wifi_link_up) return 0;
+    udp_last_tx = tx_;
+    udp_tx_count++;
+    return 1;
+}
+
+// --- HTTPClient ---
+
+bool HTTPClient::begin(WiFiClient&, const char* url) {
+    url_ = url ? url : "";
+    return !url_.empty();
+}
+
+int HTTPClient::GET() { return send("GET", ""); }
+int HTTPClient::POST(const String& body) { return send("POST", body.c_str()); }
+
+int HTTPClient::send(const char* method, const char* body) {
+    http_requests++;
+    if (!wifi_link_up || !http_handler) {
+        response_ = { HTTPC_ERROR_CONNECTION_REFUSED, "", 0, {} };
+        return response_.code;
+    }
+    SimHttpRequest req = { method, url_.c_str(), body, accept_encoding_.c_str() };
+    response_ = http_handler(req);
+    if (response_.latency_ms > timeout_ms_) {
+        clock_ms += timeout_ms_;
+        response_ = { HTTPC_ERROR_READ_TIMEOUT, "", timeout_ms_, {} };
+    } else {
+        clock_ms += response_.latency_ms;
+    }
+    body_stream_.reset(&response_.body);
+    return response_.code;
+}
+
+// --- Preferences (flat map, "namespace/key" -> raw bytes) ---
+
+static std::string nvs_key(const std::string& ns, const char* key) { return ns + "/" + key; }
+
+template <typename T>
+static size_t nvs_put(const std::string& ns, const char* key, const T& v) {
+    nvs[nvs_key(ns, key)] = std::string((const char*)&v, sizeof(T));
+    nvs_writes++;
+    return sizeof(T);
+}
+
+template <typename T>
+static T nvs_get(const std::string& ns, const char* key, T def) {
+    auto it = nvs.find(nvs_key(ns, key));
+    if (it == nvs.end() || it->second.size() != sizeof(T)) return def;
+    T v;
+    memcpy(&v, it->second.data(), sizeof(T));
+    return v;
+}
+
+bool Preferences::begin(const char* name, bool) { ns_ = name; return true; }
+
+bool Preferences::clear() {
+    std::string prefix = ns_ + "/";
+    for (auto it = nvs.begin(); it != nvs.end();) {
+        if (it->first.compare(0, prefix.size(), prefix) == 0) it = nvs.erase(it);
+        else ++it;
+    }
+    return true;
+}
+
+bool Preferences::remove(const char* key) { return nvs.erase(nvs_key(ns_, key)) > 0; }
+bool Preferences::isKey(const char* key) { return nvs.count(nvs_key(ns_, key)) > 0; }
+
+size_t Preferences::putInt(const char* key, int32_t v) { return nvs_put(ns_, key, v); }
+size_t Preferences::putUInt(const char* key, uint32_t v) { return nvs_put(ns_, key, v); }
+size_t Preferences::putUChar(const char* key, uint8_t v) { return nvs_put(ns_, key, v); }
+size_t Preferences::putBool(const char* key, bool v) { return nvs_put(ns_, key, (uint8_t)v); }
+size_t Preferences::putULong(const char* key, uint32_t v) { return nvs_put(ns_, key, v); }
+
+size_t Preferences::putString(const char* key, const char* v) {
+    nvs[nvs_key(ns_, key)] = std::string(v ? v : "");
+    nvs_writes++;
+    return strlen(v ? v : "");
+}
+
+size_t Preferences::putBytes(const char* key, const void* v, size_t len) {
+    nvs[nvs_key(ns_, key)] = std::string((const char*)v, len);
+    nvs_writes++;
+    return len;
+}
+
+int32_t Preferences::getInt(const char* key, int32_t def) { return nvs_get(ns_, key, def); }
+uint32_t Preferences::getUInt(const char* key, uint32_t def) { return nvs_get(ns_, key, def); }
+uint8_t Preferences::getUChar(const char* key, uint8_t def) { return nvs_get(ns_, key, def); }
+bool Preferences::getBool(const char* key, bool def) { return nvs_get(ns_, key, (uint8_t)def) != 0; }
+uint32_t Preferences::getULong(const char* key, uint32_t def) { return nvs_get(ns_, key, def); }
+
+size_t Preferences::getString(const char* key, char* buf, size_t len) {
+    auto it = nvs.find(nvs_key(ns_, key));
+    if (it == nvs.end() || len == 0) return 0;
+    size_t n = std::min(len - 1, it->second.size());
+    memcpy(buf, it->second.data(), n);
+    buf[n] = '\0';
+    return n;
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t len) {
+    auto it = nvs.find(nvs_key(ns_, key));
+    if (it == nvs.end()) return 0;
+    size_t n = std::min(len, it->second.size());
+    memcpy(buf, it->second.data(), n);
+    return n;
+}
+
+// --- Flash partitions ---
+
+struct SimPartition {
+    esp_partition_t info;
+    std::vector<uint8_t> flash;
+};
+
+static std::map<std::string, SimPartition> partitions;
+
+void sim_partition_set(const char* label, uint32_t size, const void* data, size_t len) {
+    SimPartition& p = partitions[label];
+    if (p.flash.empty()) {
+        p.info.type = ESP_PARTITION_TYPE_DATA;
+        p.info.subtype = 0x40;
+        p.info.address = 0x3E0000;
+        p.info.size = size;
+        strncpy(p.info.label, label, sizeof(p.info.label) - 1);
+        p.flash.resize(size);
+    }
+    memset(p.flash.data(), 0xFF, p.flash.size());
+    memcpy(p.flash.data(), data, std::min(len, p.flash.size()));
+}
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char* label) {
+    (void)subtype;
+    auto it = partitions.find(label ? label : "");
+    if (it == partitions.end() || it->second.info.type != type) return nullptr;
+    return &it->second.info;
+}
+
+esp_err_t esp_partition_mmap(const esp_partition_t* part, size_t offset, size_t size,
+                             spi_flash_mmap_memory_t memory, const void** out_ptr,
+                             spi_flash_mmap_handle_t* out_handle) {
+    (void)memory;
+    auto it = partitions.find(part->label);
+    if (it == partitions.end() || offset + size > it->second.flash.size()) return ESP_FAIL;
+    *out_ptr = it->second.flash.data() + offset;
+    *out_handle = 1;
+    return ESP_OK;
+}
+
+// --- Peripherals with nothing attached ---
+
+SimLittleFS LittleFS;
+TwoWire Wire;
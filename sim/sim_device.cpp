@@ -0,0 +1,63 @@
+#include "sim_device.h"
+#include "config_manager.h"
+#include "display.h"
+#include "glucose_engine.h"
+#include "buttons.h"
+#include "wifi_manager.h"
+#include "time_engine.h"
+#include "sensors.h"
+#include "http_client.h"
+#include "net_scheduler.h"
+#include "dns_cache.h"
+#include "buzzer.h"
+#include "feature_modules.h"
+#include "lan_share.h"
+#include "health_monitor.h"
+#include <Arduino.h>
+
+// On hardware the bootloader and core init run before setup(), so millis()
+// is never zero there; several modules use 0 as "not yet" sentinel
+#define SIM_BOOT_MS 250
+
+void sim_device_setup() {
+    delay(SIM_BOOT_MS);
+    health_init();
+    buzzer_init();
+    config_init();
+    display_init();
+    buttons_init();
+    wifi_init();
+    time_init();
+    sensors_init();
+    net_sched_init();
+    dns_cache_init();
+    http_init();
+    lan_share_init();
+    features_init();
+    engine_init();
+}
+
+void sim_device_loop() {
+    wifi_loop();
+    lan_share_loop();
+    http_loop();
+    dns_cache_loop();
+    net_sched_loop();
+    time_loop();
+
+    // Scenarios drive engine actions directly; drain the event so it doesn't linger
+    buttons_loop();
+    buttons_get_event();
+
+    sensors_loop();
+    AppConfig& cfg = config_get();
+    if (cfg.auto_brightness) {
+        display_set_brightness(sensors_get_auto_brightness());
+    }
+
+    features_loop(micros());
+    buzzer_loop();
+    health_loop();
+
+    engine_loop();
+}
@@ -0,0 +1,13 @@
+#ifndef SIM_DEVICE_H
+#define SIM_DEVICE_H
+
+// The firmware's setup()/loop() sequence minus the parts that need real
+// hardware (watchdog, web server, LED driver).
+
+// Bring up all engines in the same order as setup()
+void sim_device_setup();
+
+// One pass of the main loop
+void sim_device_loop();
+
+#endif // SIM_DEVICE_H
@@ -0,0 +1,103 @@
+// Host replacement for display.cpp: records what each frame would show
+// instead of driving the LED matrix.
+#include "display.h"
+#include "hardware_pins.h"
+#include "metrics.h"
+#include "sim.h"
+
+#include <string>
+#include <stdio.h>
+
+static uint16_t pixels[MATRIX_NUM_LEDS];
+static std::string frame_text;
+static std::string last_frame;
+static unsigned long show_count = 0;
+static uint8_t current_brightness = 40;
+
+static void note(const std::string& item) {
+    if (!frame_text.empty()) frame_text += "|";
+    frame_text += item;
+}
+
+void sim_display_reset() {
+    memset(pixels, 0, sizeof(pixels));
+    frame_text.clear();
+    last_frame.clear();
+    show_count = 0;
+    current_brightness = 40;
+}
+
+const char* sim_display_last_frame() { return last_frame.c_str(); }
+unsigned long sim_display_show_count() { return show_count; }
+
+void display_init() { sim_display_reset(); }
+
+void display_clear() {
+    memset(pixels, 0, sizeof(pixels));
+    frame_text.clear();
+}
+
+void display_show() {
+    last_frame = frame_text;
+    show_count++;
+    metrics_inc(METRIC_LED_PUSHES);
+}
+
+void display_set_brightness(uint8_t brightness) { current_brightness = brightness; }
+uint8_t display_get_brightness() { return current_brightness; }
+
+uint16_t display_color(uint8_t r, uint8_t g, uint8_t b) {
+    return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+}
+
+void display_draw_pixel(int x, int y, uint16_t color) {
+    if (x >= 0 && x < MATRIX_WIDTH && y >= 0 && y < MATRIX_HEIGHT) {
+        pixels[y * MATRIX_WIDTH + x] = color;
+    }
+}
+
+void display_flash(uint8_t r, uint8_t g, uint8_t b) {
+    display_fill(r, g, b);
+}
+
+void display_fill(uint8_t r, uint8_t g, uint8_t b) {
+    uint16_t c = display_color(r, g, b);
+    for (int i = 0; i < MATRIX_NUM_LEDS; i++) pixels[i] = c;
+    frame_text = "<fill>";
+    display_show();
+}
+
+void display_draw_text(const char* text, int x, int y, uint16_t color) {
+    (void)x; (void)y; (void)color;
+    note(text);
+}
+
+void display_draw_glucose(const char* text, int text_width, uint16_t color) {
+    (void)text_width; (void)color;
+    display_clear();
+    note(text);
+}
+
+void display_draw_trend(int trend, int x, int y, uint16_t color) {
+    (void)x; (void)y; (void)color;
+    if (trend < 0 || trend > 4) return;
+    note("<trend " + std::to_string(trend) + ">");
+}
+
+void display_draw_time(int hour, int minute, bool show_colon, bool use_24h, uint16_t color) {
+    (void)color;
+    display_clear();
+    int h = hour;
+    if (!use_24h) {
+        h = hour % 12;
+        if (h == 0) h = 12;
+    }
+    char buf[8];
+    snprintf(buf, sizeof(buf), show_colon ? "%d:%02d" : "%d %02d", h, minute);
+    note(buf);
+}
+
+void display_draw_bar(int value, int max_val, uint16_t color) {
+    (void)color;
+    note("<bar " + std::to_string(value) + "/" + std::to_string(max_val) + ">");
+}
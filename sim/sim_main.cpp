@@ -0,0 +1,320 @@
+// Scenario runner for the host simulation build.
+//
+//   pio run -e native
+//   .pio/build/native/program              # run every scenario
+//   .pio/build/native/program -v day_with_outages  # one scenario with firmware logs
+//   .pio/build/native/program --list
+//   .pio/build/native/program --bench [--baseline FILE] [--save-baseline]
+//
+// Each scenario runs in its own forked process so module statics start
+// fresh, exactly as they would after a power cycle.
+
+#include "scenario.h"
+#include "sim.h"
+#include "sim_device.h"
+#include "config_manager.h"
+#include "render_bench.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <string>
+
+#define EPOCH_BASE 1767225600UL  // virtual time zero = 2026-01-01 00:00:00 UTC
+
+// --- Fake CGM feed ---
+
+int cgm_feed_value(const CgmFeed& feed, uint64_t at_ms) {
+    uint64_t slot = at_ms / SIM_MIN(5);
+    double phase = (double)(slot * SIM_MIN(5)) / (double)SIM_HOUR(6) * 2.0 * M_PI;
+    return feed.base_mg_dl + (int)lround(feed.swing_mg_dl * sin(phase));
+}
+
+SimHttpResponse cgm_respond(const CgmFeed& feed) {
+    uint64_t now = sim_clock_ms();
+    for (const CgmOutage& o : feed.outages) {
+        if (now >= o.start_ms && now < o.end_ms) {
+            return { o.code, o.code > 0 ? "{\"error\":\"scripted\"}" : "", feed.latency_ms, {} };
+        }
+    }
+    int value = cgm_feed_value(feed, now);
+    int prev = cgm_feed_value(feed, now >= SIM_MIN(5) ? now - SIM_MIN(5) : 0);
+    int d = value - prev;
+    const char* trend = d > 10 ? "DoubleUp" : d > 3 ? "SingleUp" : d < -10 ? "DoubleDown" : d < -3 ? "SingleDown" : "Flat";
+    unsigned long ts = EPOCH_BASE + (unsigned long)(now / SIM_MIN(5) * 300);
+    char body[128];
+    snprintf(body, sizeof(body), "{\"glucose\":%d,\"trend\":\"%s\",\"timestamp\":%lu}", value, trend, ts);
+    return { 200, body, feed.latency_ms, {} };
+}
+
+// --- Scenario ---
+
+Scenario::Scenario(const char* name) : name_(name) {}
+
+void Scenario::boot_default() {
+    config_init();
+    AppConfig& cfg = config_get();
+    strncpy(cfg.wifi_ssid, "simnet", sizeof(cfg.wifi_ssid) - 1);
+    strncpy(cfg.wifi_password, "password", sizeof(cfg.wifi_password) - 1);
+    strncpy(cfg.server_url, "https://cgm.sim/api/glucose", sizeof(cfg.server_url) - 1);
+    cfg.data_source = 0;
+    cfg.auto_cycle_enabled = false;
+    config_save();
+    boot();
+}
+
+void Scenario::boot() {
+    sim_device_setup();
+    DisplayState st = engine_get_state();
+    if (changes_.empty() || changes_.back().state != st) {
+        changes_.push_back({ sim_clock_ms(), st });
+    }
+}
+
+void Scenario::reboot(esp_reset_reason_t reason) {
+    sim_set_reset_reason(reason);
+    boot();
+}
+
+void Scenario::serve(const CgmFeed& feed) {
+    sim_http_set_handler([feed](const SimHttpRequest&) { return cgm_respond(feed); });
+}
+
+void Scenario::wifi_down_between(uint64_t start_ms, uint64_t end_ms) {
+    wifi_outages_.push_back({ start_ms, end_ms, 0 });
+}
+
+void Scenario::tick() {
+    uint64_t now = sim_clock_ms();
+    bool link = true;
+    for (const CgmOutage& o : wifi_outages_) {
+        if (now >= o.start_ms && now < o.end_ms) link = false;
+    }
+    sim_wifi_set_link(link);
+
+    sim_device_loop();
+    steps_++;
+
+    DisplayState st = engine_get_state();
+    if (changes_.empty() || changes_.back().state != st) {
+        changes_.push_back({ sim_clock_ms(), st });
+    }
+}
+
+void Scenario::run_until(uint64_t at_ms) {
+    while (sim_clock_ms() < at_ms) {
+        uint64_t before = sim_clock_ms();
+        tick();
+        // A blocking fake HTTP call may already have moved the clock past the step
+        uint64_t spent = sim_clock_ms() - before;
+        if (spent < step_ms) sim_clock_advance(step_ms - spent);
+    }
+}
+
+void Scenario::run_for(uint64_t ms) {
+    run_until(sim_clock_ms() + ms);
+}
+
+DisplayState Scenario::state_at(uint64_t at_ms) const {
+    DisplayState st = STATE_BOOT;
+    for (const StateChange& c : changes_) {
+        if (c.at_ms > at_ms) break;
+        st = c.state;
+    }
+    return st;
+}
+
+static void print_sequence(const std::vector<StateChange>& changes) {
+    for (const StateChange& c : changes) {
+        printf("      %9.1fs  %s\n", c.at_ms / 1000.0, engine_state_name(c.state));
+    }
+}
+
+void Scenario::expect_sequence(std::initializer_list<DisplayState> expected) {
+    bool match = expected.size() == changes_.size();
+    if (match) {
+        size_t i = 0;
+        for (DisplayState st : expected) {
+            if (changes_[i++].state != st) { match = false; break; }
+        }
+    }
+    if (match) return;
+
+    failures_++;
+    printf("    FAIL %s: state sequence mismatch\n      expected:", name_);
+    for (DisplayState st : expected) printf(" %s", engine_state_name(st));
+    printf("\n      actual:\n");
+    print_sequence(changes_);
+}
+
+void Scenario::expect_state_at(uint64_t at_ms, DisplayState state) {
+    DisplayState actual = state_at(at_ms);
+    if (actual == state) return;
+    failures_++;
+    printf("    FAIL %s: at %.1fs expected %s, got %s\n", name_, at_ms / 1000.0,
+           engine_state_name(state), engine_state_name(actual));
+}
+
+void Scenario::expect_change_within(DisplayState state, uint64_t from_ms, uint64_t to_ms) {
+    for (const StateChange& c : changes_) {
+        if (c.state == state && c.at_ms >= from_ms && c.at_ms <= to_ms) return;
+    }
+    failures_++;
+    printf("    FAIL %s: no change to %s between %.1fs and %.1fs\n", name_,
+           engine_state_name(state), from_ms / 1000.0, to_ms / 1000.0);
+}
+
+void Scenario::expect(bool cond, const char* what) {
+    if (cond) return;
+    failures_++;
+    printf("    FAIL %s: %s\n", name_, what);
+}
+
+// --- Runner ---
+
+static bool verbose = false;
+
+static int run_scenario(const ScenarioDef& def) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        sim_reset();
+        sim_set_epoch_base(EPOCH_BASE);
+        sim_set_verbose(verbose);
+
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        Scenario s(def.name);
+        def.fn(s);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+
+        double wall_ms = (t1.tv_sec - t0.tv_sec) * 1000.0 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+        double sim_s = sim_clock_ms() / 1000.0;
+        printf("  %-4s %-22s %9.0fs simulated in %8.1f ms wall (%llu loops, %.0fx)\n",
+               s.failures() ? "FAIL" : "ok", def.name, sim_s, wall_ms,
+               (unsigned long long)s.steps(), wall_ms > 0 ? sim_s * 1000.0 / wall_ms : 0.0);
+        fflush(stdout);
+        _exit(s.failures() ? 1 : 0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status)) {
+        printf("  CRASH %s\n", def.name);
+        return 1;
+    }
+    return WEXITSTATUS(status);
+}
+
+// --- Render benchmark ---
+//
+// Same suite as POST /api/bench on the device. Host "cycles" are the
+// monotonic clock scaled to 240 MHz and the display is the capture stub,
+// so the numbers track engine-side render cost, not LED output.
+
+static bool load_host_baseline(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) return false;
+    char name[48];
+    unsigned int cycles;
+    while (fscanf(f, "%47s %u", name, &cycles) == 2) bench_set_baseline(name, cycles);
+    fclose(f);
+    return true;
+}
+
+static bool save_host_baseline(const char* path) {
+    FILE* f = fopen(path, "w");
+    if (!f) return false;
+    for (int i = 0; i < bench_result_count(); i++) {
+        const BenchResult& r = bench_get_result(i);
+        fprintf(f, "%s %u\n", r.name, r.median_cycles);
+    }
+    fclose(f);
+    return true;
+}
+
+static int run_bench(const char* baseline_path, bool save_baseline) {
+    sim_reset();
+    sim_set_epoch_base(EPOCH_BASE);
+    sim_set_verbose(verbose);
+
+    Scenario s("bench");
+    CgmFeed feed;
+    s.serve(feed);
+    s.boot_default();
+    s.run_for(SIM_MIN(2));
+
+    if (baseline_path && !save_baseline && !load_host_baseline(baseline_path)) {
+        fprintf(stderr, "No baseline at %s\n", baseline_path);
+    }
+    int regressions = bench_run();
+
+    printf("  %-22s %10s %10s %10s %10s\n", "case", "avg_cyc", "median", "max_cyc", "baseline");
+    for (int i = 0; i < bench_result_count(); i++) {
+        const BenchResult& r = bench_get_result(i);
+        char base[16] = "-";
+        if (r.baseline_cycles > 0) snprintf(base, sizeof(base), "%u", r.baseline_cycles);
+        printf("  %-22s %10u %10u %10u %10s%s\n", r.name, r.avg_cycles, r.median_cycles, r.max_cycles, base,
+               r.regressed ? "  REGRESSED" : "");
+    }
+    if (save_baseline && baseline_path) {
+        if (!save_host_baseline(baseline_path)) {
+            fprintf(stderr, "Cannot write %s\n", baseline_path);
+            return 2;
+        }
+        printf("baseline written to %s\n", baseline_path);
+        return 0;
+    }
+    printf("%d regression(s) over %d%%\n", regressions, BENCH_REGRESSION_PCT);
+    return regressions ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+    std::vector<const ScenarioDef*> selected;
+    bool bench = false;
+    bool save_baseline = false;
+    const char* baseline_path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-v") == 0) {
+            verbose = true;
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            bench = true;
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baseline_path = argv[++i];
+        } else if (strcmp(argv[i], "--save-baseline") == 0) {
+            save_baseline = true;
+        } else if (strcmp(argv[i], "--list") == 0) {
+            for (int k = 0; k < SCENARIO_COUNT; k++) {
+                printf("%-22s %s\n", SCENARIOS[k].name, SCENARIOS[k].description);
+            }
+            return 0;
+        } else {
+            bool found = false;
+            for (int k = 0; k < SCENARIO_COUNT; k++) {
+                if (strcmp(argv[i], SCENARIOS[k].name) == 0) {
+                    selected.push_back(&SCENARIOS[k]);
+                    found = true;
+                }
+            }
+            if (!found) {
+                fprintf(stderr, "Unknown scenario '%s' (see --list)\n", argv[i]);
+                return 2;
+            }
+        }
+    }
+    if (bench) {
+        return run_bench(baseline_path, save_baseline);
+    }
+    if (selected.empty()) {
+        for (int k = 0; k < SCENARIO_COUNT; k++) selected.push_back(&SCENARIOS[k]);
+    }
+
+    int failed = 0;
+    for (const ScenarioDef* def : selected) {
+        failed += run_scenario(*def) ? 1 : 0;
+    }
+    printf("%d/%d scenarios passed\n", (int)selected.size() - failed, (int)selected.size());
+    return failed ? 1 : 0;
+}
@@ -1,5 +1,6 @@
 #include "buttons.h"
 #include "hardware_pins.h"
+#include "logger.h"
 #include <Arduino.h>
 
 #define DEBOUNCE_MS     50
@@ -61,7 +62,7 @@ void buttons_loop() {
                     case 1: pending_event = BTN_MIDDLE_LONG; break;
                     case 2: pending_event = BTN_RIGHT_LONG; break;
                 }
-                Serial.printf("[BTN] Button %d LONG press\n", i);
+                LOG_D("BTN", "Button %d LONG press", i);
             }
         }
 
@@ -74,7 +75,7 @@ void buttons_loop() {
                     case 1: pending_event = BTN_MIDDLE_SHORT; break;
                     case 2: pending_event = BTN_RIGHT_SHORT; break;
                 }
-                Serial.printf("[BTN] Button %d SHORT press\n", i);
+                LOG_D("BTN", "Button %d SHORT press", i);
             }
             buttons[i].pressed = false;
         }
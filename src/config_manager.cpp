@@ -1,4 +1,8 @@
 #include "config_manager.h"
+#include "metrics.h"
+#include "engine_events.h"
+#include "logger.h"
+#include "scratch.h"
 #include <Preferences.h>
 #include <Arduino.h>
 #include <LittleFS.h>
@@ -10,6 +14,14 @@
 static AppConfig config;
 static Preferences prefs;
 
+static const char* const SECTION_NAMES[CFG_SECTION_COUNT] = {
+    "wifi", "source", "display", "time", "theme", "alerts", "weather",
+    "timer", "notify", "sysmon", "lan", "mqtt", "system",
+};
+
+static uint32_t section_version[CFG_SECTION_COUNT];
+static uint32_t boot_id;
+
 static void config_set_defaults() {
     memset(&config, 0, sizeof(AppConfig));
 
@@ -28,8 +40,10 @@ static void config_set_defaults() {
     config.dexcom_username[0] = '\0';
     config.dexcom_password[0] = '\0';
     config.dexcom_us = true;
+    config.dexcom_base_url[0] = '\0';
 
     config.poll_interval_sec = 60;
+    config.http_gzip = true;
 
     // Display
     config.brightness = 40;
@@ -62,6 +76,7 @@ static void config_set_defaults() {
     config.color_in_range    = 0x34A853;
     config.color_high        = 0xFBBC04;
     config.color_urgent_high = 0xEA4335;
+    config.color_gradient    = false;
 
     // Clock & weather colors
     config.color_clock   = 0xFFFFFF;
@@ -82,6 +97,7 @@ static void config_set_defaults() {
     strncpy(config.weather_city, "New York,US", sizeof(config.weather_city));
     config.weather_use_f = true;
     config.weather_poll_min = 15;
+    config.weather_base_url[0] = '\0';
 
     // Date display
     config.date_on_time_screen = false;
@@ -115,6 +131,20 @@ static void config_set_defaults() {
     config.countdown_name[0] = '\0';
     config.countdown_target = 0;
 
+    // LAN sharing
+    config.lan_share_mode = 0;
+    config.lan_share_key[0] = '\0';
+
+    // MQTT
+    config.mqtt_enabled = false;
+    config.mqtt_uri[0] = '\0';
+    config.mqtt_username[0] = '\0';
+    config.mqtt_password[0] = '\0';
+    strncpy(config.mqtt_topic, "sugarclock", sizeof(config.mqtt_topic));
+
+    // Logging
+    config.log_level = LOG_LEVEL_INFO;
+
     // Auto-cycle
     config.auto_cycle_enabled = true;
     config.auto_cycle_sec = 10;
@@ -124,30 +154,31 @@ static void config_set_defaults() {
 
 static void config_check_littlefs_overlay() {
     if (!LittleFS.begin(false)) {
-        Serial.println("[CONFIG] LittleFS mount failed, no overlay to apply");
+        LOG_E("CONFIG", "LittleFS mount failed, no overlay to apply");
         return;
     }
 
     if (!LittleFS.exists("/config.json")) {
-        Serial.println("[CONFIG] No /config.json overlay found");
+        LOG_I("CONFIG", "No /config.json overlay found");
         LittleFS.end();
         return;
     }
 
-    Serial.println("[CONFIG] Found /config.json overlay, applying...");
+    LOG_I("CONFIG", "Found /config.json overlay, applying...");
     File f = LittleFS.open("/config.json", "r");
     if (!f) {
-        Serial.println("[CONFIG] Failed to open /config.json");
+        LOG_E("CONFIG", "Failed to open /config.json");
         LittleFS.end();
         return;
     }
 
-    JsonDocument doc;
+    ScratchScope scope;
+    JsonDocument doc(scope.json());
     DeserializationError err = deserializeJson(doc, f);
     f.close();
 
     if (err) {
-        Serial.printf("[CONFIG] JSON parse error: %s\n", err.c_str());
+        LOG_E("CONFIG", "JSON parse error: %s", err.c_str());
         LittleFS.remove("/config.json");
         LittleFS.end();
         return;
@@ -163,6 +194,8 @@ static void config_check_littlefs_overlay() {
         config.dexcom_us = (strcmp(srv, "US") == 0);
     }
     if (doc["server_url"].is<const char*>())     strncpy(config.server_url, doc["server_url"], sizeof(config.server_url));
+    if (doc["dexcom_base_url"].is<const char*>()) strncpy(config.dexcom_base_url, doc["dexcom_base_url"], sizeof(config.dexcom_base_url) - 1);
+    if (doc["weather_base_url"].is<const char*>()) strncpy(config.weather_base_url, doc["weather_base_url"], sizeof(config.weather_base_url) - 1);
     if (doc["auth_token"].is<const char*>())     strncpy(config.auth_token, doc["auth_token"], sizeof(config.auth_token));
     if (doc["timezone"].is<const char*>())       strncpy(config.timezone, doc["timezone"], sizeof(config.timezone));
     if (doc["use_mmol"].is<bool>())              config.use_mmol = doc["use_mmol"];
@@ -171,25 +204,27 @@ static void config_check_littlefs_overlay() {
     if (doc["alert_high"].is<int>())             config.alert_high = doc["alert_high"];
 
     config_save();
-    Serial.println("[CONFIG] Applied config.json overlay from LittleFS");
+    LOG_I("CONFIG", "Applied config.json overlay from LittleFS");
 
     LittleFS.remove("/config.json");
-    Serial.println("[CONFIG] Deleted /config.json after applying");
+    LOG_I("CONFIG", "Deleted /config.json after applying");
     LittleFS.end();
 }
 
 void config_init() {
     prefs.begin(CONFIG_NAMESPACE, false);
+    boot_id = (uint32_t)random(0x7FFFFFFF);
+    memset(section_version, 0, sizeof(section_version));
 
     // Check if config exists
     uint32_t magic = prefs.getUInt("magic", 0);
 
     if (magic != CONFIG_MAGIC) {
-        Serial.println("[CONFIG] No valid config found, writing defaults");
+        LOG_I("CONFIG", "No valid config found, writing defaults");
         config_set_defaults();
         config_save();
     } else {
-        Serial.println("[CONFIG] Loading saved config");
+        LOG_I("CONFIG", "Loading saved config");
 
         prefs.getString("wifi_ssid", config.wifi_ssid, sizeof(config.wifi_ssid));
         prefs.getString("wifi_pass", config.wifi_password, sizeof(config.wifi_password));
@@ -199,7 +234,10 @@ void config_init() {
         prefs.getString("dex_user", config.dexcom_username, sizeof(config.dexcom_username));
         prefs.getString("dex_pass", config.dexcom_password, sizeof(config.dexcom_password));
         config.dexcom_us = prefs.getBool("dex_us", true);
+        config.dexcom_base_url[0] = '\0';
+        prefs.getString("dex_base", config.dexcom_base_url, sizeof(config.dexcom_base_url));
         config.poll_interval_sec = prefs.getInt("poll_int", 60);
+        config.http_gzip = prefs.getBool("http_gzip", true);
         config.brightness = prefs.getUChar("brightness", 40);
         config.auto_brightness = prefs.getBool("auto_brt", true);
         config.show_delta = prefs.getBool("show_delta", false);
@@ -224,6 +262,7 @@ void config_init() {
         config.color_in_range    = prefs.getUInt("c_inrange", 0x34A853);
         config.color_high        = prefs.getUInt("c_high", 0xFBBC04);
         config.color_urgent_high = prefs.getUInt("c_uhigh", 0xEA4335);
+        config.color_gradient    = prefs.getBool("c_gradient", false);
 
         // Clock & weather colors
         config.color_clock   = prefs.getUInt("c_clock", 0xFFFFFF);
@@ -247,6 +286,8 @@ void config_init() {
         }
         config.weather_use_f = prefs.getBool("wx_use_f", true);
         config.weather_poll_min = prefs.getInt("wx_poll", 15);
+        config.weather_base_url[0] = '\0';
+        prefs.getString("wx_base", config.weather_base_url, sizeof(config.weather_base_url));
         if (config.weather_poll_min < 5) config.weather_poll_min = 5;
 
         // Date display
@@ -284,6 +325,27 @@ void config_init() {
         prefs.getString("cd_name", config.countdown_name, sizeof(config.countdown_name));
         config.countdown_target = prefs.getULong("cd_target", 0);
 
+        // LAN sharing
+        config.lan_share_mode = prefs.getInt("lan_mode", 0);
+        config.lan_share_key[0] = '\0';
+        prefs.getString("lan_key", config.lan_share_key, sizeof(config.lan_share_key));
+
+        // MQTT
+        config.mqtt_enabled = prefs.getBool("mqtt_en", false);
+        config.mqtt_uri[0] = '\0';
+        prefs.getString("mqtt_uri", config.mqtt_uri, sizeof(config.mqtt_uri));
+        config.mqtt_username[0] = '\0';
+        prefs.getString("mqtt_user", config.mqtt_username, sizeof(config.mqtt_username));
+        config.mqtt_password[0] = '\0';
+        prefs.getString("mqtt_pass", config.mqtt_password, sizeof(config.mqtt_password));
+        prefs.getString("mqtt_topic", config.mqtt_topic, sizeof(config.mqtt_topic));
+        if (strlen(config.mqtt_topic) == 0) {
+            strncpy(config.mqtt_topic, "sugarclock", sizeof(config.mqtt_topic));
+        }
+
+        // Logging
+        config.log_level = prefs.getInt("log_lvl", LOG_LEVEL_INFO);
+
         // Auto-cycle
         config.auto_cycle_enabled = prefs.getBool("acyc_en", true);
         config.auto_cycle_sec = prefs.getInt("acyc_sec", 10);
@@ -301,107 +363,207 @@ void config_init() {
     // Check for config.json overlay from LittleFS (injected by setup app)
     config_check_littlefs_overlay();
 
-    Serial.printf("[CONFIG] Poll interval: %ds, Brightness: %d\n",
-                  config.poll_interval_sec, config.brightness);
+    LOG_I("CONFIG", "Poll interval: %ds, Brightness: %d",
+          config.poll_interval_sec, config.brightness);
 }
 
-void config_save() {
-    prefs.putUInt("magic", CONFIG_MAGIC);
-    prefs.putString("wifi_ssid", config.wifi_ssid);
-    prefs.putString("wifi_pass", config.wifi_password);
-    prefs.putInt("data_src", config.data_source);
-    prefs.putString("server_url", config.server_url);
-    prefs.putString("auth_token", config.auth_token);
-    prefs.putString("dex_user", config.dexcom_username);
-    prefs.putString("dex_pass", config.dexcom_password);
-    prefs.putBool("dex_us", config.dexcom_us);
-    prefs.putInt("poll_int", config.poll_interval_sec);
-    prefs.putUChar("brightness", config.brightness);
-    prefs.putBool("auto_brt", config.auto_brightness);
-    prefs.putBool("show_delta", config.show_delta);
-    prefs.putBool("use_mmol", config.use_mmol);
-    prefs.putInt("t_ulow", config.thresh_urgent_low);
-    prefs.putInt("t_low", config.thresh_low);
-    prefs.putInt("t_high", config.thresh_high);
-    prefs.putInt("t_uhigh", config.thresh_urgent_high);
-    prefs.putString("timezone", config.timezone);
-    prefs.putBool("use_24h", config.use_24h);
-    prefs.putInt("def_mode", config.default_mode);
-
-    // Alerts
-    prefs.putBool("alert_en", config.alert_enabled);
-    prefs.putInt("alert_low", config.alert_low);
-    prefs.putInt("alert_high", config.alert_high);
-    prefs.putInt("alert_snz", config.alert_snooze_min);
+// config_save() bookkeeping: each put compares with what NVS holds and only
+// writes, marking the current section dirty, when the value differs
+static ConfigSection save_section;
+static uint32_t save_dirty;
 
-    // Theme colors
-    prefs.putUInt("c_ulow", config.color_urgent_low);
-    prefs.putUInt("c_low", config.color_low);
-    prefs.putUInt("c_inrange", config.color_in_range);
-    prefs.putUInt("c_high", config.color_high);
-    prefs.putUInt("c_uhigh", config.color_urgent_high);
+static void section(ConfigSection s) {
+    save_section = s;
+}
 
-    // Clock & weather colors
-    prefs.putUInt("c_clock", config.color_clock);
-    prefs.putUInt("c_weather", config.color_weather);
+static void put_int(const char* key, int32_t v) {
+    if (prefs.isKey(key) && prefs.getInt(key) == v) return;
+    prefs.putInt(key, v);
+    save_dirty |= CFG_BIT(save_section);
+}
 
-    // Night mode
-    prefs.putBool("night_en", config.night_mode_enabled);
-    prefs.putInt("night_start", config.night_start_hour);
-    prefs.putInt("night_end", config.night_end_hour);
-    prefs.putUChar("night_brt", config.night_brightness);
+static void put_uint(const char* key, uint32_t v) {
+    if (prefs.isKey(key) && prefs.getUInt(key) == v) return;
+    prefs.putUInt(key, v);
+    save_dirty |= CFG_BIT(save_section);
+}
 
-    // Stale timeout
-    prefs.putInt("stale_min", config.stale_timeout_min);
+static void put_ulong(const char* key, uint32_t v) {
+    if (prefs.isKey(key) && prefs.getULong(key) == v) return;
+    prefs.putULong(key, v);
+    save_dirty |= CFG_BIT(save_section);
+}
 
-    // Weather
-    prefs.putBool("wx_en", config.weather_enabled);
-    prefs.putString("wx_apikey", config.weather_api_key);
-    prefs.putString("wx_city", config.weather_city);
-    prefs.putBool("wx_use_f", config.weather_use_f);
-    prefs.putInt("wx_poll", config.weather_poll_min);
+static void put_uchar(const char* key, uint8_t v) {
+    if (prefs.isKey(key) && prefs.getUChar(key) == v) return;
+    prefs.putUChar(key, v);
+    save_dirty |= CFG_BIT(save_section);
+}
 
-    // Date display
-    prefs.putBool("date_en", config.date_on_time_screen);
-    prefs.putInt("date_fmt", config.date_format);
+static void put_bool(const char* key, bool v) {
+    if (prefs.isKey(key) && prefs.getBool(key) == v) return;
+    prefs.putBool(key, v);
+    save_dirty |= CFG_BIT(save_section);
+}
 
-    // Timer
-    prefs.putBool("tmr_en", config.timer_enabled);
-    prefs.putInt("tmr_work", config.timer_work_min);
-    prefs.putInt("tmr_brk", config.timer_break_min);
-    prefs.putInt("tmr_lbrk", config.timer_long_break_min);
-    prefs.putInt("tmr_sess", config.timer_sessions);
-    prefs.putBool("tmr_buzz", config.timer_buzzer);
+static void put_str(const char* key, const char* v) {
+    char cur[257] = "";    // longest field is 256 with the terminator
+    if (prefs.isKey(key)) {
+        prefs.getString(key, cur, sizeof(cur));
+        if (strcmp(cur, v) == 0) return;
+    }
+    prefs.putString(key, v);
+    save_dirty |= CFG_BIT(save_section);
+}
 
-    // Stopwatch
-    prefs.putBool("sw_en", config.stopwatch_enabled);
+uint32_t config_save() {
+    if (prefs.getUInt("magic", 0) != CONFIG_MAGIC) prefs.putUInt("magic", CONFIG_MAGIC);
+    save_dirty = 0;
+
+    section(CFG_WIFI);
+    put_str("wifi_ssid", config.wifi_ssid);
+    put_str("wifi_pass", config.wifi_password);
+
+    section(CFG_SOURCE);
+    put_int("data_src", config.data_source);
+    put_str("server_url", config.server_url);
+    put_str("auth_token", config.auth_token);
+    put_str("dex_user", config.dexcom_username);
+    put_str("dex_pass", config.dexcom_password);
+    put_bool("dex_us", config.dexcom_us);
+    put_str("dex_base", config.dexcom_base_url);
+    put_int("poll_int", config.poll_interval_sec);
+    put_bool("http_gzip", config.http_gzip);
+
+    section(CFG_DISPLAY);
+    put_uchar("brightness", config.brightness);
+    put_bool("auto_brt", config.auto_brightness);
+    put_bool("show_delta", config.show_delta);
+    put_bool("use_mmol", config.use_mmol);
+    put_int("def_mode", config.default_mode);
+    put_bool("night_en", config.night_mode_enabled);
+    put_int("night_start", config.night_start_hour);
+    put_int("night_end", config.night_end_hour);
+    put_uchar("night_brt", config.night_brightness);
+    put_int("stale_min", config.stale_timeout_min);
+    put_bool("acyc_en", config.auto_cycle_enabled);
+    put_int("acyc_sec", config.auto_cycle_sec);
+
+    section(CFG_TIME);
+    put_str("timezone", config.timezone);
+    put_bool("use_24h", config.use_24h);
+    put_bool("date_en", config.date_on_time_screen);
+    put_int("date_fmt", config.date_format);
+
+    section(CFG_THEME);
+    put_int("t_ulow", config.thresh_urgent_low);
+    put_int("t_low", config.thresh_low);
+    put_int("t_high", config.thresh_high);
+    put_int("t_uhigh", config.thresh_urgent_high);
+    put_uint("c_ulow", config.color_urgent_low);
+    put_uint("c_low", config.color_low);
+    put_uint("c_inrange", config.color_in_range);
+    put_uint("c_high", config.color_high);
+    put_uint("c_uhigh", config.color_urgent_high);
+    put_bool("c_gradient", config.color_gradient);
+    put_uint("c_clock", config.color_clock);
+    put_uint("c_weather", config.color_weather);
+
+    section(CFG_ALERTS);
+    put_bool("alert_en", config.alert_enabled);
+    put_int("alert_low", config.alert_low);
+    put_int("alert_high", config.alert_high);
+    put_int("alert_snz", config.alert_snooze_min);
+
+    section(CFG_WEATHER);
+    put_bool("wx_en", config.weather_enabled);
+    put_str("wx_apikey", config.weather_api_key);
+    put_str("wx_city", config.weather_city);
+    put_bool("wx_use_f", config.weather_use_f);
+    put_int("wx_poll", config.weather_poll_min);
+    put_str("wx_base", config.weather_base_url);
+
+    section(CFG_TIMER);
+    put_bool("tmr_en", config.timer_enabled);
+    put_int("tmr_work", config.timer_work_min);
+    put_int("tmr_brk", config.timer_break_min);
+    put_int("tmr_lbrk", config.timer_long_break_min);
+    put_int("tmr_sess", config.timer_sessions);
+    put_bool("tmr_buzz", config.timer_buzzer);
+    put_bool("sw_en", config.stopwatch_enabled);
+    put_bool("cd_en", config.countdown_enabled);
+    put_str("cd_name", config.countdown_name);
+    put_ulong("cd_target", config.countdown_target);
+
+    section(CFG_NOTIFY);
+    put_bool("ntfy_en", config.notify_enabled);
+    put_int("ntfy_dur", config.notify_default_duration);
+    put_bool("ntfy_buzz", config.notify_allow_buzzer);
+
+    section(CFG_SYSMON);
+    put_bool("smon_en", config.sysmon_enabled);
+    put_str("smon_lbl", config.sysmon_label);
+    put_int("smon_dmode", config.sysmon_display_mode);
+    put_int("smon_warn", config.sysmon_warn_pct);
+    put_int("smon_crit", config.sysmon_crit_pct);
+
+    section(CFG_LAN);
+    put_int("lan_mode", config.lan_share_mode);
+    put_str("lan_key", config.lan_share_key);
+
+    section(CFG_MQTT);
+    put_bool("mqtt_en", config.mqtt_enabled);
+    put_str("mqtt_uri", config.mqtt_uri);
+    put_str("mqtt_user", config.mqtt_username);
+    put_str("mqtt_pass", config.mqtt_password);
+    put_str("mqtt_topic", config.mqtt_topic);
+
+    section(CFG_SYSTEM);
+    put_int("log_lvl", config.log_level);
+
+    if (save_dirty == 0) {
+        LOG_D("CONFIG", "Save: nothing changed");
+        return 0;
+    }
+    config_touch(save_dirty);
+    metrics_inc(METRIC_NVS_WRITES);
+    engine_post_event(ENGINE_EV_CONFIG);
 
-    // Notifications
-    prefs.putBool("ntfy_en", config.notify_enabled);
-    prefs.putInt("ntfy_dur", config.notify_default_duration);
-    prefs.putBool("ntfy_buzz", config.notify_allow_buzzer);
+    LOG_I("CONFIG", "Saved to NVS (sections 0x%04lx)", (unsigned long)save_dirty);
+    return save_dirty;
+}
 
-    // System monitor
-    prefs.putBool("smon_en", config.sysmon_enabled);
-    prefs.putString("smon_lbl", config.sysmon_label);
-    prefs.putInt("smon_dmode", config.sysmon_display_mode);
-    prefs.putInt("smon_warn", config.sysmon_warn_pct);
-    prefs.putInt("smon_crit", config.sysmon_crit_pct);
+const char* config_section_name(ConfigSection s) {
+    return s < CFG_SECTION_COUNT ? SECTION_NAMES[s] : "?";
+}
 
-    // Countdown
-    prefs.putBool("cd_en", config.countdown_enabled);
-    prefs.putString("cd_name", config.countdown_name);
-    prefs.putULong("cd_target", config.countdown_target);
+bool config_section_find(const char* name, ConfigSection* out) {
+    for (int i = 0; i < CFG_SECTION_COUNT; i++) {
+        if (strcmp(name, SECTION_NAMES[i]) == 0) {
+            *out = (ConfigSection)i;
+            return true;
+        }
+    }
+    return false;
+}
 
-    // Auto-cycle
-    prefs.putBool("acyc_en", config.auto_cycle_enabled);
-    prefs.putInt("acyc_sec", config.auto_cycle_sec);
+void config_etag(uint32_t sections, char* out, size_t len) {
+    // Versions only go up, so their sum moves whenever one of them does
+    uint32_t sum = 0;
+    for (int i = 0; i < CFG_SECTION_COUNT; i++) {
+        if (sections & CFG_BIT(i)) sum += section_version[i];
+    }
+    snprintf(out, len, "\"%08lx-%lx-%lu\"", (unsigned long)boot_id, (unsigned long)sections, (unsigned long)sum);
+}
 
-    Serial.println("[CONFIG] Saved to NVS");
+void config_touch(uint32_t sections) {
+    for (int i = 0; i < CFG_SECTION_COUNT; i++) {
+        if (sections & CFG_BIT(i)) section_version[i]++;
+    }
 }
 
 void config_reset() {
-    Serial.println("[CONFIG] Factory reset");
+    LOG_I("CONFIG", "Factory reset");
     prefs.clear();
     config_set_defaults();
     config_save();
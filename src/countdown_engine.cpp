@@ -8,10 +8,6 @@ void countdown_init() {
     // Nothing to initialize - uses config target time
 }
 
-void countdown_loop() {
-    // Lightweight - just uses time comparison
-}
-
 long countdown_get_remaining_sec() {
     AppConfig& cfg = config_get();
     if (cfg.countdown_target == 0) return 0;
@@ -1,6 +1,7 @@
 #include "display.h"
 #include "hardware_pins.h"
 #include "trend_arrows.h"
+#include "metrics.h"
 
 #include <FastLED.h>
 #include <FastLED_NeoMatrix.h>
@@ -38,6 +39,7 @@ void display_clear() {
 
 void display_show() {
     matrix.show();
+    metrics_inc(METRIC_LED_PUSHES);
 }
 
 void display_set_brightness(uint8_t brightness) {
@@ -62,12 +64,12 @@ void display_draw_pixel(int x, int y, uint16_t color) {
 
 void display_flash(uint8_t r, uint8_t g, uint8_t b) {
     matrix.fillScreen(matrix.Color(r, g, b));
-    matrix.show();
+    display_show();
 }
 
 void display_fill(uint8_t r, uint8_t g, uint8_t b) {
     matrix.fillScreen(matrix.Color(r, g, b));
-    matrix.show();
+    display_show();
 }
 
 void display_draw_text(const char* text, int x, int y, uint16_t color) {
@@ -76,17 +78,9 @@ void display_draw_text(const char* text, int x, int y, uint16_t color) {
     matrix.print(text);
 }
 
-void display_draw_glucose(int value, uint16_t color) {
+void display_draw_glucose(const char* text, int text_width, uint16_t color) {
     display_clear();
 
-    char buf[8];
-    snprintf(buf, sizeof(buf), "%d", value);
-    int len = strlen(buf);
-
-    // Each character in default 5x7 font is 6px wide (5 + 1 spacing)
-    // Calculate total width of glucose text
-    int text_width = len * 6;
-
     // Leave room for trend arrow (6px) on the right
     // Center the glucose + arrow combination
     int total_width = text_width + 6; // 6px for arrow area
@@ -95,7 +89,7 @@ void display_draw_glucose(int value, uint16_t color) {
 
     matrix.setTextColor(color);
     matrix.setCursor(x, y);
-    matrix.print(buf);
+    matrix.print(text);
 }
 
 void display_draw_trend(int trend, int x, int y, uint16_t color) {
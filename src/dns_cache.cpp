@@ -0,0 +1,235 @@
+#include "dns_cache.h"
+#include "net_scheduler.h"
+#include "metrics.h"
+#include "logger.h"
+#include <Arduino.h>
+
+static const char* const RESULT_NAMES[DNS_RESULT_COUNT] = { "hit", "resolved", "stale", "failed" };
+
+static DnsCacheEntry entries[DNS_CACHE_SLOTS];
+static unsigned long results[DNS_RESULT_COUNT];
+static unsigned long last_check_ms = 0;
+
+// Lookups run on the loop task, but /api/debug reads the table from the
+// web server task. The lock is never held across a lookup (or a log line),
+// so entries are found again by host name once one returns.
+#ifndef SUGARCLOCK_SIM
+static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+#define DNS_LOCK()   portENTER_CRITICAL(&lock)
+#define DNS_UNLOCK() portEXIT_CRITICAL(&lock)
+#else
+#define DNS_LOCK()
+#define DNS_UNLOCK()
+#endif
+
+static void count(DnsResult r) {
+    __atomic_fetch_add(&results[r], 1, __ATOMIC_RELAXED);
+    metrics_dns_result(r);
+}
+
+static DnsCacheEntry* find(const char* host) {
+    for (DnsCacheEntry& e : entries) {
+        if (e.valid && strcmp(e.host, host) == 0) return &e;
+    }
+    return nullptr;
+}
+
+// Free slot, else the least recently used one
+static DnsCacheEntry* slot_for() {
+    DnsCacheEntry* victim = &entries[0];
+    for (DnsCacheEntry& e : entries) {
+        if (!e.valid) return &e;
+        if ((long)(e.last_used_ms - victim->last_used_ms) < 0) victim = &e;
+    }
+    return victim;
+}
+
+// Blocking lookup, timed for the DNS metric
+static bool lookup(const char* host, IPAddress& out) {
+    unsigned long start = millis();
+    bool ok = WiFi.hostByName(host, out) == 1;
+    metrics_observe_dns(millis() - start, ok);
+    return ok;
+}
+
+// Record a successful lookup, taking a slot if host has none
+static void store(const char* host, uint32_t ip, unsigned long now) {
+    char evicted[sizeof(DnsCacheEntry::host)] = "";
+    DNS_LOCK();
+    DnsCacheEntry* e = find(host);
+    if (!e) {
+        e = slot_for();
+        if (e->valid) strcpy(evicted, e->host);
+        strncpy(e->host, host, sizeof(e->host) - 1);
+        e->host[sizeof(e->host) - 1] = '\0';
+        e->last_used_ms = now;
+        e->valid = true;
+    }
+    e->ip = ip;
+    e->resolved_ms = now;
+    e->expires_ms = now + DNS_CACHE_TTL_MS;
+    e->retry_ms = 0;
+    DNS_UNLOCK();
+    if (evicted[0]) LOG_D("DNS", "Evicting %s for %s", evicted, host);
+}
+
+// Failed lookup of a cached host: keep the old address and back off
+static void back_off(const char* host, unsigned long now) {
+    DNS_LOCK();
+    DnsCacheEntry* e = find(host);
+    if (e) {
+        e->retry_ms = now + DNS_CACHE_RETRY_MS;
+        if (e->retry_ms == 0) e->retry_ms = 1;
+    }
+    DNS_UNLOCK();
+    LOG_W("DNS", "Lookup of %s failed", host);
+}
+
+// Look a cached host up again
+static bool refresh(const char* host) {
+    IPAddress ip;
+    bool ok = lookup(host, ip);
+    if (ok) store(host, (uint32_t)ip, millis());
+    else back_off(host, millis());
+    return ok;
+}
+
+static bool may_look_up(const DnsCacheEntry& e, unsigned long now) {
+    return e.retry_ms == 0 || (long)(now - e.retry_ms) >= 0;
+}
+
+static bool refresh_due(const DnsCacheEntry& e, unsigned long now) {
+    return e.valid && now - e.last_used_ms < DNS_CACHE_IDLE_MS &&
+           (long)(e.expires_ms - now) < (long)DNS_CACHE_AHEAD_MS && may_look_up(e, now);
+}
+
+// Scheduler job: refresh every entry still in use that is about to expire
+static bool refresh_job() {
+    char due[DNS_CACHE_SLOTS][sizeof(DnsCacheEntry::host)];
+    int n = 0;
+    unsigned long now = millis();
+    DNS_LOCK();
+    for (const DnsCacheEntry& e : entries) {
+        if (refresh_due(e, now)) strcpy(due[n++], e.host);
+    }
+    DNS_UNLOCK();
+
+    bool ok = true;
+    for (int i = 0; i < n; i++) ok = refresh(due[i]) && ok;
+    return ok;
+}
+
+void dns_cache_init() {
+    DNS_LOCK();
+    memset(entries, 0, sizeof(entries));
+    DNS_UNLOCK();
+    memset(results, 0, sizeof(results));
+    last_check_ms = 0;
+    net_sched_register(NET_JOB_DNS, refresh_job);
+}
+
+void dns_cache_loop() {
+    unsigned long now = millis();
+    if (now - last_check_ms < 1000) return;
+    last_check_ms = now;
+    if (net_sched_pending(NET_JOB_DNS)) return;
+
+    bool due = false;
+    DNS_LOCK();
+    for (const DnsCacheEntry& e : entries) {
+        if (refresh_due(e, now)) {
+            due = true;
+            break;
+        }
+    }
+    DNS_UNLOCK();
+    if (due) net_sched_request(NET_JOB_DNS);
+}
+
+bool dns_cache_resolve(const char* host, IPAddress& out) {
+    if (out.fromString(host)) return true;
+    if (strlen(host) >= sizeof(DnsCacheEntry::host)) {
+        count(DNS_FAILED);
+        return false;
+    }
+
+    unsigned long now = millis();
+    DNS_LOCK();
+    DnsCacheEntry* e = find(host);
+    bool cached = e != nullptr;
+    bool fresh = false, may = false;
+    uint32_t ip = 0;
+    unsigned long resolved_ms = 0;
+    if (e) {
+        e->last_used_ms = now;
+        fresh = (long)(now - e->expires_ms) < 0;
+        may = may_look_up(*e, now);
+        ip = e->ip;
+        resolved_ms = e->resolved_ms;
+    }
+    DNS_UNLOCK();
+
+    if (fresh) {
+        out = IPAddress(ip);
+        count(DNS_HIT);
+        return true;
+    }
+    if (!cached || may) {
+        if (lookup(host, out)) {
+            store(host, (uint32_t)out, now);
+            count(DNS_RESOLVED);
+            return true;
+        }
+        if (!cached) {
+            count(DNS_FAILED);
+            return false;
+        }
+        back_off(host, now);
+    }
+
+    // Expired and the resolver failed (now or recently)
+    if (now - resolved_ms < DNS_CACHE_STALE_MS) {
+        out = IPAddress(ip);
+        count(DNS_STALE);
+        return true;
+    }
+    DNS_LOCK();
+    e = find(host);
+    if (e) e->valid = false;
+    DNS_UNLOCK();
+    count(DNS_FAILED);
+    return false;
+}
+
+int dns_cache_count() {
+    int n = 0;
+    DNS_LOCK();
+    for (const DnsCacheEntry& e : entries) {
+        if (e.valid) n++;
+    }
+    DNS_UNLOCK();
+    return n;
+}
+
+// Copy of the i-th valid entry
+bool dns_cache_entry(int i, DnsCacheEntry* out) {
+    bool found = false;
+    DNS_LOCK();
+    for (const DnsCacheEntry& e : entries) {
+        if (e.valid && i-- == 0) {
+            *out = e;
+            found = true;
+            break;
+        }
+    }
+    DNS_UNLOCK();
+    return found;
+}
+
+unsigned long dns_cache_results(DnsResult r) {
+    return r < DNS_RESULT_COUNT ? __atomic_load_n(&results[r], __ATOMIC_RELAXED) : 0;
+}
+
+const char* dns_result_name(DnsResult r) {
+    return r < DNS_RESULT_COUNT ? RESULT_NAMES[r] : "?";
+}
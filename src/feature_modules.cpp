@@ -0,0 +1,76 @@
+#include "feature_modules.h"
+#include "config_manager.h"
+#include "improv_serial.h"
+#include "notify_engine.h"
+#if FEATURE_WEATHER
+#include "weather_client.h"
+#endif
+#if FEATURE_TIMER
+#include "timer_engine.h"
+#endif
+#if FEATURE_SYSMON
+#include "sysmon_engine.h"
+#endif
+#if FEATURE_COUNTDOWN
+#include "countdown_engine.h"
+#endif
+#include <Arduino.h>
+
+static bool notify_pending() {
+    return notify_count() > 0;
+}
+
+#if FEATURE_WEATHER
+static bool weather_wanted() {
+    return config_get().weather_enabled;
+}
+#endif
+
+#if FEATURE_TIMER
+// The stopwatch is computed on read; only a running pomodoro needs the loop
+static bool timer_counting() {
+    TimerState s = timer_get_state();
+    return s == TIMER_RUNNING || s == TIMER_BREAK || s == TIMER_LONG_BREAK;
+}
+#endif
+
+static constexpr FeatureModule MODULES[] = {
+    { "improv",    improv_init,    improv_loop,  nullptr,        METRIC_SUB_IMPROV },
+    { "notify",    notify_init,    notify_loop,  notify_pending, METRIC_SUB_FEATURES },
+#if FEATURE_WEATHER
+    { "weather",   weather_init,   weather_loop, weather_wanted, METRIC_SUB_WEATHER },
+#endif
+#if FEATURE_TIMER
+    { "timer",     timer_init,     timer_loop,   timer_counting, METRIC_SUB_FEATURES },
+#endif
+#if FEATURE_SYSMON
+    { "sysmon",    sysmon_init,    nullptr,      nullptr,        METRIC_SUB_FEATURES },  // staleness checked on read
+#endif
+#if FEATURE_COUNTDOWN
+    { "countdown", countdown_init, nullptr,      nullptr,        METRIC_SUB_FEATURES },  // computed from the clock
+#endif
+};
+
+#define MODULE_COUNT (int)(sizeof(MODULES) / sizeof(MODULES[0]))
+
+void features_init() {
+    for (const FeatureModule& m : MODULES) m.init();
+}
+
+unsigned long features_loop(unsigned long start_us) {
+    unsigned long t = start_us;
+    for (const FeatureModule& m : MODULES) {
+        if (!m.loop || (m.active && !m.active())) continue;
+        m.loop();
+        t = metrics_subsystem_done(m.metric, t);
+    }
+    return t;
+}
+
+int features_count() {
+    return MODULE_COUNT;
+}
+
+const FeatureModule& features_get(int i) {
+    return MODULES[i];
+}
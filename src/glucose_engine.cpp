@@ -1,4 +1,5 @@
 #include "glucose_engine.h"
+#include "engine_events.h"
 #include "hardware_pins.h"
 #include "display.h"
 #include "config_manager.h"
@@ -7,17 +8,31 @@
 #include "http_client.h"
 #include "time_engine.h"
 #include "trend_arrows.h"
-#include "weather_client.h"
+#include "glucose_lut.h"
 #include "buzzer.h"
-#include "timer_engine.h"
 #include "notify_engine.h"
+#include "feature_modules.h"
+#if FEATURE_WEATHER
+#include "weather_client.h"
+#include "weather_fx.h"
+#endif
+#if FEATURE_TIMER
+#include "timer_engine.h"
+#endif
+#if FEATURE_SYSMON
 #include "sysmon_engine.h"
+#endif
+#if FEATURE_COUNTDOWN
 #include "countdown_engine.h"
+#endif
+#include "improv_serial.h"
+#include "logger.h"
 #include <Arduino.h>
 
 #define STALE_WARNING_MS   (10UL * 60 * 1000)   // 10 minutes
 #define FAILURE_STALE_COUNT    5
 #define FAILURE_NODATA_COUNT   10
+#define WARM_START_WIFI_GRACE_MS 20000  // keep showing a cached reading while WiFi reconnects
 
 static DisplayState current_state = STATE_BOOT;
 static DisplayState forced_state = STATE_BOOT;
@@ -27,6 +42,18 @@ static DisplayState user_mode = STATE_GLUCOSE_DISPLAY;
 static char message_buf[128] = "";
 static unsigned long last_render_ms = 0;
 static unsigned long boot_start_ms = 0;
+static bool warm_start = false;
+
+// Event-driven evaluation: evaluate_state() runs only when an event has been
+// posted or the earliest time-based change it found last time comes due
+static uint32_t pending_events = 0;
+static bool deadline_set = false;
+static unsigned long deadline_ms = 0;
+static unsigned long evaluations = 0;
+
+static EngineTransition transitions[ENGINE_LOG_SLOTS];
+static int transition_head = 0;     // next slot to write
+static int transition_count = 0;
 
 // Delta display flash
 static int last_seen_glucose = 0;
@@ -46,96 +73,11 @@ static uint16_t color_from_uint32(uint32_t c) {
     return display_color((c >> 16) & 0xFF, (c >> 8) & 0xFF, c & 0xFF);
 }
 
-// --- Weather particle animation system ---
-struct WeatherParticle {
-    int16_t x10;   // fixed-point x * 10
-    int16_t y10;   // fixed-point y * 10
-    int16_t vx10;  // velocity x * 10
-    int16_t vy10;  // velocity y * 10
-    bool active;
-};
-
-#define MAX_PARTICLES 10
-static WeatherParticle particles[MAX_PARTICLES];
-
-// Returns animation type: 0=none, 1=rain, 2=drizzle, 3=snow, 4=thunderstorm
-static int weather_anim_type(int condition_id) {
-    if (condition_id >= 200 && condition_id < 300) return 4; // thunderstorm
-    if (condition_id >= 300 && condition_id < 400) return 2; // drizzle
-    if (condition_id >= 500 && condition_id < 600) return 1; // rain
-    if (condition_id >= 600 && condition_id < 700) return 3; // snow
-    return 0;
-}
-
-static void weather_particles_spawn(int anim_type) {
-    for (int i = 0; i < MAX_PARTICLES; i++) {
-        if (particles[i].active) continue;
-
-        // Probability of spawning each frame
-        if (anim_type == 2 && (random(100) > 15)) continue; // drizzle: fewer
-        if (anim_type == 1 && (random(100) > 40)) continue; // rain: moderate
-        if (anim_type == 3 && (random(100) > 30)) continue; // snow: moderate
-        if (anim_type == 4 && (random(100) > 50)) continue; // thunder: lots
-
-        particles[i].active = true;
-        particles[i].x10 = random(0, MATRIX_WIDTH) * 10;
-        particles[i].y10 = 0;
-        particles[i].vx10 = 0;
-
-        if (anim_type == 3) {
-            // Snow: slow, lateral wobble
-            particles[i].vy10 = random(5, 12);
-            particles[i].vx10 = random(-3, 4);
-        } else if (anim_type == 2) {
-            // Drizzle: moderate speed
-            particles[i].vy10 = random(10, 18);
-        } else {
-            // Rain / thunderstorm: fast
-            particles[i].vy10 = random(15, 26);
-        }
-    }
-}
-
-static void weather_particles_update_and_draw(int anim_type) {
-    for (int i = 0; i < MAX_PARTICLES; i++) {
-        if (!particles[i].active) continue;
-
-        particles[i].x10 += particles[i].vx10;
-        particles[i].y10 += particles[i].vy10;
-
-        int px = particles[i].x10 / 10;
-        int py = particles[i].y10 / 10;
-
-        if (py >= MATRIX_HEIGHT || px < 0 || px >= MATRIX_WIDTH) {
-            particles[i].active = false;
-            continue;
-        }
-
-        // Color based on type
-        uint16_t color;
-        if (anim_type == 3) {
-            color = display_color(200, 200, 255); // snow: white-blue
-        } else {
-            color = display_color(80, 130, 255);  // rain/drizzle: blue
-        }
-        display_draw_pixel(px, py, color);
-    }
-}
-
-// Thunder flash state
-static unsigned long next_flash_ms = 0;
-static unsigned long flash_end_ms = 0;
-
-// Track last weather render time to detect gaps from blocking fetches
-static unsigned long last_weather_render_ms = 0;
-
+#if FEATURE_WEATHER
 // Called by weather_client just before a blocking HTTP fetch.
-// Clears particle animations and renders a clean frame so the display
-// doesn't show frozen particles during the 1-3 second network call.
+// Renders a frame without particles so the display doesn't show them
+// frozen during the 1-3 second network call; they resume afterwards.
 static void on_weather_pre_fetch() {
-    // Reset all particles
-    for (int i = 0; i < MAX_PARTICLES; i++) particles[i].active = false;
-
     // Only force-render a clean frame if currently showing weather
     if (current_state == STATE_WEATHER_DISPLAY && weather_has_data()) {
         AppConfig& cfg = config_get();
@@ -152,6 +94,10 @@ static void on_weather_pre_fetch() {
         display_show();
     }
 }
+#endif // FEATURE_WEATHER
+
+static DisplayState evaluate_state();
+static void render_state(DisplayState state);
 
 // Data-driven toggle order
 static DisplayState toggle_order[12];
@@ -163,15 +109,24 @@ static unsigned long last_cycle_ms = 0;
 
 void engine_rebuild_toggle_order() {
     AppConfig& cfg = config_get();
+    (void)cfg;  // unused when every optional screen is compiled out
     toggle_count = 0;
     toggle_order[toggle_count++] = STATE_GLUCOSE_DISPLAY;
     toggle_order[toggle_count++] = STATE_TREND_DISPLAY;
     toggle_order[toggle_count++] = STATE_TIME_DISPLAY;
+#if FEATURE_WEATHER
     if (cfg.weather_enabled) toggle_order[toggle_count++] = STATE_WEATHER_DISPLAY;
+#endif
+#if FEATURE_TIMER
     if (cfg.timer_enabled) toggle_order[toggle_count++] = STATE_TIMER_DISPLAY;
     if (cfg.stopwatch_enabled) toggle_order[toggle_count++] = STATE_STOPWATCH_DISPLAY;
+#endif
+#if FEATURE_SYSMON
     if (cfg.sysmon_enabled && sysmon_has_data()) toggle_order[toggle_count++] = STATE_SYSMON_DISPLAY;
+#endif
+#if FEATURE_COUNTDOWN
     if (cfg.countdown_enabled) toggle_order[toggle_count++] = STATE_COUNTDOWN_DISPLAY;
+#endif
 
     // Reset toggle_index to match current user_mode
     for (int i = 0; i < toggle_count; i++) {
@@ -183,23 +138,6 @@ void engine_rebuild_toggle_order() {
     toggle_index = 0;
 }
 
-// Get color for glucose value using custom theme colors from config
-static uint16_t themed_glucose_color(int mg_dl, const AppConfig& cfg) {
-    uint32_t c;
-    if (mg_dl < cfg.thresh_urgent_low) {
-        c = cfg.color_urgent_low;
-    } else if (mg_dl < cfg.thresh_low) {
-        c = cfg.color_low;
-    } else if (mg_dl <= cfg.thresh_high) {
-        c = cfg.color_in_range;
-    } else if (mg_dl <= cfg.thresh_urgent_high) {
-        c = cfg.color_high;
-    } else {
-        c = cfg.color_urgent_high;
-    }
-    return display_color((c >> 16) & 0xFF, (c >> 8) & 0xFF, c & 0xFF);
-}
-
 uint16_t glucose_color(int mg_dl, const GlucoseThresholds& t) {
     if (mg_dl < t.urgent_low) {
         return display_color(255, 0, 0);      // RED - urgent low
@@ -264,15 +202,41 @@ static void check_alerts() {
 void engine_snooze_alerts() {
     AppConfig& cfg = config_get();
     alert_snooze_until_ms = millis() + (cfg.alert_snooze_min * 60000UL);
-    Serial.printf("[ENGINE] Alerts snoozed for %d minutes\n", cfg.alert_snooze_min);
+    LOG_I("ENGINE", "Alerts snoozed for %d minutes", cfg.alert_snooze_min);
+}
+
+// Remember when evaluate_state()'s answer may change without an event
+static void wake_at(unsigned long at_ms) {
+    if (!deadline_set || (long)(at_ms - deadline_ms) < 0) {
+        deadline_ms = at_ms;
+        deadline_set = true;
+    }
+}
+
+static void log_transition(DisplayState from, DisplayState to, uint32_t reasons) {
+    EngineTransition& t = transitions[transition_head];
+    t.uptime_ms = millis();
+    t.from = (uint8_t)from;
+    t.to = (uint8_t)to;
+    t.reasons = (uint16_t)reasons;
+    transition_head = (transition_head + 1) % ENGINE_LOG_SLOTS;
+    if (transition_count < ENGINE_LOG_SLOTS) transition_count++;
+}
+
+void engine_post_event(EngineEvent ev) {
+    __atomic_fetch_or(&pending_events, 1u << ev, __ATOMIC_RELEASE);
 }
 
 void engine_init() {
     current_state = STATE_BOOT;
     boot_start_ms = millis();
+    pending_events = 0;
+    deadline_set = false;
+    wake_at(boot_start_ms);
+    warm_start = http_is_warm_start();
 
     AppConfig& cfg = config_get();
-    if (cfg.default_mode == 2) {
+    if (cfg.default_mode == 2 && engine_state_built_in(STATE_WEATHER_DISPLAY)) {
         default_mode = STATE_WEATHER_DISPLAY;
     } else if (cfg.default_mode == 1) {
         default_mode = STATE_TIME_DISPLAY;
@@ -283,8 +247,19 @@ void engine_init() {
 
     engine_rebuild_toggle_order();
 
+#if FEATURE_WEATHER
     // Register pre-fetch callback so weather animations clear before blocking HTTP calls
     weather_set_pre_fetch_callback(on_weather_pre_fetch);
+#endif
+
+    // Warm start after a soft/watchdog reset: skip the marquee and show the
+    // cached reading right away while the first fetch runs
+    if (warm_start) {
+        current_state = evaluate_state();
+        LOG_I("ENGINE", "Warm start into %s", engine_state_name(current_state));
+        render_state(current_state);
+        return;
+    }
 
     // Show initial boot frame (scrolling animation starts in engine_loop)
     display_clear();
@@ -295,14 +270,26 @@ void engine_init() {
 static DisplayState evaluate_state() {
     AppConfig& cfg = config_get();
     unsigned long stale_ms = (unsigned long)cfg.stale_timeout_min * 60UL * 1000UL;
+    unsigned long since_boot = millis() - boot_start_ms;
+    deadline_set = false;
+    evaluations++;
+
+    // Improv provisioning from the web installer overrides everything
+    if (improv_is_active()) {
+        return STATE_PROVISIONING;
+    }
 
     // Boot screen: scroll "SugarClock" across the display
-    if (millis() - boot_start_ms < 3000) {
+    if (!warm_start && since_boot < 3000) {
+        wake_at(boot_start_ms + 3000);
         return STATE_BOOT;
     }
 
-    // No WiFi
-    if (!wifi_is_connected() && config_has_wifi()) {
+    // No WiFi (after a warm start, give WiFi time to come back before
+    // replacing the cached reading)
+    bool wifi_grace = warm_start && (since_boot < WARM_START_WIFI_GRACE_MS);
+    if (wifi_grace) wake_at(boot_start_ms + WARM_START_WIFI_GRACE_MS);
+    if (!wifi_is_connected() && config_has_wifi() && !wifi_grace) {
         return STATE_NO_WIFI;
     }
 
@@ -321,9 +308,10 @@ static DisplayState evaluate_state() {
     // Check for NO DATA conditions
     int failures = http_get_failure_count();
     if (failures >= FAILURE_NODATA_COUNT || !http_has_ever_received()) {
-        if (config_has_server() && millis() - boot_start_ms > 5000) {
+        if (config_has_server() && since_boot > 5000) {
             return STATE_NO_DATA;
         }
+        wake_at(boot_start_ms + 5001);
     }
 
     // Check staleness using configurable timeout
@@ -331,15 +319,16 @@ static DisplayState evaluate_state() {
     if (age >= stale_ms || failures >= FAILURE_STALE_COUNT) {
         return STATE_STALE_WARNING;
     }
+    wake_at(millis() + (stale_ms - age));
 
     // Server force override
-    if (state_forced) {
+    if (state_forced && engine_state_built_in(forced_state)) {
         return forced_state;
     }
 
     // Check for server-pushed force_mode
     const GlucoseReading& reading = http_get_reading();
-    if (reading.valid && reading.force_mode >= 0) {
+    if (reading.valid && reading.force_mode >= 0 && engine_state_built_in((DisplayState)reading.force_mode)) {
         return (DisplayState)reading.force_mode;
     }
 
@@ -381,13 +370,14 @@ static void render_state(DisplayState state) {
                 break;
             }
 
-            uint16_t color = themed_glucose_color(reading.glucose, cfg);
+            const GlucoseLutEntry& lut = glucose_lut_get(reading.glucose);
+            uint16_t color = glucose_lut_color(lut);
 
             // Check for stale warning (dim + yellow dot)
             unsigned long age = http_time_since_last_reading();
             unsigned long stale_warn_ms = STALE_WARNING_MS;
             unsigned long stale_ms = (unsigned long)cfg.stale_timeout_min * 60UL * 1000UL;
-            bool stale_warning = (age >= stale_warn_ms && age < stale_ms);
+            bool stale_warning = (age >= stale_warn_ms && age < stale_ms) || reading.from_cache;
 
             if (stale_warning) {
                 display_set_brightness(effective_brightness() / 3);
@@ -407,14 +397,8 @@ static void render_state(DisplayState state) {
             // Delta flash: show delta for a few seconds
             if (delta_flash_active && (millis() - delta_flash_start_ms < DELTA_FLASH_DURATION_MS)) {
                 display_clear();
-                int delta = http_get_delta();
                 char dbuf[8];
-                if (delta >= 0) {
-                    snprintf(dbuf, sizeof(dbuf), "+%d", delta);
-                } else {
-                    snprintf(dbuf, sizeof(dbuf), "%d", delta);
-                }
-                int dlen = strlen(dbuf);
+                int dlen = glucose_lut_format_delta(http_get_delta(), dbuf, sizeof(dbuf));
                 int dx = (MATRIX_WIDTH - dlen * 6) / 2;
                 display_draw_text(dbuf, dx, 0, color);
                 display_show();
@@ -423,15 +407,11 @@ static void render_state(DisplayState state) {
             delta_flash_active = false;
 
             // Normal glucose display
-            display_draw_glucose(reading.glucose, color);
+            display_draw_glucose(lut.text, lut.width, color);
 
             // Draw trend arrow to the right of the number
-            char buf[8];
-            snprintf(buf, sizeof(buf), "%d", reading.glucose);
-            int text_len = strlen(buf);
-            int total_width = text_len * 6 + 6;
-            int x_start = (MATRIX_WIDTH - total_width) / 2;
-            int arrow_x = x_start + text_len * 6 + 1;
+            int x_start = (MATRIX_WIDTH - (lut.width + 6)) / 2;
+            int arrow_x = x_start + lut.width + 1;
 
             if (reading.trend != TREND_UNKNOWN) {
                 display_draw_trend(reading.trend, arrow_x, 0, color);
@@ -491,49 +471,20 @@ static void render_state(DisplayState state) {
             break;
         }
 
+#if FEATURE_WEATHER
         case STATE_WEATHER_DISPLAY: {
             display_set_brightness(effective_brightness());
             display_clear();
 
-            // Detect render gaps caused by blocking weather fetches.
-            // If the last render was more than 500ms ago, a fetch likely just
-            // blocked the loop — reset particles so the animation restarts
-            // cleanly from the top instead of resuming mid-screen.
-            {
-                unsigned long now_wx = millis();
-                if (last_weather_render_ms > 0 &&
-                    (now_wx - last_weather_render_ms > 500)) {
-                    for (int i = 0; i < MAX_PARTICLES; i++)
-                        particles[i].active = false;
-                }
-                last_weather_render_ms = now_wx;
-            }
-
             if (!weather_has_data()) {
                 display_draw_text("WX...", 4, 0, color_from_uint32(cfg.color_weather));
             } else {
                 const WeatherReading& wx = weather_get_reading();
-                int anim = weather_anim_type(wx.condition_id);
-
-                // Spawn and draw weather particles behind text
-                if (anim > 0) {
-                    weather_particles_spawn(anim);
-                    weather_particles_update_and_draw(anim);
-
-                    // Thunder flash
-                    if (anim == 4) {
-                        unsigned long now = millis();
-                        if (now >= next_flash_ms && flash_end_ms == 0) {
-                            flash_end_ms = now + 80;
-                            next_flash_ms = now + random(3000, 5001);
-                        }
-                        if (flash_end_ms > 0 && now < flash_end_ms) {
-                            display_flash(255, 255, 255);
-                            display_show();
-                            break;
-                        }
-                        if (now >= flash_end_ms) flash_end_ms = 0;
-                    }
+
+                // Particles behind the text; a lightning flash covers everything
+                if (weather_fx_frame(wx, millis())) {
+                    display_flash(255, 255, 255);
+                    break;
                 }
 
                 char tbuf[8];
@@ -548,7 +499,9 @@ static void render_state(DisplayState state) {
             display_show();
             break;
         }
+#endif
 
+#if FEATURE_TIMER
         case STATE_TIMER_DISPLAY: {
             display_set_brightness(effective_brightness());
             display_clear();
@@ -607,7 +560,9 @@ static void render_state(DisplayState state) {
             display_show();
             break;
         }
+#endif
 
+#if FEATURE_SYSMON
         case STATE_SYSMON_DISPLAY: {
             display_set_brightness(effective_brightness());
             display_clear();
@@ -648,7 +603,9 @@ static void render_state(DisplayState state) {
             display_show();
             break;
         }
+#endif
 
+#if FEATURE_COUNTDOWN
         case STATE_COUNTDOWN_DISPLAY: {
             display_set_brightness(effective_brightness());
             display_clear();
@@ -679,6 +636,7 @@ static void render_state(DisplayState state) {
             display_show();
             break;
         }
+#endif
 
         case STATE_TREND_DISPLAY: {
             display_set_brightness(effective_brightness());
@@ -688,19 +646,14 @@ static void render_state(DisplayState state) {
             if (!reading.valid || reading.trend == TREND_UNKNOWN) {
                 display_draw_text("---", 7, 0, display_color(100, 100, 100));
             } else {
-                uint16_t tcolor = themed_glucose_color(reading.glucose, cfg);
+                uint16_t tcolor = glucose_lut_color(glucose_lut_get(reading.glucose));
 
                 // Draw 5x7 trend arrow at x=1
                 display_draw_trend(reading.trend, 1, 0, tcolor);
 
                 // Draw delta number at x=8
-                int delta = http_get_delta();
                 char dbuf[8];
-                if (delta >= 0) {
-                    snprintf(dbuf, sizeof(dbuf), "+%d", delta);
-                } else {
-                    snprintf(dbuf, sizeof(dbuf), "%d", delta);
-                }
+                glucose_lut_format_delta(http_get_delta(), dbuf, sizeof(dbuf));
                 display_draw_text(dbuf, 8, 0, tcolor);
             }
 
@@ -721,9 +674,9 @@ static void render_state(DisplayState state) {
                 int x = (MATRIX_WIDTH - len * 6) / 2;
                 display_draw_text(text, x, 0, color);
             } else {
-                // Scrolling
+                // Scrolling, from the right edge each time a notification comes up
                 int total_w = len * 6;
-                int offset = (millis() / 100) % (total_w + MATRIX_WIDTH);
+                int offset = (notify_shown_ms() / NOTIFY_SCROLL_MS_PER_PX) % (total_w + MATRIX_WIDTH);
                 display_draw_text(text, MATRIX_WIDTH - offset, 0, color);
             }
 
@@ -796,12 +749,39 @@ static void render_state(DisplayState state) {
             display_show();
             break;
         }
+
+        case STATE_PROVISIONING: {
+            display_clear();
+            bool joined = improv_get_phase() == IMPROV_PROVISIONED;
+            uint16_t color = joined ? display_color(0, 255, 0) : display_color(0, 200, 200);
+            display_draw_text("WIFI", 1, 0, color);
+            // Three-dot spinner while connecting, solid once joined
+            int lit = (millis() / 250) % 3;
+            for (int i = 0; i < 3; i++) {
+                bool on = joined || i == lit;
+                display_draw_pixel(26 + i * 2, 5, on ? color : display_color(0, 40, 40));
+            }
+            // Bottom row fills over the connect timeout
+            int fill = improv_connect_progress() * MATRIX_WIDTH / 100;
+            for (int x = 0; x < fill; x++) {
+                display_draw_pixel(x, MATRIX_HEIGHT - 1, display_color(0, 60, 60));
+            }
+            display_show();
+            break;
+        }
+
+        default:
+            break;  // screens compiled out (feature_modules.h)
     }
 }
 
 void engine_loop() {
-    // Throttle rendering
-    if (millis() - last_render_ms < RENDER_INTERVAL_MS) return;
+    // Throttle rendering (the weather animation runs faster)
+    unsigned long interval_ms = RENDER_INTERVAL_MS;
+#if FEATURE_WEATHER
+    if (current_state == STATE_WEATHER_DISPLAY) interval_ms = WEATHER_FX_FRAME_MS;
+#endif
+    if (millis() - last_render_ms < interval_ms) return;
     last_render_ms = millis();
 
     // Periodically rebuild toggle order (catches sysmon data appearing/disappearing)
@@ -820,16 +800,24 @@ void engine_loop() {
             last_cycle_ms = millis();
             toggle_index = (toggle_index + 1) % toggle_count;
             user_mode = toggle_order[toggle_index];
-            Serial.printf("[ENGINE] Auto-cycle to %s\n", engine_state_name(user_mode));
+            engine_post_event(ENGINE_EV_USER);
+            LOG_D("ENGINE", "Auto-cycle to %s", engine_state_name(user_mode));
         }
     }
 
-    DisplayState new_state = evaluate_state();
-    if (new_state != current_state) {
-        Serial.printf("[ENGINE] State: %s -> %s\n",
-                      engine_state_name(current_state),
-                      engine_state_name(new_state));
-        current_state = new_state;
+    uint32_t events = __atomic_exchange_n(&pending_events, 0, __ATOMIC_ACQUIRE);
+    if (deadline_set && (long)(millis() - deadline_ms) >= 0) {
+        events |= 1u << ENGINE_EV_TIMER;
+    }
+    if (events) {
+        DisplayState new_state = evaluate_state();
+        if (new_state != current_state) {
+            LOG_I("ENGINE", "State: %s -> %s",
+                  engine_state_name(current_state),
+                  engine_state_name(new_state));
+            log_transition(current_state, new_state, events);
+            current_state = new_state;
+        }
     }
 
     render_state(current_state);
@@ -863,17 +851,60 @@ const char* engine_state_name(DisplayState state) {
         case STATE_NO_DATA:           return "NO_DATA";
         case STATE_NO_WIFI:           return "NO_WIFI";
         case STATE_NO_CFG:            return "NO_CFG";
+        case STATE_PROVISIONING:      return "PROVISIONING";
         default:                      return "UNKNOWN";
     }
 }
 
+const char* engine_event_name(EngineEvent ev) {
+    switch (ev) {
+        case ENGINE_EV_READING:      return "reading";
+        case ENGINE_EV_FETCH_FAILED: return "fetch_failed";
+        case ENGINE_EV_WIFI:         return "wifi";
+        case ENGINE_EV_NOTIFY:       return "notify";
+        case ENGINE_EV_CONFIG:       return "config";
+        case ENGINE_EV_PROVISIONING: return "provisioning";
+        case ENGINE_EV_USER:         return "user";
+        case ENGINE_EV_TIMER:        return "timer";
+        default:                     return "unknown";
+    }
+}
+
+int engine_transition_count() {
+    return transition_count;
+}
+
+bool engine_get_transition(int i, EngineTransition* out) {
+    if (i < 0 || i >= transition_count) return false;
+    int oldest = (transition_head - transition_count + ENGINE_LOG_SLOTS) % ENGINE_LOG_SLOTS;
+    *out = transitions[(oldest + i) % ENGINE_LOG_SLOTS];
+    return true;
+}
+
+unsigned long engine_evaluation_count() {
+    return evaluations;
+}
+
+bool engine_state_built_in(DisplayState state) {
+    switch (state) {
+        case STATE_WEATHER_DISPLAY:   return FEATURE_WEATHER;
+        case STATE_TIMER_DISPLAY:
+        case STATE_STOPWATCH_DISPLAY: return FEATURE_TIMER;
+        case STATE_SYSMON_DISPLAY:    return FEATURE_SYSMON;
+        case STATE_COUNTDOWN_DISPLAY: return FEATURE_COUNTDOWN;
+        default:                      return true;
+    }
+}
+
 void engine_force_state(DisplayState state) {
     forced_state = state;
     state_forced = true;
+    engine_post_event(ENGINE_EV_USER);
 }
 
 void engine_clear_force() {
     state_forced = false;
+    engine_post_event(ENGINE_EV_USER);
 }
 
 void engine_set_message(const char* msg) {
@@ -881,37 +912,74 @@ void engine_set_message(const char* msg) {
     message_buf[sizeof(message_buf) - 1] = '\0';
 }
 
+const char* engine_get_message() {
+    return message_buf;
+}
+
+void engine_render_frame(DisplayState state) {
+    render_state(state);
+}
+
 void engine_set_default_mode(DisplayState mode) {
     default_mode = mode;
     user_mode = mode;
+    engine_post_event(ENGINE_EV_USER);
 }
 
 void engine_toggle_mode() {
     toggle_index = (toggle_index + 1) % toggle_count;
     user_mode = toggle_order[toggle_index];
+    engine_post_event(ENGINE_EV_USER);
     last_cycle_ms = millis(); // reset auto-cycle timer on manual toggle
-    Serial.printf("[ENGINE] Toggled to %s\n", engine_state_name(user_mode));
+    LOG_I("ENGINE", "Toggled to %s", engine_state_name(user_mode));
 }
 
 void engine_toggle_mode_prev() {
     toggle_index = (toggle_index - 1 + toggle_count) % toggle_count;
     user_mode = toggle_order[toggle_index];
+    engine_post_event(ENGINE_EV_USER);
     last_cycle_ms = millis(); // reset auto-cycle timer on manual toggle
-    Serial.printf("[ENGINE] Toggled prev to %s\n", engine_state_name(user_mode));
+    LOG_I("ENGINE", "Toggled prev to %s", engine_state_name(user_mode));
 }
 
 void engine_reset_auto_cycle() {
     last_cycle_ms = millis();
 }
 
+unsigned long engine_ms_until_shown(DisplayState state) {
+    if (current_state == state || user_mode == state) return 0;
+
+    AppConfig& cfg = config_get();
+    if (!cfg.auto_cycle_enabled || toggle_count < 2) return ULONG_MAX;
+    int steps = -1;
+    for (int i = 0; i < toggle_count; i++) {
+        if (toggle_order[i] == state) {
+            steps = (i - toggle_index + toggle_count) % toggle_count;
+            break;
+        }
+    }
+    if (steps <= 0) return ULONG_MAX;
+
+    unsigned long interval_ms = (unsigned long)cfg.auto_cycle_sec * 1000UL;
+    unsigned long elapsed = millis() - last_cycle_ms;
+    unsigned long left = elapsed < interval_ms ? interval_ms - elapsed : 0;
+    return left + (unsigned long)(steps - 1) * interval_ms;
+}
+
+bool engine_is_night_mode() {
+    return is_night_mode();
+}
+
 void engine_right_button_action() {
     switch (user_mode) {
+#if FEATURE_TIMER
         case STATE_TIMER_DISPLAY:
             timer_toggle_start_pause();
             break;
         case STATE_STOPWATCH_DISPLAY:
             stopwatch_toggle_start_pause();
             break;
+#endif
         default:
             // Navigate backwards through screens
             engine_toggle_mode_prev();
@@ -921,17 +989,19 @@ void engine_right_button_action() {
 
 void engine_right_long_action() {
     switch (user_mode) {
+#if FEATURE_TIMER
         case STATE_TIMER_DISPLAY:
             timer_reset();
             break;
         case STATE_STOPWATCH_DISPLAY:
             stopwatch_reset();
             break;
+#endif
         default:
             // Default: clear overrides
             engine_clear_force();
             engine_set_default_mode(STATE_GLUCOSE_DISPLAY);
-            Serial.println("[ENGINE] Overrides cleared");
+            LOG_I("ENGINE", "Overrides cleared");
             break;
     }
 }
@@ -0,0 +1,142 @@
+#include "glucose_lut.h"
+#include "config_manager.h"
+#include "display.h"
+#include "logger.h"
+#include <Arduino.h>
+#include <string.h>
+
+#define LUT_SIZE (GLUCOSE_LUT_MAX - GLUCOSE_LUT_MIN + 1)
+#define GLYPH_W  6          // 5x7 font plus one column of spacing
+#define MMOL_DIV 18018      // mg/dL per mmol/L, x1000
+
+static GlucoseLutEntry table[LUT_SIZE];
+static GlucoseLutEntry spare;    // readings outside the table
+
+// The settings the table was built from
+struct LutKey {
+    int thresh[4];
+    uint32_t colors[5];
+    bool use_mmol;
+    bool gradient;
+};
+static LutKey built_key;
+static bool built = false;
+static unsigned long build_count = 0;
+
+static LutKey key_from(const AppConfig& cfg) {
+    LutKey k;
+    memset(&k, 0, sizeof(k));   // padding too, the key is compared with memcmp
+    k.thresh[0] = cfg.thresh_urgent_low;
+    k.thresh[1] = cfg.thresh_low;
+    k.thresh[2] = cfg.thresh_high;
+    k.thresh[3] = cfg.thresh_urgent_high;
+    k.colors[0] = cfg.color_urgent_low;
+    k.colors[1] = cfg.color_low;
+    k.colors[2] = cfg.color_in_range;
+    k.colors[3] = cfg.color_high;
+    k.colors[4] = cfg.color_urgent_high;
+    k.use_mmol = cfg.use_mmol;
+    k.gradient = cfg.color_gradient;
+    return k;
+}
+
+static uint16_t packed_color(uint32_t c) {
+    return display_color((c >> 16) & 0xFF, (c >> 8) & 0xFF, c & 0xFF);
+}
+
+static uint32_t range_color(int mg_dl, const LutKey& k) {
+    if (mg_dl < k.thresh[0]) return k.colors[0];
+    if (mg_dl < k.thresh[1]) return k.colors[1];
+    if (mg_dl <= k.thresh[2]) return k.colors[2];
+    if (mg_dl <= k.thresh[3]) return k.colors[3];
+    return k.colors[4];
+}
+
+// Blend: the urgent colors hold beyond their thresholds, low and high are
+// pinned mid-band, in-range holds across the middle half of the range, and
+// values between pins are mixed
+static uint32_t gradient_color(int mg_dl, const LutKey& k) {
+    int quarter = (k.thresh[2] - k.thresh[1]) / 4;
+    const int at[6] = {
+        k.thresh[0], (k.thresh[0] + k.thresh[1]) / 2, k.thresh[1] + quarter,
+        k.thresh[2] - quarter, (k.thresh[2] + k.thresh[3]) / 2, k.thresh[3],
+    };
+    const uint32_t col[6] = {
+        k.colors[0], k.colors[1], k.colors[2],
+        k.colors[2], k.colors[3], k.colors[4],
+    };
+    if (mg_dl <= at[0]) return col[0];
+    for (int i = 1; i < 6; i++) {
+        if (mg_dl > at[i]) continue;
+        int span = at[i] - at[i - 1];
+        if (span <= 0) return col[i];
+        int t = (mg_dl - at[i - 1]) * 256 / span;
+        uint32_t out = 0;
+        for (int shift = 0; shift <= 16; shift += 8) {
+            int a = (col[i - 1] >> shift) & 0xFF;
+            int b = (col[i] >> shift) & 0xFF;
+            out |= (uint32_t)(a + (b - a) * t / 256) << shift;
+        }
+        return out;
+    }
+    return col[5];
+}
+
+static void fill_entry(GlucoseLutEntry& e, int mg_dl, const LutKey& k) {
+    int clamped = mg_dl < GLUCOSE_LUT_MIN ? GLUCOSE_LUT_MIN
+                : mg_dl > GLUCOSE_LUT_MAX ? GLUCOSE_LUT_MAX : mg_dl;
+    e.color = packed_color(range_color(mg_dl, k));
+    e.gradient = packed_color(gradient_color(clamped, k));
+    // Out-of-table readings come through the spare entry; past four digits
+    // it can't be a real reading, and the bound lets the text fit e.text
+    unsigned shown = mg_dl < 0 ? 0 : mg_dl > 9999 ? 9999 : mg_dl;
+    if (k.use_mmol) {
+        unsigned tenths = (shown * 10000 + MMOL_DIV / 2) / MMOL_DIV;
+        snprintf(e.text, sizeof(e.text), "%u.%u", tenths / 10, tenths % 10);
+    } else {
+        snprintf(e.text, sizeof(e.text), "%u", shown);
+    }
+    e.width = strlen(e.text) * GLYPH_W;
+}
+
+static void sync() {
+    LutKey k = key_from(config_get());
+    if (built && memcmp(&k, &built_key, sizeof(k)) == 0) return;
+
+    for (int i = 0; i < LUT_SIZE; i++) {
+        fill_entry(table[i], GLUCOSE_LUT_MIN + i, k);
+    }
+    built_key = k;
+    built = true;
+    build_count++;
+    LOG_D("LUT", "Glucose table rebuilt (%s%s)",
+          k.use_mmol ? "mmol/L" : "mg/dL", k.gradient ? ", blended" : "");
+}
+
+const GlucoseLutEntry& glucose_lut_get(int mg_dl) {
+    sync();
+    if (mg_dl >= GLUCOSE_LUT_MIN && mg_dl <= GLUCOSE_LUT_MAX) {
+        return table[mg_dl - GLUCOSE_LUT_MIN];
+    }
+    fill_entry(spare, mg_dl, built_key);
+    return spare;
+}
+
+uint16_t glucose_lut_color(const GlucoseLutEntry& e) {
+    return built_key.gradient ? e.gradient : e.color;
+}
+
+int glucose_lut_format_delta(int delta_mg_dl, char* buf, int len) {
+    sync();
+    char sign = delta_mg_dl < 0 ? '-' : '+';
+    int mag = delta_mg_dl < 0 ? -delta_mg_dl : delta_mg_dl;
+    if (built_key.use_mmol) {
+        int tenths = (mag * 10000 + MMOL_DIV / 2) / MMOL_DIV;
+        return snprintf(buf, len, "%c%d.%d", sign, tenths / 10, tenths % 10);
+    }
+    return snprintf(buf, len, "%c%d", sign, mag);
+}
+
+unsigned long glucose_lut_builds() {
+    return build_count;
+}
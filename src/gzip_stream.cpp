@@ -0,0 +1,177 @@
+#include "gzip_stream.h"
+#include <esp32/rom/miniz.h>
+#include <esp32/rom/crc.h>
+#include <new>
+
+struct GzipStream::State {
+    tinfl_decompressor inflator;
+    uint8_t window[TINFL_LZ_DICT_SIZE];
+    uint8_t in[GZIP_IN_CHUNK];
+};
+
+// gzip header flags
+#define GZ_FHCRC     0x02
+#define GZ_FEXTRA    0x04
+#define GZ_FNAME     0x08
+#define GZ_FCOMMENT  0x10
+
+GzipStream::GzipStream(Stream& src, int wire_len)
+    : src_(src), state_(new (std::nothrow) State), wire_left_(wire_len) {
+    static_assert(sizeof(State) <= GZIP_HEAP_BYTES, "GZIP_HEAP_BYTES too small");
+    if (!state_) return;
+    tinfl_init(&state_->inflator);
+    if (!skip_header()) failed_ = true;
+}
+
+GzipStream::~GzipStream() {
+    delete state_;
+}
+
+void GzipStream::tee(char* buf, size_t len) {
+    tee_ = buf;
+    tee_len_ = len;
+    tee_used_ = 0;
+    if (len > 0) buf[0] = '\0';
+}
+
+bool GzipStream::refill() {
+    if (in_eof_) return false;
+    in_pos_ = in_len_ = 0;
+    unsigned long start = millis();
+    int avail;
+    while ((avail = src_.available()) <= 0) {
+        if (wire_left_ == 0 || millis() - start >= GZIP_TIMEOUT_MS) {
+            in_eof_ = true;
+            return false;
+        }
+        delay(1);
+    }
+    size_t want = (size_t)avail < GZIP_IN_CHUNK ? (size_t)avail : GZIP_IN_CHUNK;
+    if (wire_left_ >= 0 && want > (size_t)wire_left_) want = wire_left_;
+    in_len_ = src_.readBytes((char*)state_->in, want);
+    if (wire_left_ >= 0) wire_left_ -= in_len_;
+    wire_bytes_ += in_len_;
+    if (in_len_ == 0) in_eof_ = true;
+    return in_len_ > 0;
+}
+
+int GzipStream::next_byte() {
+    if (in_pos_ == in_len_ && !refill()) return -1;
+    return state_->in[in_pos_++];
+}
+
+bool GzipStream::skip_header() {
+    uint8_t h[10];
+    for (uint8_t& b : h) {
+        int c = next_byte();
+        if (c < 0) return false;
+        b = (uint8_t)c;
+    }
+    if (h[0] != 0x1f || h[1] != 0x8b || h[2] != 8) return false;   // gzip, deflate
+    uint8_t flags = h[3];
+    if (flags & GZ_FEXTRA) {
+        int lo = next_byte(), hi = next_byte();
+        if (lo < 0 || hi < 0) return false;
+        for (int n = lo | (hi << 8); n > 0; n--) {
+            if (next_byte() < 0) return false;
+        }
+    }
+    for (uint8_t zero_terminated : { (uint8_t)GZ_FNAME, (uint8_t)GZ_FCOMMENT }) {
+        if (!(flags & zero_terminated)) continue;
+        int c;
+        while ((c = next_byte()) > 0) {}
+        if (c < 0) return false;
+    }
+    if (flags & GZ_FHCRC) {
+        if (next_byte() < 0 || next_byte() < 0) return false;
+    }
+    return true;
+}
+
+bool GzipStream::fill() {
+    if (!ok() || done_) return false;
+
+    // The window is circular: start over at the front once it is full
+    if (win_next_ == TINFL_LZ_DICT_SIZE) win_next_ = 0;
+    out_pos_ = out_end_ = win_next_;
+
+    while (out_end_ == out_pos_) {
+        if (in_pos_ == in_len_) refill();
+        size_t in_n = in_len_ - in_pos_;
+        size_t out_n = TINFL_LZ_DICT_SIZE - win_next_;
+        tinfl_status st = tinfl_decompress(&state_->inflator, state_->in + in_pos_, &in_n,
+                                           state_->window, state_->window + win_next_, &out_n,
+                                           in_eof_ ? 0 : TINFL_FLAG_HAS_MORE_INPUT);
+        in_pos_ += in_n;
+        if (out_n > 0) {
+            const uint8_t* out = state_->window + win_next_;
+            crc_ = crc32_le(crc_, out, out_n);
+            body_bytes_ += out_n;
+            if (tee_ && tee_used_ + 1 < tee_len_) {
+                size_t n = tee_len_ - 1 - tee_used_;
+                if (n > out_n) n = out_n;
+                memcpy(tee_ + tee_used_, out, n);
+                tee_used_ += n;
+                tee_[tee_used_] = '\0';
+            }
+            win_next_ += out_n;
+            out_end_ = win_next_;
+        }
+        if (st == TINFL_STATUS_DONE) {
+            done_ = true;
+            break;
+        }
+        if (st < 0 || (st == TINFL_STATUS_NEEDS_MORE_INPUT && in_eof_)) {
+            failed_ = true;   // corrupt or cut short
+            break;
+        }
+    }
+    return out_end_ > out_pos_;
+}
+
+bool GzipStream::finish() {
+    while (ok() && !done_) {
+        out_pos_ = out_end_;
+        fill();
+    }
+    if (!ok()) return false;
+
+    // Trailer: CRC-32 and length mod 2^32, little-endian
+    uint8_t t[8];
+    for (uint8_t& b : t) {
+        int c = next_byte();
+        if (c < 0) return false;
+        b = (uint8_t)c;
+    }
+    uint32_t crc = t[0] | (t[1] << 8) | (t[2] << 16) | ((uint32_t)t[3] << 24);
+    uint32_t size = t[4] | (t[5] << 8) | (t[6] << 16) | ((uint32_t)t[7] << 24);
+    return crc == crc_ && size == (uint32_t)body_bytes_;
+}
+
+int GzipStream::available() {
+    if (out_pos_ == out_end_ && !fill()) return 0;
+    return (int)(out_end_ - out_pos_);
+}
+
+int GzipStream::read() {
+    if (out_pos_ == out_end_ && !fill()) return -1;
+    return state_->window[out_pos_++];
+}
+
+int GzipStream::peek() {
+    if (out_pos_ == out_end_ && !fill()) return -1;
+    return state_->window[out_pos_];
+}
+
+size_t GzipStream::readBytes(char* buf, size_t len) {
+    size_t got = 0;
+    while (got < len) {
+        if (out_pos_ == out_end_ && !fill()) break;
+        size_t n = out_end_ - out_pos_;
+        if (n > len - got) n = len - got;
+        memcpy(buf + got, state_->window + out_pos_, n);
+        out_pos_ += n;
+        got += n;
+    }
+    return got;
+}
@@ -0,0 +1,100 @@
+#include "health_monitor.h"
+#include "time_engine.h"
+#include "logger.h"
+#include <Arduino.h>
+
+// Tasks are looked up by name on every sample: some come and go (the MQTT
+// task is recreated when its settings change), so handles aren't kept
+static HealthTask tasks[] = {
+    { "loopTask",  0, false },   // Arduino loop
+    { "async_tcp", 0, false },   // web server handlers
+    { "log",       0, false },   // logger drain
+    { "mqtt_task", 0, false },
+    { "tiT",       0, false },   // lwIP
+    { "wifi",      0, false },
+    { "sys_evt",   0, false },
+    { "esp_timer", 0, false },
+};
+#define TASK_COUNT (int)(sizeof(tasks) / sizeof(tasks[0]))
+
+static HealthSample ring[HEALTH_RING_SLOTS];
+static int ring_head = 0;     // next slot to write
+static int ring_count = 0;
+static HealthSample boot_sample;
+static bool have_boot_sample = false;
+static unsigned long next_sample_ms = 0;
+
+static void sample_tasks() {
+#ifndef SUGARCLOCK_SIM
+    for (int i = 0; i < TASK_COUNT; i++) {
+        TaskHandle_t h = xTaskGetHandle(tasks[i].name);
+        tasks[i].running = h != nullptr;
+        if (!h) continue;
+        uint32_t free_bytes = uxTaskGetStackHighWaterMark(h);  // bytes on ESP-IDF
+        if (tasks[i].stack_free_min == 0 || free_bytes < tasks[i].stack_free_min) {
+            tasks[i].stack_free_min = free_bytes;
+        }
+    }
+#endif
+}
+
+void health_init() {
+    next_sample_ms = millis() + HEALTH_FIRST_MS;
+}
+
+void health_sample_now() {
+    HealthSample s;
+    s.uptime_sec = time_get_uptime_sec();
+    s.free_heap = ESP.getFreeHeap();
+    s.largest_block = ESP.getMaxAllocHeap();
+    s.min_free_heap = ESP.getMinFreeHeap();
+
+    ring[ring_head] = s;
+    ring_head = (ring_head + 1) % HEALTH_RING_SLOTS;
+    if (ring_count < HEALTH_RING_SLOTS) ring_count++;
+    if (!have_boot_sample) {
+        boot_sample = s;
+        have_boot_sample = true;
+    }
+    sample_tasks();
+
+    LOG_D("HEALTH", "Heap %lu, largest %lu (%u%% frag), min %lu",
+          (unsigned long)s.free_heap, (unsigned long)s.largest_block,
+          health_frag_pct(s), (unsigned long)s.min_free_heap);
+}
+
+void health_loop() {
+    if ((long)(millis() - next_sample_ms) < 0) return;
+    next_sample_ms += HEALTH_SAMPLE_MS;
+    health_sample_now();
+}
+
+uint8_t health_frag_pct(const HealthSample& s) {
+    if (s.free_heap == 0 || s.largest_block >= s.free_heap) return 0;
+    return (uint8_t)(100 - (uint64_t)s.largest_block * 100 / s.free_heap);
+}
+
+int health_sample_count() {
+    return ring_count;
+}
+
+bool health_get_sample(int i, HealthSample* out) {
+    if (i < 0 || i >= ring_count) return false;
+    int oldest = (ring_head - ring_count + HEALTH_RING_SLOTS) % HEALTH_RING_SLOTS;
+    *out = ring[(oldest + i) % HEALTH_RING_SLOTS];
+    return true;
+}
+
+bool health_get_boot_sample(HealthSample* out) {
+    if (!have_boot_sample) return false;
+    *out = boot_sample;
+    return true;
+}
+
+int health_task_count() {
+    return TASK_COUNT;
+}
+
+const HealthTask& health_get_task(int i) {
+    return tasks[i];
+}
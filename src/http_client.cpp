@@ -1,15 +1,25 @@
 #include "http_client.h"
 #include "config_manager.h"
 #include "wifi_manager.h"
-#include <WiFiClientSecure.h>
+#include "net_client.h"
+#include "net_scheduler.h"
+#include "perf_stats.h"
+#include "lan_share.h"
+#include "engine_events.h"
+#include "logger.h"
+#include "scratch.h"
 #include <HTTPClient.h>
 #include <ArduinoJson.h>
 #include <Arduino.h>
+#include <esp_system.h>
+#include <esp32/rom/crc.h>
+#include <time.h>
 
 // Dexcom Share constants
 #define DEXCOM_APP_ID "d89443d2-327c-4a6f-89e5-496bbb0317db"
-#define DEXCOM_US_BASE "https://share2.dexcom.com/ShareWebServices/Services"
-#define DEXCOM_OUS_BASE "https://shareous1.dexcom.com/ShareWebServices/Services"
+#define DEXCOM_US_HOST "https://share2.dexcom.com"
+#define DEXCOM_OUS_HOST "https://shareous1.dexcom.com"
+#define DEXCOM_SERVICES_PATH "/ShareWebServices/Services"
 #define DEXCOM_AUTH_PATH "/General/AuthenticatePublisherAccount"
 #define DEXCOM_LOGIN_PATH "/General/LoginPublisherAccountById"
 #define DEXCOM_GLUCOSE_PATH "/Publisher/ReadPublisherLatestGlucoseValues"
@@ -39,6 +49,113 @@ static int history_count = 0;
 static char dexcom_session_id[64] = "";
 static unsigned long dexcom_session_time_ms = 0;
 
+// Warm-start cache in RTC memory. RTC_NOINIT survives software and
+// watchdog resets (but not power loss), so after a crash the last reading
+// can be shown immediately instead of the boot marquee and NO DATA.
+#define WARM_CACHE_MAGIC        0x57524D31  // "WRM1"
+#define WARM_MIN_VALID_EPOCH    1600000000UL
+#define WARM_UNKNOWN_AGE_MS     (10UL * 60 * 1000) // assume stale-warning age if wall clock is unknown
+
+struct WarmCache {
+    uint32_t magic;
+    GlucoseReading reading;
+    int delta;
+    int prev_glucose;
+    unsigned long last_recorded_timestamp;
+    unsigned long saved_epoch;      // wall-clock seconds at save (0 if unknown)
+    unsigned long saved_ms;         // millis() at save, to rebase history timestamps
+    int history_write_idx;
+    int history_count;
+    GlucoseHistoryEntry history[GLUCOSE_HISTORY_SIZE];
+    uint32_t crc;                   // crc32 of everything above
+};
+
+RTC_NOINIT_ATTR static WarmCache warm_cache;
+static bool warm_started = false;
+
+static uint32_t warm_cache_crc() {
+    return crc32_le(0, (const uint8_t*)&warm_cache, offsetof(WarmCache, crc));
+}
+
+static unsigned long wall_clock_now() {
+    time_t now = time(nullptr);
+    return (now > (time_t)WARM_MIN_VALID_EPOCH) ? (unsigned long)now : 0;
+}
+
+// Snapshot the latest reading, delta and history into RTC memory
+static void warm_cache_save() {
+    warm_cache.magic = WARM_CACHE_MAGIC;
+    warm_cache.reading = current_reading;
+    warm_cache.reading.from_cache = false;
+    warm_cache.delta = current_delta;
+    warm_cache.prev_glucose = prev_glucose;
+    warm_cache.last_recorded_timestamp = last_recorded_timestamp;
+    warm_cache.saved_epoch = wall_clock_now();
+    warm_cache.saved_ms = millis();
+    warm_cache.history_write_idx = history_write_idx;
+    warm_cache.history_count = history_count;
+    memcpy(warm_cache.history, history_buf, sizeof(history_buf));
+    warm_cache.crc = warm_cache_crc();
+}
+
+// Restore the snapshot after a soft/watchdog reset. The reading keeps its
+// real age (from the CGM timestamp when the wall clock survived the reset)
+// and is flagged from_cache so the display marks it stale until refreshed.
+static bool warm_cache_restore() {
+    esp_reset_reason_t reason = esp_reset_reason();
+    if (reason == ESP_RST_POWERON || reason == ESP_RST_BROWNOUT || reason == ESP_RST_UNKNOWN) {
+        warm_cache.magic = 0;
+        return false;
+    }
+    if (warm_cache.magic != WARM_CACHE_MAGIC || warm_cache.crc != warm_cache_crc()) {
+        return false;
+    }
+    if (!warm_cache.reading.valid ||
+        warm_cache.history_count < 0 || warm_cache.history_count > GLUCOSE_HISTORY_SIZE ||
+        warm_cache.history_write_idx < 0 || warm_cache.history_write_idx >= GLUCOSE_HISTORY_SIZE) {
+        return false;
+    }
+
+    // Age of the reading itself, and time elapsed since the snapshot was taken
+    unsigned long now_epoch = wall_clock_now();
+    unsigned long age_ms = WARM_UNKNOWN_AGE_MS;
+    unsigned long since_save_ms = WARM_UNKNOWN_AGE_MS;
+    if (now_epoch > 0 && warm_cache.saved_epoch > 0 && now_epoch >= warm_cache.saved_epoch) {
+        since_save_ms = (now_epoch - warm_cache.saved_epoch) * 1000UL;
+        age_ms = since_save_ms;
+    }
+    if (now_epoch > 0 && warm_cache.reading.timestamp > 0 && now_epoch >= warm_cache.reading.timestamp) {
+        age_ms = (now_epoch - warm_cache.reading.timestamp) * 1000UL;
+    }
+
+    // millis() restarted at 0; unsigned wrap-around keeps (millis() - t) equal to the age
+    unsigned long now_ms = millis();
+    current_reading = warm_cache.reading;
+    current_reading.received_at_ms = now_ms - age_ms;
+    current_reading.force_mode = -1;
+    current_reading.from_cache = true;
+    last_success_ms = now_ms - age_ms;
+    if (last_success_ms == 0) last_success_ms = 1;
+    ever_received = true;
+
+    current_delta = warm_cache.delta;
+    prev_glucose = warm_cache.prev_glucose;
+    has_prev_reading = true;
+    last_recorded_timestamp = warm_cache.last_recorded_timestamp;
+
+    history_write_idx = warm_cache.history_write_idx;
+    history_count = warm_cache.history_count;
+    for (int i = 0; i < GLUCOSE_HISTORY_SIZE; i++) {
+        history_buf[i] = warm_cache.history[i];
+        unsigned long rel_ms = warm_cache.saved_ms - history_buf[i].timestamp;
+        history_buf[i].timestamp = now_ms - since_save_ms - rel_ms;
+    }
+
+    LOG_I("HTTP", "Warm start: %d mg/dL from RTC cache, age %lus, %d history entries",
+          current_reading.glucose, age_ms / 1000, history_count);
+    return true;
+}
+
 // Record a glucose value to history and update delta.
 // reading_timestamp is the CGM timestamp (epoch seconds) so we can skip
 // duplicate readings that arrive when we poll faster than the CGM updates.
@@ -66,7 +183,17 @@ static void record_reading(int glucose, unsigned long reading_timestamp) {
         history_count++;
     }
 
-    Serial.printf("[HTTP] Delta: %+d (prev: %d, now: %d)\n", current_delta, prev_glucose - current_delta, glucose);
+    LOG_D("HTTP", "Delta: %+d (prev: %d, now: %d)", current_delta, prev_glucose - current_delta, glucose);
+}
+
+// Bookkeeping for a freshly parsed, valid current_reading
+static void commit_reading() {
+    current_reading.from_cache = false;
+    record_reading(current_reading.glucose, current_reading.timestamp);
+    failure_count = 0;
+    ever_received = true;
+    last_success_ms = millis();
+    warm_cache_save();
 }
 
 // Parse trend string to enum
@@ -96,14 +223,26 @@ static TrendType parse_trend_number(int trend) {
     }
 }
 
+// Helper: Share web services root, honoring the configured host override
+static void dexcom_base(char* buf, size_t len) {
+    AppConfig& cfg = config_get();
+    const char* host = cfg.dexcom_base_url;
+    if (strlen(host) == 0) {
+        host = cfg.dexcom_us ? DEXCOM_US_HOST : DEXCOM_OUS_HOST;
+    }
+    // Tolerate a trailing slash on the override
+    size_t host_len = strlen(host);
+    if (host_len > 0 && host[host_len - 1] == '/') host_len--;
+    snprintf(buf, len, "%.*s%s", (int)host_len, host, DEXCOM_SERVICES_PATH);
+}
+
 // Helper: POST JSON to Dexcom endpoint, return response string
 static String dexcom_post(const char* url, const String& body, int& httpCode) {
-    WiFiClientSecure client;
-    client.setInsecure();
-    client.setTimeout(15);
+    WiFiClient plain;
+    TlsClient tls;
 
     HTTPClient http;
-    if (!http.begin(client, url)) {
+    if (!net_begin(http, plain, tls, url, 15)) {
         httpCode = -1;
         return "";
     }
@@ -121,17 +260,20 @@ static String dexcom_post(const char* url, const String& body, int& httpCode) {
 // Dexcom Share: two-step authenticate and get session ID
 static bool dexcom_login() {
     AppConfig& cfg = config_get();
-    const char* base = cfg.dexcom_us ? DEXCOM_US_BASE : DEXCOM_OUS_BASE;
+    char base[160];
+    dexcom_base(base, sizeof(base));
 
     // Step 1: AuthenticatePublisherAccount (get account ID)
-    JsonDocument authDoc;
+    ScratchScope scope;
+    JsonDocument authDoc(scope.json());
     authDoc["accountName"] = cfg.dexcom_username;
     authDoc["password"] = cfg.dexcom_password;
     authDoc["applicationId"] = DEXCOM_APP_ID;
     String authBody;
     serializeJson(authDoc, authBody);
 
-    Serial.printf("[DEXCOM] Auth as '%s' (%s)...\n", cfg.dexcom_username, cfg.dexcom_us ? "US" : "OUS");
+    LOG_I("DEXCOM", "Auth as '%s' (%s)...", cfg.dexcom_username,
+          strlen(cfg.dexcom_base_url) > 0 ? base : (cfg.dexcom_us ? "US" : "OUS"));
 
     char auth_url[256];
     snprintf(auth_url, sizeof(auth_url), "%s%s", base, DEXCOM_AUTH_PATH);
@@ -141,10 +283,10 @@ static bool dexcom_login() {
     strncpy(last_response_body, authResp.c_str(), sizeof(last_response_body) - 1);
     last_response_code = authCode;
 
-    Serial.printf("[DEXCOM] Auth step 1: HTTP %d, body: %.60s\n", authCode, authResp.c_str());
+    LOG_D("DEXCOM", "Auth step 1: HTTP %d, body: %.60s", authCode, authResp.c_str());
 
     if (authCode != HTTP_CODE_OK) {
-        Serial.printf("[DEXCOM] Auth failed: HTTP %d\n", authCode);
+        LOG_E("DEXCOM", "Auth failed: HTTP %d", authCode);
         return false;
     }
 
@@ -154,7 +296,7 @@ static bool dexcom_login() {
     accountId.replace("\"", "");
 
     // Step 2: LoginPublisherAccountById (get session ID using account ID)
-    JsonDocument loginDoc;
+    JsonDocument loginDoc(scope.json());
     loginDoc["accountId"] = accountId;
     loginDoc["password"] = cfg.dexcom_password;
     loginDoc["applicationId"] = DEXCOM_APP_ID;
@@ -169,7 +311,7 @@ static bool dexcom_login() {
     strncpy(last_response_body, loginResp.c_str(), sizeof(last_response_body) - 1);
     last_response_code = loginCode;
 
-    Serial.printf("[DEXCOM] Auth step 2: HTTP %d, body: %.60s\n", loginCode, loginResp.c_str());
+    LOG_D("DEXCOM", "Auth step 2: HTTP %d, body: %.60s", loginCode, loginResp.c_str());
 
     if (loginCode == HTTP_CODE_OK) {
         loginResp.trim();
@@ -177,26 +319,24 @@ static bool dexcom_login() {
 
         // Check for null session (means Share not enabled or no followers)
         if (loginResp == DEXCOM_NULL_SESSION || loginResp.length() < 10) {
-            Serial.println("[DEXCOM] Got null session! Dexcom Share may not be enabled.");
-            Serial.println("[DEXCOM] Enable Share in Dexcom app: Settings > Share > enable sharing");
+            LOG_E("DEXCOM", "Got null session! Dexcom Share may not be enabled.");
+            LOG_W("DEXCOM", "Enable Share in Dexcom app: Settings > Share > enable sharing");
             strncpy(last_response_body, "Null session - enable Dexcom Share in app", sizeof(last_response_body) - 1);
             return false;
         }
 
         strncpy(dexcom_session_id, loginResp.c_str(), sizeof(dexcom_session_id) - 1);
         dexcom_session_time_ms = millis();
-        Serial.printf("[DEXCOM] Login OK, session: %.8s...\n", dexcom_session_id);
+        LOG_I("DEXCOM", "Login OK, session: %.8s...", dexcom_session_id);
         return true;
     }
 
-    Serial.printf("[DEXCOM] Login failed: HTTP %d\n", loginCode);
+    LOG_E("DEXCOM", "Login failed: HTTP %d", loginCode);
     return false;
 }
 
 // Dexcom Share: fetch latest glucose reading
 static bool dexcom_fetch_glucose() {
-    AppConfig& cfg = config_get();
-
     // Check if session needs refresh
     if (strlen(dexcom_session_id) == 0 ||
         (millis() - dexcom_session_time_ms > DEXCOM_SESSION_LIFETIME_MS)) {
@@ -206,39 +346,38 @@ static bool dexcom_fetch_glucose() {
         }
     }
 
-    const char* base = cfg.dexcom_us ? DEXCOM_US_BASE : DEXCOM_OUS_BASE;
+    char base[160];
+    dexcom_base(base, sizeof(base));
     char url[384];
     snprintf(url, sizeof(url), "%s%s?sessionId=%s&minutes=10&maxCount=1",
              base, DEXCOM_GLUCOSE_PATH, dexcom_session_id);
 
-    WiFiClientSecure client;
-    client.setInsecure();
-    client.setTimeout(10);
+    WiFiClient plain;
+    TlsClient tls;
 
     HTTPClient http;
-    if (!http.begin(client, url)) {
-        Serial.println("[DEXCOM] Fetch: failed to begin");
+    if (!net_begin(http, plain, tls, url, 10)) {
+        LOG_E("DEXCOM", "Fetch: failed to begin");
         failure_count++;
         return false;
     }
 
     http.setTimeout(15000);
     http.addHeader("Accept", "application/json");
+    net_request_headers(http);
 
     int httpCode = http.POST(""); // Dexcom requires POST even for reads
     last_response_code = httpCode;
 
     if (httpCode == HTTP_CODE_OK) {
-        String payload = http.getString();
-        strncpy(last_response_body, payload.c_str(), sizeof(last_response_body) - 1);
-        last_response_body[sizeof(last_response_body) - 1] = '\0';
-
         // Parse JSON array response
-        JsonDocument doc;
-        DeserializationError err = deserializeJson(doc, payload);
+        ScratchScope scope;
+        JsonDocument doc(scope.json());
+        DeserializationError err = net_read_json(http, NET_SRC_DEXCOM, doc,
+                                                 last_response_body, sizeof(last_response_body));
 
         if (err) {
-            Serial.printf("[DEXCOM] JSON parse error: %s\n", err.c_str());
+            LOG_E("DEXCOM", "JSON parse error: %s", err.c_str());
             failure_count++;
             http.end();
             return false;
@@ -247,7 +386,7 @@ static bool dexcom_fetch_glucose() {
         // Response is an array, get first element
         JsonArray arr = doc.as<JsonArray>();
         if (arr.size() == 0) {
-            Serial.println("[DEXCOM] Empty glucose array");
+            LOG_W("DEXCOM", "Empty glucose array");
             failure_count++;
             http.end();
             return false;
@@ -282,13 +421,10 @@ static bool dexcom_fetch_glucose() {
         current_reading.valid = (current_reading.glucose > 0);
 
         if (current_reading.valid) {
-            record_reading(current_reading.glucose, current_reading.timestamp);
-            failure_count = 0;
-            ever_received = true;
-            last_success_ms = millis();
-            Serial.printf("[DEXCOM] Glucose: %d, Trend: %s\n",
-                          current_reading.glucose,
-                          TREND_NAMES[current_reading.trend]);
+            commit_reading();
+            LOG_I("DEXCOM", "Glucose: %d, Trend: %s",
+                  current_reading.glucose,
+                  TREND_NAMES[current_reading.trend]);
         } else {
             failure_count++;
         }
@@ -299,13 +435,12 @@ static bool dexcom_fetch_glucose() {
 
     // Session expired? Try re-login
     if (httpCode == 500) {
-        Serial.println("[DEXCOM] Session expired, re-authenticating");
+        LOG_W("DEXCOM", "Session expired, re-authenticating");
         dexcom_session_id[0] = '\0';
     }
 
-    String resp = http.getString();
-    strncpy(last_response_body, resp.c_str(), sizeof(last_response_body) - 1);
-    Serial.printf("[DEXCOM] Fetch failed: HTTP %d\n", httpCode);
+    net_read_text(http, NET_SRC_DEXCOM, last_response_body, sizeof(last_response_body));
+    LOG_E("DEXCOM", "Fetch failed: HTTP %d", httpCode);
     failure_count++;
     http.end();
     return false;
@@ -315,15 +450,14 @@ static bool dexcom_fetch_glucose() {
 static void generic_fetch() {
     AppConfig& cfg = config_get();
 
-    WiFiClientSecure client;
-    client.setInsecure();
-    client.setTimeout(10);
+    WiFiClient plain;
+    TlsClient tls;
 
     HTTPClient http;
-    Serial.printf("[HTTP] Polling: %s\n", cfg.server_url);
+    LOG_D("HTTP", "Polling: %s", cfg.server_url);
 
-    if (!http.begin(client, cfg.server_url)) {
-        Serial.println("[HTTP] Failed to begin connection");
+    if (!net_begin(http, plain, tls, cfg.server_url, 10)) {
+        LOG_E("HTTP", "Failed to begin connection");
         failure_count++;
         last_response_code = -1;
         return;
@@ -337,20 +471,19 @@ static void generic_fetch() {
         snprintf(auth_header, sizeof(auth_header), "Bearer %s", cfg.auth_token);
         http.addHeader("Authorization", auth_header);
     }
+    net_request_headers(http);
 
     int httpCode = http.GET();
     last_response_code = httpCode;
 
     if (httpCode == HTTP_CODE_OK) {
-        String payload = http.getString();
-        strncpy(last_response_body, payload.c_str(), sizeof(last_response_body) - 1);
-        last_response_body[sizeof(last_response_body) - 1] = '\0';
-
-        JsonDocument doc;
-        DeserializationError err = deserializeJson(doc, payload);
+        ScratchScope scope;
+        JsonDocument doc(scope.json());
+        DeserializationError err = net_read_json(http, NET_SRC_SERVER, doc,
+                                                 last_response_body, sizeof(last_response_body));
 
         if (err) {
-            Serial.printf("[HTTP] JSON parse error: %s\n", err.c_str());
+            LOG_E("HTTP", "JSON parse error: %s", err.c_str());
             failure_count++;
         } else {
             current_reading.glucose = doc["glucose"] | 0;
@@ -367,20 +500,17 @@ static void generic_fetch() {
             current_reading.message[sizeof(current_reading.message) - 1] = '\0';
 
             if (current_reading.valid) {
-                record_reading(current_reading.glucose, current_reading.timestamp);
-                failure_count = 0;
-                ever_received = true;
-                last_success_ms = millis();
-                Serial.printf("[HTTP] Glucose: %d, Trend: %s\n",
-                              current_reading.glucose,
-                              TREND_NAMES[current_reading.trend]);
+                commit_reading();
+                LOG_I("HTTP", "Glucose: %d, Trend: %s",
+                      current_reading.glucose,
+                      TREND_NAMES[current_reading.trend]);
             } else {
                 failure_count++;
-                Serial.println("[HTTP] Invalid glucose value");
+                LOG_W("HTTP", "Invalid glucose value");
             }
         }
     } else {
-        Serial.printf("[HTTP] Error: %d\n", httpCode);
+        LOG_E("HTTP", "Error: %d", httpCode);
         snprintf(last_response_body, sizeof(last_response_body), "HTTP %d", httpCode);
         failure_count++;
     }
@@ -388,6 +518,34 @@ static void generic_fetch() {
     http.end();
 }
 
+// Fetch from the configured source, recording how long the loop was blocked
+static bool timed_fetch() {
+    AppConfig& cfg = config_get();
+    unsigned long start = millis();
+    bool ok;
+
+    if (cfg.data_source == 1) {
+        ok = dexcom_fetch_glucose();
+    } else {
+        generic_fetch();
+        ok = current_reading.valid;
+    }
+
+    perf_fetch_sample(PERF_GLUCOSE, millis() - start, last_response_code);
+    engine_post_event(ok ? ENGINE_EV_READING : ENGINE_EV_FETCH_FAILED);
+    if (ok) lan_share_publish();
+    return ok;
+}
+
+// Scheduler job: WiFi or the source may have gone since it was requested
+static bool glucose_job() {
+    if (!wifi_is_connected()) return false;
+    if (!config_has_server()) return false;
+
+    last_poll_ms = millis(); // the interval runs from the actual fetch
+    return timed_fetch();
+}
+
 void http_init() {
     memset(&current_reading, 0, sizeof(GlucoseReading));
     current_reading.valid = false;
@@ -403,6 +561,9 @@ void http_init() {
     current_delta = 0;
     prev_glucose = 0;
     last_recorded_timestamp = 0;
+
+    warm_started = warm_cache_restore();
+    net_sched_register(NET_JOB_GLUCOSE, glucose_job);
 }
 
 void http_loop() {
@@ -411,19 +572,16 @@ void http_loop() {
 
     AppConfig& cfg = config_get();
 
+    // A LAN leader is supplying readings
+    if (!lan_share_should_poll()) return;
+
     unsigned long interval_ms = max(15, cfg.poll_interval_sec) * 1000UL;
 
     if (last_poll_ms != 0 && (millis() - last_poll_ms < interval_ms)) {
         return;
     }
 
-    last_poll_ms = millis();
-
-    if (cfg.data_source == 1) {
-        dexcom_fetch_glucose();
-    } else {
-        generic_fetch();
-    }
+    if (!net_sched_pending(NET_JOB_GLUCOSE)) net_sched_request(NET_JOB_GLUCOSE);
 }
 
 const GlucoseReading& http_get_reading() {
@@ -457,21 +615,35 @@ int http_get_delta() {
     return current_delta;
 }
 
-bool http_force_fetch() {
-    if (!wifi_is_connected()) return false;
-    if (!config_has_server()) return false;
+void http_set_reading(const GlucoseReading& reading) {
+    current_reading = reading;
+    engine_post_event(ENGINE_EV_READING);
+}
 
-    AppConfig& cfg = config_get();
-    last_poll_ms = millis(); // reset timer so regular loop doesn't re-fetch
+void http_apply_shared_reading(int glucose, TrendType trend, unsigned long timestamp, unsigned long age_ms) {
+    if (current_reading.valid && timestamp < current_reading.timestamp) return;
+    bool is_new = !current_reading.valid || timestamp != current_reading.timestamp;
 
-    if (cfg.data_source == 1) {
-        return dexcom_fetch_glucose();
-    } else {
-        generic_fetch();
-        return current_reading.valid;
+    current_reading.glucose = glucose;
+    current_reading.trend = trend;
+    current_reading.timestamp = timestamp;
+    current_reading.received_at_ms = millis() - age_ms;
+    current_reading.force_mode = -1;
+    current_reading.message[0] = '\0';
+    current_reading.valid = true;
+    commit_reading();
+    last_success_ms = millis() - age_ms;
+    engine_post_event(ENGINE_EV_READING);
+
+    if (is_new) {
+        LOG_I("HTTP", "Glucose from LAN: %d, Trend: %s", glucose, TREND_NAMES[trend]);
     }
 }
 
+bool http_is_warm_start() {
+    return warm_started;
+}
+
 int http_get_history(GlucoseHistoryEntry* out, int max_count) {
     if (history_count == 0) return 0;
 
@@ -1,6 +1,9 @@
 #include "improv_serial.h"
 #include "config_manager.h"
 #include "wifi_manager.h"
+#include "engine_events.h"
+#include "logger.h"
+#include "scratch.h"
 #include <WiFi.h>
 #include <Arduino.h>
 
@@ -34,6 +37,7 @@
 #define IMPROV_BUF_SIZE 256
 #define IMPROV_HEADER_LEN 9  // "IMPROV" (6) + version (1) + type (1) + length (1)
 #define WIFI_CONNECT_TIMEOUT 15000
+#define RESTART_DELAY_MS     1000
 
 static uint8_t rx_buf[IMPROV_BUF_SIZE];
 static int rx_pos = 0;
@@ -41,8 +45,11 @@ static bool active = false;
 
 static const uint8_t HEADER[] = {'I', 'M', 'P', 'R', 'O', 'V'};
 
+// One write per packet: log lines share the UART and must not land mid-frame
 static void send_packet(uint8_t type, const uint8_t* data, uint8_t len) {
-    uint8_t packet[IMPROV_BUF_SIZE];
+    ScratchScope scope;
+    uint8_t* packet = (uint8_t*)scope.alloc(IMPROV_HEADER_LEN + len + 1);
+    if (!packet) return;
     int pos = 0;
 
     // Header
@@ -71,7 +78,9 @@ static void send_error(uint8_t error) {
 }
 
 static void send_rpc_result(uint8_t command, const char* url) {
-    uint8_t data[IMPROV_BUF_SIZE];
+    ScratchScope scope;
+    uint8_t* data = (uint8_t*)scope.alloc(IMPROV_BUF_SIZE);
+    if (!data) return;
     int pos = 0;
 
     data[pos++] = command;
@@ -90,7 +99,35 @@ static void send_rpc_result(uint8_t command, const char* url) {
     send_packet(TYPE_RPC_RESULT, data, pos);
 }
 
+// Provisioning runs as a state machine: the RPC handler only starts the
+// connection, Wi-Fi events and improv_loop() finish it without blocking
+static ImprovPhase phase = IMPROV_IDLE;
+static char pending_ssid[64] = "";
+static char pending_password[64] = "";
+static unsigned long phase_start_ms = 0;
+
+// Set from the Wi-Fi event task, consumed in improv_loop()
+static volatile bool evt_got_ip = false;
+static volatile bool evt_auth_failed = false;
+
+static void on_wifi_event(arduino_event_id_t event, arduino_event_info_t info) {
+    if (phase != IMPROV_CONNECTING) return;
+    if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP) {
+        evt_got_ip = true;
+    } else if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) {
+        uint8_t reason = info.wifi_sta_disconnected.reason;
+        if (reason == WIFI_REASON_AUTH_FAIL || reason == WIFI_REASON_HANDSHAKE_TIMEOUT ||
+            reason == WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT) {
+            evt_auth_failed = true;
+        }
+    }
+}
+
 static void handle_wifi_settings(const uint8_t* data, uint8_t len) {
+    if (phase != IMPROV_IDLE) {
+        LOG_W("IMPROV", "Provisioning already in progress");
+        return;
+    }
     if (len < 2) {
         send_error(ERROR_INVALID_RPC);
         return;
@@ -100,13 +137,12 @@ static void handle_wifi_settings(const uint8_t* data, uint8_t len) {
 
     // Read SSID (length-prefixed string)
     uint8_t ssid_len = data[pos++];
-    if (pos + ssid_len > len) {
+    if (pos + ssid_len > len || ssid_len >= sizeof(pending_ssid)) {
         send_error(ERROR_INVALID_RPC);
         return;
     }
-    char ssid[64] = {0};
-    memcpy(ssid, data + pos, ssid_len);
-    ssid[ssid_len] = '\0';
+    memcpy(pending_ssid, data + pos, ssid_len);
+    pending_ssid[ssid_len] = '\0';
     pos += ssid_len;
 
     // Read password (length-prefixed string)
@@ -115,72 +151,94 @@ static void handle_wifi_settings(const uint8_t* data, uint8_t len) {
         return;
     }
     uint8_t pass_len = data[pos++];
-    if (pos + pass_len > len) {
+    if (pos + pass_len > len || pass_len >= sizeof(pending_password)) {
         send_error(ERROR_INVALID_RPC);
         return;
     }
-    char password[64] = {0};
-    memcpy(password, data + pos, pass_len);
-    password[pass_len] = '\0';
+    memcpy(pending_password, data + pos, pass_len);
+    pending_password[pass_len] = '\0';
 
-    Serial.printf("[IMPROV] Received WiFi credentials: SSID='%s'\n", ssid);
+    LOG_I("IMPROV", "Received WiFi credentials: SSID='%s'", pending_ssid);
 
     // Set provisioning state
     send_state(STATE_PROVISIONING);
     active = true;
+    engine_post_event(ENGINE_EV_PROVISIONING);
+    phase = IMPROV_CONNECTING;
+    phase_start_ms = millis();
+    evt_got_ip = false;
+    evt_auth_failed = false;
 
-    // Stop AP mode if running, switch to STA
+    // Stop AP mode if running, switch to STA; the result arrives via events
     WiFi.softAPdisconnect(true);
     WiFi.mode(WIFI_STA);
-    WiFi.begin(ssid, password);
+    WiFi.begin(pending_ssid, pending_password);
+}
 
-    // Wait for connection
-    unsigned long start = millis();
-    while (WiFi.status() != WL_CONNECTED && millis() - start < WIFI_CONNECT_TIMEOUT) {
-        delay(250);
-    }
+static void finish_connected() {
+    // Save WiFi credentials and clear any old glucose source config.
+    // This ensures the device shows "Visit <IP> to setup" after a
+    // web flash instead of "STALE" from leftover server URLs.
+    AppConfig& cfg = config_get();
+    strncpy(cfg.wifi_ssid, pending_ssid, sizeof(cfg.wifi_ssid) - 1);
+    cfg.wifi_ssid[sizeof(cfg.wifi_ssid) - 1] = '\0';
+    strncpy(cfg.wifi_password, pending_password, sizeof(cfg.wifi_password) - 1);
+    cfg.wifi_password[sizeof(cfg.wifi_password) - 1] = '\0';
+    cfg.server_url[0] = '\0';
+    cfg.dexcom_username[0] = '\0';
+    cfg.dexcom_password[0] = '\0';
+    cfg.data_source = 0;
+    config_save();
+
+    // Build URL for the device
+    IPAddress ip = WiFi.localIP();
+    char url[64];
+    snprintf(url, sizeof(url), "http://%d.%d.%d.%d", ip[0], ip[1], ip[2], ip[3]);
+
+    LOG_I("IMPROV", "Connected! IP: %s", url);
+    send_rpc_result(CMD_WIFI_SETTINGS, url);
+    send_state(STATE_PROVISIONED);
+
+    // Reboot so wifi_manager picks up the saved creds cleanly, once the
+    // reply has had time to reach the installer
+    phase = IMPROV_PROVISIONED;
+    phase_start_ms = millis();
+}
 
-    if (WiFi.status() == WL_CONNECTED) {
-        // Save WiFi credentials and clear any old glucose source config.
-        // This ensures the device shows "Visit <IP> to setup" after a
-        // web flash instead of "STALE" from leftover server URLs.
-        AppConfig& cfg = config_get();
-        strncpy(cfg.wifi_ssid, ssid, sizeof(cfg.wifi_ssid) - 1);
-        cfg.wifi_ssid[sizeof(cfg.wifi_ssid) - 1] = '\0';
-        strncpy(cfg.wifi_password, password, sizeof(cfg.wifi_password) - 1);
-        cfg.wifi_password[sizeof(cfg.wifi_password) - 1] = '\0';
-        cfg.server_url[0] = '\0';
-        cfg.dexcom_username[0] = '\0';
-        cfg.dexcom_password[0] = '\0';
-        cfg.data_source = 0;
-        config_save();
-
-        // Build URL for the device
-        IPAddress ip = WiFi.localIP();
-        char url[64];
-        snprintf(url, sizeof(url), "http://%d.%d.%d.%d", ip[0], ip[1], ip[2], ip[3]);
-
-        Serial.printf("[IMPROV] Connected! IP: %s\n", url);
-        send_rpc_result(CMD_WIFI_SETTINGS, url);
-        send_state(STATE_PROVISIONED);
-
-        // Reboot so wifi_manager picks up the saved creds cleanly
-        delay(1000);
-        ESP.restart();
-    } else {
-        Serial.println("[IMPROV] WiFi connection failed");
-        send_error(ERROR_UNABLE_TO_CONNECT);
-        send_state(STATE_READY);
-        active = false;
-
-        // Restart AP mode
-        WiFi.mode(WIFI_AP);
-        WiFi.softAP("SugarClock-Setup");
+static void finish_failed(const char* why) {
+    LOG_E("IMPROV", "WiFi connection failed: %s", why);
+    send_error(ERROR_UNABLE_TO_CONNECT);
+    send_state(STATE_READY);
+    active = false;
+    engine_post_event(ENGINE_EV_PROVISIONING);
+    phase = IMPROV_IDLE;
+    pending_password[0] = '\0';
+
+    // Restart AP mode
+    WiFi.disconnect();
+    WiFi.mode(WIFI_AP);
+    WiFi.softAP("SugarClock-Setup");
+}
+
+static void provisioning_loop() {
+    if (phase == IMPROV_CONNECTING) {
+        if (evt_got_ip) {
+            finish_connected();
+        } else if (evt_auth_failed) {
+            finish_failed("authentication");
+        } else if (millis() - phase_start_ms >= WIFI_CONNECT_TIMEOUT) {
+            finish_failed("timeout");
+        }
+    } else if (phase == IMPROV_PROVISIONED) {
+        if (millis() - phase_start_ms >= RESTART_DELAY_MS) {
+            Serial.flush();
+            ESP.restart();
+        }
     }
 }
 
 static void handle_identify() {
-    Serial.println("[IMPROV] Identify requested");
+    LOG_I("IMPROV", "Identify requested");
     // No-op — we could blink the display here if desired
     send_rpc_result(CMD_IDENTIFY, NULL);
 }
@@ -206,7 +264,7 @@ static void process_packet() {
         checksum += rx_buf[i];
     }
     if (checksum != rx_buf[IMPROV_HEADER_LEN + data_len]) {
-        Serial.println("[IMPROV] Checksum mismatch");
+        LOG_W("IMPROV", "Checksum mismatch");
         return;
     }
 
@@ -237,7 +295,8 @@ static void process_packet() {
 }
 
 void improv_init() {
-    Serial.println("[IMPROV] Improv Wi-Fi serial handler ready");
+    WiFi.onEvent(on_wifi_event);
+    LOG_I("IMPROV", "Improv Wi-Fi serial handler ready");
 }
 
 void improv_loop() {
@@ -247,6 +306,8 @@ void improv_loop() {
     // and old config may persist).
     if (config_has_wifi() && !active && millis() > 120000) return;
 
+    provisioning_loop();
+
     // Periodically announce ready state so ESP Web Tools detects us
     static unsigned long last_announce = 0;
     if (millis() - last_announce > 1000) {
@@ -296,3 +357,15 @@ void improv_loop() {
 bool improv_is_active() {
     return active;
 }
+
+ImprovPhase improv_get_phase() {
+    return phase;
+}
+
+uint8_t improv_connect_progress() {
+    if (phase == IMPROV_PROVISIONED) return 100;
+    if (phase != IMPROV_CONNECTING) return 0;
+    unsigned long elapsed = millis() - phase_start_ms;
+    if (elapsed >= WIFI_CONNECT_TIMEOUT) return 100;
+    return (uint8_t)(elapsed * 100 / WIFI_CONNECT_TIMEOUT);
+}
@@ -0,0 +1,243 @@
+#include "lan_share.h"
+#include "config_manager.h"
+#include "wifi_manager.h"
+#include "time_engine.h"
+#include "logger.h"
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <mbedtls/md.h>
+#include <Arduino.h>
+#include <time.h>
+
+#define LAN_MAGIC_0   'S'
+#define LAN_MAGIC_1   'C'
+#define LAN_VERSION   2
+#define LAN_FLAG_FORCED_LEADER 0x01
+#define LAN_SIGNED_LEN 24   // bytes covered by the tag
+#define LAN_TAG_LEN    8    // truncated HMAC-SHA256
+
+static WiFiUDP udp;
+static bool joined = false;
+static int active_mode = 0;
+static LanRole role = LAN_ROLE_OFF;
+static uint32_t my_id = 0;
+
+static unsigned long role_since_ms = 0;
+static unsigned long last_heard_ms = 0;
+static unsigned long last_sent_ms = 0;
+static uint32_t leader_id = 0;
+static uint8_t send_seq = 0;             // tells apart packets sent in the same second
+
+// Newest packet accepted, for the replay check
+static uint32_t last_sender = 0;
+static uint32_t last_sent_at = 0;
+static uint8_t last_seq = 0;
+static unsigned long received = 0;
+static unsigned long rejected = 0;
+
+static void put_u16(uint8_t* p, uint16_t v) { p[0] = v; p[1] = v >> 8; }
+static void put_u32(uint8_t* p, uint32_t v) { p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24; }
+static uint16_t get_u16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+static uint32_t get_u32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+static void sign(const uint8_t* data, const char* key, uint8_t* tag) {
+    uint8_t mac[32];
+    mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256),
+                    (const uint8_t*)key, strlen(key), data, LAN_SIGNED_LEN, mac);
+    memcpy(tag, mac, LAN_TAG_LEN);
+}
+
+static void set_role(LanRole r) {
+    if (r == role) return;
+    role = r;
+    role_since_ms = millis();
+    LOG_I("LAN", "Role: %s", lan_share_role_name());
+}
+
+size_t lan_share_encode(uint8_t* out, uint32_t sender_id, const GlucoseReading& reading,
+                        uint32_t polled_at, uint32_t sent_at, const char* key) {
+    out[0] = LAN_MAGIC_0;
+    out[1] = LAN_MAGIC_1;
+    out[2] = LAN_VERSION;
+    out[3] = config_get().lan_share_mode == 2 ? LAN_FLAG_FORCED_LEADER : 0;
+    put_u32(out + 4, sender_id);
+    put_u32(out + 8, reading.timestamp);
+    put_u16(out + 12, reading.glucose);
+    out[14] = reading.trend;
+    out[15] = send_seq++;
+    put_u32(out + 16, polled_at);
+    put_u32(out + 20, sent_at);
+    sign(out, key, out + LAN_SIGNED_LEN);
+    return LAN_PACKET_LEN;
+}
+
+static void send_current() {
+    // A leader that can't reach the cloud goes quiet so followers try themselves
+    unsigned long age_ms = http_time_since_last_reading();
+    if (age_ms >= LAN_SILENCE_MS) return;
+    // Followers can't tell this from a replay without the send time
+    if (!time_is_available()) return;
+    uint32_t now = (uint32_t)time(nullptr);
+    uint8_t pkt[LAN_PACKET_LEN];
+    lan_share_encode(pkt, my_id, http_get_reading(), now - age_ms / 1000UL, now,
+                     config_get().lan_share_key);
+    udp.beginPacket(IPAddress(LAN_GROUP_IP), LAN_PORT);
+    udp.write(pkt, sizeof(pkt));
+    udp.endPacket();
+    last_sent_ms = millis();
+}
+
+static void handle_packet(const uint8_t* pkt, int len) {
+    if (len != LAN_PACKET_LEN || pkt[0] != LAN_MAGIC_0 || pkt[1] != LAN_MAGIC_1) return;
+    uint32_t sender = get_u32(pkt + 4);
+    if (sender == my_id) return;  // our own multicast looped back
+
+    uint8_t tag[LAN_TAG_LEN];
+    sign(pkt, config_get().lan_share_key, tag);
+    uint8_t diff = 0;
+    for (int i = 0; i < LAN_TAG_LEN; i++) diff |= tag[i] ^ pkt[LAN_SIGNED_LEN + i];
+    if (diff != 0 || pkt[2] != LAN_VERSION) {
+        rejected++;
+        return;
+    }
+
+    // Replays: the send time must be within LAN_MAX_SKEW_S of our clock
+    // (all that is left to check right after a reboot) and, from the same
+    // sender, later than the last packet taken
+    if (!time_is_available()) return;
+    uint32_t now = (uint32_t)time(nullptr);
+    uint32_t polled_at = get_u32(pkt + 16);
+    uint32_t sent_at = get_u32(pkt + 20);
+    uint8_t seq = pkt[15];
+    bool in_window = sent_at + LAN_MAX_SKEW_S >= now && sent_at <= now + LAN_MAX_SKEW_S;
+    bool newer = sender != last_sender || sent_at > last_sent_at ||
+                 (sent_at == last_sent_at && (int8_t)(seq - last_seq) > 0);
+    if (!in_window || !newer || polled_at > sent_at) {
+        rejected++;
+        return;
+    }
+    last_sender = sender;
+    last_sent_at = sent_at;
+    last_seq = seq;
+
+    // Two leaders in auto mode: the lower id keeps the job
+    bool forced = pkt[3] & LAN_FLAG_FORCED_LEADER;
+    if (role == LAN_ROLE_LEADER) {
+        if (active_mode == 2 || (!forced && sender > my_id)) return;
+        LOG_W("LAN", "Yielding to leader %08lx", (unsigned long)sender);
+    }
+
+    received++;
+    last_heard_ms = millis();
+    if (leader_id != sender) {
+        leader_id = sender;
+        LOG_I("LAN", "Following %08lx", (unsigned long)sender);
+    }
+    set_role(LAN_ROLE_FOLLOWER);
+
+    int glucose = get_u16(pkt + 12);
+    TrendType trend = pkt[14] <= TREND_UNKNOWN ? (TrendType)pkt[14] : TREND_UNKNOWN;
+    unsigned long age_ms = now > polled_at ? (now - polled_at) * 1000UL : 0;
+    if (glucose > 0) http_apply_shared_reading(glucose, trend, get_u32(pkt + 8), age_ms);
+}
+
+void lan_share_init() {
+    joined = false;
+    active_mode = 0;
+    role = LAN_ROLE_OFF;
+    leader_id = 0;
+    last_sender = 0;
+    last_sent_at = 0;
+    last_seq = 0;
+    last_sent_ms = 0;
+    received = 0;
+    rejected = 0;
+}
+
+void lan_share_loop() {
+    AppConfig& cfg = config_get();
+    int mode = strlen(cfg.lan_share_key) > 0 ? cfg.lan_share_mode : 0;
+
+    if (mode != active_mode) {
+        active_mode = mode;
+        leader_id = 0;
+        set_role(mode == 0 ? LAN_ROLE_OFF : mode == 2 ? LAN_ROLE_LEADER : LAN_ROLE_LISTENING);
+    }
+    if (mode == 0 || !wifi_is_connected()) {
+        if (joined) {
+            udp.stop();
+            joined = false;
+        }
+        return;
+    }
+
+    if (!joined) {
+        my_id = (uint32_t)(ESP.getEfuseMac() >> 16);  // low MAC bytes are the vendor OUI
+        joined = udp.beginMulticast(IPAddress(LAN_GROUP_IP), LAN_PORT);
+        if (!joined) return;
+        LOG_I("LAN", "Joined group as %08lx", (unsigned long)my_id);
+        role_since_ms = millis();
+    }
+
+    uint8_t pkt[64];
+    int size;
+    while ((size = udp.parsePacket()) > 0) {
+        int len = udp.read(pkt, sizeof(pkt));
+        if (len == size) handle_packet(pkt, len);
+    }
+
+    switch (role) {
+        case LAN_ROLE_LISTENING:
+            // Auto: nobody spoke up, take over. Listen-only keeps listening
+            // and polls itself meanwhile (see lan_share_should_poll).
+            if (mode == 1 && millis() - role_since_ms >= LAN_LISTEN_MS) set_role(LAN_ROLE_LEADER);
+            break;
+        case LAN_ROLE_FOLLOWER:
+            if (millis() - last_heard_ms >= LAN_SILENCE_MS) {
+                LOG_W("LAN", "Leader %08lx silent, polling again", (unsigned long)leader_id);
+                leader_id = 0;
+                set_role(mode == 1 ? LAN_ROLE_LEADER : LAN_ROLE_LISTENING);
+            }
+            break;
+        case LAN_ROLE_LEADER:
+            if (millis() - last_sent_ms >= LAN_HEARTBEAT_MS) send_current();
+            break;
+        default:
+            break;
+    }
+}
+
+bool lan_share_should_poll() {
+    if (role == LAN_ROLE_FOLLOWER) return false;
+    // Auto mode holds off its first poll while it looks for a leader
+    return !(role == LAN_ROLE_LISTENING && active_mode == 1);
+}
+
+void lan_share_publish() {
+    if (role == LAN_ROLE_LEADER && joined) send_current();
+}
+
+LanRole lan_share_get_role() {
+    return role;
+}
+
+const char* lan_share_role_name() {
+    switch (role) {
+        case LAN_ROLE_LISTENING: return "LISTENING";
+        case LAN_ROLE_LEADER:    return "LEADER";
+        case LAN_ROLE_FOLLOWER:  return "FOLLOWER";
+        default:                 return "OFF";
+    }
+}
+
+uint32_t lan_share_leader_id() {
+    return leader_id;
+}
+
+unsigned long lan_share_packets_received() {
+    return received;
+}
+
+unsigned long lan_share_packets_rejected() {
+    return rejected;
+}
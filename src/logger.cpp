@@ -0,0 +1,133 @@
+#include "logger.h"
+#include <Arduino.h>
+#include <stdarg.h>
+#include <string.h>
+
+// Each slot carries the sequence number it holds (+1, 0 = being written).
+// Writers claim a sequence number with one atomic add and publish the slot
+// when done; readers copy a slot and re-check its stamp, so a slot that was
+// overwritten mid-copy is detected and skipped. Any number of tasks may log
+// and any number of readers may follow the ring, each with its own cursor.
+struct Slot {
+    uint32_t stamp;
+    LogEntry entry;
+};
+
+static Slot ring[LOG_RING_SLOTS];
+static uint32_t head = 0;
+static unsigned long dropped = 0;
+static void (*sink)(const LogEntry&) = nullptr;
+
+volatile uint8_t logger_runtime_level = LOG_LEVEL_INFO;
+
+static const char* const LEVEL_NAMES[] = { "NONE", "ERROR", "WARN", "INFO", "DEBUG" };
+
+// Write everything new to Serial (the drain task, or inline in the sim)
+static void drain() {
+    static uint32_t next = 0;
+    static LogEntry e;
+    uint32_t expected = next;
+    while (logger_next(&next, &e)) {
+        if (e.seq != expected) dropped += e.seq - expected;
+        expected = next;
+        Serial.println(e.text);
+        if (sink) sink(e);
+    }
+}
+
+#ifndef SUGARCLOCK_SIM
+static void drain_task(void*) {
+    for (;;) {
+        drain();
+        vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_MS));
+    }
+}
+#endif
+
+void logger_init() {
+#ifndef SUGARCLOCK_SIM
+    // Core 0 next to the WiFi stack, below the Arduino loop's priority
+    xTaskCreatePinnedToCore(drain_task, "log", 3072, NULL, tskIDLE_PRIORITY + 1, NULL, 0);
+#endif
+}
+
+void logger_write(LogLevel level, const char* tag, const char* fmt, ...) {
+    char line[LOG_LINE_MAX];
+    int n = snprintf(line, sizeof(line), "[%s] ", tag);
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(line + n, sizeof(line) - n, fmt, ap);
+    va_end(ap);
+
+    uint32_t seq = __atomic_fetch_add(&head, 1, __ATOMIC_RELAXED);
+    Slot& slot = ring[seq & (LOG_RING_SLOTS - 1)];
+    __atomic_store_n(&slot.stamp, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    slot.entry.seq = seq;
+    slot.entry.ms = millis();
+    slot.entry.level = level;
+    strcpy(slot.entry.text, line);
+    __atomic_store_n(&slot.stamp, seq + 1, __ATOMIC_RELEASE);
+
+#ifdef SUGARCLOCK_SIM
+    drain();
+#endif
+}
+
+bool logger_next(uint32_t* seq, LogEntry* out) {
+    while (true) {
+        uint32_t h = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+        if ((int32_t)(h - *seq) <= 0) return false;
+        if (h - *seq > LOG_RING_SLOTS) {
+            *seq = h - LOG_RING_SLOTS;  // fell behind: skip to the oldest held
+            continue;
+        }
+
+        const Slot& slot = ring[*seq & (LOG_RING_SLOTS - 1)];
+        uint32_t stamp = __atomic_load_n(&slot.stamp, __ATOMIC_ACQUIRE);
+        if (stamp != *seq + 1) {
+            // Not published yet (the writer is mid-copy), or already reused
+            if (stamp == 0 || (int32_t)(stamp - (*seq + 1)) < 0) return false;
+            (*seq)++;
+            continue;
+        }
+        memcpy(out, &slot.entry, sizeof(LogEntry));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&slot.stamp, __ATOMIC_RELAXED) != stamp) {
+            (*seq)++;  // overwritten while copying
+            continue;
+        }
+        out->text[LOG_LINE_MAX - 1] = '\0';
+        *seq = out->seq + 1;
+        return true;
+    }
+}
+
+void logger_set_level(LogLevel level) {
+    logger_runtime_level = level > LOG_LEVEL_DEBUG ? LOG_LEVEL_DEBUG : level;
+}
+
+LogLevel logger_get_level() {
+    return (LogLevel)logger_runtime_level;
+}
+
+const char* logger_level_name(uint8_t level) {
+    return level <= LOG_LEVEL_DEBUG ? LEVEL_NAMES[level] : "?";
+}
+
+uint32_t logger_head_seq() {
+    return __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+}
+
+uint32_t logger_oldest_seq() {
+    uint32_t h = logger_head_seq();
+    return h > LOG_RING_SLOTS ? h - LOG_RING_SLOTS : 0;
+}
+
+unsigned long logger_dropped() {
+    return dropped;
+}
+
+void logger_set_sink(void (*s)(const LogEntry& entry)) {
+    sink = s;
+}
@@ -9,14 +9,20 @@
 #include "time_engine.h"
 #include "sensors.h"
 #include "http_client.h"
-#include "weather_client.h"
+#include "net_scheduler.h"
+#include "dns_cache.h"
 #include "web_server.h"
 #include "buzzer.h"
-#include "timer_engine.h"
-#include "notify_engine.h"
-#include "sysmon_engine.h"
-#include "countdown_engine.h"
-#include "improv_serial.h"
+#include "feature_modules.h"
+#include "perf_stats.h"
+#include "metrics.h"
+#include "render_bench.h"
+#include "ota_update.h"
+#include "lan_share.h"
+#include "mqtt_bridge.h"
+#include "logger.h"
+#include "scratch.h"
+#include "health_monitor.h"
 
 #define FIRMWARE_VERSION "0.1.0"
 #define WDT_TIMEOUT_SEC  30
@@ -34,6 +40,9 @@ void setup() {
     // 1. Serial init
     Serial.begin(115200);
     delay(100);
+    logger_init();  // everything after the banner goes through the log ring
+    scratch_init();
+    health_init();
 
     // 2. Initialize buzzer (silences immediately)
     buzzer_init();
@@ -49,8 +58,12 @@ void setup() {
     }
     Serial.println("================================");
 
+    // Roll back a freshly flashed OTA image that keeps failing to boot
+    ota_init();
+
     // 3. Load configuration
     config_init();
+    logger_set_level((LogLevel)config_get().log_level);
 
     // 4. Initialize display + show boot screen
     display_init();
@@ -70,46 +83,46 @@ void setup() {
     // 8. Init sensors
     sensors_init();
 
-    // 9. Init HTTP client
+    // 9. Init HTTP client (and LAN sharing of its readings); its fetches,
+    // like weather's, run through the outbound request scheduler
+    net_sched_init();
+    dns_cache_init();
     http_init();
+    lan_share_init();
 
-    // 10. Init weather client
-    weather_init();
-
-    // 11. Init web server routes (doesn't start serving yet)
+    // 10. Init web server routes (doesn't start serving yet)
     webserver_init();
 
-    // 12. Init new feature engines
-    timer_init();
-    notify_init();
-    sysmon_init();
-    countdown_init();
+    // 11. Init the feature engines built in (Improv, notifications, weather, ...)
+    features_init();
 
-    // 13. Init Improv Wi-Fi serial handler
-    improv_init();
+    // 12. Init MQTT bridge (connects once WiFi is up)
+    mqtt_init();
 
-    // 14. Init glucose engine (state machine)
+    // 13. Init glucose engine (state machine)
     engine_init();
 
     // 14. Enable watchdog timer
     esp_task_wdt_init(WDT_TIMEOUT_SEC, true);
     esp_task_wdt_add(NULL); // add current task
 
-    Serial.println("[BOOT] Setup complete");
-    Serial.printf("[BOOT] Free heap: %d bytes\n", ESP.getFreeHeap());
+    LOG_I("BOOT", "Setup complete");
+    LOG_I("BOOT", "Free heap: %d bytes", ESP.getFreeHeap());
 }
 
 void loop() {
     unsigned long loop_start = millis();
+    unsigned long loop_start_us = micros();
 
     // Reset watchdog
     esp_task_wdt_reset();
 
+    // Each stage's time is added to sugarclock_subsystem_seconds_total
+    unsigned long t = loop_start_us;
+
     // 1. WiFi management
     wifi_loop();
-
-    // 1b. Improv Wi-Fi serial (for ESP Web Tools credential input)
-    improv_loop();
+    t = metrics_subsystem_done(METRIC_SUB_WIFI, t);
 
     // Start web server once WiFi connects or in AP mode (one-time)
     if ((wifi_is_connected() || wifi_is_ap_mode()) && !webserver_started) {
@@ -117,14 +130,21 @@ void loop() {
         webserver_started = true;
     }
 
-    // 2. HTTP polling
+    // 2. HTTP polling (skipped while a LAN leader supplies readings)
+    lan_share_loop();
+    t = metrics_subsystem_done(METRIC_SUB_LAN, t);
     http_loop();
+    dns_cache_loop();
+    net_sched_loop();   // at most one outbound fetch per pass
+    t = metrics_subsystem_done(METRIC_SUB_HTTP, t);
 
-    // 2b. Weather polling
-    weather_loop();
+    // 2a. MQTT: inbound commands, publish changed readings
+    mqtt_loop();
+    t = metrics_subsystem_done(METRIC_SUB_MQTT, t);
 
     // 3. Time management
     time_loop();
+    t = metrics_subsystem_done(METRIC_SUB_TIME, t);
 
     // 4. Button input
     buttons_loop();
@@ -144,13 +164,13 @@ void loop() {
                 cfg.auto_brightness = false;
                 display_set_brightness(cfg.brightness);
                 config_save();
-                Serial.printf("[BTN] Brightness: %d\n", cfg.brightness);
+                LOG_I("BTN", "Brightness: %d", cfg.brightness);
                 break;
             }
             case BTN_MIDDLE_LONG:
                 // Snooze buzzer alerts
                 engine_snooze_alerts();
-                Serial.println("[BTN] Alerts snoozed");
+                LOG_I("BTN", "Alerts snoozed");
                 break;
             case BTN_RIGHT_SHORT:
                 // Context-sensitive right button
@@ -159,7 +179,7 @@ void loop() {
             case BTN_LEFT_LONG:
                 engine_clear_force();
                 engine_set_default_mode(STATE_GLUCOSE_DISPLAY);
-                Serial.println("[BTN] Overrides cleared");
+                LOG_I("BTN", "Overrides cleared");
                 break;
             case BTN_RIGHT_LONG:
                 // Context-sensitive right long press
@@ -170,6 +190,8 @@ void loop() {
         }
     }
 
+    t = metrics_subsystem_done(METRIC_SUB_BUTTONS, t);
+
     // 5. Sensor readings
     sensors_loop();
 
@@ -179,31 +201,40 @@ void loop() {
         uint8_t auto_brt = sensors_get_auto_brightness();
         display_set_brightness(auto_brt);
     }
+    t = metrics_subsystem_done(METRIC_SUB_SENSORS, t);
 
-    // 6. Feature engine loops
+    // 6. Feature engines (those switched off in config are skipped)
+    t = features_loop(t);
     buzzer_loop();
-    timer_loop();
-    notify_loop();
-    sysmon_loop();
-    countdown_loop();
+    health_loop();
+    t = metrics_subsystem_done(METRIC_SUB_FEATURES, t);
 
     // 7. Engine state machine + rendering
     engine_loop();
+    t = metrics_subsystem_done(METRIC_SUB_ENGINE, t);
+
+    // 7b. Confirm a new OTA image once it has run healthy
+    ota_loop();
+    metrics_subsystem_done(METRIC_SUB_OTA, t);
+
+    // 7c. Render benchmark requested via /api/bench (blocks for a few seconds)
+    bench_loop();
 
     // Performance tracking
     unsigned long loop_time = millis() - loop_start;
     loop_count++;
     loop_time_sum += loop_time;
     if (loop_time > loop_time_max) loop_time_max = loop_time;
+    perf_loop_sample(micros() - loop_start_us);
 
     // Periodic diagnostic logging
     if (millis() - last_diag_ms > DIAG_INTERVAL_MS) {
         last_diag_ms = millis();
         unsigned long avg = (loop_count > 0) ? (loop_time_sum / loop_count) : 0;
-        Serial.printf("[DIAG] Heap: %d/%d, Loop avg: %lums, max: %lums, state: %s\n",
-                      ESP.getFreeHeap(), ESP.getMinFreeHeap(),
-                      avg, loop_time_max,
-                      engine_state_name(engine_get_state()));
+        LOG_I("DIAG", "Heap: %d/%d, Loop avg: %lums, max: %lums, state: %s",
+              ESP.getFreeHeap(), ESP.getMinFreeHeap(),
+              avg, loop_time_max,
+              engine_state_name(engine_get_state()));
         loop_count = 0;
         loop_time_sum = 0;
         loop_time_max = 0;
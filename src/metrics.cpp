@@ -0,0 +1,309 @@
+#include "metrics.h"
+#include "http_client.h"
+#include "dns_cache.h"
+#include "net_client.h"
+#include <Arduino.h>
+#include <limits.h>
+#include <string.h>
+
+#define HIST_MAX_BUCKETS 11   // finite bounds + the +Inf bucket
+
+// Per-bucket (not cumulative) counts; the exposition accumulates them
+struct Histogram {
+    uint32_t buckets[HIST_MAX_BUCKETS];
+    uint64_t sum;             // in the histogram's native unit (us or ms)
+};
+
+enum FetchStatus {
+    FETCH_OK,                 // HTTP 200
+    FETCH_HTTP_ERROR,         // any other HTTP status
+    FETCH_NETWORK_ERROR,      // DNS, connect, TLS, timeout (code <= 0)
+    FETCH_STATUS_COUNT
+};
+
+static const uint32_t LOOP_BOUNDS_US[] = { 500, 1000, 2000, 5000, 10000, 20000, 50000, 100000, 250000, 1000000 };
+static const char* const LOOP_LE[] = { "0.0005", "0.001", "0.002", "0.005", "0.01", "0.02", "0.05", "0.1", "0.25", "1" };
+#define LOOP_BUCKETS (int)(sizeof(LOOP_BOUNDS_US) / sizeof(LOOP_BOUNDS_US[0]))
+
+static const uint32_t FETCH_BOUNDS_MS[] = { 100, 250, 500, 1000, 2000, 5000, 10000, 20000 };
+static const char* const FETCH_LE[] = { "0.1", "0.25", "0.5", "1", "2", "5", "10", "20" };
+#define FETCH_BUCKETS (int)(sizeof(FETCH_BOUNDS_MS) / sizeof(FETCH_BOUNDS_MS[0]))
+
+static const uint32_t DNS_BOUNDS_MS[] = { 5, 10, 25, 50, 100, 250, 500, 1000, 2500 };
+static const char* const DNS_LE[] = { "0.005", "0.01", "0.025", "0.05", "0.1", "0.25", "0.5", "1", "2.5" };
+#define DNS_BUCKETS (int)(sizeof(DNS_BOUNDS_MS) / sizeof(DNS_BOUNDS_MS[0]))
+
+static const char* const SUBSYSTEM_NAMES[METRIC_SUB_COUNT] = {
+    "wifi", "improv", "lan", "http", "mqtt", "weather",
+    "time", "buttons", "sensors", "features", "engine", "ota"
+};
+static const char* const FETCH_STATUS_NAMES[FETCH_STATUS_COUNT] = { "ok", "http_error", "network_error" };
+
+static uint32_t counters[METRIC_COUNTER_COUNT];
+static uint64_t subsystem_us[METRIC_SUB_COUNT];
+static Histogram loop_hist;
+static Histogram fetch_hist[PERF_SOURCE_COUNT][FETCH_STATUS_COUNT];
+static Histogram dns_hist[2];              // lookup ok, failed
+static uint32_t dns_results[DNS_RESULT_COUNT];
+
+// --- Updates ---
+
+static void observe(Histogram& h, const uint32_t* bounds, int nbounds, uint32_t value) {
+    int i = 0;
+    while (i < nbounds && value > bounds[i]) i++;
+    __atomic_fetch_add(&h.buckets[i], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h.sum, (uint64_t)value, __ATOMIC_RELAXED);
+}
+
+void metrics_inc(MetricCounter c) {
+    if (c < METRIC_COUNTER_COUNT) __atomic_fetch_add(&counters[c], 1, __ATOMIC_RELAXED);
+}
+
+unsigned long metrics_subsystem_done(MetricSubsystem sub, unsigned long start_us) {
+    unsigned long now = micros();
+    if (sub < METRIC_SUB_COUNT) {
+        __atomic_fetch_add(&subsystem_us[sub], (uint64_t)(now - start_us), __ATOMIC_RELAXED);
+    }
+    return now;
+}
+
+void metrics_observe_loop(unsigned long loop_us) {
+    observe(loop_hist, LOOP_BOUNDS_US, LOOP_BUCKETS, loop_us);
+    if (loop_us >= PERF_STALL_MS * 1000UL) metrics_inc(METRIC_LOOP_STALLS);
+}
+
+void metrics_observe_fetch(PerfSource src, unsigned long duration_ms, int http_code) {
+    if (src >= PERF_SOURCE_COUNT) return;
+    FetchStatus status = http_code == 200 ? FETCH_OK : http_code > 0 ? FETCH_HTTP_ERROR : FETCH_NETWORK_ERROR;
+    observe(fetch_hist[src][status], FETCH_BOUNDS_MS, FETCH_BUCKETS, duration_ms);
+}
+
+void metrics_observe_dns(unsigned long duration_ms, bool ok) {
+    observe(dns_hist[ok ? 0 : 1], DNS_BOUNDS_MS, DNS_BUCKETS, duration_ms);
+}
+
+void metrics_dns_result(int result) {
+    if (result >= 0 && result < DNS_RESULT_COUNT) __atomic_fetch_add(&dns_results[result], 1, __ATOMIC_RELAXED);
+}
+
+// --- Exposition ---
+
+enum Family {
+    FAM_UPTIME,
+    FAM_HEAP_FREE,
+    FAM_HEAP_MIN,
+    FAM_HEAP_LARGEST,
+    FAM_READING_AGE,
+    FAM_LOOP_DURATION,
+    FAM_LOOP_STALLS,
+    FAM_SUBSYSTEM_SECONDS,
+    FAM_FETCH_DURATION,
+    FAM_FETCH_FAILURES,
+    FAM_DNS_DURATION,
+    FAM_DNS_CACHE,
+    FAM_BODY_BYTES,
+    FAM_LED_PUSHES,
+    FAM_NVS_WRITES,
+    FAM_COUNT
+};
+
+struct FamilyInfo {
+    const char* name;
+    const char* type;
+    const char* help;
+};
+
+static const FamilyInfo FAMILIES[FAM_COUNT] = {
+    { "sugarclock_uptime_seconds",            "gauge",     "Seconds since boot" },
+    { "sugarclock_heap_free_bytes",           "gauge",     "Free heap" },
+    { "sugarclock_heap_min_free_bytes",       "gauge",     "Lowest free heap since boot" },
+    { "sugarclock_heap_largest_block_bytes",  "gauge",     "Largest allocatable heap block" },
+    { "sugarclock_reading_age_seconds",       "gauge",     "Seconds since the last successful glucose reading" },
+    { "sugarclock_loop_duration_seconds",     "histogram", "Main loop pass duration" },
+    { "sugarclock_loop_stalls_total",         "counter",   "Main loop passes over 100 ms" },
+    { "sugarclock_subsystem_seconds_total",   "counter",   "Main loop time spent per subsystem" },
+    { "sugarclock_fetch_duration_seconds",    "histogram", "Blocking fetch latency by source and outcome" },
+    { "sugarclock_fetch_failures_total",      "counter",   "Fetches that did not return HTTP 200" },
+    { "sugarclock_dns_lookup_seconds",        "histogram", "Resolver lookups by outcome (cache hits excluded)" },
+    { "sugarclock_dns_cache_total",           "counter",   "Host name resolutions by cache result" },
+    { "sugarclock_http_body_bytes_total",     "counter",   "Response body bytes by source, on the wire and decoded" },
+    { "sugarclock_led_pushes_total",          "counter",   "Frames pushed to the LED matrix" },
+    { "sugarclock_nvs_writes_total",          "counter",   "Config saves and other NVS commits" },
+};
+
+static uint32_t load(const uint32_t& v) {
+    return __atomic_load_n(&v, __ATOMIC_RELAXED);
+}
+
+static uint64_t load64(const uint64_t& v) {
+    return __atomic_load_n(&v, __ATOMIC_RELAXED);
+}
+
+// "name{labels} value" with the braces left out when there are no labels
+static int sample(char* out, size_t cap, const char* name, const char* suffix,
+                  const char* labels, const char* value) {
+    if (labels[0] == '\0') return snprintf(out, cap, "%s%s %s\n", name, suffix, value);
+    return snprintf(out, cap, "%s%s{%s} %s\n", name, suffix, labels, value);
+}
+
+static void format_fixed(char* out, size_t cap, uint64_t value, uint32_t per_second, int digits) {
+    snprintf(out, cap, "%llu.%0*llu", (unsigned long long)(value / per_second), digits,
+             (unsigned long long)(value % per_second));
+}
+
+// One line of a histogram series: buckets, +Inf, _sum, _count (part >= 0)
+static int histogram_line(char* out, size_t cap, const char* name, const char* labels,
+                          const Histogram& h, const char* const* le, int nbounds,
+                          uint32_t per_second, int digits, int part) {
+    char value[32];
+    char lbl[96];
+    const char* sep = labels[0] ? "," : "";
+
+    if (part <= nbounds) {
+        uint32_t cumulative = 0;
+        for (int i = 0; i <= part; i++) cumulative += load(h.buckets[i]);
+        snprintf(lbl, sizeof(lbl), "%s%sle=\"%s\"", labels, sep, part < nbounds ? le[part] : "+Inf");
+        snprintf(value, sizeof(value), "%lu", (unsigned long)cumulative);
+        return sample(out, cap, name, "_bucket", lbl, value);
+    }
+    if (part == nbounds + 1) {
+        format_fixed(value, sizeof(value), load64(h.sum), per_second, digits);
+        return sample(out, cap, name, "_sum", labels, value);
+    }
+    if (part == nbounds + 2) {
+        uint32_t count = 0;
+        for (int i = 0; i <= nbounds; i++) count += load(h.buckets[i]);
+        snprintf(value, sizeof(value), "%lu", (unsigned long)count);
+        return sample(out, cap, name, "_count", labels, value);
+    }
+    return -1;
+}
+
+static int gauge_line(char* out, size_t cap, const char* name, unsigned long v) {
+    char value[16];
+    snprintf(value, sizeof(value), "%lu", v);
+    return sample(out, cap, name, "", "", value);
+}
+
+// Sample k of a family, or -1 past its last sample
+static int sample_line(int family, int k, char* out, size_t cap) {
+    const char* name = FAMILIES[family].name;
+    char labels[64];
+    char value[32];
+
+    switch (family) {
+        case FAM_UPTIME:       return k == 0 ? gauge_line(out, cap, name, millis() / 1000) : -1;
+        case FAM_HEAP_FREE:    return k == 0 ? gauge_line(out, cap, name, ESP.getFreeHeap()) : -1;
+        case FAM_HEAP_MIN:     return k == 0 ? gauge_line(out, cap, name, ESP.getMinFreeHeap()) : -1;
+        case FAM_HEAP_LARGEST: return k == 0 ? gauge_line(out, cap, name, ESP.getMaxAllocHeap()) : -1;
+        case FAM_READING_AGE: {
+            if (k != 0) return -1;
+            unsigned long age = http_time_since_last_reading();
+            if (age == ULONG_MAX) return sample(out, cap, name, "", "", "NaN");
+            return gauge_line(out, cap, name, age / 1000);
+        }
+        case FAM_LOOP_DURATION:
+            return histogram_line(out, cap, name, "", loop_hist, LOOP_LE, LOOP_BUCKETS, 1000000, 6, k);
+        case FAM_LOOP_STALLS:
+            return k == 0 ? gauge_line(out, cap, name, load(counters[METRIC_LOOP_STALLS])) : -1;
+        case FAM_SUBSYSTEM_SECONDS:
+            if (k >= METRIC_SUB_COUNT) return -1;
+            snprintf(labels, sizeof(labels), "subsystem=\"%s\"", SUBSYSTEM_NAMES[k]);
+            format_fixed(value, sizeof(value), load64(subsystem_us[k]), 1000000, 6);
+            return sample(out, cap, name, "", labels, value);
+        case FAM_FETCH_DURATION: {
+            int lines = FETCH_BUCKETS + 3;
+            int series = k / lines;
+            if (series >= PERF_SOURCE_COUNT * FETCH_STATUS_COUNT) return -1;
+            int src = series / FETCH_STATUS_COUNT;
+            int status = series % FETCH_STATUS_COUNT;
+            snprintf(labels, sizeof(labels), "source=\"%s\",status=\"%s\"",
+                     perf_source_name((PerfSource)src), FETCH_STATUS_NAMES[status]);
+            return histogram_line(out, cap, name, labels, fetch_hist[src][status],
+                                  FETCH_LE, FETCH_BUCKETS, 1000, 3, k % lines);
+        }
+        case FAM_FETCH_FAILURES: {
+            if (k >= PERF_SOURCE_COUNT) return -1;
+            uint32_t failures = 0;
+            for (int s = FETCH_HTTP_ERROR; s < FETCH_STATUS_COUNT; s++) {
+                for (int i = 0; i <= FETCH_BUCKETS; i++) failures += load(fetch_hist[k][s].buckets[i]);
+            }
+            snprintf(labels, sizeof(labels), "source=\"%s\"", perf_source_name((PerfSource)k));
+            snprintf(value, sizeof(value), "%lu", (unsigned long)failures);
+            return sample(out, cap, name, "", labels, value);
+        }
+        case FAM_DNS_DURATION: {
+            int lines = DNS_BUCKETS + 3;
+            int series = k / lines;
+            if (series >= 2) return -1;
+            snprintf(labels, sizeof(labels), "status=\"%s\"", series == 0 ? "ok" : "error");
+            return histogram_line(out, cap, name, labels, dns_hist[series],
+                                  DNS_LE, DNS_BUCKETS, 1000, 3, k % lines);
+        }
+        case FAM_DNS_CACHE:
+            if (k >= DNS_RESULT_COUNT) return -1;
+            snprintf(labels, sizeof(labels), "result=\"%s\"", dns_result_name((DnsResult)k));
+            snprintf(value, sizeof(value), "%lu", (unsigned long)load(dns_results[k]));
+            return sample(out, cap, name, "", labels, value);
+        case FAM_BODY_BYTES: {
+            if (k >= NET_SRC_COUNT * 2) return -1;
+            const NetBodyStats& st = net_body_stats((NetSource)(k / 2));
+            bool wire = (k % 2) == 0;
+            snprintf(labels, sizeof(labels), "source=\"%s\",stage=\"%s\"",
+                     net_source_name((NetSource)(k / 2)), wire ? "wire" : "decoded");
+            snprintf(value, sizeof(value), "%llu",
+                     (unsigned long long)(wire ? st.wire_bytes : st.body_bytes));
+            return sample(out, cap, name, "", labels, value);
+        }
+        case FAM_LED_PUSHES:
+            return k == 0 ? gauge_line(out, cap, name, load(counters[METRIC_LED_PUSHES])) : -1;
+        case FAM_NVS_WRITES:
+            return k == 0 ? gauge_line(out, cap, name, load(counters[METRIC_NVS_WRITES])) : -1;
+        default:
+            return -1;
+    }
+}
+
+static int family_line(int family, int line, char* out, size_t cap) {
+    const FamilyInfo& f = FAMILIES[family];
+    if (line == 0) return snprintf(out, cap, "# HELP %s %s\n", f.name, f.help);
+    if (line == 1) return snprintf(out, cap, "# TYPE %s %s\n", f.name, f.type);
+    return sample_line(family, line - 2, out, cap);
+}
+
+void metrics_cursor_init(MetricsCursor& cur) {
+    cur.family = 0;
+    cur.line = 0;
+    cur.pending_len = 0;
+    cur.pending_off = 0;
+}
+
+size_t metrics_render(MetricsCursor& cur, uint8_t* buf, size_t max_len) {
+    size_t n = 0;
+    while (n < max_len) {
+        if (cur.pending_off < cur.pending_len) {
+            size_t take = cur.pending_len - cur.pending_off;
+            if (take > max_len - n) take = max_len - n;
+            memcpy(buf + n, cur.pending + cur.pending_off, take);
+            cur.pending_off += take;
+            n += take;
+            continue;
+        }
+        if (cur.family >= FAM_COUNT) break;
+
+        int len = family_line(cur.family, cur.line, cur.pending, sizeof(cur.pending));
+        if (len < 0) {
+            cur.family++;
+            cur.line = 0;
+            continue;
+        }
+        cur.line++;
+        if (len >= (int)sizeof(cur.pending)) {
+            len = sizeof(cur.pending) - 1;
+            cur.pending[len - 1] = '\n';
+        }
+        cur.pending_len = len;
+        cur.pending_off = 0;
+    }
+    return n;
+}
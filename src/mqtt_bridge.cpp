@@ -0,0 +1,317 @@
+#include "mqtt_bridge.h"
+#include "config_manager.h"
+#include "wifi_manager.h"
+#include "http_client.h"
+#include "glucose_engine.h"
+#include "notify_engine.h"
+#include "feature_modules.h"
+#if FEATURE_SYSMON
+#include "sysmon_engine.h"
+#endif
+#include "logger.h"
+#include "scratch.h"
+#include <mqtt_client.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <esp32/rom/crc.h>
+#include <ArduinoJson.h>
+#include <Arduino.h>
+#include <limits.h>
+
+enum InboxTopic {
+    INBOX_NOTIFY,
+    INBOX_SYSMON,
+    INBOX_COMMAND
+};
+
+struct InboxMessage {
+    uint8_t topic;
+    char payload[MQTT_PAYLOAD_MAX];
+};
+
+static esp_mqtt_client_handle_t client = nullptr;
+static QueueHandle_t inbox = nullptr;
+static uint32_t active_signature = 0;
+static bool started = false;
+
+// Written by the MQTT task, read in mqtt_loop()
+static volatile bool connected = false;
+static volatile bool just_connected = false;
+static volatile bool connection_lost = false;
+
+static unsigned long backoff_ms = MQTT_BACKOFF_MIN_MS;
+static unsigned long retry_at_ms = 0;
+static bool retry_pending = false;
+static unsigned long last_config_check_ms = 0;
+
+static unsigned long published = 0;
+static unsigned long received = 0;
+static unsigned long dropped = 0;
+
+// Full topic names, built once per client
+static char client_id[24];
+static char topic_status[80];
+static char topic_notify[80];
+static char topic_sysmon[80];
+static char topic_command[80];
+
+// Last values published (retained on the broker)
+static int pub_glucose = -1;
+static int pub_trend = -1;
+static int pub_delta = INT_MIN;
+static int pub_state = -1;
+
+static uint32_t config_signature() {
+    AppConfig& cfg = config_get();
+    uint32_t crc = crc32_le(0, (const uint8_t*)&cfg.mqtt_enabled, sizeof(cfg.mqtt_enabled));
+    crc = crc32_le(crc, (const uint8_t*)cfg.mqtt_uri, strlen(cfg.mqtt_uri));
+    crc = crc32_le(crc, (const uint8_t*)cfg.mqtt_username, strlen(cfg.mqtt_username));
+    crc = crc32_le(crc, (const uint8_t*)cfg.mqtt_password, strlen(cfg.mqtt_password));
+    crc = crc32_le(crc, (const uint8_t*)cfg.mqtt_topic, strlen(cfg.mqtt_topic));
+    return crc;
+}
+
+static bool topic_is(const esp_mqtt_event_handle_t ev, const char* topic) {
+    return ev->topic_len == (int)strlen(topic) && memcmp(ev->topic, topic, ev->topic_len) == 0;
+}
+
+// Runs in the MQTT task: subscribe on connect, hand messages to the loop
+static void on_mqtt_event(void*, esp_event_base_t, int32_t event_id, void* event_data) {
+    esp_mqtt_event_handle_t ev = (esp_mqtt_event_handle_t)event_data;
+
+    switch ((esp_mqtt_event_id_t)event_id) {
+        case MQTT_EVENT_CONNECTED:
+            esp_mqtt_client_subscribe(client, topic_notify, 1);
+#if FEATURE_SYSMON
+            esp_mqtt_client_subscribe(client, topic_sysmon, 1);
+#endif
+            esp_mqtt_client_subscribe(client, topic_command, 1);
+            esp_mqtt_client_publish(client, topic_status, "online", 0, 1, 1);
+            connected = true;
+            just_connected = true;
+            break;
+
+        case MQTT_EVENT_DISCONNECTED:
+            connected = false;
+            connection_lost = true;
+            break;
+
+        case MQTT_EVENT_DATA: {
+            // Oversized payloads arrive in fragments; they are never valid here
+            if (ev->current_data_offset != 0 || ev->data_len != ev->total_data_len ||
+                ev->data_len >= MQTT_PAYLOAD_MAX) {
+                dropped++;
+                break;
+            }
+            InboxMessage msg;
+            if (topic_is(ev, topic_notify)) msg.topic = INBOX_NOTIFY;
+            else if (topic_is(ev, topic_sysmon)) msg.topic = INBOX_SYSMON;
+            else if (topic_is(ev, topic_command)) msg.topic = INBOX_COMMAND;
+            else break;
+            memcpy(msg.payload, ev->data, ev->data_len);
+            msg.payload[ev->data_len] = '\0';
+            if (xQueueSend(inbox, &msg, 0) != pdTRUE) dropped++;
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+static void stop_client() {
+    if (!client) return;
+    if (started) esp_mqtt_client_stop(client);
+    esp_mqtt_client_destroy(client);
+    client = nullptr;
+    started = false;
+    connected = false;
+    retry_pending = false;
+}
+
+static void create_client() {
+    AppConfig& cfg = config_get();
+    active_signature = config_signature();
+    if (!cfg.mqtt_enabled || strlen(cfg.mqtt_uri) == 0) return;
+
+    uint64_t mac = ESP.getEfuseMac();
+    snprintf(client_id, sizeof(client_id), "sugarclock-%06lx", (unsigned long)(mac >> 24) & 0xFFFFFF);
+    snprintf(topic_status, sizeof(topic_status), "%s/status", cfg.mqtt_topic);
+    snprintf(topic_notify, sizeof(topic_notify), "%s/notify", cfg.mqtt_topic);
+    snprintf(topic_sysmon, sizeof(topic_sysmon), "%s/sysmon", cfg.mqtt_topic);
+    snprintf(topic_command, sizeof(topic_command), "%s/command", cfg.mqtt_topic);
+
+    esp_mqtt_client_config_t mqtt_cfg = {};
+    mqtt_cfg.uri = cfg.mqtt_uri;
+    mqtt_cfg.client_id = client_id;
+    if (strlen(cfg.mqtt_username) > 0) {
+        mqtt_cfg.username = cfg.mqtt_username;
+        mqtt_cfg.password = cfg.mqtt_password;
+    }
+    mqtt_cfg.keepalive = 30;
+    mqtt_cfg.lwt_topic = topic_status;
+    mqtt_cfg.lwt_msg = "offline";
+    mqtt_cfg.lwt_qos = 1;
+    mqtt_cfg.lwt_retain = 1;
+    mqtt_cfg.disable_auto_reconnect = true;  // mqtt_loop() backs off instead
+    mqtt_cfg.network_timeout_ms = 5000;
+
+    client = esp_mqtt_client_init(&mqtt_cfg);
+    if (!client) {
+        LOG_E("MQTT", "Client init failed");
+        return;
+    }
+    esp_mqtt_client_register_event(client, (esp_mqtt_event_id_t)ESP_EVENT_ANY_ID, on_mqtt_event, NULL);
+    backoff_ms = MQTT_BACKOFF_MIN_MS;
+    LOG_I("MQTT", "Broker %s, topics %s/#", cfg.mqtt_uri, cfg.mqtt_topic);
+}
+
+// Queue a retained QoS 1 message; esp-mqtt's task does the sending
+static void publish(const char* leaf, const char* payload) {
+    char topic[96];
+    snprintf(topic, sizeof(topic), "%s/%s", config_get().mqtt_topic, leaf);
+    if (esp_mqtt_client_enqueue(client, topic, payload, 0, 1, 1, true) >= 0) published++;
+}
+
+static void publish_changes() {
+    char buf[16];
+    const GlucoseReading& r = http_get_reading();
+    if (r.valid) {
+        if (r.glucose != pub_glucose) {
+            pub_glucose = r.glucose;
+            snprintf(buf, sizeof(buf), "%d", r.glucose);
+            publish("glucose", buf);
+        }
+        if ((int)r.trend != pub_trend) {
+            pub_trend = r.trend;
+            publish("trend", TREND_NAMES[r.trend]);
+        }
+        int delta = http_get_delta();
+        if (delta != pub_delta) {
+            pub_delta = delta;
+            snprintf(buf, sizeof(buf), "%d", delta);
+            publish("delta", buf);
+        }
+    }
+
+    DisplayState state = engine_get_state();
+    if ((int)state != pub_state) {
+        pub_state = state;
+        publish("state", engine_state_name(state));
+    }
+}
+
+static void handle_command(const char* cmd) {
+    LOG_I("MQTT", "Command: %s", cmd);
+    if (strcmp(cmd, "next") == 0) engine_toggle_mode();
+    else if (strcmp(cmd, "prev") == 0) engine_toggle_mode_prev();
+    else if (strcmp(cmd, "snooze") == 0) engine_snooze_alerts();
+    else if (strcmp(cmd, "dismiss") == 0) notify_dismiss();
+    else if (strcmp(cmd, "clear") == 0) engine_clear_force();
+    else if (strcmp(cmd, "restart") == 0) {
+        publish("status", "offline");
+        delay(500);
+        ESP.restart();
+    } else {
+        LOG_W("MQTT", "Unknown command");
+    }
+}
+
+static void handle_inbox(const InboxMessage& msg) {
+    AppConfig& cfg = config_get();
+    received++;
+
+    if (msg.topic == INBOX_COMMAND) {
+        handle_command(msg.payload);
+        return;
+    }
+
+    ScratchScope scope;
+    JsonDocument doc(scope.json());
+    bool is_json = msg.payload[0] == '{' && !deserializeJson(doc, msg.payload);
+
+    if (msg.topic == INBOX_NOTIFY) {
+        if (!cfg.notify_enabled) return;
+        const char* text = is_json ? (doc["text"] | "") : msg.payload;
+        if (strlen(text) == 0) return;
+        int duration = is_json ? (doc["duration_sec"] | cfg.notify_default_duration) : cfg.notify_default_duration;
+        bool urgent = is_json ? (doc["urgent"] | false) : false;
+        notify_push(text, duration, urgent);
+    }
+#if FEATURE_SYSMON
+    else if (msg.topic == INBOX_SYSMON) {
+        if (!cfg.sysmon_enabled || !is_json) return;
+        sysmon_push(doc["label"] | cfg.sysmon_label, doc["value"] | 0, doc["max"] | 100);
+    }
+#endif
+}
+
+void mqtt_init() {
+    if (!inbox) inbox = xQueueCreate(MQTT_INBOX_DEPTH, sizeof(InboxMessage));
+    create_client();
+}
+
+void mqtt_loop() {
+    // Pick up config changes from the web UI (checked once a second)
+    if (millis() - last_config_check_ms >= 1000) {
+        last_config_check_ms = millis();
+        if (config_signature() != active_signature) {
+            LOG_I("MQTT", "Settings changed, restarting client");
+            stop_client();
+            create_client();
+        }
+    }
+    if (!client) return;
+
+    if (!started) {
+        if (!wifi_is_connected()) return;
+        esp_mqtt_client_start(client);
+        started = true;
+    }
+
+    if (connection_lost) {
+        connection_lost = false;
+        retry_pending = true;
+        retry_at_ms = millis() + backoff_ms;
+        LOG_W("MQTT", "Disconnected, retry in %lus", backoff_ms / 1000);
+        backoff_ms = min(backoff_ms * 2, (unsigned long)MQTT_BACKOFF_MAX_MS);
+    }
+    if (retry_pending && (long)(millis() - retry_at_ms) >= 0 && wifi_is_connected()) {
+        retry_pending = false;
+        esp_mqtt_client_reconnect(client);
+    }
+
+    if (just_connected) {
+        just_connected = false;
+        backoff_ms = MQTT_BACKOFF_MIN_MS;
+        // Republish everything; the broker may have replaced it with the last will
+        pub_glucose = -1;
+        pub_trend = -1;
+        pub_delta = INT_MIN;
+        pub_state = -1;
+        LOG_I("MQTT", "Connected");
+    }
+
+    InboxMessage msg;
+    while (xQueueReceive(inbox, &msg, 0) == pdTRUE) {
+        handle_inbox(msg);
+    }
+
+    if (connected) publish_changes();
+}
+
+bool mqtt_is_connected() {
+    return connected;
+}
+
+unsigned long mqtt_messages_published() {
+    return published;
+}
+
+unsigned long mqtt_messages_received() {
+    return received;
+}
+
+unsigned long mqtt_messages_dropped() {
+    return dropped;
+}
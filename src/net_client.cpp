@@ -0,0 +1,129 @@
+#include "net_client.h"
+#include "dns_cache.h"
+#include "net_scheduler.h"
+#include "gzip_stream.h"
+#include "config_manager.h"
+#include "logger.h"
+#include <Arduino.h>
+
+static NetBodyStats body_stats[NET_SRC_COUNT];
+static const char* const SOURCE_NAMES[NET_SRC_COUNT] = { "dexcom", "server", "weather" };
+
+bool net_is_plain_http(const char* url) {
+    return url && strncasecmp(url, "http://", 7) == 0;
+}
+
+// Host and port of an http(s) URL; false if there is no host
+static bool url_host(const char* url, char* host, size_t len, uint16_t* port) {
+    bool plain = net_is_plain_http(url);
+    const char* p = strstr(url, "://");
+    p = p ? p + 3 : url;
+    size_t n = strcspn(p, ":/?#");
+    if (n == 0 || n >= len) return false;
+    memcpy(host, p, n);
+    host[n] = '\0';
+    *port = p[n] == ':' ? (uint16_t)atoi(p + n + 1) : (plain ? 80 : 443);
+    return *port != 0;
+}
+
+bool net_begin(HTTPClient& http, WiFiClient& plain, TlsClient& tls,
+               const char* url, uint32_t socket_timeout_sec) {
+    char host[64];
+    uint16_t port;
+    IPAddress ip;
+    if (!url_host(url, host, sizeof(host), &port)) return false;
+    if (!dns_cache_resolve(host, ip)) {
+        LOG_E("NET", "Can't resolve %s", host);
+        return false;
+    }
+
+    // Connect to the cached address ourselves; HTTPClient reuses an
+    // already connected client instead of resolving the host again
+    if (net_is_plain_http(url)) {
+        plain.setTimeout(socket_timeout_sec);
+        if (!plain.connect(ip, port, socket_timeout_sec * 1000)) return false;
+        return http.begin(plain, url);
+    }
+    tls.setTimeout(socket_timeout_sec);
+    if (!tls.connect(ip, port, host, socket_timeout_sec * 1000)) return false;  // host for SNI
+    return http.begin(tls, url);
+}
+
+void net_request_headers(HTTPClient& http, const char* also_collect) {
+    const char* keys[] = { "Content-Encoding", also_collect };
+    http.collectHeaders(keys, also_collect ? 2 : 1);
+    if (!config_get().http_gzip) return;
+    if (ESP.getMaxAllocHeap() < GZIP_HEAP_BYTES + NET_HEAP_RESERVE) return;
+    http.addHeader("Accept-Encoding", "gzip");
+    http.useHTTP10(true);   // no chunked framing, the inflater reads the raw socket
+}
+
+static bool body_is_gzip(HTTPClient& http) {
+    return strcasecmp(http.header("Content-Encoding").c_str(), "gzip") == 0;
+}
+
+static void count_body(NetSource src, size_t wire, size_t body, bool gzipped) {
+    NetBodyStats& st = body_stats[src];
+    st.responses++;
+    if (gzipped) st.gzipped++;
+    st.wire_bytes += wire;
+    st.body_bytes += body;
+}
+
+DeserializationError net_read_json(HTTPClient& http, NetSource src, JsonDocument& doc,
+                                   char* snapshot, size_t snapshot_len, JsonDocument* filter) {
+    if (!body_is_gzip(http)) {
+        String payload = http.getString();
+        if (snapshot && snapshot_len > 0) {
+            strncpy(snapshot, payload.c_str(), snapshot_len - 1);
+            snapshot[snapshot_len - 1] = '\0';
+        }
+        count_body(src, payload.length(), payload.length(), false);
+        return filter ? deserializeJson(doc, payload, DeserializationOption::Filter(*filter))
+                      : deserializeJson(doc, payload);
+    }
+
+    Stream* body = http.getStreamPtr();
+    if (!body) return DeserializationError::IncompleteInput;
+    GzipStream gz(*body, http.getSize());
+    if (snapshot && snapshot_len > 0) gz.tee(snapshot, snapshot_len);
+    if (!gz.ok()) {
+        LOG_E("NET", "%s: can't inflate gzip body", SOURCE_NAMES[src]);
+        return DeserializationError::InvalidInput;
+    }
+    DeserializationError err = filter ? deserializeJson(doc, gz, DeserializationOption::Filter(*filter))
+                                      : deserializeJson(doc, gz);
+    if (!gz.finish() && !err) {
+        LOG_W("NET", "%s: gzip body failed its CRC/length check", SOURCE_NAMES[src]);
+        err = DeserializationError::InvalidInput;
+    }
+    count_body(src, gz.wire_bytes(), gz.body_bytes(), true);
+    return err;
+}
+
+void net_read_text(HTTPClient& http, NetSource src, char* buf, size_t len) {
+    if (len == 0) return;
+    if (!body_is_gzip(http)) {
+        String payload = http.getString();
+        strncpy(buf, payload.c_str(), len - 1);
+        buf[len - 1] = '\0';
+        count_body(src, payload.length(), payload.length(), false);
+        return;
+    }
+
+    buf[0] = '\0';
+    Stream* body = http.getStreamPtr();
+    if (!body) return;
+    GzipStream gz(*body, http.getSize());
+    gz.tee(buf, len);
+    gz.finish();
+    count_body(src, gz.wire_bytes(), gz.body_bytes(), true);
+}
+
+const NetBodyStats& net_body_stats(NetSource src) {
+    return body_stats[src < NET_SRC_COUNT ? src : 0];
+}
+
+const char* net_source_name(NetSource src) {
+    return src < NET_SRC_COUNT ? SOURCE_NAMES[src] : "?";
+}
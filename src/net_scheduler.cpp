@@ -0,0 +1,145 @@
+#include "net_scheduler.h"
+#include "logger.h"
+#include <Arduino.h>
+
+static const char* const JOB_NAMES[NET_JOB_COUNT] = { "glucose", "weather", "forecast", "dns" };
+
+static NetJobFn jobs[NET_JOB_COUNT];
+static NetJobStats stats[NET_JOB_COUNT];
+static bool last_ok[NET_JOB_COUNT];
+static uint32_t finished[NET_JOB_COUNT];   // completed runs, the force tickets
+
+// Bit per job; shared with the web server task
+static uint32_t pending_mask = 0;
+static uint32_t running_mask = 0;
+
+static unsigned long last_start_ms = 0;
+static bool heap_warned = false;
+
+static int bits(uint32_t v) {
+    return __builtin_popcount(v);
+}
+
+// Room for one more session: a slot and a heap block big enough for it
+static bool heap_fits_session() {
+    return ESP.getMaxAllocHeap() >= NET_HEAP_RESERVE + NET_TLS_SESSION_BYTES;
+}
+
+// Take a session slot for job; false if it is in flight or there's no room
+static bool try_claim(NetJob job) {
+    uint32_t bit = 1u << job;
+    uint32_t cur = __atomic_load_n(&running_mask, __ATOMIC_RELAXED);
+    do {
+        if (cur & bit) return false;
+        if (bits(cur) >= NET_MAX_TLS_SESSIONS) return false;
+        if (!heap_fits_session()) return false;
+    } while (!__atomic_compare_exchange_n(&running_mask, &cur, cur | bit, false,
+                                          __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+    return true;
+}
+
+// Run a claimed job. Requests that arrive meanwhile are answered by this run.
+static bool execute(NetJob job) {
+    uint32_t bit = 1u << job;
+    unsigned long start = millis();
+    bool ok = jobs[job]();
+
+    NetJobStats& s = stats[job];
+    s.runs++;
+    if (!ok) s.failures++;
+    s.last_ms = millis() - start;
+    last_ok[job] = ok;
+
+    __atomic_and_fetch(&pending_mask, ~bit, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&finished[job], 1, __ATOMIC_RELEASE);
+    __atomic_and_fetch(&running_mask, ~bit, __ATOMIC_RELEASE);
+    return ok;
+}
+
+void net_sched_init() {
+    memset(stats, 0, sizeof(stats));
+    memset(last_ok, 0, sizeof(last_ok));
+    pending_mask = 0;
+    running_mask = 0;
+    last_start_ms = 0;
+    heap_warned = false;
+}
+
+void net_sched_register(NetJob job, NetJobFn fn) {
+    if (job < NET_JOB_COUNT) jobs[job] = fn;
+}
+
+void net_sched_request(NetJob job) {
+    if (job >= NET_JOB_COUNT || !jobs[job]) return;
+    uint32_t bit = 1u << job;
+    __atomic_fetch_or(&pending_mask, bit, __ATOMIC_RELAXED);
+    if (__atomic_load_n(&running_mask, __ATOMIC_RELAXED) & bit) {
+        __atomic_fetch_add(&stats[job].coalesced, 1, __ATOMIC_RELAXED);
+    }
+}
+
+void net_sched_loop() {
+    uint32_t pending = __atomic_load_n(&pending_mask, __ATOMIC_RELAXED);
+    if (pending == 0) return;
+    if (last_start_ms != 0 && millis() - last_start_ms < NET_JOB_GAP_MS) return;
+
+    for (int i = 0; i < NET_JOB_COUNT; i++) {
+        NetJob job = (NetJob)i;
+        if (!(pending & (1u << i))) continue;
+        if (!jobs[i]) {
+            __atomic_and_fetch(&pending_mask, ~(1u << i), __ATOMIC_RELAXED);
+            continue;
+        }
+        if (!try_claim(job)) {
+            // Lower priorities would need the same slot; wait for the next pass
+            __atomic_fetch_add(&stats[i].deferred, 1, __ATOMIC_RELAXED);
+            if (!heap_fits_session() && !heap_warned) {
+                LOG_W("NET", "Deferring %s: largest free block %u B is below the TLS budget",
+                      JOB_NAMES[i], (unsigned)ESP.getMaxAllocHeap());
+                heap_warned = true;
+            }
+            return;
+        }
+        heap_warned = false;
+        last_start_ms = millis();
+        execute(job);
+        return;   // one job per pass, the display gets a frame in between
+    }
+}
+
+uint32_t net_sched_force(NetJob job) {
+    if (job >= NET_JOB_COUNT) return 0;
+    uint32_t ticket = __atomic_load_n(&finished[job], __ATOMIC_ACQUIRE);
+    net_sched_request(job);
+    return ticket;
+}
+
+NetResult net_sched_result(NetJob job, uint32_t ticket) {
+    if (job >= NET_JOB_COUNT || !jobs[job]) return NET_RESULT_FAILED;
+    if (__atomic_load_n(&finished[job], __ATOMIC_ACQUIRE) == ticket) return NET_RESULT_PENDING;
+    return last_ok[job] ? NET_RESULT_OK : NET_RESULT_FAILED;
+}
+
+int net_sched_sessions_allowed() {
+    int active = net_sched_active();
+    int room = (int)((ESP.getMaxAllocHeap() > NET_HEAP_RESERVE
+                      ? ESP.getMaxAllocHeap() - NET_HEAP_RESERVE : 0) / NET_TLS_SESSION_BYTES);
+    int allowed = active + room;
+    return allowed < NET_MAX_TLS_SESSIONS ? allowed : NET_MAX_TLS_SESSIONS;
+}
+
+int net_sched_active() {
+    return bits(__atomic_load_n(&running_mask, __ATOMIC_RELAXED));
+}
+
+bool net_sched_pending(NetJob job) {
+    return job < NET_JOB_COUNT && (__atomic_load_n(&pending_mask, __ATOMIC_RELAXED) & (1u << job));
+}
+
+const NetJobStats& net_sched_stats(NetJob job) {
+    return stats[job < NET_JOB_COUNT ? job : 0];
+}
+
+const char* net_sched_job_name(NetJob job) {
+    return job < NET_JOB_COUNT ? JOB_NAMES[job] : "?";
+}
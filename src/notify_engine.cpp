@@ -1,99 +1,342 @@
 #include "notify_engine.h"
 #include "config_manager.h"
 #include "buzzer.h"
+#include "engine_events.h"
+#include "logger.h"
 #include <Arduino.h>
 #include <string.h>
 
-#define MAX_NOTIFICATIONS 3
+// Pushes come from the web handlers (AsyncTCP task) as well as the loop
+// task, which expires and rotates; every table, lane and heap change
+// happens under this lock. Nothing inside it logs or beeps.
+#ifndef SUGARCLOCK_SIM
+static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+#define NOTIFY_LOCK()   portENTER_CRITICAL(&lock)
+#define NOTIFY_UNLOCK() portEXIT_CRITICAL(&lock)
+#else
+#define NOTIFY_LOCK()
+#define NOTIFY_UNLOCK()
+#endif
 
+#define MAX_NOTIFICATIONS   32
+#define ARENA_BLOCK_SIZE    32
+#define ARENA_BLOCKS        64   // 2 KB of text shared by all notifications
+#define NOTIFY_MAX_TEXT     128  // per notification, including terminator
+#define NOTIFY_MIN_DWELL_MS 3000 // short texts in rotation
+
+// Entries live in a fixed table; the two lanes are ring buffers of table
+// indices (urgent items are shown before any normal one) and a min-heap of
+// indices orders them by expiry, so per-frame queries never scan.
 struct Notification {
-    char text[64];
     unsigned long expire_ms;
+    uint8_t block;       // first arena block of the text
+    uint8_t blocks;      // arena blocks used
+    uint8_t text_len;
+    uint8_t heap_pos;
     bool urgent;
     bool active;
 };
 
+struct Lane {
+    uint8_t items[MAX_NOTIFICATIONS];
+    uint8_t head;
+    uint8_t count;
+};
+
 static Notification notifications[MAX_NOTIFICATIONS];
-static int current_index = 0;
+static char arena[ARENA_BLOCKS * ARENA_BLOCK_SIZE];
+static uint64_t arena_used = 0;   // one bit per block
 
-void notify_init() {
-    for (int i = 0; i < MAX_NOTIFICATIONS; i++) {
-        notifications[i].active = false;
-        notifications[i].text[0] = '\0';
+static Lane urgent_lane;
+static Lane normal_lane;
+
+static uint8_t heap[MAX_NOTIFICATIONS];
+static int heap_size = 0;
+
+// Cached head of the lane being shown (-1 = none); updated on push,
+// expiry, dismiss and rotation only
+static int current = -1;
+static unsigned long current_since_ms = 0;
+static unsigned long rejected = 0;
+
+// Copy of the current text handed to the renderer, so a push evicting the
+// entry on another task can't rewrite it mid-frame
+static char shown_text[NOTIFY_MAX_TEXT];
+
+// --- Text arena ---
+
+static int arena_alloc(int blocks) {
+    int run = 0;
+    for (int i = 0; i < ARENA_BLOCKS; i++) {
+        if (arena_used & (1ULL << i)) {
+            run = 0;
+            continue;
+        }
+        if (++run == blocks) {
+            int start = i - blocks + 1;
+            for (int b = start; b <= i; b++) arena_used |= 1ULL << b;
+            return start;
+        }
     }
+    return -1;
 }
 
-void notify_loop() {
-    // Expire old notifications
-    for (int i = 0; i < MAX_NOTIFICATIONS; i++) {
-        if (notifications[i].active && millis() >= notifications[i].expire_ms) {
-            notifications[i].active = false;
-            Serial.printf("[NOTIFY] Notification %d expired\n", i);
+static void arena_free(int start, int blocks) {
+    for (int b = start; b < start + blocks; b++) arena_used &= ~(1ULL << b);
+}
+
+// --- Expiry heap ---
+
+static bool expires_before(int a, int b) {
+    return (long)(notifications[a].expire_ms - notifications[b].expire_ms) < 0;
+}
+
+static void heap_swap(int i, int j) {
+    uint8_t t = heap[i];
+    heap[i] = heap[j];
+    heap[j] = t;
+    notifications[heap[i]].heap_pos = i;
+    notifications[heap[j]].heap_pos = j;
+}
+
+static void heap_sift_up(int i) {
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!expires_before(heap[i], heap[parent])) break;
+        heap_swap(i, parent);
+        i = parent;
+    }
+}
+
+static void heap_sift_down(int i) {
+    while (true) {
+        int smallest = i;
+        int l = 2 * i + 1, r = 2 * i + 2;
+        if (l < heap_size && expires_before(heap[l], heap[smallest])) smallest = l;
+        if (r < heap_size && expires_before(heap[r], heap[smallest])) smallest = r;
+        if (smallest == i) break;
+        heap_swap(i, smallest);
+        i = smallest;
+    }
+}
+
+static void heap_remove(int pos) {
+    heap_size--;
+    if (pos == heap_size) return;
+    heap[pos] = heap[heap_size];
+    notifications[heap[pos]].heap_pos = pos;
+    heap_sift_up(pos);
+    heap_sift_down(notifications[heap[pos]].heap_pos);
+}
+
+// --- Lanes ---
+
+// New notifications go to the front so they are shown right away; the
+// rest of the lane continues in rotation after them
+static void lane_push_front(Lane& lane, int idx) {
+    lane.head = (lane.head + MAX_NOTIFICATIONS - 1) % MAX_NOTIFICATIONS;
+    lane.items[lane.head] = idx;
+    lane.count++;
+}
+
+static void lane_remove(Lane& lane, int idx) {
+    for (int i = 0; i < lane.count; i++) {
+        if (lane.items[(lane.head + i) % MAX_NOTIFICATIONS] != idx) continue;
+        for (int j = i; j < lane.count - 1; j++) {
+            lane.items[(lane.head + j) % MAX_NOTIFICATIONS] =
+                lane.items[(lane.head + j + 1) % MAX_NOTIFICATIONS];
         }
+        lane.count--;
+        return;
     }
 }
 
-void notify_push(const char* text, int duration_sec, bool urgent) {
-    // Find empty slot or use oldest (circular)
-    int slot = -1;
-    for (int i = 0; i < MAX_NOTIFICATIONS; i++) {
-        if (!notifications[i].active) {
-            slot = i;
-            break;
+static void update_current() {
+    int prev = current;
+    if (urgent_lane.count > 0) current = urgent_lane.items[urgent_lane.head];
+    else if (normal_lane.count > 0) current = normal_lane.items[normal_lane.head];
+    else current = -1;
+    if (current != prev) current_since_ms = millis();
+    if ((current >= 0) != (prev >= 0)) engine_post_event(ENGINE_EV_NOTIFY);
+}
+
+static void remove_entry(int idx) {
+    Notification& n = notifications[idx];
+    lane_remove(n.urgent ? urgent_lane : normal_lane, idx);
+    heap_remove(n.heap_pos);
+    arena_free(n.block, n.blocks);
+    n.active = false;
+}
+
+// Normal notification closest to expiry, or -1 (only used when full)
+static int expiring_normal() {
+    int best = -1;
+    for (int i = 0; i < normal_lane.count; i++) {
+        int idx = normal_lane.items[(normal_lane.head + i) % MAX_NOTIFICATIONS];
+        if (best < 0 || expires_before(idx, best)) best = idx;
+    }
+    return best;
+}
+
+// Time the current notification stays up before the next one in its lane
+static unsigned long dwell_ms(int idx) {
+    int len = notifications[idx].text_len;
+    if (len <= 5) return NOTIFY_MIN_DWELL_MS;
+    return (unsigned long)(len * 6 + 32) * NOTIFY_SCROLL_MS_PER_PX;
+}
+
+void notify_init() {
+    NOTIFY_LOCK();
+    memset(notifications, 0, sizeof(notifications));
+    memset(&urgent_lane, 0, sizeof(urgent_lane));
+    memset(&normal_lane, 0, sizeof(normal_lane));
+    arena_used = 0;
+    heap_size = 0;
+    current = -1;
+    rejected = 0;
+    NOTIFY_UNLOCK();
+}
+
+void notify_loop() {
+    NOTIFY_LOCK();
+    // Expire from the top of the heap only
+    int expired = 0;
+    while (heap_size > 0 && (long)(millis() - notifications[heap[0]].expire_ms) >= 0) {
+        remove_entry(heap[0]);
+        expired++;
+    }
+    if (expired) update_current();
+
+    // Rotate within the lane being shown
+    if (current >= 0) {
+        Lane& lane = notifications[current].urgent ? urgent_lane : normal_lane;
+        if (lane.count > 1 && millis() - current_since_ms >= dwell_ms(current)) {
+            lane.head = (lane.head + 1) % MAX_NOTIFICATIONS;
+            lane.items[(lane.head + lane.count - 1) % MAX_NOTIFICATIONS] = current;
+            update_current();
         }
     }
-    if (slot < 0) {
-        // Overwrite oldest (slot 0, shift others)
-        for (int i = 0; i < MAX_NOTIFICATIONS - 1; i++) {
-            notifications[i] = notifications[i + 1];
+    NOTIFY_UNLOCK();
+
+    if (expired) LOG_D("NOTIFY", "%d notification(s) expired", expired);
+}
+
+bool notify_push(const char* text, int duration_sec, bool urgent) {
+    int len = strlen(text);
+    if (len > NOTIFY_MAX_TEXT - 1) len = NOTIFY_MAX_TEXT - 1;
+    int blocks = (len + 1 + ARENA_BLOCK_SIZE - 1) / ARENA_BLOCK_SIZE;
+
+    // Find a free entry and room for the text. An urgent push may evict
+    // the normal notification closest to expiry; a normal one is refused.
+    int idx = -1;
+    int block = -1;
+    int dropped = 0;
+    char dropped_text[NOTIFY_MAX_TEXT];
+    NOTIFY_LOCK();
+    while (true) {
+        if (idx < 0) {
+            for (int i = 0; i < MAX_NOTIFICATIONS; i++) {
+                if (!notifications[i].active) { idx = i; break; }
+            }
+        }
+        if (idx >= 0) block = arena_alloc(blocks);
+        if (idx >= 0 && block >= 0) break;
+
+        int victim = urgent ? expiring_normal() : -1;
+        if (victim < 0) {
+            rejected++;
+            NOTIFY_UNLOCK();
+            LOG_W("NOTIFY", "Queue full, rejected: \"%s\"", text);
+            return false;
         }
-        slot = MAX_NOTIFICATIONS - 1;
+        strcpy(dropped_text, arena + notifications[victim].block * ARENA_BLOCK_SIZE);
+        remove_entry(victim);
+        rejected++;
+        dropped++;
     }
 
-    strncpy(notifications[slot].text, text, sizeof(notifications[slot].text) - 1);
-    notifications[slot].text[sizeof(notifications[slot].text) - 1] = '\0';
-    notifications[slot].expire_ms = millis() + (unsigned long)duration_sec * 1000UL;
-    notifications[slot].urgent = urgent;
-    notifications[slot].active = true;
-    current_index = slot;
+    Notification& n = notifications[idx];
+    char* dst = arena + block * ARENA_BLOCK_SIZE;
+    memcpy(dst, text, len);
+    dst[len] = '\0';
+    n.block = block;
+    n.blocks = blocks;
+    n.text_len = len;
+    n.expire_ms = millis() + (unsigned long)duration_sec * 1000UL;
+    n.urgent = urgent;
+    n.active = true;
 
-    Serial.printf("[NOTIFY] Pushed: \"%s\" duration=%ds urgent=%d\n", text, duration_sec, urgent);
+    heap[heap_size] = idx;
+    n.heap_pos = heap_size;
+    heap_size++;
+    heap_sift_up(n.heap_pos);
+
+    lane_push_front(urgent ? urgent_lane : normal_lane, idx);
+    update_current();
+    int queued = heap_size;
+    NOTIFY_UNLOCK();
+
+    if (dropped) {
+        LOG_W("NOTIFY", "Queue full, dropped %d (last \"%s\") for urgent notification",
+              dropped, dropped_text);
+    }
+    LOG_I("NOTIFY", "Pushed: \"%.*s\" duration=%ds urgent=%d (%d queued)",
+          len, text, duration_sec, urgent, queued);
 
     // Buzzer for urgent notifications
     AppConfig& cfg = config_get();
     if (urgent && cfg.notify_allow_buzzer) {
         buzzer_beep(2, 2500, 150);
     }
+    return true;
 }
 
 bool notify_has_active() {
-    for (int i = 0; i < MAX_NOTIFICATIONS; i++) {
-        if (notifications[i].active) return true;
-    }
-    return false;
+    return current >= 0;
 }
 
 const char* notify_get_text() {
-    // Return most recent active notification
-    for (int i = MAX_NOTIFICATIONS - 1; i >= 0; i--) {
-        if (notifications[i].active) {
-            return notifications[i].text;
-        }
-    }
-    return "";
+    NOTIFY_LOCK();
+    if (current < 0) shown_text[0] = '\0';
+    else strcpy(shown_text, arena + notifications[current].block * ARENA_BLOCK_SIZE);
+    NOTIFY_UNLOCK();
+    return shown_text;
 }
 
 bool notify_is_urgent() {
-    for (int i = MAX_NOTIFICATIONS - 1; i >= 0; i--) {
-        if (notifications[i].active) {
-            return notifications[i].urgent;
-        }
-    }
-    return false;
+    NOTIFY_LOCK();
+    bool urgent = current >= 0 && notifications[current].urgent;
+    NOTIFY_UNLOCK();
+    return urgent;
+}
+
+unsigned long notify_shown_ms() {
+    NOTIFY_LOCK();
+    unsigned long ms = current >= 0 ? millis() - current_since_ms : 0;
+    NOTIFY_UNLOCK();
+    return ms;
+}
+
+int notify_count() {
+    return heap_size;
+}
+
+unsigned long notify_rejected_count() {
+    return rejected;
 }
 
 void notify_dismiss() {
-    for (int i = 0; i < MAX_NOTIFICATIONS; i++) {
-        notifications[i].active = false;
+    NOTIFY_LOCK();
+    if (current >= 0) {
+        remove_entry(current);
+        update_current();
     }
+    NOTIFY_UNLOCK();
+}
+
+void notify_clear() {
+    NOTIFY_LOCK();
+    while (heap_size > 0) remove_entry(heap[0]);
+    update_current();
+    NOTIFY_UNLOCK();
 }
@@ -0,0 +1,334 @@
+#include "ota_update.h"
+#include "wifi_manager.h"
+#include "metrics.h"
+#include "www_bundle.h"
+#include <Update.h>
+#include <LittleFS.h>
+#include <Preferences.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <mbedtls/sha256.h>
+#include "esp32/rom/miniz.h"
+#include "logger.h"
+#include <Arduino.h>
+
+#define OTA_NAMESPACE  "ota"
+#define GZIP_DICT_SIZE TINFL_LZ_DICT_SIZE  // 32 KB inflate window
+
+static OtaState state = OTA_IDLE;
+static OtaTarget target = OTA_FIRMWARE;
+static char last_error[96] = "";
+static size_t received = 0;
+static size_t written = 0;
+static bool pending_verify = false;
+
+// Web bundle target: written with the partition API (Update only knows app
+// and spiffs partitions), erasing each sector just ahead of the data
+static const esp_partition_t* www_part = nullptr;
+static size_t www_erased = 0;
+
+static mbedtls_sha256_context sha_ctx;
+static uint8_t expected_digest[32];
+static bool check_digest = false;
+
+// gzip stream (only allocated while inflating)
+static bool sniffed = false;
+static bool gzip = false;
+static bool gzip_done = false;
+static tinfl_decompressor* inflator = nullptr;
+static uint8_t* dict = nullptr;
+static size_t dict_pos = 0;
+
+static void free_buffers() {
+    free(inflator);
+    free(dict);
+    inflator = nullptr;
+    dict = nullptr;
+}
+
+static bool fail(const char* msg) {
+    strncpy(last_error, msg, sizeof(last_error) - 1);
+    last_error[sizeof(last_error) - 1] = '\0';
+    LOG_E("OTA", "Failed: %s", last_error);
+    Update.abort();
+    mbedtls_sha256_free(&sha_ctx);
+    free_buffers();
+    state = OTA_FAILED;
+    // Resume the bundle this update suspended, if the erase left it whole
+    if (target == OTA_WEB_BUNDLE && www_part) www_bundle_init();
+    return false;
+}
+
+static bool parse_hex_digest(const char* hex, uint8_t* out) {
+    if (strlen(hex) != 64) return false;
+    for (int i = 0; i < 32; i++) {
+        char byte[3] = { hex[i * 2], hex[i * 2 + 1], '\0' };
+        char* end;
+        out[i] = (uint8_t)strtoul(byte, &end, 16);
+        if (*end != '\0') return false;
+    }
+    return true;
+}
+
+// RFC 1952 member header; must arrive whole in the first chunk
+static bool skip_gzip_header(const uint8_t* data, size_t len, size_t* offset) {
+    if (len < 10 || data[0] != 0x1f || data[1] != 0x8b || data[2] != 8) return false;
+    uint8_t flags = data[3];
+    size_t pos = 10;
+    if (flags & 0x04) {  // FEXTRA
+        if (pos + 2 > len) return false;
+        pos += 2 + (data[pos] | (data[pos + 1] << 8));
+    }
+    if (flags & 0x08) {  // FNAME
+        while (pos < len && data[pos] != 0) pos++;
+        pos++;
+    }
+    if (flags & 0x10) {  // FCOMMENT
+        while (pos < len && data[pos] != 0) pos++;
+        pos++;
+    }
+    if (flags & 0x02) pos += 2;  // FHCRC
+    if (pos > len) return false;
+    *offset = pos;
+    return true;
+}
+
+static bool write_www(const uint8_t* data, size_t len) {
+    if (written + len > www_part->size) return fail("Image larger than the www partition");
+    while (www_erased < written + len) {
+        if (esp_partition_erase_range(www_part, www_erased, SPI_FLASH_SEC_SIZE) != ESP_OK) {
+            return fail("Flash erase failed");
+        }
+        www_erased += SPI_FLASH_SEC_SIZE;
+    }
+    if (esp_partition_write(www_part, written, data, len) != ESP_OK) return fail("Flash write failed");
+    return true;
+}
+
+static bool write_image(const uint8_t* data, size_t len) {
+    mbedtls_sha256_update(&sha_ctx, data, len);
+    if (target == OTA_WEB_BUNDLE) {
+        if (!write_www(data, len)) return false;
+    } else if (Update.write((uint8_t*)data, len) != len) {
+        return fail(Update.errorString());
+    }
+    written += len;
+    return true;
+}
+
+static bool inflate_chunk(const uint8_t* data, size_t len) {
+    while (!gzip_done) {
+        size_t in_bytes = len;
+        size_t out_bytes = GZIP_DICT_SIZE - dict_pos;
+        tinfl_status st = tinfl_decompress(inflator, data, &in_bytes, dict, dict + dict_pos,
+                                           &out_bytes, TINFL_FLAG_HAS_MORE_INPUT);
+        data += in_bytes;
+        len -= in_bytes;
+        if (out_bytes > 0 && !write_image(dict + dict_pos, out_bytes)) return false;
+        dict_pos = (dict_pos + out_bytes) & (GZIP_DICT_SIZE - 1);
+
+        if (st < TINFL_STATUS_DONE) return fail("Corrupt gzip data");
+        if (st == TINFL_STATUS_DONE) gzip_done = true;
+        else if (st == TINFL_STATUS_NEEDS_MORE_INPUT && len == 0) break;
+        else if (in_bytes == 0 && out_bytes == 0) return fail("gzip stream stalled");
+    }
+    // The CRC32/size trailer is ignored; the SHA-256 covers the inflated image
+    return true;
+}
+
+void ota_init() {
+    const esp_partition_t* running = esp_ota_get_running_partition();
+    Preferences prefs;
+    prefs.begin(OTA_NAMESPACE, false);
+
+    if (prefs.getBool("pending", false)) {
+        char prev[17] = "";
+        prefs.getString("prev", prev, sizeof(prev));
+        uint8_t boots = prefs.getUChar("boots", 0) + 1;
+
+        if (strcmp(running->label, prev) == 0) {
+            // The bootloader already refused the new image
+            LOG_W("OTA", "New firmware did not boot, still on %s", running->label);
+            prefs.clear();
+        } else if (boots > OTA_MAX_BOOT_ATTEMPTS) {
+            prefs.clear();
+            prefs.end();
+            const esp_partition_t* fallback = esp_partition_find_first(
+                ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_ANY, prev);
+            if (fallback && esp_ota_set_boot_partition(fallback) == ESP_OK) {
+                LOG_W("OTA", "%s failed %d boots, rolling back to %s",
+                      running->label, OTA_MAX_BOOT_ATTEMPTS, prev);
+                delay(100);
+                ESP.restart();
+            }
+            LOG_W("OTA", "Rollback to %s not possible, keeping %s", prev, running->label);
+            return;
+        } else {
+            prefs.putUChar("boots", boots);
+            metrics_inc(METRIC_NVS_WRITES);
+            pending_verify = true;
+            LOG_I("OTA", "New firmware on %s, boot %d/%d before confirmation",
+                  running->label, boots, OTA_MAX_BOOT_ATTEMPTS);
+        }
+    }
+    prefs.end();
+}
+
+void ota_loop() {
+    if (!pending_verify) return;
+    if (millis() < OTA_HEALTHY_MS) return;
+    if (!wifi_is_connected() && !wifi_is_ap_mode()) return;
+
+    // Also cancels the bootloader's own rollback when that is compiled in
+    esp_ota_mark_app_valid_cancel_rollback();
+    Preferences prefs;
+    prefs.begin(OTA_NAMESPACE, false);
+    prefs.clear();
+    prefs.end();
+    metrics_inc(METRIC_NVS_WRITES);
+    pending_verify = false;
+    LOG_I("OTA", "Firmware on %s confirmed", ota_running_partition());
+}
+
+bool ota_begin(OtaTarget t, const char* expected_sha256) {
+    if (state == OTA_RECEIVING) {
+        strncpy(last_error, "Update already in progress", sizeof(last_error) - 1);
+        return false;
+    }
+
+    target = t;
+    received = 0;
+    written = 0;
+    sniffed = false;
+    gzip = false;
+    gzip_done = false;
+    dict_pos = 0;
+    last_error[0] = '\0';
+
+    check_digest = expected_sha256 && strlen(expected_sha256) > 0;
+    if (check_digest && !parse_hex_digest(expected_sha256, expected_digest)) {
+        strncpy(last_error, "sha256 must be 64 hex digits", sizeof(last_error) - 1);
+        state = OTA_FAILED;
+        return false;
+    }
+
+    mbedtls_sha256_init(&sha_ctx);
+    mbedtls_sha256_starts(&sha_ctx, 0);
+    state = OTA_RECEIVING;
+
+    if (target == OTA_FILESYSTEM) {
+        // The partition is overwritten in place; stop serving from it
+        LittleFS.end();
+        if (!Update.begin(UPDATE_SIZE_UNKNOWN, U_SPIFFS)) return fail(Update.errorString());
+        LOG_I("OTA", "Receiving filesystem image");
+    } else if (target == OTA_WEB_BUNDLE) {
+        www_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                            WWW_PARTITION_LABEL);
+        if (!www_part) return fail("No www partition (flash the new layout over USB once)");
+        www_bundle_suspend();
+        www_erased = 0;
+        LOG_I("OTA", "Receiving web bundle into %s", www_part->label);
+    } else {
+        if (!Update.begin(UPDATE_SIZE_UNKNOWN, U_FLASH)) return fail(Update.errorString());
+        const esp_partition_t* next = esp_ota_get_next_update_partition(NULL);
+        LOG_I("OTA", "Receiving firmware into %s", next ? next->label : "?");
+    }
+    return true;
+}
+
+bool ota_write(const uint8_t* data, size_t len) {
+    if (state != OTA_RECEIVING) return false;
+    received += len;
+
+    if (!sniffed) {
+        sniffed = true;
+        if (len >= 2 && data[0] == 0x1f && data[1] == 0x8b) {
+            size_t offset = 0;
+            if (!skip_gzip_header(data, len, &offset)) return fail("Bad gzip header");
+            inflator = (tinfl_decompressor*)malloc(sizeof(tinfl_decompressor));
+            dict = (uint8_t*)malloc(GZIP_DICT_SIZE);
+            if (!inflator || !dict) return fail("Not enough memory to inflate");
+            tinfl_init(inflator);
+            gzip = true;
+            data += offset;
+            len -= offset;
+            LOG_I("OTA", "gzip image, inflating on the fly");
+        }
+    }
+
+    if (gzip) return inflate_chunk(data, len);
+    return write_image(data, len);
+}
+
+bool ota_end() {
+    if (state != OTA_RECEIVING) return false;
+    if (gzip && !gzip_done) return fail("Truncated gzip stream");
+    if (written == 0) return fail("Empty image");
+
+    uint8_t digest[32];
+    mbedtls_sha256_finish(&sha_ctx, digest);
+    if (check_digest && memcmp(digest, expected_digest, sizeof(digest)) != 0) {
+        return fail("SHA-256 mismatch");
+    }
+
+    // For firmware this also validates the app image and selects the new slot
+    if (target != OTA_WEB_BUNDLE && !Update.end(true)) return fail(Update.errorString());
+    mbedtls_sha256_free(&sha_ctx);
+    free_buffers();
+
+    if (target == OTA_FIRMWARE) {
+        Preferences prefs;
+        prefs.begin(OTA_NAMESPACE, false);
+        prefs.putBool("pending", true);
+        prefs.putString("prev", ota_running_partition());
+        prefs.putUChar("boots", 0);
+        prefs.end();
+        metrics_inc(METRIC_NVS_WRITES);
+    }
+
+    state = OTA_SUCCESS;
+    LOG_I("OTA", "%s update OK: %u bytes received, %u written",
+          ota_target_name(target), (unsigned)received, (unsigned)written);
+    return true;
+}
+
+void ota_abort() {
+    if (state == OTA_RECEIVING) fail("Upload aborted");
+}
+
+OtaState ota_get_state() {
+    return state;
+}
+
+OtaTarget ota_get_target() {
+    return target;
+}
+
+const char* ota_target_name(OtaTarget t) {
+    switch (t) {
+        case OTA_FILESYSTEM: return "filesystem";
+        case OTA_WEB_BUNDLE: return "www";
+        default:             return "firmware";
+    }
+}
+
+const char* ota_last_error() {
+    return last_error;
+}
+
+size_t ota_bytes_received() {
+    return received;
+}
+
+size_t ota_bytes_written() {
+    return written;
+}
+
+const char* ota_running_partition() {
+    const esp_partition_t* running = esp_ota_get_running_partition();
+    return running ? running->label : "?";
+}
+
+bool ota_is_pending_verify() {
+    return pending_verify;
+}
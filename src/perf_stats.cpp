@@ -0,0 +1,65 @@
+#include "perf_stats.h"
+#include "metrics.h"
+#include <Arduino.h>
+
+static unsigned long loop_count = 0;
+static uint64_t loop_total_us = 0;
+static unsigned long loop_max_us = 0;
+static unsigned long loop_stalls = 0;
+static PerfFetchStats fetch_stats[PERF_SOURCE_COUNT];
+
+static const char* SOURCE_NAMES[PERF_SOURCE_COUNT] = { "glucose", "weather" };
+
+void perf_loop_sample(unsigned long loop_us) {
+    loop_count++;
+    loop_total_us += loop_us;
+    if (loop_us > loop_max_us) loop_max_us = loop_us;
+    if (loop_us >= PERF_STALL_MS * 1000UL) loop_stalls++;
+    metrics_observe_loop(loop_us);
+}
+
+void perf_fetch_sample(PerfSource src, unsigned long duration_ms, int http_code) {
+    if (src >= PERF_SOURCE_COUNT) return;
+    PerfFetchStats& s = fetch_stats[src];
+    s.count++;
+    if (http_code != 200) s.failures++;
+    s.last_ms = duration_ms;
+    s.total_ms += duration_ms;
+    if (duration_ms > s.max_ms) s.max_ms = duration_ms;
+    s.last_code = http_code;
+    metrics_observe_fetch(src, duration_ms, http_code);
+}
+
+unsigned long perf_loop_count() {
+    return loop_count;
+}
+
+unsigned long perf_loop_max_us() {
+    return loop_max_us;
+}
+
+unsigned long perf_loop_avg_us() {
+    if (loop_count == 0) return 0;
+    return (unsigned long)(loop_total_us / loop_count);
+}
+
+unsigned long perf_loop_stalls() {
+    return loop_stalls;
+}
+
+const PerfFetchStats& perf_fetch_stats(PerfSource src) {
+    if (src >= PERF_SOURCE_COUNT) src = PERF_GLUCOSE;
+    return fetch_stats[src];
+}
+
+const char* perf_source_name(PerfSource src) {
+    return src < PERF_SOURCE_COUNT ? SOURCE_NAMES[src] : "unknown";
+}
+
+void perf_reset() {
+    loop_count = 0;
+    loop_total_us = 0;
+    loop_max_us = 0;
+    loop_stalls = 0;
+    memset(fetch_stats, 0, sizeof(fetch_stats));
+}
@@ -0,0 +1,134 @@
+#include "rate_limit.h"
+#include "logger.h"
+#include <Arduino.h>
+
+// All calls come from the AsyncTCP task (handlers and disconnects), so the
+// tables need no locking.
+
+struct ClassLimit {
+    const char* name;
+    uint32_t per_min;     // sustained rate
+    uint32_t burst;       // bucket size
+};
+
+static const ClassLimit LIMITS[RATE_CLASS_COUNT] = {
+    { "status", 240, 20 },   // a few dashboard tabs polling every couple of seconds
+    { "config",  30,  6 },
+    { "ingest", 120, 10 },
+    { "test",     6,  2 },   // each one is an outbound fetch
+};
+
+struct Client {
+    uint32_t ip;
+    unsigned long last_ms;
+    uint32_t milli_tokens[RATE_CLASS_COUNT];
+    bool used;
+};
+
+static Client clients[RATE_CLIENT_SLOTS];
+static unsigned long inflight_since[RATE_INFLIGHT_MAX];   // 0 = free
+static RateClassStats stats[RATE_CLASS_COUNT];
+
+void rate_limit_init() {
+    memset(clients, 0, sizeof(clients));
+    memset(inflight_since, 0, sizeof(inflight_since));
+    memset(stats, 0, sizeof(stats));
+}
+
+// The client's entry, else a fresh one in a free or the least recently seen slot
+static Client& client_for(uint32_t ip, unsigned long now) {
+    Client* victim = &clients[0];
+    for (Client& c : clients) {
+        if (c.used && c.ip == ip) return c;
+    }
+    for (Client& c : clients) {
+        if (!c.used) { victim = &c; break; }
+        if ((long)(c.last_ms - victim->last_ms) < 0) victim = &c;
+    }
+    victim->used = true;
+    victim->ip = ip;
+    victim->last_ms = now;
+    for (int i = 0; i < RATE_CLASS_COUNT; i++) victim->milli_tokens[i] = LIMITS[i].burst * 1000;
+    return *victim;
+}
+
+static void refill(Client& c, unsigned long now) {
+    unsigned long elapsed = now - c.last_ms;
+    c.last_ms = now;
+    for (int i = 0; i < RATE_CLASS_COUNT; i++) {
+        uint64_t t = c.milli_tokens[i] + (uint64_t)elapsed * LIMITS[i].per_min / 60;
+        uint32_t cap = LIMITS[i].burst * 1000;
+        c.milli_tokens[i] = t > cap ? cap : (uint32_t)t;
+    }
+}
+
+// Reclaim slots whose release never came (connection torn down oddly)
+static void expire_inflight(unsigned long now) {
+    for (unsigned long& since : inflight_since) {
+        if (since && now - since >= RATE_INFLIGHT_TIMEOUT_MS) {
+            LOG_W("RATE", "In-flight slot never released, reclaiming");
+            since = 0;
+        }
+    }
+}
+
+int rate_limit_inflight() {
+    int n = 0;
+    for (unsigned long since : inflight_since) {
+        if (since) n++;
+    }
+    return n;
+}
+
+int rate_limit_inflight_cap() {
+    uint32_t free_heap = ESP.getFreeHeap();
+    if (free_heap <= RATE_HEAP_FLOOR) return 0;
+    uint32_t n = (free_heap - RATE_HEAP_FLOOR) / RATE_RESPONSE_BYTES;
+    return n > RATE_INFLIGHT_MAX ? RATE_INFLIGHT_MAX : (int)n;
+}
+
+Admission rate_limit_admit(uint32_t ip, RateClass cls, int* slot, uint32_t* retry_after_sec) {
+    unsigned long now = millis();
+    *slot = -1;
+    *retry_after_sec = 0;
+
+    Client& c = client_for(ip, now);
+    refill(c, now);
+    const ClassLimit& lim = LIMITS[cls];
+    if (c.milli_tokens[cls] < 1000) {
+        uint32_t missing = 1000 - c.milli_tokens[cls];
+        uint32_t wait_ms = (uint32_t)((uint64_t)missing * 60 / lim.per_min);
+        *retry_after_sec = wait_ms / 1000 + 1;
+        stats[cls].limited++;
+        return ADMIT_LIMITED;
+    }
+
+    expire_inflight(now);
+    if (rate_limit_inflight() >= rate_limit_inflight_cap()) {
+        *retry_after_sec = 1;
+        stats[cls].busy++;
+        return ADMIT_BUSY;    // the client's token is kept: it wasn't served
+    }
+    for (int i = 0; i < RATE_INFLIGHT_MAX; i++) {
+        if (inflight_since[i] == 0) {
+            inflight_since[i] = now ? now : 1;
+            *slot = i;
+            break;
+        }
+    }
+    c.milli_tokens[cls] -= 1000;
+    stats[cls].admitted++;
+    return ADMIT_OK;
+}
+
+void rate_limit_release(int slot) {
+    if (slot >= 0 && slot < RATE_INFLIGHT_MAX) inflight_since[slot] = 0;
+}
+
+const RateClassStats& rate_limit_stats(RateClass cls) {
+    return stats[cls < RATE_CLASS_COUNT ? cls : 0];
+}
+
+const char* rate_class_name(RateClass cls) {
+    return cls < RATE_CLASS_COUNT ? LIMITS[cls].name : "?";
+}
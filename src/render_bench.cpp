@@ -0,0 +1,376 @@
+#include "render_bench.h"
+#include "glucose_engine.h"
+#include "display.h"
+#include "glucose_lut.h"
+#include "config_manager.h"
+#include "http_client.h"
+#include "notify_engine.h"
+#include "feature_modules.h"
+#if FEATURE_WEATHER
+#include "weather_client.h"
+#include "weather_fx.h"
+#endif
+#if FEATURE_SYSMON
+#include "sysmon_engine.h"
+#endif
+#include "logger.h"
+#include <LittleFS.h>
+#include <ArduinoJson.h>
+#include <Arduino.h>
+
+#define BENCH_MARQUEE_TEXT "Lunch is ready in the kitchen!"  // 30 chars
+
+struct BenchCase {
+    const char* name;
+    BenchKind kind;
+    DisplayState state;   // BENCH_KIND_STATE
+    void (*setup)();      // optional, runs before the warmup frames
+    void (*draw)();       // BENCH_KIND_PRIMITIVE
+};
+
+// --- Fixtures ---
+
+static int fixture_glucose = 142;
+
+static void set_glucose(int value, TrendType trend) {
+    GlucoseReading r;
+    memset(&r, 0, sizeof(r));
+    r.glucose = value;
+    r.trend = trend;
+    r.force_mode = -1;
+    r.received_at_ms = millis();
+    r.valid = true;
+    http_set_reading(r);
+}
+
+static void setup_glucose() {
+    config_get().show_delta = false;
+    set_glucose(fixture_glucose, TREND_FLAT);
+}
+
+// Two readings in a row so the 3 s delta flash is showing. The second one
+// is the real value, so no stray flash follows when the bench restores it.
+static void setup_glucose_delta() {
+    config_get().show_delta = true;
+    set_glucose(fixture_glucose - 6, TREND_RISING);
+    engine_render_frame(STATE_GLUCOSE_DISPLAY);
+    set_glucose(fixture_glucose, TREND_RISING);
+}
+
+static void setup_trend() {
+    set_glucose(fixture_glucose, TREND_RISING);
+}
+
+#if FEATURE_WEATHER
+// Heavy rain: particles spawn every frame, no random thunder flash
+static void setup_weather() {
+    WeatherReading wx;
+    memset(&wx, 0, sizeof(wx));
+    wx.temp = 21.4f;
+    strncpy(wx.description, "Rain", sizeof(wx.description) - 1);
+    wx.condition_id = 502;
+    wx.humidity = 60;
+    wx.received_at_ms = millis();
+    wx.valid = true;
+    weather_set_reading(wx);
+}
+
+// Every particle slot in use, blown sideways: the animation's worst case
+static void setup_weather_fx() {
+    setup_weather();
+    WeatherReading wx = weather_get_reading();
+    wx.wind_ms = 8.0f;
+    wx.wind_deg = 270;
+    weather_set_reading(wx);
+    weather_fx_clear();
+    weather_fx_fill(wx);
+}
+#endif
+
+#if FEATURE_SYSMON
+// Only when no computer is pushing stats; the sample ages out after 30 s
+static void setup_sysmon() {
+    if (!sysmon_has_data()) sysmon_push("CPU", 73, 100);
+}
+
+static void setup_sysmon_text() {
+    setup_sysmon();
+    config_get().sysmon_display_mode = 0;
+}
+
+static void setup_sysmon_bar() {
+    setup_sysmon();
+    config_get().sysmon_display_mode = 1;
+}
+#endif
+
+static void setup_message() {
+    engine_set_message(BENCH_MARQUEE_TEXT);
+}
+
+static bool pushed_notify = false;
+
+static void setup_notify() {
+    if (notify_has_active()) return;
+    notify_push(BENCH_MARQUEE_TEXT, 60);
+    pushed_notify = true;
+}
+
+// --- Primitives ---
+
+static void draw_clear()   { display_clear(); }
+static void draw_text()    { display_draw_text("12:34", 2, 0, display_color(255, 255, 255)); }
+static void draw_text_30() { display_draw_text(BENCH_MARQUEE_TEXT, 0, 0, display_color(0, 200, 200)); }
+static void draw_glucose() {
+    const GlucoseLutEntry& e = glucose_lut_get(fixture_glucose);
+    display_draw_glucose(e.text, e.width, glucose_lut_color(e));
+}
+static void draw_trend()   { display_draw_trend(TREND_RISING, 20, 0, display_color(0, 255, 0)); }
+static void draw_bar()     { display_draw_bar(73, 100, display_color(255, 255, 0)); }
+static void draw_show()    { display_show(); }
+#if FEATURE_WEATHER
+static void draw_weather_fx() { weather_fx_frame(weather_get_reading(), millis()); }
+#endif
+
+static const BenchCase CASES[] = {
+    { "BOOT",                 BENCH_KIND_STATE, STATE_BOOT,              nullptr,             nullptr },
+    { "GLUCOSE",              BENCH_KIND_STATE, STATE_GLUCOSE_DISPLAY,   setup_glucose,       nullptr },
+    { "GLUCOSE_DELTA",        BENCH_KIND_STATE, STATE_GLUCOSE_DISPLAY,   setup_glucose_delta, nullptr },
+    { "TREND",                BENCH_KIND_STATE, STATE_TREND_DISPLAY,     setup_trend,         nullptr },
+    { "TIME",                 BENCH_KIND_STATE, STATE_TIME_DISPLAY,      nullptr,             nullptr },
+#if FEATURE_WEATHER
+    { "WEATHER",              BENCH_KIND_STATE, STATE_WEATHER_DISPLAY,   setup_weather,       nullptr },
+#endif
+#if FEATURE_TIMER
+    { "TIMER",                BENCH_KIND_STATE, STATE_TIMER_DISPLAY,     nullptr,             nullptr },
+    { "STOPWATCH",            BENCH_KIND_STATE, STATE_STOPWATCH_DISPLAY, nullptr,             nullptr },
+#endif
+#if FEATURE_SYSMON
+    { "SYSMON",               BENCH_KIND_STATE, STATE_SYSMON_DISPLAY,    setup_sysmon_text,   nullptr },
+    { "SYSMON_BAR",           BENCH_KIND_STATE, STATE_SYSMON_DISPLAY,    setup_sysmon_bar,    nullptr },
+#endif
+#if FEATURE_COUNTDOWN
+    { "COUNTDOWN",            BENCH_KIND_STATE, STATE_COUNTDOWN_DISPLAY, nullptr,             nullptr },
+#endif
+    { "MESSAGE",              BENCH_KIND_STATE, STATE_MESSAGE_DISPLAY,   setup_message,       nullptr },
+    { "NOTIFY",               BENCH_KIND_STATE, STATE_NOTIFY_DISPLAY,    setup_notify,        nullptr },
+    { "STALE",                BENCH_KIND_STATE, STATE_STALE_WARNING,     nullptr,             nullptr },
+    { "NO_DATA",              BENCH_KIND_STATE, STATE_NO_DATA,           nullptr,             nullptr },
+    { "NO_WIFI",              BENCH_KIND_STATE, STATE_NO_WIFI,           nullptr,             nullptr },
+    { "NO_CFG",               BENCH_KIND_STATE, STATE_NO_CFG,            nullptr,             nullptr },
+    { "PROVISIONING",         BENCH_KIND_STATE, STATE_PROVISIONING,      nullptr,             nullptr },
+    { "display_clear",        BENCH_KIND_PRIMITIVE, STATE_BOOT,          nullptr,             draw_clear },
+    { "display_draw_text",    BENCH_KIND_PRIMITIVE, STATE_BOOT,          nullptr,             draw_text },
+    { "display_draw_text_30", BENCH_KIND_PRIMITIVE, STATE_BOOT,          nullptr,             draw_text_30 },
+    { "display_draw_glucose", BENCH_KIND_PRIMITIVE, STATE_BOOT,          nullptr,             draw_glucose },
+    { "display_draw_trend",   BENCH_KIND_PRIMITIVE, STATE_BOOT,          nullptr,             draw_trend },
+    { "display_draw_bar",     BENCH_KIND_PRIMITIVE, STATE_BOOT,          nullptr,             draw_bar },
+    { "display_show",         BENCH_KIND_PRIMITIVE, STATE_BOOT,          nullptr,             draw_show },
+#if FEATURE_WEATHER
+    { "weather_fx_full",      BENCH_KIND_PRIMITIVE, STATE_BOOT,          setup_weather_fx,    draw_weather_fx },
+#endif
+};
+
+#define CASE_COUNT ((int)(sizeof(CASES) / sizeof(CASES[0])))
+
+static BenchResult results[CASE_COUNT];
+static uint32_t baseline[CASE_COUNT];
+static int regressions = 0;
+static volatile BenchStatus status = BENCH_IDLE;
+static volatile bool save_after_run = false;
+
+static void measure(const BenchCase& c, BenchResult& r) {
+    if (c.setup) c.setup();
+
+    uint32_t samples[BENCH_FRAMES];
+    uint64_t total = 0;
+    for (int i = 0; i < BENCH_WARMUP_FRAMES + BENCH_FRAMES; i++) {
+        uint32_t start = ESP.getCycleCount();
+        if (c.kind == BENCH_KIND_STATE) {
+            engine_render_frame(c.state);
+        } else {
+            c.draw();
+        }
+        uint32_t cycles = ESP.getCycleCount() - start;
+        if (i < BENCH_WARMUP_FRAMES) continue;
+        total += cycles;
+
+        // Insertion sort as we go; BENCH_FRAMES is small
+        int j = i - BENCH_WARMUP_FRAMES;
+        while (j > 0 && samples[j - 1] > cycles) {
+            samples[j] = samples[j - 1];
+            j--;
+        }
+        samples[j] = cycles;
+    }
+
+    r.name = c.name;
+    r.kind = c.kind;
+    r.avg_cycles = (uint32_t)(total / BENCH_FRAMES);
+    r.median_cycles = samples[BENCH_FRAMES / 2];
+    r.max_cycles = samples[BENCH_FRAMES - 1];
+}
+
+void bench_request(bool save_baseline) {
+    save_after_run = save_baseline;
+    status = BENCH_PENDING;
+}
+
+void bench_loop() {
+    if (status != BENCH_PENDING) return;
+    bench_run();
+    if (save_after_run) {
+        save_after_run = false;
+        bench_save_baseline();
+    }
+}
+
+int bench_run() {
+    bench_load_baseline();
+
+    // Snapshot everything the fixtures overwrite
+    AppConfig& cfg = config_get();
+    GlucoseReading saved_reading = http_get_reading();
+#if FEATURE_WEATHER
+    WeatherReading saved_weather = weather_get_reading();
+#endif
+    char saved_message[128];
+    strncpy(saved_message, engine_get_message(), sizeof(saved_message) - 1);
+    saved_message[sizeof(saved_message) - 1] = '\0';
+    bool saved_show_delta = cfg.show_delta;
+    int saved_sysmon_mode = cfg.sysmon_display_mode;
+    uint8_t saved_brightness = display_get_brightness();
+
+    fixture_glucose = saved_reading.valid ? saved_reading.glucose : 142;
+    pushed_notify = false;
+
+    unsigned long start_ms = millis();
+    regressions = 0;
+    for (int i = 0; i < CASE_COUNT; i++) {
+        BenchResult& r = results[i];
+        measure(CASES[i], r);
+        r.baseline_cycles = baseline[i];
+        r.regressed = baseline[i] > 0 &&
+                      r.median_cycles > baseline[i] + BENCH_NOISE_CYCLES &&
+                      (uint64_t)r.median_cycles * 100 > (uint64_t)baseline[i] * (100 + BENCH_REGRESSION_PCT);
+        if (r.regressed) regressions++;
+    }
+
+    http_set_reading(saved_reading);
+#if FEATURE_WEATHER
+    weather_set_reading(saved_weather);
+    weather_fx_clear();
+#endif
+    engine_set_message(saved_message);
+    cfg.show_delta = saved_show_delta;
+    cfg.sysmon_display_mode = saved_sysmon_mode;
+    display_set_brightness(saved_brightness);
+    if (pushed_notify) notify_dismiss();
+
+    LOG_I("BENCH", "%d cases x %d frames in %lums, %d regression(s)",
+          CASE_COUNT, BENCH_FRAMES, millis() - start_ms, regressions);
+    for (int i = 0; i < CASE_COUNT; i++) {
+        if (results[i].regressed) {
+            LOG_E("BENCH", "REGRESSION %s: %u cycles (baseline %u)",
+                  results[i].name, results[i].median_cycles, results[i].baseline_cycles);
+        }
+#if FEATURE_WEATHER
+        if (CASES[i].draw == draw_weather_fx && results[i].median_cycles > WEATHER_FX_BUDGET_CYCLES) {
+            LOG_W("BENCH", "weather_fx_full over budget: %u cycles (%u)",
+                  results[i].median_cycles, (unsigned)WEATHER_FX_BUDGET_CYCLES);
+        }
+#endif
+    }
+
+    status = BENCH_DONE;
+    return regressions;
+}
+
+BenchStatus bench_get_status() {
+    return status;
+}
+
+int bench_result_count() {
+    return status == BENCH_DONE ? CASE_COUNT : 0;
+}
+
+const BenchResult& bench_get_result(int index) {
+    return results[constrain(index, 0, CASE_COUNT - 1)];
+}
+
+int bench_regression_count() {
+    return regressions;
+}
+
+uint32_t bench_cpu_mhz() {
+    return getCpuFrequencyMhz();
+}
+
+void bench_set_baseline(const char* name, uint32_t cycles) {
+    for (int i = 0; i < CASE_COUNT; i++) {
+        if (strcmp(CASES[i].name, name) == 0) {
+            baseline[i] = cycles;
+            return;
+        }
+    }
+}
+
+// Mounted on first use: with the web UI bundle nothing mounts it at boot
+// (a no-op when it is already mounted)
+static bool fs_mount() {
+    if (LittleFS.begin(true)) return true;
+    LOG_E("BENCH", "LittleFS mount failed");
+    return false;
+}
+
+bool bench_load_baseline() {
+    if (!fs_mount() || !LittleFS.exists(BENCH_BASELINE_PATH)) return false;
+    File f = LittleFS.open(BENCH_BASELINE_PATH, "r");
+    if (!f) return false;
+
+    JsonDocument doc;
+    DeserializationError err = deserializeJson(doc, f);
+    f.close();
+    if (err) {
+        LOG_E("BENCH", "Baseline parse error: %s", err.c_str());
+        return false;
+    }
+
+    // Cycle counts from a different clock speed are not comparable
+    if ((doc["cpu_mhz"] | 0) != (int)bench_cpu_mhz()) {
+        LOG_W("BENCH", "Baseline recorded at a different CPU clock, ignoring");
+        return false;
+    }
+
+    memset(baseline, 0, sizeof(baseline));
+    JsonObject cases = doc["cases"];
+    for (JsonPair kv : cases) {
+        bench_set_baseline(kv.key().c_str(), kv.value().as<uint32_t>());
+    }
+    return true;
+}
+
+bool bench_save_baseline() {
+    if (status != BENCH_DONE) return false;
+
+    JsonDocument doc;
+    doc["cpu_mhz"] = bench_cpu_mhz();
+    JsonObject cases = doc["cases"].to<JsonObject>();
+    for (int i = 0; i < CASE_COUNT; i++) {
+        cases[results[i].name] = results[i].median_cycles;
+        baseline[i] = results[i].median_cycles;
+        results[i].baseline_cycles = results[i].median_cycles;
+        results[i].regressed = false;
+    }
+    regressions = 0;
+
+    File f = fs_mount() ? LittleFS.open(BENCH_BASELINE_PATH, "w") : File();
+    if (!f) {
+        LOG_E("BENCH", "Failed to write baseline");
+        return false;
+    }
+    serializeJson(doc, f);
+    f.close();
+    LOG_I("BENCH", "Baseline saved");
+    return true;
+}
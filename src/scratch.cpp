@@ -0,0 +1,124 @@
+#include "scratch.h"
+#include <Arduino.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint8_t loop_buf[SCRATCH_LOOP_SIZE] __attribute__((aligned(8)));
+static uint8_t web_buf[SCRATCH_WEB_SIZE] __attribute__((aligned(8)));
+
+ScratchArena scratch_loop = { "loop", loop_buf, sizeof(loop_buf), 0, 0, 0 };
+ScratchArena scratch_web = { "web", web_buf, sizeof(web_buf), 0, 0, 0 };
+
+#ifndef SUGARCLOCK_SIM
+static TaskHandle_t loop_task = nullptr;
+#endif
+
+static size_t align8(size_t n) {
+    return (n + 7) & ~(size_t)7;
+}
+
+static ScratchArena& arena_for_task() {
+#ifdef SUGARCLOCK_SIM
+    return scratch_loop;
+#else
+    return xTaskGetCurrentTaskHandle() == loop_task ? scratch_loop : scratch_web;
+#endif
+}
+
+static void* arena_alloc(ScratchArena& a, size_t size) {
+    size_t need = align8(size);
+    if (need > a.size - a.used) {
+        a.overflows++;
+        return nullptr;
+    }
+    void* p = a.base + a.used;
+    a.used += need;
+    if (a.used > a.high_water) a.high_water = a.used;
+    return p;
+}
+
+// ArduinoJson grows its pools with reallocate(), so each block carries its
+// size. The newest block can grow, shrink or be released in place; anything
+// older stays until the scope rewinds.
+#define BLOCK_HDR 8
+
+class ArenaJsonAllocator : public ArduinoJson::Allocator {
+public:
+    explicit ArenaJsonAllocator(ScratchArena& arena) : a_(arena) {}
+
+    void* allocate(size_t size) override {
+        uint8_t* block = (uint8_t*)arena_alloc(a_, size + BLOCK_HDR);
+        if (!block) return malloc(size);
+        *(size_t*)block = size;
+        return block + BLOCK_HDR;
+    }
+
+    void deallocate(void* ptr) override {
+        if (!ptr) return;
+        if (!owns(ptr)) {
+            free(ptr);
+            return;
+        }
+        uint8_t* block = (uint8_t*)ptr - BLOCK_HDR;
+        if (is_last(block)) a_.used = block - a_.base;
+    }
+
+    void* reallocate(void* ptr, size_t new_size) override {
+        if (!ptr) return allocate(new_size);
+        if (!owns(ptr)) return realloc(ptr, new_size);
+
+        uint8_t* block = (uint8_t*)ptr - BLOCK_HDR;
+        size_t old_size = *(size_t*)block;
+        if (is_last(block)) {
+            size_t end = (block - a_.base) + align8(new_size + BLOCK_HDR);
+            if (end <= a_.size) {
+                a_.used = end;
+                if (a_.used > a_.high_water) a_.high_water = a_.used;
+                *(size_t*)block = new_size;
+                return ptr;
+            }
+        } else if (new_size <= old_size) {
+            return ptr;
+        }
+
+        void* moved = allocate(new_size);
+        if (!moved) return nullptr;
+        memcpy(moved, ptr, old_size < new_size ? old_size : new_size);
+        deallocate(ptr);
+        return moved;
+    }
+
+private:
+    bool owns(const void* p) const {
+        return p >= a_.base && p < a_.base + a_.size;
+    }
+    bool is_last(const uint8_t* block) const {
+        return block + align8(*(const size_t*)block + BLOCK_HDR) == a_.base + a_.used;
+    }
+
+    ScratchArena& a_;
+};
+
+static ArenaJsonAllocator loop_json(scratch_loop);
+static ArenaJsonAllocator web_json(scratch_web);
+
+void scratch_init() {
+#ifndef SUGARCLOCK_SIM
+    loop_task = xTaskGetCurrentTaskHandle();
+#endif
+}
+
+ScratchScope::ScratchScope() : arena_(arena_for_task()), mark_(arena_.used) {}
+
+ScratchScope::~ScratchScope() {
+    arena_.used = mark_;
+}
+
+void* ScratchScope::alloc(size_t size) {
+    return arena_alloc(arena_, size);
+}
+
+ArduinoJson::Allocator* ScratchScope::json() {
+    if (&arena_ == &scratch_loop) return &loop_json;
+    return &web_json;
+}
@@ -1,5 +1,6 @@
 #include "sensors.h"
 #include "hardware_pins.h"
+#include "logger.h"
 #include <Arduino.h>
 
 #define SENSOR_UPDATE_MS    2000
@@ -34,7 +35,7 @@ void sensors_init() {
     // Initial battery read
     battery_voltage = (analogRead(PIN_BATTERY) / ADC_RESOLUTION) * ADC_REF_VOLTAGE * BATTERY_DIVIDER;
 
-    Serial.printf("[SENSOR] LDR: %d, Battery: %.2fV\n", ldr_smoothed, battery_voltage);
+    LOG_D("SENSOR", "LDR: %d, Battery: %.2fV", ldr_smoothed, battery_voltage);
 }
 
 void sensors_loop() {
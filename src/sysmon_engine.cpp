@@ -1,4 +1,5 @@
 #include "sysmon_engine.h"
+#include "logger.h"
 #include <Arduino.h>
 #include <string.h>
 
@@ -16,17 +17,13 @@ void sysmon_init() {
     last_push_ms = 0;
 }
 
-void sysmon_loop() {
-    // Nothing needed - staleness is checked in sysmon_has_data()
-}
-
 void sysmon_push(const char* lbl, int val, int mx) {
     strncpy(label, lbl, sizeof(label) - 1);
     label[sizeof(label) - 1] = '\0';
     value = val;
     max_val = (mx > 0) ? mx : 100;
     last_push_ms = millis();
-    Serial.printf("[SYSMON] Push: %s=%d/%d\n", label, value, max_val);
+    LOG_D("SYSMON", "Push: %s=%d/%d", label, value, max_val);
 }
 
 bool sysmon_has_data() {
@@ -1,6 +1,7 @@
 #include "time_engine.h"
 #include "config_manager.h"
 #include "wifi_manager.h"
+#include "logger.h"
 #include <Arduino.h>
 #include <time.h>
 #include <Wire.h>
@@ -47,7 +48,7 @@ static void rtc_write_time() {
     Wire.write(dec_to_bcd(timeinfo.tm_year - 100));
     Wire.endTransmission();
 
-    Serial.println("[TIME] Written to RTC");
+    LOG_D("TIME", "Written to RTC");
 }
 
 // Read time from DS1307 and set system time
@@ -82,7 +83,7 @@ static bool rtc_read_time() {
     struct timeval tv = { .tv_sec = epoch, .tv_usec = 0 };
     settimeofday(&tv, NULL);
 
-    Serial.printf("[TIME] Read from RTC: %02d:%02d:%02d\n", hour, min, sec);
+    LOG_I("TIME", "Read from RTC: %02d:%02d:%02d", hour, min, sec);
     return true;
 }
 
@@ -95,15 +96,15 @@ static void ntp_sync() {
     if (getLocalTime(&timeinfo, 5000)) {
         ntp_synced = true;
         last_ntp_sync_ms = millis();
-        Serial.printf("[TIME] NTP synced: %02d:%02d:%02d\n",
-                      timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
+        LOG_I("TIME", "NTP synced: %02d:%02d:%02d",
+              timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
 
         // Write to RTC if available
         if (rtc_available) {
             rtc_write_time();
         }
     } else {
-        Serial.println("[TIME] NTP sync failed");
+        LOG_E("TIME", "NTP sync failed");
     }
 }
 
@@ -116,13 +117,13 @@ void time_init() {
     // Detect RTC
     rtc_available = rtc_detect();
     if (rtc_available) {
-        Serial.println("[TIME] DS1307 RTC detected");
+        LOG_I("TIME", "DS1307 RTC detected");
         // Read time from RTC as initial source
         if (rtc_read_time()) {
-            Serial.println("[TIME] Using RTC time until NTP sync");
+            LOG_I("TIME", "Using RTC time until NTP sync");
         }
     } else {
-        Serial.println("[TIME] No RTC detected");
+        LOG_W("TIME", "No RTC detected");
     }
 
     // Try NTP if WiFi is connected
@@ -140,7 +141,7 @@ void time_loop() {
     // Periodic NTP resync
     if (ntp_synced && wifi_is_connected() &&
         (millis() - last_ntp_sync_ms > NTP_RESYNC_INTERVAL_MS)) {
-        Serial.println("[TIME] NTP resync");
+        LOG_D("TIME", "NTP resync");
         ntp_sync();
     }
 }
@@ -1,6 +1,7 @@
 #include "timer_engine.h"
 #include "config_manager.h"
 #include "buzzer.h"
+#include "logger.h"
 #include <Arduino.h>
 
 // Pomodoro timer state
@@ -40,14 +41,14 @@ void timer_loop() {
                     timer_duration_ms = cfg.timer_long_break_min * 60000;
                     timer_start_ms = millis();
                     timer_current_session = 1;
-                    Serial.println("[TIMER] Long break started");
+                    LOG_I("TIMER", "Long break started");
                 } else {
                     // Start short break
                     timer_state = TIMER_BREAK;
                     timer_duration_ms = cfg.timer_break_min * 60000;
                     timer_start_ms = millis();
-                    Serial.printf("[TIMER] Break started (session %d/%d done)\n",
-                                  timer_current_session, cfg.timer_sessions);
+                    LOG_I("TIMER", "Break started (session %d/%d done)",
+                          timer_current_session, cfg.timer_sessions);
                 }
             } else {
                 // Break done - start next work session
@@ -55,7 +56,7 @@ void timer_loop() {
                 timer_state = TIMER_RUNNING;
                 timer_duration_ms = cfg.timer_work_min * 60000;
                 timer_start_ms = millis();
-                Serial.printf("[TIMER] Work session %d started\n", timer_current_session);
+                LOG_I("TIMER", "Work session %d started", timer_current_session);
             }
         }
     }
@@ -72,7 +73,7 @@ void timer_toggle_start_pause() {
             timer_duration_ms = cfg.timer_work_min * 60000;
             timer_start_ms = millis();
             timer_current_session = 1;
-            Serial.println("[TIMER] Started");
+            LOG_I("TIMER", "Started");
             break;
 
         case TIMER_RUNNING:
@@ -83,7 +84,7 @@ void timer_toggle_start_pause() {
             timer_paused_remaining_ms = (timer_duration_ms > (int)elapsed) ?
                                         (timer_duration_ms - elapsed) : 0;
             timer_state = TIMER_PAUSED;
-            Serial.println("[TIMER] Paused");
+            LOG_I("TIMER", "Paused");
             break;
         }
 
@@ -92,7 +93,7 @@ void timer_toggle_start_pause() {
             timer_state = TIMER_RUNNING;
             timer_duration_ms = timer_paused_remaining_ms;
             timer_start_ms = millis();
-            Serial.println("[TIMER] Resumed");
+            LOG_I("TIMER", "Resumed");
             break;
     }
 }
@@ -103,7 +104,7 @@ void timer_reset() {
     timer_duration_ms = cfg.timer_work_min * 60000;
     timer_paused_remaining_ms = timer_duration_ms;
     timer_current_session = 1;
-    Serial.println("[TIMER] Reset");
+    LOG_I("TIMER", "Reset");
 }
 
 TimerState timer_get_state() {
@@ -150,19 +151,19 @@ void stopwatch_toggle_start_pause() {
             sw_state = SW_RUNNING;
             sw_start_ms = millis();
             sw_paused_elapsed_ms = 0;
-            Serial.println("[STOPWATCH] Started");
+            LOG_I("STOPWATCH", "Started");
             break;
 
         case SW_RUNNING:
             sw_paused_elapsed_ms = millis() - sw_start_ms;
             sw_state = SW_PAUSED;
-            Serial.println("[STOPWATCH] Paused");
+            LOG_I("STOPWATCH", "Paused");
             break;
 
         case SW_PAUSED:
             sw_start_ms = millis() - sw_paused_elapsed_ms;
             sw_state = SW_RUNNING;
-            Serial.println("[STOPWATCH] Resumed");
+            LOG_I("STOPWATCH", "Resumed");
             break;
     }
 }
@@ -171,7 +172,7 @@ void stopwatch_reset() {
     sw_state = SW_IDLE;
     sw_start_ms = 0;
     sw_paused_elapsed_ms = 0;
-    Serial.println("[STOPWATCH] Reset");
+    LOG_I("STOPWATCH", "Reset");
 }
 
 StopwatchState stopwatch_get_state() {
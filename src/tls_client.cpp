@@ -0,0 +1,324 @@
+#include "tls_client.h"
+#include "logger.h"
+#include <Arduino.h>
+#include <new>
+
+#ifndef SUGARCLOCK_SIM
+#include <esp_random.h>
+#include <mbedtls/error.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/net_sockets.h>
+#include <mbedtls/ssl_ciphersuites.h>
+#endif
+
+static TlsHostStats hosts[TLS_HOST_SLOTS];
+
+// Slot for a host: its own, a free one, else the least recently used
+static TlsHostStats& stats_for(const char* host) {
+    TlsHostStats* victim = &hosts[0];
+    for (TlsHostStats& h : hosts) {
+        if (strcmp(h.host, host) == 0) return h;
+    }
+    for (TlsHostStats& h : hosts) {
+        if (h.host[0] == '\0') { victim = &h; break; }
+        if ((long)(h.last_used_ms - victim->last_used_ms) < 0) victim = &h;
+    }
+    memset(victim, 0, sizeof(*victim));
+    strncpy(victim->host, host, sizeof(victim->host) - 1);
+    return *victim;
+}
+
+static void record_handshake(const char* host, bool ok, unsigned long ms,
+                             uint16_t max_frag, const char* suite) {
+    TlsHostStats& h = stats_for(host);
+    h.last_used_ms = millis();
+    if (!ok) {
+        h.failures++;
+        return;
+    }
+    h.handshakes++;
+    h.last_handshake_ms = ms;
+    if (ms > h.max_handshake_ms) h.max_handshake_ms = ms;
+    h.max_frag = max_frag;
+    strncpy(h.suite, suite, sizeof(h.suite) - 1);
+    h.suite[sizeof(h.suite) - 1] = '\0';
+}
+
+static void record_peak(const char* host, uint32_t bytes) {
+    TlsHostStats& h = stats_for(host);
+    if (bytes > h.peak_heap_bytes) h.peak_heap_bytes = bytes;
+}
+
+int tls_host_count() {
+    int n = 0;
+    for (const TlsHostStats& h : hosts) {
+        if (h.host[0] != '\0') n++;
+    }
+    return n;
+}
+
+// i-th host seen
+const TlsHostStats& tls_host_stats(int i) {
+    for (const TlsHostStats& h : hosts) {
+        if (h.host[0] != '\0' && i-- == 0) return h;
+    }
+    return hosts[0];
+}
+
+TlsClient::TlsClient() {
+    host_[0] = '\0';
+}
+
+TlsClient::~TlsClient() {
+    stop();
+}
+
+void TlsClient::sample_heap() {
+    uint32_t free_heap = ESP.getFreeHeap();
+    if (free_heap < heap_low_) heap_low_ = free_heap;
+}
+
+#ifndef SUGARCLOCK_SIM
+
+struct TlsClient::Session {
+    mbedtls_ssl_context ssl;
+    mbedtls_ssl_config conf;
+};
+
+static const int SUITES[] = {
+    MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256,
+    MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256,
+    MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_256_GCM_SHA384,
+    MBEDTLS_TLS_ECDHE_RSA_WITH_AES_256_GCM_SHA384,
+    MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_CBC_SHA256,
+    MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_CBC_SHA256,
+    MBEDTLS_TLS_RSA_WITH_AES_128_GCM_SHA256,     // servers without ECDHE
+    MBEDTLS_TLS_RSA_WITH_AES_128_CBC_SHA,
+    0
+};
+
+static const mbedtls_ecp_group_id CURVES[] = {
+#ifdef MBEDTLS_ECP_DP_CURVE25519_ENABLED
+    MBEDTLS_ECP_DP_CURVE25519,
+#endif
+    MBEDTLS_ECP_DP_SECP256R1,
+    MBEDTLS_ECP_DP_SECP384R1,
+    MBEDTLS_ECP_DP_NONE
+};
+
+static int hw_random(void*, unsigned char* out, size_t len) {
+    esp_fill_random(out, len);
+    return 0;
+}
+
+static int bio_send(void* ctx, const unsigned char* buf, size_t len) {
+    WiFiClient* tcp = (WiFiClient*)ctx;
+    if (!tcp->connected()) return MBEDTLS_ERR_NET_CONN_RESET;
+    size_t n = tcp->write(buf, len);
+    return n > 0 ? (int)n : MBEDTLS_ERR_SSL_WANT_WRITE;
+}
+
+static int bio_recv(void* ctx, unsigned char* buf, size_t len) {
+    WiFiClient* tcp = (WiFiClient*)ctx;
+    if (tcp->available() <= 0) {
+        return tcp->connected() ? MBEDTLS_ERR_SSL_WANT_READ : MBEDTLS_ERR_NET_CONN_RESET;
+    }
+    int n = tcp->read(buf, len);
+    return n > 0 ? n : MBEDTLS_ERR_SSL_WANT_READ;
+}
+
+static bool retry(int ret) {
+    return ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE;
+}
+
+int TlsClient::connect(IPAddress ip, uint16_t port, const char* host, uint32_t timeout_ms) {
+    stop();
+    strncpy(host_, host, sizeof(host_) - 1);
+    host_[sizeof(host_) - 1] = '\0';
+
+    unsigned long start = millis();
+    tcp_.setTimeout((timeout_ms + 999) / 1000);
+    if (!tcp_.connect(ip, port, timeout_ms)) {
+        record_handshake(host_, false, 0, 0, "");
+        return 0;
+    }
+
+    heap_before_ = ESP.getFreeHeap();
+    heap_low_ = heap_before_;
+    session_ = new (std::nothrow) Session;
+    if (!session_) {
+        tcp_.stop();
+        record_handshake(host_, false, 0, 0, "");
+        return 0;
+    }
+    mbedtls_ssl_init(&session_->ssl);
+    mbedtls_ssl_config_init(&session_->conf);
+
+    mbedtls_ssl_config& conf = session_->conf;
+    int ret = mbedtls_ssl_config_defaults(&conf, MBEDTLS_SSL_IS_CLIENT,
+                                          MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT);
+    if (ret == 0) {
+        mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_NONE);
+        mbedtls_ssl_conf_rng(&conf, hw_random, nullptr);
+        mbedtls_ssl_conf_ciphersuites(&conf, SUITES);
+        mbedtls_ssl_conf_curves(&conf, CURVES);
+#ifdef MBEDTLS_SSL_MAX_FRAGMENT_LENGTH
+        mbedtls_ssl_conf_max_frag_len(&conf, MBEDTLS_SSL_MAX_FRAG_LEN_4096);
+#endif
+        ret = mbedtls_ssl_setup(&session_->ssl, &conf);
+    }
+    if (ret == 0) ret = mbedtls_ssl_set_hostname(&session_->ssl, host_);
+    if (ret == 0) {
+        mbedtls_ssl_set_bio(&session_->ssl, &tcp_, bio_send, bio_recv, nullptr);
+        while ((ret = mbedtls_ssl_handshake(&session_->ssl)) != 0) {
+            sample_heap();
+            if (!retry(ret)) break;
+            if (millis() - start >= timeout_ms) {
+                ret = MBEDTLS_ERR_SSL_TIMEOUT;
+                break;
+            }
+            delay(2);
+        }
+    }
+    sample_heap();
+    unsigned long ms = millis() - start;
+
+    if (ret != 0) {
+        char err[64];
+        mbedtls_strerror(ret, err, sizeof(err));
+        LOG_E("TLS", "%s: handshake failed after %lu ms (-0x%04x %s)", host_, ms, -ret, err);
+        record_handshake(host_, false, ms, 0, "");
+        stop();
+        return 0;
+    }
+
+    uint16_t frag = 16384;
+#ifdef MBEDTLS_SSL_MAX_FRAGMENT_LENGTH
+    frag = (uint16_t)mbedtls_ssl_get_input_max_frag_len(&session_->ssl);
+#endif
+    const char* suite = mbedtls_ssl_get_ciphersuite(&session_->ssl);
+    record_handshake(host_, true, ms, frag, suite ? suite : "?");
+    LOG_D("TLS", "%s: %s in %lu ms, records <= %u B, %u B heap",
+          host_, suite ? suite : "?", ms, (unsigned)frag, (unsigned)(heap_before_ - heap_low_));
+    return 1;
+}
+
+int TlsClient::available() {
+    if (!session_) return 0;
+    int n = (peeked_ >= 0) ? 1 : 0;
+    int ret = mbedtls_ssl_read(&session_->ssl, nullptr, 0);   // pulls in the next record
+    n += (int)mbedtls_ssl_get_bytes_avail(&session_->ssl);
+    sample_heap();
+    if (n == 0 && ret != 0 && !retry(ret)) {
+        // close_notify or a broken connection: nothing more will come
+        stop();
+    }
+    return n;
+}
+
+int TlsClient::read(uint8_t* buf, size_t size) {
+    if (!session_ || size == 0) return -1;
+    int got = 0;
+    if (peeked_ >= 0) {
+        buf[got++] = (uint8_t)peeked_;
+        peeked_ = -1;
+        if (--size == 0) return got;
+    }
+    if (mbedtls_ssl_get_bytes_avail(&session_->ssl) == 0 && !available()) {
+        return got > 0 ? got : -1;
+    }
+    int ret = mbedtls_ssl_read(&session_->ssl, buf + got, size);
+    sample_heap();
+    if (ret > 0) got += ret;
+    return got > 0 ? got : -1;
+}
+
+size_t TlsClient::write(const uint8_t* buf, size_t size) {
+    if (!session_) return 0;
+    size_t done = 0;
+    unsigned long start = millis();
+    while (done < size) {
+        int ret = mbedtls_ssl_write(&session_->ssl, buf + done, size - done);
+        if (ret > 0) {
+            done += ret;
+            continue;
+        }
+        if (!retry(ret) || millis() - start >= (unsigned long)getTimeout()) break;
+        delay(2);
+    }
+    sample_heap();
+    return done;
+}
+
+uint8_t TlsClient::connected() {
+    if (!session_) return 0;
+    return peeked_ >= 0 || mbedtls_ssl_get_bytes_avail(&session_->ssl) > 0 || tcp_.connected();
+}
+
+void TlsClient::stop() {
+    if (session_) {
+        mbedtls_ssl_close_notify(&session_->ssl);
+        mbedtls_ssl_free(&session_->ssl);
+        mbedtls_ssl_config_free(&session_->conf);
+        delete session_;
+        session_ = nullptr;
+        record_peak(host_, heap_before_ - heap_low_);
+    }
+    peeked_ = -1;
+    tcp_.stop();
+}
+
+#else  // SUGARCLOCK_SIM: the fake HTTPClient never touches the transport
+
+struct TlsClient::Session {};
+
+int TlsClient::connect(IPAddress ip, uint16_t port, const char* host, uint32_t timeout_ms) {
+    stop();
+    strncpy(host_, host, sizeof(host_) - 1);
+    host_[sizeof(host_) - 1] = '\0';
+    if (!tcp_.connect(ip, port, timeout_ms)) {
+        record_handshake(host_, false, 0, 0, "");
+        return 0;
+    }
+    session_ = new Session;
+    heap_before_ = heap_low_ = ESP.getFreeHeap();
+    record_handshake(host_, true, 0, TLS_MAX_FRAG_LEN, "TLS-ECDHE-ECDSA-WITH-AES-128-GCM-SHA256");
+    return 1;
+}
+
+int TlsClient::available() { return 0; }
+int TlsClient::read(uint8_t*, size_t) { return -1; }
+size_t TlsClient::write(const uint8_t*, size_t size) { return session_ ? size : 0; }
+uint8_t TlsClient::connected() { return session_ != nullptr; }
+
+void TlsClient::stop() {
+    if (session_) {
+        delete session_;
+        session_ = nullptr;
+        record_peak(host_, heap_before_ - heap_low_);
+    }
+    peeked_ = -1;
+    tcp_.stop();
+}
+
+#endif
+
+size_t TlsClient::write(uint8_t b) {
+    return write(&b, 1);
+}
+
+int TlsClient::read() {
+    uint8_t b;
+    return read(&b, 1) == 1 ? b : -1;
+}
+
+int TlsClient::peek() {
+    if (peeked_ < 0) {
+        uint8_t b;
+        if (read(&b, 1) == 1) peeked_ = b;
+    }
+    return peeked_;
+}
+
+void TlsClient::flush() {
+}
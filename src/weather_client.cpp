@@ -1,13 +1,36 @@
 #include "weather_client.h"
 #include "config_manager.h"
 #include "wifi_manager.h"
-#include <WiFiClientSecure.h>
+#include "net_client.h"
+#include "net_scheduler.h"
+#include "perf_stats.h"
+#include "logger.h"
+#include "scratch.h"
+#include "time_engine.h"
+#include "glucose_engine.h"
 #include <HTTPClient.h>
 #include <ArduinoJson.h>
 #include <Arduino.h>
-
-static WeatherReading current_weather;
-static unsigned long last_poll_ms = 0;
+#include <time.h>
+
+#define OWM_DEFAULT_HOST "https://api.openweathermap.org"
+#define OWM_WEATHER_PATH "/data/2.5/weather"
+#define OWM_FORECAST_PATH "/data/2.5/forecast"
+
+#define WEATHER_LEAD_MS   (20UL * 1000UL)        // fetch this long before the screen comes up
+#define WEATHER_RETRY_MS  (60UL * 1000UL)
+#define FORECAST_TTL_MS   (3UL * 3600UL * 1000UL) // OWM recomputes forecasts every 3 h
+#define FORECAST_STEP_MS  (60UL * 1000UL)         // how often the shown reading follows the forecast
+
+static WeatherReading current_weather;   // what the screen shows
+static WeatherReading observed;          // last current-conditions response
+static uint32_t observed_epoch = 0;      // its wall-clock time, 0 = clock not set
+static WeatherForecastSlot forecast[WEATHER_FORECAST_SLOTS];
+static int forecast_count = 0;
+static unsigned long expires_ms = 0;     // when the cached data runs out
+static unsigned long retry_after_ms = 0;
+static unsigned long last_apply_ms = 0;
+static unsigned long api_calls = 0;
 static bool ever_received = false;
 static int last_http_code = 0;
 static char last_response[256] = "";
@@ -38,140 +61,303 @@ static bool is_zip_code(const char* loc) {
     return false;
 }
 
-// Build the weather API URL with auto-detected location type
-static void build_weather_url(char* url, size_t url_len) {
+// Build an API URL (path plus optional extra query) with auto-detected location type
+static void build_weather_url(char* url, size_t url_len, const char* path, const char* extra) {
     AppConfig& cfg = config_get();
     const char* units = cfg.weather_use_f ? "imperial" : "metric";
 
+    // Host override (e.g. a local stand-in server), trailing slash tolerated
+    const char* host = strlen(cfg.weather_base_url) > 0 ? cfg.weather_base_url : OWM_DEFAULT_HOST;
+    int host_len = strlen(host);
+    if (host_len > 0 && host[host_len - 1] == '/') host_len--;
+
     if (is_zip_code(cfg.weather_city)) {
-        // Zip/postal code — use zip= parameter
         // If no country code provided, default to US
-        if (strchr(cfg.weather_city, ',')) {
-            snprintf(url, url_len,
-                     "https://api.openweathermap.org/data/2.5/weather?zip=%s&appid=%s&units=%s",
-                     cfg.weather_city, cfg.weather_api_key, units);
-        } else {
-            snprintf(url, url_len,
-                     "https://api.openweathermap.org/data/2.5/weather?zip=%s,US&appid=%s&units=%s",
-                     cfg.weather_city, cfg.weather_api_key, units);
-        }
-        Serial.printf("[WEATHER] Using zip code: %s\n", cfg.weather_city);
+        snprintf(url, url_len, "%.*s%s?zip=%s%s&appid=%s&units=%s%s",
+                 host_len, host, path, cfg.weather_city,
+                 strchr(cfg.weather_city, ',') ? "" : ",US",
+                 cfg.weather_api_key, units, extra);
     } else {
         // City name — use q= parameter
-        snprintf(url, url_len,
-                 "https://api.openweathermap.org/data/2.5/weather?q=%s&appid=%s&units=%s",
-                 cfg.weather_city, cfg.weather_api_key, units);
-        Serial.printf("[WEATHER] Using city: %s\n", cfg.weather_city);
+        snprintf(url, url_len, "%.*s%s?q=%s&appid=%s&units=%s%s",
+                 host_len, host, path,
+                 cfg.weather_city, cfg.weather_api_key, units, extra);
     }
 }
 
-// Internal fetch logic (shared by loop and force_fetch)
-static bool weather_do_fetch() {
-    AppConfig& cfg = config_get();
-
-    if (strlen(cfg.weather_api_key) == 0) {
-        strncpy(last_response, "No API key configured", sizeof(last_response) - 1);
-        return false;
-    }
-    if (strlen(cfg.weather_city) == 0) {
-        strncpy(last_response, "No location configured", sizeof(last_response) - 1);
-        return false;
-    }
-    if (!wifi_is_connected()) {
-        strncpy(last_response, "WiFi not connected", sizeof(last_response) - 1);
-        return false;
-    }
+// "Cache-Control: max-age=N" in ms, or the fallback
+static unsigned long max_age_ms(HTTPClient& http, unsigned long fallback_ms) {
+    String cc = http.header("Cache-Control");
+    int at = cc.indexOf("max-age=");
+    if (at < 0) return fallback_ms;
+    long sec = atol(cc.c_str() + at + 8);
+    return sec > 0 ? (unsigned long)sec * 1000UL : fallback_ms;
+}
 
-    char url[300];
-    build_weather_url(url, sizeof(url));
+// Blocking GET; true on 200 with the body parsed into doc (through filter,
+// if given) and the cache lifetime in ttl_ms
+static bool owm_get(const char* path, const char* extra, JsonDocument& doc, JsonDocument* filter,
+                    unsigned long* ttl_ms, unsigned long fallback_ttl_ms) {
+    char url[320];
+    build_weather_url(url, sizeof(url), path, extra);
 
-    WiFiClientSecure client;
-    client.setInsecure();
-    client.setTimeout(10);
+    WiFiClient plain;
+    TlsClient tls;
 
     HTTPClient http;
-    if (!http.begin(client, url)) {
-        Serial.println("[WEATHER] Failed to begin connection");
+    if (!net_begin(http, plain, tls, url, 10)) {
+        LOG_E("WEATHER", "Failed to begin connection");
         last_http_code = -1;
         strncpy(last_response, "Failed to connect", sizeof(last_response) - 1);
         return false;
     }
 
     http.setTimeout(10000);
+    net_request_headers(http, "Cache-Control");
 
-    // Notify engine before the blocking HTTP call so it can clear
-    // particle animations and render a clean frame.
+    // Notify engine before the blocking HTTP call so it can render a
+    // frame without particles
     if (pre_fetch_cb) pre_fetch_cb();
 
     int httpCode = http.GET();
+    api_calls++;
     last_http_code = httpCode;
 
     if (httpCode == HTTP_CODE_OK) {
-        String payload = http.getString();
-        strncpy(last_response, payload.c_str(), sizeof(last_response) - 1);
-        last_response[sizeof(last_response) - 1] = '\0';
-
-        JsonDocument doc;
-        DeserializationError err = deserializeJson(doc, payload);
-
+        *ttl_ms = max_age_ms(http, fallback_ttl_ms);
+        DeserializationError err = net_read_json(http, NET_SRC_WEATHER, doc,
+                                                 last_response, sizeof(last_response), filter);
+        http.end();
         if (err) {
-            Serial.printf("[WEATHER] JSON parse error: %s\n", err.c_str());
+            LOG_E("WEATHER", "JSON parse error: %s", err.c_str());
             snprintf(last_response, sizeof(last_response), "JSON parse error: %s", err.c_str());
-            http.end();
             return false;
         }
-
-        current_weather.temp = doc["main"]["temp"] | 0.0f;
-        current_weather.humidity = doc["main"]["humidity"] | 0;
-
-        const char* desc = doc["weather"][0]["main"] | "Unknown";
-        strncpy(current_weather.description, desc, sizeof(current_weather.description) - 1);
-        current_weather.description[sizeof(current_weather.description) - 1] = '\0';
-
-        current_weather.condition_id = doc["weather"][0]["id"] | 0;
-
-        current_weather.received_at_ms = millis();
-        current_weather.valid = true;
-        ever_received = true;
-
-        Serial.printf("[WEATHER] Temp: %.1f%s, %s, Humidity: %d%%\n",
-                      current_weather.temp,
-                      cfg.weather_use_f ? "F" : "C",
-                      current_weather.description,
-                      current_weather.humidity);
-        http.end();
         return true;
-    } else {
-        // Capture error response body for debugging
-        String body = http.getString();
-        Serial.printf("[WEATHER] HTTP error: %d, body: %s\n", httpCode, body.c_str());
-
-        // Try to extract OWM's error message from JSON
-        JsonDocument errDoc;
-        if (deserializeJson(errDoc, body) == DeserializationError::Ok) {
-            const char* msg = errDoc["message"] | "";
-            if (strlen(msg) > 0) {
-                snprintf(last_response, sizeof(last_response), "HTTP %d: %s", httpCode, msg);
-            } else {
-                snprintf(last_response, sizeof(last_response), "HTTP %d", httpCode);
-            }
+    }
+
+    // Capture error response body for debugging
+    char body[160];
+    net_read_text(http, NET_SRC_WEATHER, body, sizeof(body));
+    LOG_E("WEATHER", "HTTP error: %d, body: %s", httpCode, body);
+
+    // Try to extract OWM's error message from JSON
+    ScratchScope scope;
+    JsonDocument errDoc(scope.json());
+    if (deserializeJson(errDoc, body) == DeserializationError::Ok) {
+        const char* msg = errDoc["message"] | "";
+        if (strlen(msg) > 0) {
+            snprintf(last_response, sizeof(last_response), "HTTP %d: %s", httpCode, msg);
         } else {
-            snprintf(last_response, sizeof(last_response), "HTTP %d: %s",
-                     httpCode, body.length() > 0 ? body.c_str() : "No response");
+            snprintf(last_response, sizeof(last_response), "HTTP %d", httpCode);
         }
+    } else {
+        snprintf(last_response, sizeof(last_response), "HTTP %d: %s",
+                 httpCode, body[0] ? body : "No response");
     }
 
     http.end();
     return false;
 }
 
+// Current conditions into observed
+static bool fetch_current(unsigned long* ttl_ms) {
+    AppConfig& cfg = config_get();
+    unsigned long poll_ms = (unsigned long)max(5, cfg.weather_poll_min) * 60UL * 1000UL;
+
+    ScratchScope scope;
+    JsonDocument doc(scope.json());
+    if (!owm_get(OWM_WEATHER_PATH, "", doc, nullptr, ttl_ms, poll_ms)) return false;
+
+    observed.temp = doc["main"]["temp"] | 0.0f;
+    observed.humidity = doc["main"]["humidity"] | 0;
+
+    const char* desc = doc["weather"][0]["main"] | "Unknown";
+    strncpy(observed.description, desc, sizeof(observed.description) - 1);
+    observed.description[sizeof(observed.description) - 1] = '\0';
+
+    observed.condition_id = doc["weather"][0]["id"] | 0;
+    observed.wind_ms = doc["wind"]["speed"] | 0.0f;
+    if (cfg.weather_use_f) observed.wind_ms *= 0.44704f;   // imperial units report mph
+    observed.wind_deg = doc["wind"]["deg"] | 0;
+
+    observed.received_at_ms = millis();
+    observed.valid = true;
+    observed_epoch = time_is_available() ? (uint32_t)time(nullptr) : 0;
+
+    LOG_I("WEATHER", "Temp: %.1f%s, %s, Humidity: %d%%",
+          observed.temp,
+          cfg.weather_use_f ? "F" : "C",
+          observed.description,
+          observed.humidity);
+    return true;
+}
+
+// The next WEATHER_FORECAST_SLOTS 3-hour slots into forecast[]
+static bool fetch_forecast(unsigned long* ttl_ms) {
+    AppConfig& cfg = config_get();
+    char extra[16];
+    snprintf(extra, sizeof(extra), "&cnt=%d", WEATHER_FORECAST_SLOTS);
+
+    // Keep only what the slots need; the full response is several KB
+    ScratchScope scope;
+    JsonDocument filter(scope.json());
+    JsonObject item = filter["list"].add<JsonObject>();
+    item["dt"] = true;
+    item["main"]["temp"] = true;
+    item["weather"][0]["id"] = true;
+    item["weather"][0]["main"] = true;
+    item["wind"]["speed"] = true;
+    item["wind"]["deg"] = true;
+
+    JsonDocument doc(scope.json());
+    if (!owm_get(OWM_FORECAST_PATH, extra, doc, &filter, ttl_ms, FORECAST_TTL_MS)) return false;
+
+    forecast_count = 0;
+    for (JsonObject f : doc["list"].as<JsonArray>()) {
+        if (forecast_count >= WEATHER_FORECAST_SLOTS) break;
+        WeatherForecastSlot& slot = forecast[forecast_count++];
+        slot.time = f["dt"] | 0UL;
+        slot.temp = f["main"]["temp"] | 0.0f;
+        slot.condition_id = f["weather"][0]["id"] | 0;
+        const char* desc = f["weather"][0]["main"] | "Unknown";
+        strncpy(slot.description, desc, sizeof(slot.description) - 1);
+        slot.description[sizeof(slot.description) - 1] = '\0';
+        slot.wind_ms = f["wind"]["speed"] | 0.0f;
+        if (cfg.weather_use_f) slot.wind_ms *= 0.44704f;
+        slot.wind_deg = f["wind"]["deg"] | 0;
+    }
+    LOG_I("WEATHER", "Forecast: %d slots cached for %lu min", forecast_count, *ttl_ms / 60000UL);
+    return forecast_count > 0;
+}
+
+// Move the shown reading along the forecast: the temperature is
+// interpolated from the last observation through the 3-hour slots, the
+// condition and wind are taken from the nearer point
+static void apply_forecast() {
+    if (!observed.valid || observed_epoch == 0 || forecast_count == 0) return;
+    if (!time_is_available()) return;
+    uint32_t now = (uint32_t)time(nullptr);
+
+    uint32_t a_time = observed_epoch;
+    float a_temp = observed.temp;
+    const WeatherForecastSlot* a_slot = nullptr;    // nullptr = the observation
+    for (int i = 0; i < forecast_count; i++) {
+        const WeatherForecastSlot& b = forecast[i];
+        if (b.time <= a_time) continue;
+        if (now >= b.time) {
+            a_time = b.time;
+            a_temp = b.temp;
+            a_slot = &b;
+            continue;
+        }
+        float t = (float)(now - a_time) / (float)(b.time - a_time);
+        current_weather = observed;
+        current_weather.temp = a_temp + (b.temp - a_temp) * t;
+        const WeatherForecastSlot* near = t < 0.5f ? a_slot : &b;
+        if (near) {
+            current_weather.condition_id = near->condition_id;
+            strncpy(current_weather.description, near->description, sizeof(current_weather.description) - 1);
+            current_weather.description[sizeof(current_weather.description) - 1] = '\0';
+            current_weather.wind_ms = near->wind_ms;
+            current_weather.wind_deg = near->wind_deg;
+        }
+        current_weather.received_at_ms = millis();
+        return;
+    }
+    // Past the last slot: hold it until the next fetch
+    if (a_slot) {
+        current_weather.temp = a_slot->temp;
+        current_weather.condition_id = a_slot->condition_id;
+        strncpy(current_weather.description, a_slot->description, sizeof(current_weather.description) - 1);
+        current_weather.description[sizeof(current_weather.description) - 1] = '\0';
+        current_weather.wind_ms = a_slot->wind_ms;
+        current_weather.wind_deg = a_slot->wind_deg;
+        current_weather.received_at_ms = millis();
+    }
+}
+
+// Config and link checks shared by both jobs
+static bool fetch_ready() {
+    AppConfig& cfg = config_get();
+
+    if (strlen(cfg.weather_api_key) == 0) {
+        strncpy(last_response, "No API key configured", sizeof(last_response) - 1);
+        return false;
+    }
+    if (strlen(cfg.weather_city) == 0) {
+        strncpy(last_response, "No location configured", sizeof(last_response) - 1);
+        return false;
+    }
+    if (!wifi_is_connected()) {
+        strncpy(last_response, "WiFi not connected", sizeof(last_response) - 1);
+        return false;
+    }
+    return true;
+}
+
+// Fetch current conditions; they last until their own max-age unless the
+// forecast, fetched on a later pass, carries them further
+static bool weather_do_fetch() {
+    if (!fetch_ready()) return false;
+
+    // Time the blocking request end to end for the perf stats
+    unsigned long start = millis();
+    unsigned long ttl = 0;
+    bool ok = fetch_current(&ttl);
+    perf_fetch_sample(PERF_WEATHER, millis() - start, last_http_code);
+    if (!ok) return false;
+
+    current_weather = observed;
+    ever_received = true;
+    expires_ms = millis() + ttl;
+    last_apply_ms = millis();
+
+    // The forecast is placed against the observation's wall-clock time
+    if (observed_epoch != 0) net_sched_request(NET_JOB_FORECAST);
+    else forecast_count = 0;
+    return true;
+}
+
+// Scheduler job; failures back off before the next request
+static bool weather_job() {
+    bool ok = weather_do_fetch();
+    retry_after_ms = ok ? 0 : millis() + WEATHER_RETRY_MS;
+    return ok;
+}
+
+// Scheduler job: with a forecast the data lasts until the forecast's
+// max-age. Without one the current conditions keep their own.
+static bool forecast_job() {
+    if (!observed.valid || observed_epoch == 0 || !fetch_ready()) return false;
+
+    unsigned long start = millis();
+    unsigned long ttl = 0;
+    bool ok = fetch_forecast(&ttl);
+    perf_fetch_sample(PERF_WEATHER, millis() - start, last_http_code);
+    if (!ok) {
+        forecast_count = 0;
+        return false;
+    }
+    expires_ms = millis() + ttl;
+    return true;
+}
+
 void weather_init() {
     memset(&current_weather, 0, sizeof(WeatherReading));
     current_weather.valid = false;
-    last_poll_ms = 0;
+    memset(&observed, 0, sizeof(WeatherReading));
+    observed_epoch = 0;
+    forecast_count = 0;
+    expires_ms = 0;
+    retry_after_ms = 0;
+    last_apply_ms = 0;
+    api_calls = 0;
     ever_received = false;
     last_http_code = 0;
     last_response[0] = '\0';
+    net_sched_register(NET_JOB_WEATHER, weather_job);
+    net_sched_register(NET_JOB_FORECAST, forecast_job);
 }
 
 void weather_loop() {
@@ -181,19 +367,34 @@ void weather_loop() {
     if (strlen(cfg.weather_api_key) == 0) return;
     if (!wifi_is_connected()) return;
 
-    unsigned long interval_ms = (unsigned long)max(5, cfg.weather_poll_min) * 60UL * 1000UL;
+    // Only for a screen someone will see: not at night, and only once
+    // auto-cycle is about to reach it (or it is up already)
+    if (engine_is_night_mode()) return;
+    if (engine_ms_until_shown(STATE_WEATHER_DISPLAY) > WEATHER_LEAD_MS) return;
 
-    if (last_poll_ms != 0 && (millis() - last_poll_ms < interval_ms)) {
+    unsigned long now = millis();
+    if (!ever_received || (long)(now - expires_ms) >= 0) {
+        if (retry_after_ms != 0 && (long)(now - retry_after_ms) < 0) return;
+        if (!net_sched_pending(NET_JOB_WEATHER)) net_sched_request(NET_JOB_WEATHER);
         return;
     }
 
-    last_poll_ms = millis();
-    weather_do_fetch();
+    if (now - last_apply_ms >= FORECAST_STEP_MS) {
+        last_apply_ms = now;
+        apply_forecast();
+    }
+}
+
+unsigned long weather_api_call_count() {
+    return api_calls;
+}
+
+int weather_forecast_count() {
+    return forecast_count;
 }
 
-bool weather_force_fetch() {
-    last_poll_ms = millis();
-    return weather_do_fetch();
+const WeatherForecastSlot& weather_get_forecast(int i) {
+    return forecast[i];
 }
 
 int weather_get_last_http_code() {
@@ -222,8 +423,20 @@ void weather_set_mock(float temp, const char* desc, int condition_id) {
     current_weather.description[sizeof(current_weather.description) - 1] = '\0';
     current_weather.condition_id = condition_id;
     current_weather.humidity = 50;
+    current_weather.wind_ms = 0.0f;
+    current_weather.wind_deg = 0;
     current_weather.received_at_ms = millis();
     current_weather.valid = true;
     ever_received = true;
-    Serial.printf("[WEATHER] Mock set: %.0f° %s (id=%d)\n", temp, desc, condition_id);
+    // Hold the mock for a poll interval instead of walking it along a forecast
+    observed = current_weather;
+    observed_epoch = 0;
+    forecast_count = 0;
+    expires_ms = millis() + (unsigned long)max(5, config_get().weather_poll_min) * 60UL * 1000UL;
+    LOG_I("WEATHER", "Mock set: %.0f° %s (id=%d)", temp, desc, condition_id);
+}
+
+void weather_set_reading(const WeatherReading& reading) {
+    current_weather = reading;
+    if (reading.valid) ever_received = true;
 }
@@ -0,0 +1,216 @@
+#include "weather_fx.h"
+#include "display.h"
+#include "hardware_pins.h"
+#include <Arduino.h>
+#include <math.h>
+
+// Positions in 1/256 px, velocities in 1/256 px per second
+#define FX_SHIFT        8
+#define FX_PX(n)        ((n) * (1 << FX_SHIFT))   // multiply: n may be negative
+#define FX_MAX_DT_MS    100   // a longer gap (blocking fetch) resumes as one slow frame
+#define FX_MARGIN_PX    8     // upwind spawn area and off-screen drift allowance
+#define FLASH_MS        80
+
+enum FxColor { FX_RAIN, FX_DRIZZLE, FX_SNOW, FX_COLOR_COUNT };
+
+struct Emitter {
+    uint16_t per_sec;       // spawn rate at moderate intensity
+    uint8_t vy_min;         // fall speed, px/s
+    uint8_t vy_max;
+    uint8_t jitter;         // random sideways speed, +/- px/s
+    uint8_t wind_pct;       // share of the wind drift it picks up
+    uint8_t color;
+    bool wobble;
+    bool lightning;
+};
+
+// Indexed by FxKind
+enum FxKind { FX_NONE, FX_KIND_RAIN, FX_KIND_DRIZZLE, FX_KIND_SNOW, FX_KIND_THUNDER };
+static const Emitter EMITTERS[] = {
+    {   0,  0,  0, 0,   0, FX_RAIN,    false, false },  // none
+    {  45, 15, 26, 0,  60, FX_RAIN,    false, false },  // rain
+    {  15, 10, 18, 0,  80, FX_DRIZZLE, false, false },  // drizzle
+    {  25,  5, 12, 3, 100, FX_SNOW,    true,  false },  // snow
+    {  70, 18, 30, 0,  60, FX_RAIN,    false, true  },  // thunderstorm
+};
+
+// Snow sway, px/s in 1/256 (one period per 16 steps)
+static const int16_t WOBBLE[16] = {
+    0, 294, 543, 710, 768, 710, 543, 294, 0, -294, -543, -710, -768, -710, -543, -294,
+};
+
+// Live particles are packed at [0, live): spawning appends, dying moves the
+// last one into the hole, so the free slots are always [live, MAX)
+static int16_t pos_x[WEATHER_FX_MAX_PARTICLES];
+static int16_t pos_y[WEATHER_FX_MAX_PARTICLES];
+static int16_t vel_x[WEATHER_FX_MAX_PARTICLES];
+static int16_t vel_y[WEATHER_FX_MAX_PARTICLES];
+static uint8_t phase[WEATHER_FX_MAX_PARTICLES];
+static int live = 0;
+
+static uint16_t colors[FX_COLOR_COUNT];
+static bool colors_ready = false;
+
+// Emitter settings for the current reading, recomputed when it changes
+static unsigned long cached_at_ms = 0;
+static int cached_condition = -1;
+static FxKind kind = FX_NONE;
+static uint16_t rate = 0;          // particles per second
+static int16_t wind_vx = 0;        // full drift, px/s in 1/256
+
+static unsigned long last_frame_ms = 0;
+static uint32_t spawn_acc = 0;     // particle-milliseconds owed
+static unsigned long next_flash_ms = 0;
+static unsigned long flash_end_ms = 0;
+
+// xorshift32: a few cycles, plenty random for rain
+static uint32_t rng_state = 0x9E3779B9;
+
+static uint32_t rng() {
+    uint32_t x = rng_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return rng_state = x;
+}
+
+static int rng_below(int n) {
+    return (int)(((rng() >> 16) * (uint32_t)n) >> 16);
+}
+
+static void build_colors() {
+    colors[FX_RAIN] = display_color(80, 130, 255);
+    colors[FX_DRIZZLE] = display_color(60, 100, 200);
+    colors[FX_SNOW] = display_color(200, 200, 255);
+    colors_ready = true;
+}
+
+// OpenWeatherMap condition codes: 2xx thunder, 3xx drizzle, 5xx rain, 6xx snow
+static FxKind kind_for(int condition_id) {
+    if (condition_id >= 200 && condition_id < 300) return FX_KIND_THUNDER;
+    if (condition_id >= 300 && condition_id < 400) return FX_KIND_DRIZZLE;
+    if (condition_id >= 500 && condition_id < 600) return FX_KIND_RAIN;
+    if (condition_id >= 600 && condition_id < 700) return FX_KIND_SNOW;
+    return FX_NONE;
+}
+
+// Light codes halve the rate, heavy ones double it
+static int intensity_pct(int condition_id) {
+    switch (condition_id) {
+        case 200: case 230: case 300: case 310: case 500: case 520: case 600: case 620:
+            return 50;
+        case 202: case 212: case 232: case 302: case 312: case 314: case 502: case 503:
+        case 504: case 522: case 602: case 622:
+            return 200;
+        default:
+            return 100;
+    }
+}
+
+static void update_emitter(const WeatherReading& wx) {
+    if (wx.received_at_ms == cached_at_ms && wx.condition_id == cached_condition) return;
+    cached_at_ms = wx.received_at_ms;
+    cached_condition = wx.condition_id;
+
+    kind = kind_for(wx.condition_id);
+    rate = EMITTERS[kind].per_sec * intensity_pct(wx.condition_id) / 100;
+
+    // The wind direction is where it blows from; 1.2 px/s per m/s sideways
+    float drift = -wx.wind_ms * 1.2f * sinf(wx.wind_deg * (float)M_PI / 180.0f);
+    if (drift > 20.0f) drift = 20.0f;
+    if (drift < -20.0f) drift = -20.0f;
+    wind_vx = (int16_t)(drift * 256.0f);
+}
+
+static void spawn(const Emitter& e, int y_px) {
+    if (live >= WEATHER_FX_MAX_PARTICLES) return;
+    int i = live++;
+    int x = rng_below(MATRIX_WIDTH + FX_MARGIN_PX);
+    if (wind_vx > 0) x -= FX_MARGIN_PX;     // enter from the upwind side
+    pos_x[i] = FX_PX(x);
+    pos_y[i] = FX_PX(y_px);
+    int vy = e.vy_min + rng_below(e.vy_max - e.vy_min + 1);
+    int vx = e.jitter ? rng_below(2 * e.jitter + 1) - e.jitter : 0;
+    vel_y[i] = FX_PX(vy);
+    vel_x[i] = FX_PX(vx) + wind_vx * e.wind_pct / 100;
+    phase[i] = rng() & 0x0F;
+}
+
+static void kill(int i) {
+    int last = --live;
+    pos_x[i] = pos_x[last];
+    pos_y[i] = pos_y[last];
+    vel_x[i] = vel_x[last];
+    vel_y[i] = vel_y[last];
+    phase[i] = phase[last];
+}
+
+bool weather_fx_frame(const WeatherReading& wx, unsigned long now_ms) {
+    if (!colors_ready) build_colors();
+    update_emitter(wx);
+    const Emitter& e = EMITTERS[kind];
+
+    unsigned long dt = now_ms - last_frame_ms;
+    if (last_frame_ms == 0 || dt > FX_MAX_DT_MS) dt = WEATHER_FX_FRAME_MS;
+    last_frame_ms = now_ms;
+    int32_t dt_q16 = (int32_t)(dt * 65536UL / 1000UL);   // seconds in 1/65536
+
+    // Emit
+    spawn_acc += rate * dt;
+    while (spawn_acc >= 1000) {
+        spawn_acc -= 1000;
+        spawn(e, 0);
+    }
+    if (live >= WEATHER_FX_MAX_PARTICLES) spawn_acc = 0;
+
+    // Move and draw
+    uint16_t color = colors[e.color];
+    const int16_t x_min = FX_PX(-FX_MARGIN_PX);
+    const int16_t x_max = FX_PX(MATRIX_WIDTH + FX_MARGIN_PX);
+    const int16_t y_max = FX_PX(MATRIX_HEIGHT);
+    for (int i = 0; i < live; ) {
+        int32_t vx = vel_x[i];
+        if (e.wobble) {
+            vx += WOBBLE[phase[i] & 0x0F];
+            phase[i]++;
+        }
+        pos_x[i] += (int16_t)((vx * dt_q16) >> 16);
+        pos_y[i] += (int16_t)(((int32_t)vel_y[i] * dt_q16) >> 16);
+        if (pos_y[i] >= y_max || pos_x[i] < x_min || pos_x[i] >= x_max) {
+            kill(i);
+            continue;   // slot i now holds the former last particle
+        }
+        display_draw_pixel(pos_x[i] >> FX_SHIFT, pos_y[i] >> FX_SHIFT, color);
+        i++;
+    }
+
+    // Lightning
+    if (!e.lightning) return false;
+    if (flash_end_ms == 0 && (long)(now_ms - next_flash_ms) >= 0) {
+        flash_end_ms = now_ms + FLASH_MS;
+        next_flash_ms = now_ms + 3000 + rng_below(2001);
+    }
+    if (flash_end_ms != 0) {
+        if ((long)(now_ms - flash_end_ms) < 0) return true;
+        flash_end_ms = 0;
+    }
+    return false;
+}
+
+void weather_fx_clear() {
+    live = 0;
+    spawn_acc = 0;
+    last_frame_ms = 0;
+}
+
+void weather_fx_fill(const WeatherReading& wx) {
+    update_emitter(wx);
+    if (kind == FX_NONE) return;
+    while (live < WEATHER_FX_MAX_PARTICLES) {
+        spawn(EMITTERS[kind], rng_below(MATRIX_HEIGHT));
+    }
+}
+
+int weather_fx_count() {
+    return live;
+}
@@ -2,25 +2,52 @@
 #include "config_manager.h"
 #include "wifi_manager.h"
 #include "http_client.h"
+#include "net_scheduler.h"
+#include "dns_cache.h"
+#include "net_client.h"
+#include "tls_client.h"
 #include "glucose_engine.h"
+#include "engine_events.h"
 #include "time_engine.h"
 #include "sensors.h"
 #include "display.h"
-#include "weather_client.h"
-#include "timer_engine.h"
 #include "notify_engine.h"
-#include "sysmon_engine.h"
-#include "countdown_engine.h"
+#include "lan_share.h"
+#include "mqtt_bridge.h"
 #include "buzzer.h"
 #include "buttons.h"
 #include "hardware_pins.h"
+#include "perf_stats.h"
+#include "metrics.h"
+#include "render_bench.h"
+#include "ota_update.h"
+#include "logger.h"
+#include "scratch.h"
+#include "rate_limit.h"
+#include "www_bundle.h"
+#include "health_monitor.h"
+#include "feature_modules.h"
+#if FEATURE_WEATHER
+#include "weather_client.h"
+#endif
+#if FEATURE_TIMER
+#include "timer_engine.h"
+#endif
+#if FEATURE_SYSMON
+#include "sysmon_engine.h"
+#endif
+#if FEATURE_COUNTDOWN
+#include "countdown_engine.h"
+#endif
 
 #include <ESPAsyncWebServer.h>
 #include <LittleFS.h>
 #include <ArduinoJson.h>
 #include <Arduino.h>
+#include <memory>
 
 static AsyncWebServer server(80);
+static AsyncEventSource log_events("/api/logs/stream");
 static bool started = false;
 
 // Helper: convert uint32_t RGB to "#RRGGBB" hex string
@@ -36,14 +63,52 @@ static uint32_t hex_to_color(const char* hex) {
     return strtoul(hex + 1, NULL, 16);
 }
 
+// Charge the request to its client's bucket and an in-flight slot; when it
+// is turned away, answer 429/503 with Retry-After and return false
+static bool admit(AsyncWebServerRequest* request, RateClass cls) {
+    int slot;
+    uint32_t retry_after;
+    Admission a = rate_limit_admit((uint32_t)request->client()->remoteIP(), cls, &slot, &retry_after);
+    if (a == ADMIT_OK) {
+        request->onDisconnect([slot]() { rate_limit_release(slot); });
+        return true;
+    }
+    bool busy = a == ADMIT_BUSY;
+    AsyncWebServerResponse* resp = request->beginResponse(busy ? 503 : 429, "application/json",
+        busy ? "{\"error\":\"Busy\"}" : "{\"error\":\"Rate limited\"}");
+    char secs[12];
+    snprintf(secs, sizeof(secs), "%lu", (unsigned long)retry_after);
+    resp->addHeader("Retry-After", secs);
+    request->send(resp);
+    return false;
+}
+
+// Route handlers behind admit()
+static ArRequestHandlerFunction gated(RateClass cls, ArRequestHandlerFunction fn) {
+    return [cls, fn](AsyncWebServerRequest* r) {
+        if (admit(r, cls)) fn(r);
+    };
+}
+
+// Body handlers are admitted on their first chunk; the handlers already
+// ignore later chunks of a request they never started
+static ArBodyHandlerFunction gated_body(RateClass cls, ArBodyHandlerFunction fn) {
+    return [cls, fn](AsyncWebServerRequest* r, uint8_t* data, size_t len, size_t index, size_t total) {
+        if (index == 0 && !admit(r, cls)) return;
+        fn(r, data, len, index, total);
+    };
+}
+
 // GET /api/status
 static void handle_status(AsyncWebServerRequest* request) {
-    JsonDocument doc;
+    ScratchScope scope;
+    JsonDocument doc(scope.json());
 
     const GlucoseReading& r = http_get_reading();
     doc["glucose"] = r.valid ? r.glucose : 0;
     doc["trend"] = r.valid ? TREND_NAMES[r.trend] : "Unknown";
     doc["valid"] = r.valid;
+    doc["cached"] = r.from_cache;
     doc["data_age_sec"] = r.valid ? (millis() - r.received_at_ms) / 1000 : -1;
     doc["state"] = engine_state_name(engine_get_state());
     doc["wifi_connected"] = wifi_is_connected();
@@ -78,14 +143,20 @@ static void handle_status(AsyncWebServerRequest* request) {
     thresholds["high"] = cfg.thresh_high;
     thresholds["urgent_high"] = cfg.thresh_urgent_high;
 
+#if FEATURE_WEATHER
     // Weather
     if (weather_has_data()) {
         const WeatherReading& wx = weather_get_reading();
         doc["weather_temp"] = wx.temp;
         doc["weather_desc"] = wx.description;
         doc["weather_humidity"] = wx.humidity;
+        doc["weather_wind_ms"] = wx.wind_ms;
     }
+    doc["weather_forecast_slots"] = weather_forecast_count();
+    doc["weather_api_calls"] = weather_api_call_count();
+#endif
 
+#if FEATURE_TIMER
     // Timer status
     doc["timer_state"] = (int)timer_get_state();
     doc["timer_remaining"] = timer_get_remaining_sec();
@@ -94,388 +165,546 @@ static void handle_status(AsyncWebServerRequest* request) {
     // Stopwatch status
     doc["stopwatch_state"] = (int)stopwatch_get_state();
     doc["stopwatch_elapsed"] = stopwatch_get_elapsed_sec();
+#endif
 
+#if FEATURE_SYSMON
     // Sysmon
     if (sysmon_has_data()) {
         doc["sysmon_label"] = sysmon_get_label();
         doc["sysmon_value"] = sysmon_get_value();
         doc["sysmon_max"] = sysmon_get_max();
     }
+#endif
 
+#if FEATURE_COUNTDOWN
     // Countdown
     if (cfg.countdown_enabled && countdown_is_configured()) {
         doc["countdown_remaining"] = countdown_get_remaining_sec();
         doc["countdown_name"] = cfg.countdown_name;
     }
+#endif
 
     String output;
     serializeJson(doc, output);
     request->send(200, "application/json", output);
 }
 
-// GET /api/config
-static void handle_get_config(AsyncWebServerRequest* request) {
+// Fields of the given sections, flat as in the full /api/config document
+static void config_to_json(JsonDocument& doc, uint32_t sections) {
     AppConfig& cfg = config_get();
-    JsonDocument doc;
-
-    doc["wifi_ssid"] = cfg.wifi_ssid;
-    doc["wifi_password"] = cfg.wifi_password;
-    doc["data_source"] = cfg.data_source;
-    doc["server_url"] = cfg.server_url;
-    doc["auth_token"] = cfg.auth_token;
-    doc["dexcom_username"] = cfg.dexcom_username;
-    doc["dexcom_password"] = cfg.dexcom_password;
-    doc["dexcom_us"] = cfg.dexcom_us;
-    doc["poll_interval"] = cfg.poll_interval_sec;
-    doc["brightness"] = cfg.brightness;
-    doc["auto_brightness"] = cfg.auto_brightness;
-    doc["show_delta"] = cfg.show_delta;
-    doc["use_mmol"] = cfg.use_mmol;
-    doc["thresh_urgent_low"] = cfg.thresh_urgent_low;
-    doc["thresh_low"] = cfg.thresh_low;
-    doc["thresh_high"] = cfg.thresh_high;
-    doc["thresh_urgent_high"] = cfg.thresh_urgent_high;
-    doc["timezone"] = cfg.timezone;
-    doc["use_24h"] = cfg.use_24h;
-    doc["default_mode"] = cfg.default_mode;
-
-    // Alerts
-    doc["alert_enabled"] = cfg.alert_enabled;
-    doc["alert_low"] = cfg.alert_low;
-    doc["alert_high"] = cfg.alert_high;
-    doc["alert_snooze_min"] = cfg.alert_snooze_min;
-
-    // Theme colors
-    doc["color_urgent_low"] = color_to_hex(cfg.color_urgent_low);
-    doc["color_low"] = color_to_hex(cfg.color_low);
-    doc["color_in_range"] = color_to_hex(cfg.color_in_range);
-    doc["color_high"] = color_to_hex(cfg.color_high);
-    doc["color_urgent_high"] = color_to_hex(cfg.color_urgent_high);
-
-    // Clock & weather colors
-    doc["color_clock"] = color_to_hex(cfg.color_clock);
-    doc["color_weather"] = color_to_hex(cfg.color_weather);
-
-    // Night mode
-    doc["night_mode_enabled"] = cfg.night_mode_enabled;
-    doc["night_start_hour"] = cfg.night_start_hour;
-    doc["night_end_hour"] = cfg.night_end_hour;
-    doc["night_brightness"] = cfg.night_brightness;
-
-    // Stale timeout
-    doc["stale_timeout_min"] = cfg.stale_timeout_min;
 
-    // Weather
-    doc["weather_enabled"] = cfg.weather_enabled;
-    doc["weather_api_key"] = cfg.weather_api_key;
-    doc["weather_city"] = cfg.weather_city;
-    doc["weather_use_f"] = cfg.weather_use_f;
-    doc["weather_poll_min"] = cfg.weather_poll_min;
-
-    // Date
-    doc["date_on_time_screen"] = cfg.date_on_time_screen;
-    doc["date_format"] = cfg.date_format;
-
-    // Timer
-    doc["timer_enabled"] = cfg.timer_enabled;
-    doc["timer_work_min"] = cfg.timer_work_min;
-    doc["timer_break_min"] = cfg.timer_break_min;
-    doc["timer_long_break_min"] = cfg.timer_long_break_min;
-    doc["timer_sessions"] = cfg.timer_sessions;
-    doc["timer_buzzer"] = cfg.timer_buzzer;
-
-    // Stopwatch
-    doc["stopwatch_enabled"] = cfg.stopwatch_enabled;
-
-    // Notifications
-    doc["notify_enabled"] = cfg.notify_enabled;
-    doc["notify_default_duration"] = cfg.notify_default_duration;
-    doc["notify_allow_buzzer"] = cfg.notify_allow_buzzer;
+    if (sections & CFG_BIT(CFG_WIFI)) {
+        doc["wifi_ssid"] = cfg.wifi_ssid;
+        doc["wifi_password"] = cfg.wifi_password;
+    }
+    if (sections & CFG_BIT(CFG_SOURCE)) {
+        doc["data_source"] = cfg.data_source;
+        doc["server_url"] = cfg.server_url;
+        doc["auth_token"] = cfg.auth_token;
+        doc["dexcom_username"] = cfg.dexcom_username;
+        doc["dexcom_password"] = cfg.dexcom_password;
+        doc["dexcom_us"] = cfg.dexcom_us;
+        doc["dexcom_base_url"] = cfg.dexcom_base_url;
+        doc["poll_interval"] = cfg.poll_interval_sec;
+        doc["http_gzip"] = cfg.http_gzip;
+    }
+    if (sections & CFG_BIT(CFG_DISPLAY)) {
+        doc["brightness"] = cfg.brightness;
+        doc["auto_brightness"] = cfg.auto_brightness;
+        doc["show_delta"] = cfg.show_delta;
+        doc["use_mmol"] = cfg.use_mmol;
+        doc["default_mode"] = cfg.default_mode;
+        doc["night_mode_enabled"] = cfg.night_mode_enabled;
+        doc["night_start_hour"] = cfg.night_start_hour;
+        doc["night_end_hour"] = cfg.night_end_hour;
+        doc["night_brightness"] = cfg.night_brightness;
+        doc["stale_timeout_min"] = cfg.stale_timeout_min;
+        doc["auto_cycle_enabled"] = cfg.auto_cycle_enabled;
+        doc["auto_cycle_sec"] = cfg.auto_cycle_sec;
+    }
+    if (sections & CFG_BIT(CFG_TIME)) {
+        doc["timezone"] = cfg.timezone;
+        doc["use_24h"] = cfg.use_24h;
+        doc["date_on_time_screen"] = cfg.date_on_time_screen;
+        doc["date_format"] = cfg.date_format;
+    }
+    if (sections & CFG_BIT(CFG_THEME)) {
+        doc["thresh_urgent_low"] = cfg.thresh_urgent_low;
+        doc["thresh_low"] = cfg.thresh_low;
+        doc["thresh_high"] = cfg.thresh_high;
+        doc["thresh_urgent_high"] = cfg.thresh_urgent_high;
+        doc["color_urgent_low"] = color_to_hex(cfg.color_urgent_low);
+        doc["color_low"] = color_to_hex(cfg.color_low);
+        doc["color_in_range"] = color_to_hex(cfg.color_in_range);
+        doc["color_high"] = color_to_hex(cfg.color_high);
+        doc["color_urgent_high"] = color_to_hex(cfg.color_urgent_high);
+        doc["color_gradient"] = cfg.color_gradient;
+        doc["color_clock"] = color_to_hex(cfg.color_clock);
+        doc["color_weather"] = color_to_hex(cfg.color_weather);
+    }
+    if (sections & CFG_BIT(CFG_ALERTS)) {
+        doc["alert_enabled"] = cfg.alert_enabled;
+        doc["alert_low"] = cfg.alert_low;
+        doc["alert_high"] = cfg.alert_high;
+        doc["alert_snooze_min"] = cfg.alert_snooze_min;
+    }
+    if (sections & CFG_BIT(CFG_WEATHER)) {
+        doc["weather_enabled"] = cfg.weather_enabled;
+        doc["weather_api_key"] = cfg.weather_api_key;
+        doc["weather_city"] = cfg.weather_city;
+        doc["weather_use_f"] = cfg.weather_use_f;
+        doc["weather_poll_min"] = cfg.weather_poll_min;
+        doc["weather_base_url"] = cfg.weather_base_url;
+    }
+    if (sections & CFG_BIT(CFG_TIMER)) {
+        doc["timer_enabled"] = cfg.timer_enabled;
+        doc["timer_work_min"] = cfg.timer_work_min;
+        doc["timer_break_min"] = cfg.timer_break_min;
+        doc["timer_long_break_min"] = cfg.timer_long_break_min;
+        doc["timer_sessions"] = cfg.timer_sessions;
+        doc["timer_buzzer"] = cfg.timer_buzzer;
+        doc["stopwatch_enabled"] = cfg.stopwatch_enabled;
+        doc["countdown_enabled"] = cfg.countdown_enabled;
+        doc["countdown_name"] = cfg.countdown_name;
+        doc["countdown_target"] = cfg.countdown_target;
+    }
+    if (sections & CFG_BIT(CFG_NOTIFY)) {
+        doc["notify_enabled"] = cfg.notify_enabled;
+        doc["notify_default_duration"] = cfg.notify_default_duration;
+        doc["notify_allow_buzzer"] = cfg.notify_allow_buzzer;
+    }
+    if (sections & CFG_BIT(CFG_SYSMON)) {
+        doc["sysmon_enabled"] = cfg.sysmon_enabled;
+        doc["sysmon_label"] = cfg.sysmon_label;
+        doc["sysmon_display_mode"] = cfg.sysmon_display_mode;
+        doc["sysmon_warn_pct"] = cfg.sysmon_warn_pct;
+        doc["sysmon_crit_pct"] = cfg.sysmon_crit_pct;
+    }
+    if (sections & CFG_BIT(CFG_LAN)) {
+        doc["lan_share_mode"] = cfg.lan_share_mode;
+        doc["lan_share_key"] = cfg.lan_share_key;
+    }
+    if (sections & CFG_BIT(CFG_MQTT)) {
+        doc["mqtt_enabled"] = cfg.mqtt_enabled;
+        doc["mqtt_uri"] = cfg.mqtt_uri;
+        doc["mqtt_username"] = cfg.mqtt_username;
+        doc["mqtt_password"] = cfg.mqtt_password;
+        doc["mqtt_topic"] = cfg.mqtt_topic;
+    }
+    if (sections & CFG_BIT(CFG_SYSTEM)) {
+        doc["log_level"] = cfg.log_level;
+    }
+}
 
-    // Sysmon
-    doc["sysmon_enabled"] = cfg.sysmon_enabled;
-    doc["sysmon_label"] = cfg.sysmon_label;
-    doc["sysmon_display_mode"] = cfg.sysmon_display_mode;
-    doc["sysmon_warn_pct"] = cfg.sysmon_warn_pct;
-    doc["sysmon_crit_pct"] = cfg.sysmon_crit_pct;
+// Sections addressed by /api/config or /api/config/<section>; false if the
+// section is unknown (404 sent)
+static bool config_sections(AsyncWebServerRequest* request, uint32_t* sections) {
+    const String& url = request->url();
+    const size_t prefix = sizeof("/api/config/") - 1;
+    if (url.length() <= prefix) {
+        *sections = CFG_ALL;
+        return true;
+    }
+    ConfigSection s;
+    if (!config_section_find(url.c_str() + prefix, &s)) {
+        request->send(404, "application/json", "{\"error\":\"Unknown config section\"}");
+        return false;
+    }
+    *sections = CFG_BIT(s);
+    return true;
+}
 
-    // Countdown
-    doc["countdown_enabled"] = cfg.countdown_enabled;
-    doc["countdown_name"] = cfg.countdown_name;
-    doc["countdown_target"] = cfg.countdown_target;
+// GET /api/config, GET /api/config/<section>. Answers 304 when If-None-Match
+// still holds the section's ETag; browsers revalidate on their own
+// (no-cache), so a page reload costs a 304 instead of the whole document.
+static void handle_get_config(AsyncWebServerRequest* request) {
+    uint32_t sections;
+    if (!config_sections(request, &sections)) return;
+
+    char etag[40];
+    config_etag(sections, etag, sizeof(etag));
+    if (request->hasHeader("If-None-Match") && request->header("If-None-Match") == etag) {
+        AsyncWebServerResponse* resp = request->beginResponse(304);
+        resp->addHeader("ETag", etag);
+        resp->addHeader("Cache-Control", "no-cache");
+        request->send(resp);
+        return;
+    }
 
-    // Auto-cycle
-    doc["auto_cycle_enabled"] = cfg.auto_cycle_enabled;
-    doc["auto_cycle_sec"] = cfg.auto_cycle_sec;
+    ScratchScope scope;
+    JsonDocument doc(scope.json());
+    config_to_json(doc, sections);
 
     String output;
     serializeJson(doc, output);
-    request->send(200, "application/json", output);
+    AsyncWebServerResponse* resp = request->beginResponse(200, "application/json", output);
+    resp->addHeader("ETag", etag);
+    resp->addHeader("Cache-Control", "no-cache");
+    request->send(resp);
 }
 
-// POST /api/config (JSON body) — accumulate chunks before parsing
-static char config_body[4096];
+// Request body fields, looked up section by section: fields outside the
+// sections the request addresses read as absent, and the sections that
+// had a field sent are noted in touched
+struct ConfigPatch {
+    JsonDocument& doc;
+    uint32_t allowed;
+    ConfigSection section = CFG_WIFI;
+    uint32_t touched = 0;
+
+    ConfigPatch(JsonDocument& d, uint32_t sections) : doc(d), allowed(sections) {}
+
+    JsonVariantConst operator[](const char* key) {
+        if (!(allowed & CFG_BIT(section))) return JsonVariantConst();
+        JsonVariantConst v = doc[key];
+        if (!v.isNull()) touched |= CFG_BIT(section);
+        return v;
+    }
+};
+
+// POST/PATCH /api/config and /api/config/<section> (JSON body): only the
+// fields sent are applied, only keys whose value changed are written to
+// NVS, and side effects run for the sections that changed. If-Match with a
+// stale ETag gets 412. Chunks are accumulated before parsing; the buffer
+// belongs to the request (freed with it, even if the client drops)
+#define CONFIG_BODY_MAX 4096
 
 static void handle_post_config(AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
-    if (total > sizeof(config_body) - 1) {
-        request->send(413, "application/json", "{\"error\":\"Body too large\"}");
+    if (total > CONFIG_BODY_MAX) {
+        if (index == 0) request->send(413, "application/json", "{\"error\":\"Body too large\"}");
         return;
     }
-    memcpy(config_body + index, data, len);
+    if (index == 0) request->_tempObject = malloc(total);
+    char* body = (char*)request->_tempObject;
+    if (!body) {
+        if (index == 0) request->send(503, "application/json", "{\"error\":\"Out of memory\"}");
+        return;
+    }
+    memcpy(body + index, data, len);
     if (index + len < total) return; // wait for all chunks
-    config_body[total] = '\0';
 
-    JsonDocument doc;
-    DeserializationError err = deserializeJson(doc, config_body, total);
+    ScratchScope scope;
+    JsonDocument doc(scope.json());
+    DeserializationError err = deserializeJson(doc, body, total);
     if (err) {
         request->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
         return;
     }
 
+    uint32_t sections;
+    if (!config_sections(request, &sections)) return;
+    char etag[40];
+    config_etag(sections, etag, sizeof(etag));
+    if (request->hasHeader("If-Match") && request->header("If-Match") != etag) {
+        request->send(412, "application/json", "{\"error\":\"Config changed since it was read\"}");
+        return;
+    }
+
     AppConfig& cfg = config_get();
+    ConfigPatch in(doc, sections);
+
+    in.section = CFG_WIFI;
+    if (in["wifi_ssid"].is<const char*>()) {
+        strncpy(cfg.wifi_ssid, in["wifi_ssid"] | "", sizeof(cfg.wifi_ssid) - 1);
+    }
+    if (in["wifi_password"].is<const char*>()) {
+        strncpy(cfg.wifi_password, in["wifi_password"] | "", sizeof(cfg.wifi_password) - 1);
+    }
 
-    if (doc["wifi_ssid"].is<const char*>()) {
-        strncpy(cfg.wifi_ssid, doc["wifi_ssid"] | "", sizeof(cfg.wifi_ssid) - 1);
+    in.section = CFG_SOURCE;
+    if (in["data_source"].is<int>()) {
+        cfg.data_source = in["data_source"].as<int>();
     }
-    if (doc["wifi_password"].is<const char*>()) {
-        strncpy(cfg.wifi_password, doc["wifi_password"] | "", sizeof(cfg.wifi_password) - 1);
+    if (in["server_url"].is<const char*>()) {
+        strncpy(cfg.server_url, in["server_url"] | "", sizeof(cfg.server_url) - 1);
     }
-    if (doc["data_source"].is<int>()) {
-        cfg.data_source = doc["data_source"].as<int>();
+    if (in["auth_token"].is<const char*>()) {
+        strncpy(cfg.auth_token, in["auth_token"] | "", sizeof(cfg.auth_token) - 1);
     }
-    if (doc["server_url"].is<const char*>()) {
-        strncpy(cfg.server_url, doc["server_url"] | "", sizeof(cfg.server_url) - 1);
+    if (in["dexcom_username"].is<const char*>()) {
+        strncpy(cfg.dexcom_username, in["dexcom_username"] | "", sizeof(cfg.dexcom_username) - 1);
     }
-    if (doc["auth_token"].is<const char*>()) {
-        strncpy(cfg.auth_token, doc["auth_token"] | "", sizeof(cfg.auth_token) - 1);
+    if (in["dexcom_password"].is<const char*>()) {
+        strncpy(cfg.dexcom_password, in["dexcom_password"] | "", sizeof(cfg.dexcom_password) - 1);
     }
-    if (doc["dexcom_username"].is<const char*>()) {
-        strncpy(cfg.dexcom_username, doc["dexcom_username"] | "", sizeof(cfg.dexcom_username) - 1);
+    if (in["dexcom_us"].is<bool>()) {
+        cfg.dexcom_us = in["dexcom_us"].as<bool>();
     }
-    if (doc["dexcom_password"].is<const char*>()) {
-        strncpy(cfg.dexcom_password, doc["dexcom_password"] | "", sizeof(cfg.dexcom_password) - 1);
+    if (in["dexcom_base_url"].is<const char*>()) {
+        strncpy(cfg.dexcom_base_url, in["dexcom_base_url"] | "", sizeof(cfg.dexcom_base_url) - 1);
+        cfg.dexcom_base_url[sizeof(cfg.dexcom_base_url) - 1] = '\0';
     }
-    if (doc["dexcom_us"].is<bool>()) {
-        cfg.dexcom_us = doc["dexcom_us"].as<bool>();
+    if (in["poll_interval"].is<int>()) {
+        cfg.poll_interval_sec = max(15, in["poll_interval"].as<int>());
     }
-    if (doc["poll_interval"].is<int>()) {
-        cfg.poll_interval_sec = max(15, doc["poll_interval"].as<int>());
+    if (in["http_gzip"].is<bool>()) {
+        cfg.http_gzip = in["http_gzip"].as<bool>();
     }
-    if (doc["brightness"].is<int>()) {
-        cfg.brightness = constrain(doc["brightness"].as<int>(), 1, 255);
+
+    in.section = CFG_DISPLAY;
+    if (in["brightness"].is<int>()) {
+        cfg.brightness = constrain(in["brightness"].as<int>(), 1, 255);
+    }
+    if (in["auto_brightness"].is<bool>()) {
+        cfg.auto_brightness = in["auto_brightness"].as<bool>();
     }
-    if (doc["auto_brightness"].is<bool>()) {
-        cfg.auto_brightness = doc["auto_brightness"].as<bool>();
+    if (in["show_delta"].is<bool>()) {
+        cfg.show_delta = in["show_delta"].as<bool>();
     }
-    if (doc["show_delta"].is<bool>()) {
-        cfg.show_delta = doc["show_delta"].as<bool>();
+    if (in["use_mmol"].is<bool>()) {
+        cfg.use_mmol = in["use_mmol"].as<bool>();
     }
-    if (doc["use_mmol"].is<bool>()) {
-        cfg.use_mmol = doc["use_mmol"].as<bool>();
+    if (in["default_mode"].is<int>()) {
+        cfg.default_mode = in["default_mode"].as<int>();
     }
-    if (doc["thresh_urgent_low"].is<int>()) {
-        cfg.thresh_urgent_low = doc["thresh_urgent_low"].as<int>();
+    if (in["night_mode_enabled"].is<bool>()) {
+        cfg.night_mode_enabled = in["night_mode_enabled"].as<bool>();
     }
-    if (doc["thresh_low"].is<int>()) {
-        cfg.thresh_low = doc["thresh_low"].as<int>();
+    if (in["night_start_hour"].is<int>()) {
+        cfg.night_start_hour = constrain(in["night_start_hour"].as<int>(), 0, 23);
     }
-    if (doc["thresh_high"].is<int>()) {
-        cfg.thresh_high = doc["thresh_high"].as<int>();
+    if (in["night_end_hour"].is<int>()) {
+        cfg.night_end_hour = constrain(in["night_end_hour"].as<int>(), 0, 23);
     }
-    if (doc["thresh_urgent_high"].is<int>()) {
-        cfg.thresh_urgent_high = doc["thresh_urgent_high"].as<int>();
+    if (in["night_brightness"].is<int>()) {
+        cfg.night_brightness = constrain(in["night_brightness"].as<int>(), 1, 255);
     }
-    if (doc["timezone"].is<const char*>()) {
-        strncpy(cfg.timezone, doc["timezone"] | "", sizeof(cfg.timezone) - 1);
+    if (in["stale_timeout_min"].is<int>()) {
+        cfg.stale_timeout_min = constrain(in["stale_timeout_min"].as<int>(), 5, 60);
     }
-    if (doc["use_24h"].is<bool>()) {
-        cfg.use_24h = doc["use_24h"].as<bool>();
+    if (in["auto_cycle_enabled"].is<bool>()) {
+        cfg.auto_cycle_enabled = in["auto_cycle_enabled"].as<bool>();
     }
-    if (doc["default_mode"].is<int>()) {
-        cfg.default_mode = doc["default_mode"].as<int>();
+    if (in["auto_cycle_sec"].is<int>()) {
+        cfg.auto_cycle_sec = constrain(in["auto_cycle_sec"].as<int>(), 3, 300);
     }
 
-    // Alerts
-    if (doc["alert_enabled"].is<bool>()) {
-        cfg.alert_enabled = doc["alert_enabled"].as<bool>();
+    in.section = CFG_TIME;
+    if (in["timezone"].is<const char*>()) {
+        strncpy(cfg.timezone, in["timezone"] | "", sizeof(cfg.timezone) - 1);
     }
-    if (doc["alert_low"].is<int>()) {
-        cfg.alert_low = doc["alert_low"].as<int>();
+    if (in["use_24h"].is<bool>()) {
+        cfg.use_24h = in["use_24h"].as<bool>();
     }
-    if (doc["alert_high"].is<int>()) {
-        cfg.alert_high = doc["alert_high"].as<int>();
+    if (in["date_on_time_screen"].is<bool>()) {
+        cfg.date_on_time_screen = in["date_on_time_screen"].as<bool>();
     }
-    if (doc["alert_snooze_min"].is<int>()) {
-        cfg.alert_snooze_min = constrain(doc["alert_snooze_min"].as<int>(), 1, 120);
+    if (in["date_format"].is<int>()) {
+        cfg.date_format = constrain(in["date_format"].as<int>(), 0, 2);
     }
 
-    // Theme colors
-    if (doc["color_urgent_low"].is<const char*>()) {
-        cfg.color_urgent_low = hex_to_color(doc["color_urgent_low"] | "#ea4335");
+    in.section = CFG_THEME;
+    if (in["thresh_urgent_low"].is<int>()) {
+        cfg.thresh_urgent_low = in["thresh_urgent_low"].as<int>();
     }
-    if (doc["color_low"].is<const char*>()) {
-        cfg.color_low = hex_to_color(doc["color_low"] | "#fbbc04");
+    if (in["thresh_low"].is<int>()) {
+        cfg.thresh_low = in["thresh_low"].as<int>();
     }
-    if (doc["color_in_range"].is<const char*>()) {
-        cfg.color_in_range = hex_to_color(doc["color_in_range"] | "#34a853");
+    if (in["thresh_high"].is<int>()) {
+        cfg.thresh_high = in["thresh_high"].as<int>();
     }
-    if (doc["color_high"].is<const char*>()) {
-        cfg.color_high = hex_to_color(doc["color_high"] | "#fbbc04");
+    if (in["thresh_urgent_high"].is<int>()) {
+        cfg.thresh_urgent_high = in["thresh_urgent_high"].as<int>();
     }
-    if (doc["color_urgent_high"].is<const char*>()) {
-        cfg.color_urgent_high = hex_to_color(doc["color_urgent_high"] | "#ea4335");
+    if (in["color_urgent_low"].is<const char*>()) {
+        cfg.color_urgent_low = hex_to_color(in["color_urgent_low"] | "#ea4335");
     }
-
-    // Clock & weather colors
-    if (doc["color_clock"].is<const char*>()) {
-        cfg.color_clock = hex_to_color(doc["color_clock"] | "#ffffff");
+    if (in["color_low"].is<const char*>()) {
+        cfg.color_low = hex_to_color(in["color_low"] | "#fbbc04");
     }
-    if (doc["color_weather"].is<const char*>()) {
-        cfg.color_weather = hex_to_color(doc["color_weather"] | "#ffffff");
+    if (in["color_in_range"].is<const char*>()) {
+        cfg.color_in_range = hex_to_color(in["color_in_range"] | "#34a853");
     }
-
-    // Night mode
-    if (doc["night_mode_enabled"].is<bool>()) {
-        cfg.night_mode_enabled = doc["night_mode_enabled"].as<bool>();
+    if (in["color_high"].is<const char*>()) {
+        cfg.color_high = hex_to_color(in["color_high"] | "#fbbc04");
+    }
+    if (in["color_urgent_high"].is<const char*>()) {
+        cfg.color_urgent_high = hex_to_color(in["color_urgent_high"] | "#ea4335");
     }
-    if (doc["night_start_hour"].is<int>()) {
-        cfg.night_start_hour = constrain(doc["night_start_hour"].as<int>(), 0, 23);
+    if (in["color_gradient"].is<bool>()) {
+        cfg.color_gradient = in["color_gradient"].as<bool>();
     }
-    if (doc["night_end_hour"].is<int>()) {
-        cfg.night_end_hour = constrain(doc["night_end_hour"].as<int>(), 0, 23);
+    if (in["color_clock"].is<const char*>()) {
+        cfg.color_clock = hex_to_color(in["color_clock"] | "#ffffff");
     }
-    if (doc["night_brightness"].is<int>()) {
-        cfg.night_brightness = constrain(doc["night_brightness"].as<int>(), 1, 255);
+    if (in["color_weather"].is<const char*>()) {
+        cfg.color_weather = hex_to_color(in["color_weather"] | "#ffffff");
     }
 
-    // Stale timeout
-    if (doc["stale_timeout_min"].is<int>()) {
-        cfg.stale_timeout_min = constrain(doc["stale_timeout_min"].as<int>(), 5, 60);
+    in.section = CFG_ALERTS;
+    if (in["alert_enabled"].is<bool>()) {
+        cfg.alert_enabled = in["alert_enabled"].as<bool>();
+    }
+    if (in["alert_low"].is<int>()) {
+        cfg.alert_low = in["alert_low"].as<int>();
+    }
+    if (in["alert_high"].is<int>()) {
+        cfg.alert_high = in["alert_high"].as<int>();
+    }
+    if (in["alert_snooze_min"].is<int>()) {
+        cfg.alert_snooze_min = constrain(in["alert_snooze_min"].as<int>(), 1, 120);
     }
 
-    // Weather
-    if (doc["weather_enabled"].is<bool>()) {
-        cfg.weather_enabled = doc["weather_enabled"].as<bool>();
+    in.section = CFG_WEATHER;
+    if (in["weather_enabled"].is<bool>()) {
+        cfg.weather_enabled = in["weather_enabled"].as<bool>();
     }
-    if (doc["weather_api_key"].is<const char*>()) {
-        strncpy(cfg.weather_api_key, doc["weather_api_key"] | "", sizeof(cfg.weather_api_key) - 1);
+    if (in["weather_api_key"].is<const char*>()) {
+        strncpy(cfg.weather_api_key, in["weather_api_key"] | "", sizeof(cfg.weather_api_key) - 1);
         cfg.weather_api_key[sizeof(cfg.weather_api_key) - 1] = '\0';
     }
-    if (doc["weather_city"].is<const char*>()) {
-        strncpy(cfg.weather_city, doc["weather_city"] | "", sizeof(cfg.weather_city) - 1);
+    if (in["weather_city"].is<const char*>()) {
+        strncpy(cfg.weather_city, in["weather_city"] | "", sizeof(cfg.weather_city) - 1);
         cfg.weather_city[sizeof(cfg.weather_city) - 1] = '\0';
     }
-    if (doc["weather_use_f"].is<bool>()) {
-        cfg.weather_use_f = doc["weather_use_f"].as<bool>();
+    if (in["weather_use_f"].is<bool>()) {
+        cfg.weather_use_f = in["weather_use_f"].as<bool>();
+    }
+    if (in["weather_poll_min"].is<int>()) {
+        cfg.weather_poll_min = constrain(in["weather_poll_min"].as<int>(), 5, 60);
     }
-    if (doc["weather_poll_min"].is<int>()) {
-        cfg.weather_poll_min = constrain(doc["weather_poll_min"].as<int>(), 5, 60);
+    if (in["weather_base_url"].is<const char*>()) {
+        strncpy(cfg.weather_base_url, in["weather_base_url"] | "", sizeof(cfg.weather_base_url) - 1);
+        cfg.weather_base_url[sizeof(cfg.weather_base_url) - 1] = '\0';
     }
 
-    // Date
-    if (doc["date_on_time_screen"].is<bool>()) {
-        cfg.date_on_time_screen = doc["date_on_time_screen"].as<bool>();
+    in.section = CFG_TIMER;
+    if (in["timer_enabled"].is<bool>()) {
+        cfg.timer_enabled = in["timer_enabled"].as<bool>();
     }
-    if (doc["date_format"].is<int>()) {
-        cfg.date_format = constrain(doc["date_format"].as<int>(), 0, 2);
+    if (in["timer_work_min"].is<int>()) {
+        cfg.timer_work_min = constrain(in["timer_work_min"].as<int>(), 1, 120);
     }
-
-    // Timer
-    if (doc["timer_enabled"].is<bool>()) {
-        cfg.timer_enabled = doc["timer_enabled"].as<bool>();
+    if (in["timer_break_min"].is<int>()) {
+        cfg.timer_break_min = constrain(in["timer_break_min"].as<int>(), 1, 60);
     }
-    if (doc["timer_work_min"].is<int>()) {
-        cfg.timer_work_min = constrain(doc["timer_work_min"].as<int>(), 1, 120);
+    if (in["timer_long_break_min"].is<int>()) {
+        cfg.timer_long_break_min = constrain(in["timer_long_break_min"].as<int>(), 1, 60);
     }
-    if (doc["timer_break_min"].is<int>()) {
-        cfg.timer_break_min = constrain(doc["timer_break_min"].as<int>(), 1, 60);
+    if (in["timer_sessions"].is<int>()) {
+        cfg.timer_sessions = constrain(in["timer_sessions"].as<int>(), 1, 12);
     }
-    if (doc["timer_long_break_min"].is<int>()) {
-        cfg.timer_long_break_min = constrain(doc["timer_long_break_min"].as<int>(), 1, 60);
+    if (in["timer_buzzer"].is<bool>()) {
+        cfg.timer_buzzer = in["timer_buzzer"].as<bool>();
     }
-    if (doc["timer_sessions"].is<int>()) {
-        cfg.timer_sessions = constrain(doc["timer_sessions"].as<int>(), 1, 12);
+    if (in["stopwatch_enabled"].is<bool>()) {
+        cfg.stopwatch_enabled = in["stopwatch_enabled"].as<bool>();
     }
-    if (doc["timer_buzzer"].is<bool>()) {
-        cfg.timer_buzzer = doc["timer_buzzer"].as<bool>();
+    if (in["countdown_enabled"].is<bool>()) {
+        cfg.countdown_enabled = in["countdown_enabled"].as<bool>();
     }
-
-    // Stopwatch
-    if (doc["stopwatch_enabled"].is<bool>()) {
-        cfg.stopwatch_enabled = doc["stopwatch_enabled"].as<bool>();
+    if (in["countdown_name"].is<const char*>()) {
+        strncpy(cfg.countdown_name, in["countdown_name"] | "", sizeof(cfg.countdown_name) - 1);
+        cfg.countdown_name[sizeof(cfg.countdown_name) - 1] = '\0';
+    }
+    if (in["countdown_target"].is<unsigned long>()) {
+        cfg.countdown_target = in["countdown_target"].as<unsigned long>();
     }
 
-    // Notifications
-    if (doc["notify_enabled"].is<bool>()) {
-        cfg.notify_enabled = doc["notify_enabled"].as<bool>();
+    in.section = CFG_NOTIFY;
+    if (in["notify_enabled"].is<bool>()) {
+        cfg.notify_enabled = in["notify_enabled"].as<bool>();
     }
-    if (doc["notify_default_duration"].is<int>()) {
-        cfg.notify_default_duration = constrain(doc["notify_default_duration"].as<int>(), 5, 600);
+    if (in["notify_default_duration"].is<int>()) {
+        cfg.notify_default_duration = constrain(in["notify_default_duration"].as<int>(), 5, 600);
     }
-    if (doc["notify_allow_buzzer"].is<bool>()) {
-        cfg.notify_allow_buzzer = doc["notify_allow_buzzer"].as<bool>();
+    if (in["notify_allow_buzzer"].is<bool>()) {
+        cfg.notify_allow_buzzer = in["notify_allow_buzzer"].as<bool>();
     }
 
-    // Sysmon
-    if (doc["sysmon_enabled"].is<bool>()) {
-        cfg.sysmon_enabled = doc["sysmon_enabled"].as<bool>();
+    in.section = CFG_SYSMON;
+    if (in["sysmon_enabled"].is<bool>()) {
+        cfg.sysmon_enabled = in["sysmon_enabled"].as<bool>();
     }
-    if (doc["sysmon_label"].is<const char*>()) {
-        strncpy(cfg.sysmon_label, doc["sysmon_label"] | "CPU", sizeof(cfg.sysmon_label) - 1);
+    if (in["sysmon_label"].is<const char*>()) {
+        strncpy(cfg.sysmon_label, in["sysmon_label"] | "CPU", sizeof(cfg.sysmon_label) - 1);
         cfg.sysmon_label[sizeof(cfg.sysmon_label) - 1] = '\0';
     }
-    if (doc["sysmon_display_mode"].is<int>()) {
-        cfg.sysmon_display_mode = constrain(doc["sysmon_display_mode"].as<int>(), 0, 1);
+    if (in["sysmon_display_mode"].is<int>()) {
+        cfg.sysmon_display_mode = constrain(in["sysmon_display_mode"].as<int>(), 0, 1);
     }
-    if (doc["sysmon_warn_pct"].is<int>()) {
-        cfg.sysmon_warn_pct = constrain(doc["sysmon_warn_pct"].as<int>(), 0, 100);
+    if (in["sysmon_warn_pct"].is<int>()) {
+        cfg.sysmon_warn_pct = constrain(in["sysmon_warn_pct"].as<int>(), 0, 100);
     }
-    if (doc["sysmon_crit_pct"].is<int>()) {
-        cfg.sysmon_crit_pct = constrain(doc["sysmon_crit_pct"].as<int>(), 0, 100);
+    if (in["sysmon_crit_pct"].is<int>()) {
+        cfg.sysmon_crit_pct = constrain(in["sysmon_crit_pct"].as<int>(), 0, 100);
     }
 
-    // Countdown
-    if (doc["countdown_enabled"].is<bool>()) {
-        cfg.countdown_enabled = doc["countdown_enabled"].as<bool>();
+    in.section = CFG_LAN;
+    if (in["lan_share_mode"].is<int>()) {
+        cfg.lan_share_mode = constrain(in["lan_share_mode"].as<int>(), 0, 3);
     }
-    if (doc["countdown_name"].is<const char*>()) {
-        strncpy(cfg.countdown_name, doc["countdown_name"] | "", sizeof(cfg.countdown_name) - 1);
-        cfg.countdown_name[sizeof(cfg.countdown_name) - 1] = '\0';
-    }
-    if (doc["countdown_target"].is<unsigned long>()) {
-        cfg.countdown_target = doc["countdown_target"].as<unsigned long>();
+    if (in["lan_share_key"].is<const char*>()) {
+        strncpy(cfg.lan_share_key, in["lan_share_key"] | "", sizeof(cfg.lan_share_key) - 1);
+        cfg.lan_share_key[sizeof(cfg.lan_share_key) - 1] = '\0';
     }
 
-    // Auto-cycle
-    if (doc["auto_cycle_enabled"].is<bool>()) {
-        cfg.auto_cycle_enabled = doc["auto_cycle_enabled"].as<bool>();
+    in.section = CFG_MQTT;
+    if (in["mqtt_enabled"].is<bool>()) {
+        cfg.mqtt_enabled = in["mqtt_enabled"].as<bool>();
+    }
+    if (in["mqtt_uri"].is<const char*>()) {
+        strncpy(cfg.mqtt_uri, in["mqtt_uri"] | "", sizeof(cfg.mqtt_uri) - 1);
+        cfg.mqtt_uri[sizeof(cfg.mqtt_uri) - 1] = '\0';
     }
-    if (doc["auto_cycle_sec"].is<int>()) {
-        cfg.auto_cycle_sec = constrain(doc["auto_cycle_sec"].as<int>(), 3, 300);
+    if (in["mqtt_username"].is<const char*>()) {
+        strncpy(cfg.mqtt_username, in["mqtt_username"] | "", sizeof(cfg.mqtt_username) - 1);
+        cfg.mqtt_username[sizeof(cfg.mqtt_username) - 1] = '\0';
+    }
+    if (in["mqtt_password"].is<const char*>()) {
+        strncpy(cfg.mqtt_password, in["mqtt_password"] | "", sizeof(cfg.mqtt_password) - 1);
+        cfg.mqtt_password[sizeof(cfg.mqtt_password) - 1] = '\0';
+    }
+    if (in["mqtt_topic"].is<const char*>() && strlen(in["mqtt_topic"] | "") > 0) {
+        strncpy(cfg.mqtt_topic, in["mqtt_topic"] | "", sizeof(cfg.mqtt_topic) - 1);
+        cfg.mqtt_topic[sizeof(cfg.mqtt_topic) - 1] = '\0';
     }
 
-    config_save();
-    engine_rebuild_toggle_order();
+    in.section = CFG_SYSTEM;
+    if (in["log_level"].is<int>()) {
+        cfg.log_level = constrain(in["log_level"].as<int>(), LOG_LEVEL_ERROR, LOG_LEVEL_DEBUG);
+        logger_set_level((LogLevel)cfg.log_level);
+    }
+
+    uint32_t changed = config_save();
+
+    // Screens in the toggle order come and go with their enable flags
+    if (changed & (CFG_BIT(CFG_WEATHER) | CFG_BIT(CFG_TIMER) | CFG_BIT(CFG_SYSMON))) {
+        engine_rebuild_toggle_order();
+    }
 
     // Apply brightness immediately
-    if (!cfg.auto_brightness) {
+    if ((changed & CFG_BIT(CFG_DISPLAY)) && !cfg.auto_brightness) {
         display_set_brightness(cfg.brightness);
     }
 
-    // If WiFi credentials were just saved while in AP mode, reboot to connect
-    if (wifi_is_ap_mode() && config_has_wifi()) {
+    // If WiFi credentials were just sent while in AP mode, reboot to connect
+    // (even unchanged: the last attempt may have failed on a flaky AP)
+    if ((in.touched & CFG_BIT(CFG_WIFI)) && wifi_is_ap_mode() && config_has_wifi()) {
         request->send(200, "application/json", "{\"status\":\"ok\",\"reboot\":true}");
         delay(1000);
         ESP.restart();
         return;
     }
 
-    request->send(200, "application/json", "{\"status\":\"ok\"}");
+    doc.clear();
+    doc["status"] = "ok";
+    JsonArray names = doc["changed"].to<JsonArray>();
+    for (int i = 0; i < CFG_SECTION_COUNT; i++) {
+        if (changed & CFG_BIT(i)) names.add(config_section_name((ConfigSection)i));
+    }
+    String output;
+    serializeJson(doc, output);
+    config_etag(sections, etag, sizeof(etag));
+    AsyncWebServerResponse* resp = request->beginResponse(200, "application/json", output);
+    resp->addHeader("ETag", etag);
+    request->send(resp);
 }
 
 // GET /api/debug
 static void handle_debug(AsyncWebServerRequest* request) {
-    JsonDocument doc;
+    ScratchScope scope;
+    JsonDocument doc(scope.json());
 
     doc["last_http_code"] = http_get_last_response_code();
     doc["last_http_body"] = http_get_last_response_body();
@@ -498,13 +727,112 @@ static void handle_debug(AsyncWebServerRequest* request) {
     doc["btn_middle_raw"] = digitalRead(PIN_BUTTON_MIDDLE);
     doc["btn_right_raw"] = digitalRead(PIN_BUTTON_RIGHT);
     doc["user_mode"] = engine_state_name(engine_get_user_mode());
+    doc["notify_queued"] = notify_count();
+    doc["notify_rejected"] = notify_rejected_count();
+
+    JsonObject lan = doc["lan"].to<JsonObject>();
+    lan["role"] = lan_share_role_name();
+    char leader[9];
+    snprintf(leader, sizeof(leader), "%08lx", (unsigned long)lan_share_leader_id());
+    lan["leader"] = leader;
+    lan["received"] = lan_share_packets_received();
+    lan["rejected"] = lan_share_packets_rejected();
+
+    JsonObject mqtt = doc["mqtt"].to<JsonObject>();
+    mqtt["connected"] = mqtt_is_connected();
+    mqtt["published"] = mqtt_messages_published();
+    mqtt["received"] = mqtt_messages_received();
+    mqtt["dropped"] = mqtt_messages_dropped();
+
+    // Outbound request scheduler
+    JsonObject net = doc["net"].to<JsonObject>();
+    net["active"] = net_sched_active();
+    net["sessions_allowed"] = net_sched_sessions_allowed();
+    JsonObject net_jobs = net["jobs"].to<JsonObject>();
+    for (int i = 0; i < NET_JOB_COUNT; i++) {
+        const NetJobStats& st = net_sched_stats((NetJob)i);
+        JsonObject j = net_jobs[net_sched_job_name((NetJob)i)].to<JsonObject>();
+        j["runs"] = st.runs;
+        j["failures"] = st.failures;
+        j["coalesced"] = st.coalesced;
+        j["deferred"] = st.deferred;
+        j["last_ms"] = st.last_ms;
+    }
+
+    JsonObject dns = doc["dns"].to<JsonObject>();
+    for (int i = 0; i < DNS_RESULT_COUNT; i++) {
+        dns[dns_result_name((DnsResult)i)] = dns_cache_results((DnsResult)i);
+    }
+    JsonArray hosts = dns["hosts"].to<JsonArray>();
+    DnsCacheEntry e;
+    for (int i = 0; dns_cache_entry(i, &e); i++) {
+        JsonObject h = hosts.add<JsonObject>();
+        h["host"] = e.host;
+        h["ip"] = IPAddress(e.ip).toString();
+        h["age_sec"] = (millis() - e.resolved_ms) / 1000;
+    }
+
+    JsonArray tls = doc["tls"].to<JsonArray>();
+    for (int i = 0; i < tls_host_count(); i++) {
+        const TlsHostStats& t = tls_host_stats(i);
+        JsonObject h = tls.add<JsonObject>();
+        h["host"] = t.host;
+        h["handshakes"] = t.handshakes;
+        h["failures"] = t.failures;
+        h["last_handshake_ms"] = t.last_handshake_ms;
+        h["max_handshake_ms"] = t.max_handshake_ms;
+        h["peak_heap_bytes"] = t.peak_heap_bytes;
+        h["max_frag"] = t.max_frag;
+        h["suite"] = t.suite;
+    }
+
+    // Response bodies per source: what compression saves on the wire
+    JsonObject bodies = doc["bodies"].to<JsonObject>();
+    for (int i = 0; i < NET_SRC_COUNT; i++) {
+        const NetBodyStats& st = net_body_stats((NetSource)i);
+        JsonObject b = bodies[net_source_name((NetSource)i)].to<JsonObject>();
+        b["responses"] = st.responses;
+        b["gzipped"] = st.gzipped;
+        b["wire_bytes"] = st.wire_bytes;
+        b["decoded_bytes"] = st.body_bytes;
+        b["saved_pct"] = st.body_bytes ? 100 - (int)(st.wire_bytes * 100 / st.body_bytes) : 0;
+    }
+
+    JsonObject admission = doc["admission"].to<JsonObject>();
+    admission["inflight"] = rate_limit_inflight();
+    admission["inflight_cap"] = rate_limit_inflight_cap();
+    for (int i = 0; i < RATE_CLASS_COUNT; i++) {
+        const RateClassStats& st = rate_limit_stats((RateClass)i);
+        JsonObject c = admission[rate_class_name((RateClass)i)].to<JsonObject>();
+        c["admitted"] = st.admitted;
+        c["limited"] = st.limited;
+        c["busy"] = st.busy;
+    }
+
+    JsonArray features = doc["features"].to<JsonArray>();
+    for (int i = 0; i < features_count(); i++) features.add(features_get(i).name);
+
+    // Scratch arena use: high water near size means overflows to the heap
+    JsonArray scratch = doc["scratch"].to<JsonArray>();
+    const ScratchArena* arenas[] = { &scratch_loop, &scratch_web };
+    for (const ScratchArena* a : arenas) {
+        JsonObject arena = scratch.add<JsonObject>();
+        arena["name"] = a->name;
+        arena["size"] = a->size;
+        arena["high_water"] = a->high_water;
+        arena["overflows"] = a->overflows;
+    }
 
     // MAC address
     doc["mac"] = WiFi.macAddress();
 
-    // LittleFS info
+    // LittleFS info (0 until something mounts it)
     doc["fs_used"] = LittleFS.usedBytes();
     doc["fs_total"] = LittleFS.totalBytes();
+    JsonObject www = doc["www"].to<JsonObject>();
+    www["bundle"] = www_bundle_ready();
+    www["files"] = www_bundle_count();
+    www["bytes"] = www_bundle_bytes();
 
     unsigned long age = http_time_since_last_reading();
     doc["data_age_ms"] = (age == ULONG_MAX) ? -1 : (long)age;
@@ -518,6 +846,23 @@ static void handle_debug(AsyncWebServerRequest* request) {
         doc["raw_delta"] = http_get_delta();
     }
 
+    // Loop and fetch timing since boot or the last POST /api/perf/reset
+    JsonObject perf = doc["perf"].to<JsonObject>();
+    perf["loop_count"] = perf_loop_count();
+    perf["loop_avg_us"] = perf_loop_avg_us();
+    perf["loop_max_us"] = perf_loop_max_us();
+    perf["loop_stalls"] = perf_loop_stalls();
+    for (int i = 0; i < PERF_SOURCE_COUNT; i++) {
+        const PerfFetchStats& fs = perf_fetch_stats((PerfSource)i);
+        JsonObject src = perf[perf_source_name((PerfSource)i)].to<JsonObject>();
+        src["count"] = fs.count;
+        src["failures"] = fs.failures;
+        src["last_ms"] = fs.last_ms;
+        src["max_ms"] = fs.max_ms;
+        src["avg_ms"] = fs.count > 0 ? fs.total_ms / fs.count : 0;
+        src["last_code"] = fs.last_code;
+    }
+
     String output;
     serializeJson(doc, output);
     request->send(200, "application/json", output);
@@ -525,10 +870,14 @@ static void handle_debug(AsyncWebServerRequest* request) {
 
 // GET /api/history
 static void handle_history(AsyncWebServerRequest* request) {
-    JsonDocument doc;
-
-    GlucoseHistoryEntry entries[GLUCOSE_HISTORY_SIZE];
+    ScratchScope scope;
+    GlucoseHistoryEntry* entries = (GlucoseHistoryEntry*)scope.alloc(sizeof(GlucoseHistoryEntry) * GLUCOSE_HISTORY_SIZE);
+    if (!entries) {
+        request->send(503, "application/json", "{\"error\":\"Out of memory\"}");
+        return;
+    }
     int count = http_get_history(entries, GLUCOSE_HISTORY_SIZE);
+    JsonDocument doc(scope.json());
 
     JsonArray readings = doc["readings"].to<JsonArray>();
     for (int i = 0; i < count; i++) {
@@ -544,9 +893,73 @@ static void handle_history(AsyncWebServerRequest* request) {
     request->send(200, "application/json", output);
 }
 
+static void add_health_sample(JsonObject obj, const HealthSample& h) {
+    obj["t"] = h.uptime_sec;
+    obj["free"] = h.free_heap;
+    obj["largest"] = h.largest_block;
+    obj["min_free"] = h.min_free_heap;
+    obj["frag"] = health_frag_pct(h);
+}
+
+// GET /api/health — heap time series (oldest first) and task stack headroom
+static void handle_health(AsyncWebServerRequest* request) {
+    ScratchScope scope;
+    JsonDocument doc(scope.json());
+    doc["interval_sec"] = HEALTH_SAMPLE_MS / 1000;
+
+    HealthSample h;
+    if (health_get_boot_sample(&h)) add_health_sample(doc["boot"].to<JsonObject>(), h);
+
+    JsonArray samples = doc["samples"].to<JsonArray>();
+    for (int i = 0; health_get_sample(i, &h); i++) {
+        add_health_sample(samples.add<JsonObject>(), h);
+    }
+
+    JsonArray tasks = doc["tasks"].to<JsonArray>();
+    for (int i = 0; i < health_task_count(); i++) {
+        const HealthTask& t = health_get_task(i);
+        if (t.stack_free_min == 0) continue;
+        JsonObject task = tasks.add<JsonObject>();
+        task["name"] = t.name;
+        task["stack_free_min"] = t.stack_free_min;
+        task["running"] = t.running;
+    }
+
+    String output;
+    serializeJson(doc, output);
+    request->send(200, "application/json", output);
+}
+
+// GET /api/transitions - recent display state changes and what caused them
+static void handle_transitions(AsyncWebServerRequest* request) {
+    ScratchScope scope;
+    JsonDocument doc(scope.json());
+    doc["state"] = engine_state_name(engine_get_state());
+    doc["evaluations"] = engine_evaluation_count();
+
+    JsonArray list = doc["transitions"].to<JsonArray>();
+    EngineTransition t;
+    for (int i = 0; engine_get_transition(i, &t); i++) {
+        JsonObject o = list.add<JsonObject>();
+        o["uptime_ms"] = t.uptime_ms;
+        o["from"] = engine_state_name((DisplayState)t.from);
+        o["to"] = engine_state_name((DisplayState)t.to);
+        JsonArray reasons = o["reasons"].to<JsonArray>();
+        for (int ev = 0; ev < ENGINE_EV_COUNT; ev++) {
+            if (t.reasons & (1u << ev)) reasons.add(engine_event_name((EngineEvent)ev));
+        }
+    }
+
+    String output;
+    serializeJson(doc, output);
+    request->send(200, "application/json", output);
+}
+
+#if FEATURE_TIMER
 // GET /api/timer
 static void handle_timer_status(AsyncWebServerRequest* request) {
-    JsonDocument doc;
+    ScratchScope scope;
+    JsonDocument doc(scope.json());
     doc["timer_state"] = (int)timer_get_state();
     doc["timer_remaining"] = timer_get_remaining_sec();
     doc["timer_session"] = timer_get_session();
@@ -558,6 +971,197 @@ static void handle_timer_status(AsyncWebServerRequest* request) {
     serializeJson(doc, output);
     request->send(200, "application/json", output);
 }
+#endif
+
+// GET /metrics - Prometheus exposition, generated chunk by chunk
+static void handle_metrics(AsyncWebServerRequest* request) {
+    std::shared_ptr<MetricsCursor> cursor = std::make_shared<MetricsCursor>();
+    metrics_cursor_init(*cursor);
+    AsyncWebServerResponse* response = request->beginChunkedResponse(
+        "text/plain; version=0.0.4",
+        [cursor](uint8_t* buffer, size_t max_len, size_t index) -> size_t {
+            return metrics_render(*cursor, buffer, max_len);
+        });
+    request->send(response);
+}
+
+// GET /api/logs?since=<seq> - lines still in the log ring after seq
+static void handle_logs(AsyncWebServerRequest* request) {
+    uint32_t seq = logger_oldest_seq();
+    if (request->hasParam("since")) {
+        uint32_t since = strtoul(request->getParam("since")->value().c_str(), NULL, 10);
+        if ((int32_t)(since - seq) > 0) seq = since;
+    }
+
+    ScratchScope scope;
+    JsonDocument doc(scope.json());
+    doc["level"] = logger_level_name(logger_get_level());
+    doc["dropped"] = logger_dropped();
+    JsonArray lines = doc["lines"].to<JsonArray>();
+    LogEntry e;
+    while (logger_next(&seq, &e)) {
+        JsonObject line = lines.add<JsonObject>();
+        line["seq"] = e.seq;
+        line["ms"] = e.ms;
+        line["level"] = logger_level_name(e.level);
+        line["text"] = e.text;
+    }
+    doc["next"] = seq;
+
+    String output;
+    serializeJson(doc, output);
+    request->send(200, "application/json", output);
+}
+
+// Log drain task: forward each line to connected /api/logs/stream clients
+static void stream_log_line(const LogEntry& e) {
+    if (log_events.count() == 0) return;
+    log_events.send(e.text, logger_level_name(e.level), e.seq);
+}
+
+// GET /api/bench
+static void handle_get_bench(AsyncWebServerRequest* request) {
+    ScratchScope scope;
+    JsonDocument doc(scope.json());
+    BenchStatus st = bench_get_status();
+    doc["status"] = st == BENCH_DONE ? "done" : (st == BENCH_PENDING ? "running" : "idle");
+    doc["frames"] = BENCH_FRAMES;
+    doc["cpu_mhz"] = bench_cpu_mhz();
+    doc["regression_pct"] = BENCH_REGRESSION_PCT;
+    doc["regressions"] = bench_regression_count();
+
+    JsonArray results = doc["results"].to<JsonArray>();
+    for (int i = 0; i < bench_result_count(); i++) {
+        const BenchResult& r = bench_get_result(i);
+        JsonObject o = results.add<JsonObject>();
+        o["name"] = r.name;
+        o["kind"] = r.kind == BENCH_KIND_STATE ? "state" : "primitive";
+        o["avg_cycles"] = r.avg_cycles;
+        o["median_cycles"] = r.median_cycles;
+        o["max_cycles"] = r.max_cycles;
+        o["avg_us"] = r.avg_cycles / bench_cpu_mhz();
+        if (r.baseline_cycles > 0) {
+            o["baseline_cycles"] = r.baseline_cycles;
+            o["delta_pct"] = ((long)r.median_cycles - (long)r.baseline_cycles) * 100L / (long)r.baseline_cycles;
+            o["regressed"] = r.regressed;
+        }
+    }
+
+    String output;
+    serializeJson(doc, output);
+    request->send(200, "application/json", output);
+}
+
+// POST /api/bench[?baseline=1] - runs on the main loop, poll GET for results
+static void handle_post_bench(AsyncWebServerRequest* request) {
+    bool save = request->hasParam("baseline") && request->getParam("baseline")->value() == "1";
+    bench_request(save);
+    request->send(202, "application/json", "{\"status\":\"running\"}");
+}
+
+// GET /api/ota
+static void handle_get_ota(AsyncWebServerRequest* request) {
+    static const char* STATE_NAMES[] = { "idle", "receiving", "success", "failed" };
+    ScratchScope scope;
+    JsonDocument doc(scope.json());
+    doc["state"] = STATE_NAMES[ota_get_state()];
+    doc["target"] = ota_target_name(ota_get_target());
+    doc["received"] = ota_bytes_received();
+    doc["written"] = ota_bytes_written();
+    doc["error"] = ota_last_error();
+    doc["running"] = ota_running_partition();
+    doc["pending_verify"] = ota_is_pending_verify();
+
+    String output;
+    serializeJson(doc, output);
+    request->send(200, "application/json", output);
+}
+
+// POST /api/ota?target=firmware|filesystem|www&sha256=<hex>
+// Accepts a multipart upload (browser form, curl -F) or a raw body
+// (curl --data-binary); plain or gzip-compressed images.
+static AsyncWebServerRequest* ota_request = nullptr;
+
+// A www update that fails after its erase reached the bundle leaves no web
+// UI; restarting takes the LittleFS fallback in webserver_init()
+static bool www_from_bundle = false;
+
+static bool www_lost() {
+    return www_from_bundle && !www_bundle_ready();
+}
+
+static void ota_chunk(AsyncWebServerRequest* request, size_t index, uint8_t* data, size_t len, bool final) {
+    if (index == 0) {
+        if (ota_get_state() == OTA_RECEIVING) return;  // another upload owns the slot
+        ota_request = request;
+        request->onDisconnect([request]() {
+            if (ota_request == request) {
+                ota_abort();
+                ota_request = nullptr;
+                if (www_lost()) ESP.restart();
+            }
+        });
+
+        OtaTarget target = OTA_FIRMWARE;
+        if (request->hasParam("target")) {
+            const String& t = request->getParam("target")->value();
+            if (t == "filesystem") target = OTA_FILESYSTEM;
+            else if (t == "www") target = OTA_WEB_BUNDLE;
+        }
+        String sha = request->hasParam("sha256") ? request->getParam("sha256")->value() : String();
+        if (!ota_begin(target, sha.c_str())) return;
+    }
+    if (request != ota_request) return;
+    if (ota_write(data, len) && final) ota_end();
+}
+
+static void handle_ota_upload(AsyncWebServerRequest* request, const String& filename,
+                              size_t index, uint8_t* data, size_t len, bool final) {
+    ota_chunk(request, index, data, len, final);
+}
+
+static void handle_ota_body(AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
+    ota_chunk(request, index, data, len, index + len == total);
+}
+
+static void handle_ota_done(AsyncWebServerRequest* request) {
+    if (ota_request == nullptr) {
+        request->send(400, "application/json", "{\"ok\":false,\"error\":\"No image received\"}");
+        return;
+    }
+    if (request != ota_request) {
+        request->send(409, "application/json", "{\"ok\":false,\"error\":\"Update already in progress\"}");
+        return;
+    }
+    ota_request = nullptr;
+
+    ScratchScope scope;
+    JsonDocument doc(scope.json());
+    if (ota_get_state() == OTA_SUCCESS) {
+        doc["ok"] = true;
+        doc["written"] = ota_bytes_written();
+        doc["status"] = "restarting";
+        String output;
+        serializeJson(doc, output);
+        request->send(200, "application/json", output);
+        delay(500);
+        ESP.restart();
+        return;
+    }
+
+    ota_abort();
+    bool restart = www_lost();
+    doc["ok"] = false;
+    doc["error"] = ota_last_error();
+    if (restart) doc["status"] = "restarting";
+    String output;
+    serializeJson(doc, output);
+    request->send(400, "application/json", output);
+    if (restart) {
+        delay(500);
+        ESP.restart();
+    }
+}
 
 // POST /api/notify
 static void handle_post_notify(AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
@@ -569,7 +1173,8 @@ static void handle_post_notify(AsyncWebServerRequest* request, uint8_t* data, si
         return;
     }
 
-    JsonDocument doc;
+    ScratchScope scope;
+    JsonDocument doc(scope.json());
     DeserializationError err = deserializeJson(doc, data, len);
     if (err) {
         request->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
@@ -585,10 +1190,16 @@ static void handle_post_notify(AsyncWebServerRequest* request, uint8_t* data, si
     int duration = doc["duration_sec"] | cfg.notify_default_duration;
     bool urgent = doc["urgent"] | false;
 
-    notify_push(text, duration, urgent);
-    request->send(200, "application/json", "{\"status\":\"ok\"}");
+    if (!notify_push(text, duration, urgent)) {
+        request->send(429, "application/json", "{\"error\":\"Notification queue full\"}");
+        return;
+    }
+    char resp[48];
+    snprintf(resp, sizeof(resp), "{\"status\":\"ok\",\"queued\":%d}", notify_count());
+    request->send(200, "application/json", resp);
 }
 
+#if FEATURE_SYSMON
 // POST /api/sysmon
 static void handle_post_sysmon(AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
     if (index != 0) return;
@@ -599,7 +1210,8 @@ static void handle_post_sysmon(AsyncWebServerRequest* request, uint8_t* data, si
         return;
     }
 
-    JsonDocument doc;
+    ScratchScope scope;
+    JsonDocument doc(scope.json());
     DeserializationError err = deserializeJson(doc, data, len);
     if (err) {
         request->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
@@ -613,11 +1225,49 @@ static void handle_post_sysmon(AsyncWebServerRequest* request, uint8_t* data, si
     sysmon_push(label, value, max_val);
     request->send(200, "application/json", "{\"status\":\"ok\"}");
 }
+#endif
+
+// Test fetches run on the loop task like any other: POST marks the job due
+// and answers 202, GET on the same path polls for the result
+static uint32_t test_ticket[NET_JOB_COUNT];
+static bool test_requested[NET_JOB_COUNT];
+
+static void send_test_queued(AsyncWebServerRequest* request, NetJob job) {
+    test_ticket[job] = net_sched_force(job);
+    test_requested[job] = true;
+    char resp[96];
+    snprintf(resp, sizeof(resp), "{\"status\":\"queued\",\"poll\":\"%s\"}", request->url().c_str());
+    request->send(202, "application/json", resp);
+}
+
+// False once it has answered itself (nothing requested, or still running)
+static bool test_finished(AsyncWebServerRequest* request, NetJob job, bool* ok) {
+    if (!test_requested[job]) {
+        request->send(404, "application/json", "{\"state\":\"idle\",\"error\":\"No test requested\"}");
+        return false;
+    }
+    NetResult res = net_sched_result(job, test_ticket[job]);
+    if (res == NET_RESULT_PENDING) {
+        request->send(200, "application/json", "{\"state\":\"pending\"}");
+        return false;
+    }
+    *ok = res == NET_RESULT_OK;
+    return true;
+}
 
+#if FEATURE_WEATHER
 // POST /api/test/weather
 static void handle_test_weather(AsyncWebServerRequest* request) {
-    bool ok = weather_force_fetch();
-    JsonDocument doc;
+    send_test_queued(request, NET_JOB_WEATHER);
+}
+
+// GET /api/test/weather
+static void handle_test_weather_result(AsyncWebServerRequest* request) {
+    bool ok;
+    if (!test_finished(request, NET_JOB_WEATHER, &ok)) return;
+    ScratchScope scope;
+    JsonDocument doc(scope.json());
+    doc["state"] = "done";
     doc["ok"] = ok;
     doc["http_code"] = weather_get_last_http_code();
 
@@ -639,7 +1289,8 @@ static void handle_test_weather(AsyncWebServerRequest* request) {
 static void handle_test_weather_mock(AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
     if (index != 0) return;
 
-    JsonDocument doc;
+    ScratchScope scope;
+    JsonDocument doc(scope.json());
     DeserializationError err = deserializeJson(doc, data, len);
     if (err) {
         request->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
@@ -655,10 +1306,12 @@ static void handle_test_weather_mock(AsyncWebServerRequest* request, uint8_t* da
     // Force weather enabled + switch to weather display
     AppConfig& cfg = config_get();
     cfg.weather_enabled = true;
+    config_touch(CFG_BIT(CFG_WEATHER));
     engine_rebuild_toggle_order();
     engine_force_state(STATE_WEATHER_DISPLAY);
 
-    JsonDocument resp;
+    ScratchScope reply_scope;
+    JsonDocument resp(reply_scope.json());
     resp["status"] = "ok";
     resp["condition_id"] = cid;
     resp["description"] = desc;
@@ -668,11 +1321,10 @@ static void handle_test_weather_mock(AsyncWebServerRequest* request, uint8_t* da
     serializeJson(resp, output);
     request->send(200, "application/json", output);
 }
+#endif
 
 // POST /api/test/glucose
 static void handle_test_glucose(AsyncWebServerRequest* request) {
-    AppConfig& cfg = config_get();
-
     if (!wifi_is_connected()) {
         request->send(503, "application/json", "{\"ok\":false,\"error\":\"WiFi not connected\"}");
         return;
@@ -681,9 +1333,16 @@ static void handle_test_glucose(AsyncWebServerRequest* request) {
         request->send(400, "application/json", "{\"ok\":false,\"error\":\"No data source configured\"}");
         return;
     }
+    send_test_queued(request, NET_JOB_GLUCOSE);
+}
 
-    bool ok = http_force_fetch();
-    JsonDocument doc;
+// GET /api/test/glucose
+static void handle_test_glucose_result(AsyncWebServerRequest* request) {
+    bool ok;
+    if (!test_finished(request, NET_JOB_GLUCOSE, &ok)) return;
+    ScratchScope scope;
+    JsonDocument doc(scope.json());
+    doc["state"] = "done";
     doc["ok"] = ok;
     doc["http_code"] = http_get_last_response_code();
 
@@ -717,7 +1376,8 @@ static void handle_test_glucose(AsyncWebServerRequest* request) {
 // POST /api/display/next
 static void handle_display_next(AsyncWebServerRequest* request) {
     engine_toggle_mode();
-    JsonDocument doc;
+    ScratchScope scope;
+    JsonDocument doc(scope.json());
     doc["status"] = "ok";
     doc["mode"] = engine_state_name(engine_get_user_mode());
     String output;
@@ -728,7 +1388,8 @@ static void handle_display_next(AsyncWebServerRequest* request) {
 // POST /api/display/prev
 static void handle_display_prev(AsyncWebServerRequest* request) {
     engine_toggle_mode_prev();
-    JsonDocument doc;
+    ScratchScope scope;
+    JsonDocument doc(scope.json());
     doc["status"] = "ok";
     doc["mode"] = engine_state_name(engine_get_user_mode());
     String output;
@@ -751,69 +1412,127 @@ static void handle_factory_reset(AsyncWebServerRequest* request) {
     ESP.restart();
 }
 
-void webserver_init() {
-    // Initialize LittleFS
-    if (!LittleFS.begin(true)) {
-        Serial.println("[WEB] LittleFS mount failed");
+// GET /* (registered last) — web UI straight from the mapped bundle, sent
+// as stored (gzip) with its CRC as the ETag
+static void handle_www(AsyncWebServerRequest* request) {
+    WwwAsset asset;
+    if (!www_bundle_find(request->url().c_str(), &asset)) {
+        request->send(404, "text/plain", "Not found");
         return;
     }
-    Serial.println("[WEB] LittleFS mounted");
-
-    // Static files from /www/
-    server.serveStatic("/", LittleFS, "/www/").setDefaultFile("index.html");
+    char etag[12];
+    snprintf(etag, sizeof(etag), "\"%08lx\"", (unsigned long)asset.crc);
+    AsyncWebServerResponse* resp;
+    if (request->hasHeader("If-None-Match") && request->header("If-None-Match") == etag) {
+        resp = request->beginResponse(304);
+    } else {
+        resp = request->beginResponse(200, asset.content_type, asset.data, asset.len);
+        if (asset.gzip) resp->addHeader("Content-Encoding", "gzip");
+    }
+    resp->addHeader("ETag", etag);
+    resp->addHeader("Cache-Control", "no-cache");
+    request->send(resp);
+}
 
-    // API routes
-    server.on("/api/status", HTTP_GET, handle_status);
-    server.on("/api/config", HTTP_GET, handle_get_config);
-    server.on("/api/debug", HTTP_GET, handle_debug);
-    server.on("/api/history", HTTP_GET, handle_history);
-    server.on("/api/timer", HTTP_GET, handle_timer_status);
-    server.on("/api/restart", HTTP_POST, [](AsyncWebServerRequest* r) { handle_restart(r); });
-    server.on("/api/factory-reset", HTTP_POST, [](AsyncWebServerRequest* r) { handle_factory_reset(r); });
-    server.on("/api/test/weather", HTTP_POST, [](AsyncWebServerRequest* r) { handle_test_weather(r); });
-    server.on("/api/test/glucose", HTTP_POST, [](AsyncWebServerRequest* r) { handle_test_glucose(r); });
+void webserver_init() {
+    // Web UI from the bundle partition; LittleFS /www/ only without one
+    // (older partition layout, or nothing flashed there yet)
+    bool bundle = www_bundle_init();
+    www_from_bundle = bundle;
+    if (!bundle) {
+        if (!LittleFS.begin(true)) {
+            LOG_E("WEB", "LittleFS mount failed");
+            return;
+        }
+        LOG_I("WEB", "LittleFS mounted, serving the web UI from it");
+        server.serveStatic("/", LittleFS, "/www/").setDefaultFile("index.html");
+    }
+
+    // API routes, each behind its client's rate for the route class and the
+    // in-flight cap (OTA has its own single-upload guard)
+    rate_limit_init();
+    server.on("/api/status", HTTP_GET, gated(RATE_STATUS, handle_status));
+    server.on("/api/config", HTTP_GET, gated(RATE_STATUS, handle_get_config));
+    server.on("/api/debug", HTTP_GET, gated(RATE_STATUS, handle_debug));
+    server.on("/metrics", HTTP_GET, gated(RATE_STATUS, handle_metrics));
+    server.addHandler(&log_events);  // before /api/logs, which would also match /stream
+    server.on("/api/logs", HTTP_GET, gated(RATE_STATUS, handle_logs));
+    logger_set_sink(stream_log_line);
+    server.on("/api/history", HTTP_GET, gated(RATE_STATUS, handle_history));
+    server.on("/api/health", HTTP_GET, gated(RATE_STATUS, handle_health));
+    server.on("/api/transitions", HTTP_GET, gated(RATE_STATUS, handle_transitions));
+#if FEATURE_TIMER
+    server.on("/api/timer", HTTP_GET, gated(RATE_STATUS, handle_timer_status));
+#endif
+    server.on("/api/restart", HTTP_POST, gated(RATE_CONFIG, handle_restart));
+    server.on("/api/factory-reset", HTTP_POST, gated(RATE_CONFIG, handle_factory_reset));
+    server.on("/api/test/glucose", HTTP_POST, gated(RATE_TEST, handle_test_glucose));
+    server.on("/api/test/glucose", HTTP_GET, gated(RATE_STATUS, handle_test_glucose_result));
+    server.on("/api/ota", HTTP_GET, gated(RATE_STATUS, handle_get_ota));
+    server.on("/api/ota", HTTP_POST, handle_ota_done, handle_ota_upload, handle_ota_body);
+    server.on("/api/bench", HTTP_GET, gated(RATE_STATUS, handle_get_bench));
+    server.on("/api/bench", HTTP_POST, gated(RATE_TEST, handle_post_bench));
+    server.on("/api/perf/reset", HTTP_POST, gated(RATE_CONFIG, [](AsyncWebServerRequest* r) {
+        perf_reset();
+        r->send(200, "application/json", "{\"status\":\"ok\"}");
+    }));
+
+#if FEATURE_WEATHER
+    server.on("/api/test/weather", HTTP_POST, gated(RATE_TEST, handle_test_weather));
+    server.on("/api/test/weather", HTTP_GET, gated(RATE_STATUS, handle_test_weather_result));
 
     // POST /api/test/weather-mock with body
     server.on("/api/test/weather-mock", HTTP_POST,
         [](AsyncWebServerRequest* request) {},
         NULL,
-        handle_test_weather_mock
+        gated_body(RATE_TEST, handle_test_weather_mock)
     );
-    server.on("/api/display/next", HTTP_POST, [](AsyncWebServerRequest* r) { handle_display_next(r); });
-    server.on("/api/display/prev", HTTP_POST, [](AsyncWebServerRequest* r) { handle_display_prev(r); });
+#endif
+    server.on("/api/display/next", HTTP_POST, gated(RATE_CONFIG, handle_display_next));
+    server.on("/api/display/prev", HTTP_POST, gated(RATE_CONFIG, handle_display_prev));
 
-    // POST /api/config with body
+    // POST/PATCH /api/config[/<section>] with body (same merge semantics)
     server.on("/api/config", HTTP_POST,
         [](AsyncWebServerRequest* request) {},
         NULL,
-        handle_post_config
+        gated_body(RATE_CONFIG, handle_post_config)
+    );
+    server.on("/api/config", HTTP_PATCH,
+        [](AsyncWebServerRequest* request) {},
+        NULL,
+        gated_body(RATE_CONFIG, handle_post_config)
     );
 
     // POST /api/notify with body
     server.on("/api/notify", HTTP_POST,
         [](AsyncWebServerRequest* request) {},
         NULL,
-        handle_post_notify
+        gated_body(RATE_INGEST, handle_post_notify)
     );
 
+#if FEATURE_SYSMON
     // POST /api/sysmon with body
     server.on("/api/sysmon", HTTP_POST,
         [](AsyncWebServerRequest* request) {},
         NULL,
-        handle_post_sysmon
+        gated_body(RATE_INGEST, handle_post_sysmon)
     );
+#endif
+
+    // After every API route, so only what they don't match falls through
+    if (bundle) server.on("/*", HTTP_GET, handle_www);
 
     // CORS headers for development
     DefaultHeaders::Instance().addHeader("Access-Control-Allow-Origin", "*");
-    DefaultHeaders::Instance().addHeader("Access-Control-Allow-Methods", "GET, POST, OPTIONS");
-    DefaultHeaders::Instance().addHeader("Access-Control-Allow-Headers", "Content-Type");
+    DefaultHeaders::Instance().addHeader("Access-Control-Allow-Methods", "GET, POST, PATCH, OPTIONS");
+    DefaultHeaders::Instance().addHeader("Access-Control-Allow-Headers", "Content-Type, If-Match, If-None-Match");
 
-    Serial.println("[WEB] Routes registered");
+    LOG_I("WEB", "Routes registered");
 }
 
 void webserver_start() {
     if (started) return;
     server.begin();
     started = true;
-    Serial.printf("[WEB] Server started at http://%s/\n", wifi_get_ip());
+    LOG_I("WEB", "Server started at http://%s/", wifi_get_ip());
 }
@@ -1,5 +1,8 @@
 #include "wifi_manager.h"
 #include "config_manager.h"
+#include "improv_serial.h"
+#include "engine_events.h"
+#include "logger.h"
 #include <WiFi.h>
 #include <Arduino.h>
 
@@ -18,13 +21,13 @@ void wifi_init() {
     AppConfig& cfg = config_get();
 
     if (!config_has_wifi()) {
-        Serial.println("[WIFI] No WiFi credentials — starting AP mode");
+        LOG_I("WIFI", "No WiFi credentials — starting AP mode");
         WiFi.mode(WIFI_AP);
         WiFi.softAP("SugarClock-Setup");
         ap_mode = true;
         IPAddress apIp = WiFi.softAPIP();
         snprintf(ap_ip_buf, sizeof(ap_ip_buf), "%d.%d.%d.%d", apIp[0], apIp[1], apIp[2], apIp[3]);
-        Serial.printf("[WIFI] AP started: SSID=SugarClock-Setup  IP=%s\n", ap_ip_buf);
+        LOG_I("WIFI", "AP started: SSID=SugarClock-Setup  IP=%s", ap_ip_buf);
         status_str = "AP MODE";
         return;
     }
@@ -32,7 +35,7 @@ void wifi_init() {
     WiFi.mode(WIFI_STA);
     WiFi.setAutoReconnect(true);
 
-    Serial.printf("[WIFI] Connecting to '%s'...\n", cfg.wifi_ssid);
+    LOG_I("WIFI", "Connecting to '%s'...", cfg.wifi_ssid);
     WiFi.begin(cfg.wifi_ssid, cfg.wifi_password);
     connecting = true;
     last_attempt_ms = millis();
@@ -42,30 +45,34 @@ void wifi_init() {
 void wifi_loop() {
     if (ap_mode) return;
     if (!config_has_wifi()) return;
+    // Improv owns the radio while it tries new credentials
+    if (improv_is_active()) return;
 
     if (WiFi.status() == WL_CONNECTED) {
         if (!was_connected) {
             // Just connected
             IPAddress ip = WiFi.localIP();
             snprintf(ip_buf, sizeof(ip_buf), "%d.%d.%d.%d", ip[0], ip[1], ip[2], ip[3]);
-            Serial.printf("[WIFI] Connected! IP: %s, RSSI: %d dBm\n", ip_buf, WiFi.RSSI());
+            LOG_I("WIFI", "Connected! IP: %s, RSSI: %d dBm", ip_buf, WiFi.RSSI());
             was_connected = true;
             connecting = false;
             status_str = "CONNECTED";
+            engine_post_event(ENGINE_EV_WIFI);
         }
         return;
     }
 
     // Not connected
     if (was_connected) {
-        Serial.println("[WIFI] Connection lost, will auto-reconnect");
+        LOG_W("WIFI", "Connection lost, will auto-reconnect");
         was_connected = false;
         status_str = "RECONNECTING";
+        engine_post_event(ENGINE_EV_WIFI);
     }
 
     // Check connection timeout
     if (connecting && (millis() - last_attempt_ms > WIFI_CONNECT_TIMEOUT_MS)) {
-        Serial.println("[WIFI] Connection timeout");
+        LOG_W("WIFI", "Connection timeout");
         connecting = false;
         status_str = "TIMEOUT";
     }
@@ -73,7 +80,7 @@ void wifi_loop() {
     // Retry logic (non-blocking)
     if (!connecting && (millis() - last_attempt_ms > WIFI_RETRY_INTERVAL_MS)) {
         AppConfig& cfg = config_get();
-        Serial.printf("[WIFI] Retrying connection to '%s'...\n", cfg.wifi_ssid);
+        LOG_I("WIFI", "Retrying connection to '%s'...", cfg.wifi_ssid);
         WiFi.disconnect();
         WiFi.begin(cfg.wifi_ssid, cfg.wifi_password);
         connecting = true;
@@ -0,0 +1,127 @@
+#include "www_bundle.h"
+#include "logger.h"
+#include <Arduino.h>
+#include <esp_partition.h>
+#include <esp32/rom/crc.h>
+
+struct WwwHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+    uint32_t total_len;
+    uint32_t crc;                 // of everything after the header
+};
+
+struct WwwEntry {
+    char path[WWW_PATH_MAX];
+    uint32_t offset;
+    uint32_t len;
+    uint32_t crc;
+    uint8_t type;
+    uint8_t flags;
+    uint16_t reserved;
+};
+
+static_assert(sizeof(WwwHeader) == 16, "bundle header layout");
+static_assert(sizeof(WwwEntry) == 64, "bundle index layout");
+
+// Indexed by WwwEntry::type (TYPES in tools/www_pack.py)
+static const char* const WWW_TYPES[] = {
+    "application/octet-stream", "text/html", "text/css", "application/javascript",
+    "application/json", "image/svg+xml", "image/png", "image/x-icon", "text/plain",
+};
+
+static const uint8_t* base = nullptr;
+static const WwwEntry* entries = nullptr;
+static uint16_t count = 0;
+static uint32_t total = 0;
+static bool ready = false;
+
+static bool reject(const char* why) {
+    LOG_W("WWW", "No web bundle: %s", why);
+    return false;
+}
+
+bool www_bundle_init() {
+    ready = false;
+    const esp_partition_t* part = esp_partition_find_first(
+        ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, WWW_PARTITION_LABEL);
+    if (!part) return reject("no www partition");
+
+    // Mapped once and never unmapped: responses point into it
+    if (!base) {
+        const void* ptr;
+        spi_flash_mmap_handle_t handle;
+        if (esp_partition_mmap(part, 0, part->size, SPI_FLASH_MMAP_DATA, &ptr, &handle) != ESP_OK) {
+            return reject("mmap failed");
+        }
+        base = (const uint8_t*)ptr;
+    }
+
+    const WwwHeader* h = (const WwwHeader*)base;
+    if (h->magic != WWW_MAGIC) return reject("partition empty");
+    if (h->version != WWW_VERSION) return reject("unknown bundle version");
+    uint32_t index_end = sizeof(WwwHeader) + (uint32_t)h->count * sizeof(WwwEntry);
+    if (h->total_len < index_end || h->total_len > part->size) return reject("bad length");
+    if (crc32_le(0, base + sizeof(WwwHeader), h->total_len - sizeof(WwwHeader)) != h->crc) {
+        return reject("CRC mismatch");
+    }
+
+    const WwwEntry* e = (const WwwEntry*)(base + sizeof(WwwHeader));
+    for (int i = 0; i < h->count; i++) {
+        if (e[i].offset < index_end || e[i].offset + e[i].len > h->total_len ||
+            e[i].path[0] != '/' || e[i].path[WWW_PATH_MAX - 1] != '\0') {
+            return reject("bad index entry");
+        }
+    }
+
+    entries = e;
+    count = h->count;
+    total = h->total_len;
+    ready = true;
+    LOG_I("WWW", "Web bundle: %u files, %lu bytes at 0x%06lx", count,
+          (unsigned long)total, (unsigned long)part->address);
+    return true;
+}
+
+bool www_bundle_ready() {
+    return ready;
+}
+
+bool www_bundle_find(const char* path, WwwAsset* out) {
+    if (!ready) return false;
+
+    char want[WWW_PATH_MAX];
+    size_t n = strlen(path);
+    if (n == 0 || n >= sizeof(want)) return false;
+    if (path[n - 1] == '/') {
+        if (n + strlen("index.html") >= sizeof(want)) return false;
+        snprintf(want, sizeof(want), "%sindex.html", path);
+    } else {
+        memcpy(want, path, n + 1);
+    }
+
+    for (int i = 0; i < count; i++) {
+        const WwwEntry& e = entries[i];
+        if (strcmp(e.path, want) != 0) continue;
+        out->data = base + e.offset;
+        out->len = e.len;
+        out->crc = e.crc;
+        out->content_type = e.type < sizeof(WWW_TYPES) / sizeof(WWW_TYPES[0]) ? WWW_TYPES[e.type] : WWW_TYPES[0];
+        out->gzip = e.flags & WWW_FLAG_GZIP;
+        return true;
+    }
+    return false;
+}
+
+void www_bundle_suspend() {
+    ready = false;
+}
+
+int www_bundle_count() {
+    return ready ? count : 0;
+}
+
+uint32_t www_bundle_bytes() {
+    return ready ? total : 0;
+}
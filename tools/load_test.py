@@ -0,0 +1,154 @@
+#!/usr/bin/env python3
+"""Load test for the clock's web API admission control.
+
+Floods /api/notify from several threads and keeps a few "dashboard tabs"
+polling /api/debug, while a user probe loads the setup page and
+/api/status once a second. Reports what the flood got back (200/429/503),
+the probe's latency and any probe failures (timeouts, connection errors,
+5xx). Exits non-zero if more than --max-probe-failures of the probes fail.
+
+    python3 tools/load_test.py --device 192.168.1.50 --flooders 8 --tabs 3 --seconds 60
+
+All traffic comes from this host, so flood, tabs and probe share one
+client IP: the probe's /api/status shares the tabs' bucket, and a probe
+turned away with 429 is counted as limited rather than failed.
+Standard library only.
+"""
+
+import argparse
+import json
+import sys
+import threading
+import time
+import urllib.error
+import urllib.request
+from collections import Counter
+
+
+class Tally:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.codes = Counter()
+        self.latencies = []
+
+    def add(self, code, latency=None):
+        with self.lock:
+            self.codes[code] += 1
+            if latency is not None:
+                self.latencies.append(latency)
+
+
+def fetch(method, url, body=None, timeout=5):
+    """Status code of one request ("timeout"/"error" if none came back)."""
+    data = json.dumps(body).encode() if body is not None else None
+    req = urllib.request.Request(url, data=data, method=method,
+                                 headers={"Content-Type": "application/json"})
+    try:
+        with urllib.request.urlopen(req, timeout=timeout) as resp:
+            resp.read()
+            return resp.status
+    except urllib.error.HTTPError as e:
+        return e.code
+    except TimeoutError:
+        return "timeout"
+    except (urllib.error.URLError, OSError) as e:
+        return "timeout" if "timed out" in str(e) else "error"
+
+
+def flooder(dev, stop, tally):
+    n = 0
+    while not stop.is_set():
+        n += 1
+        tally.add(fetch("POST", dev + "/api/notify", {"text": f"load {n}", "duration_sec": 1}))
+
+
+def tab(dev, stop, tally, interval):
+    while not stop.is_set():
+        tally.add(fetch("GET", dev + "/api/debug"))
+        stop.wait(interval)
+
+
+def probe(dev, stop, tally, timeout):
+    while not stop.is_set():
+        for path in ("/", "/api/status"):
+            start = time.monotonic()
+            code = fetch("GET", dev + path, timeout=timeout)
+            tally.add(code, (time.monotonic() - start) * 1000 if code == 200 else None)
+        stop.wait(1.0)
+
+
+def percentile(values, p):
+    if not values:
+        return 0.0
+    s = sorted(values)
+    return s[min(len(s) - 1, int(round(p / 100 * (len(s) - 1))))]
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--device", required=True, help="clock IP or base URL")
+    ap.add_argument("--flooders", type=int, default=8, help="threads posting /api/notify back to back")
+    ap.add_argument("--tabs", type=int, default=3, help="threads polling /api/debug")
+    ap.add_argument("--tab-interval", type=float, default=2.0, help="seconds between tab polls")
+    ap.add_argument("--seconds", type=float, default=60)
+    ap.add_argument("--probe-timeout", type=float, default=5.0, help="seconds before a probe counts as failed")
+    ap.add_argument("--max-probe-failures", type=float, default=0.05, help="allowed failed fraction of probes")
+    ap.add_argument("--json", action="store_true", help="print results as JSON")
+    args = ap.parse_args()
+
+    dev = args.device if args.device.startswith("http") else "http://" + args.device
+    dev = dev.rstrip("/")
+    stop = threading.Event()
+    flood, tabs, user = Tally(), Tally(), Tally()
+    threads = [threading.Thread(target=flooder, args=(dev, stop, flood)) for _ in range(args.flooders)]
+    threads += [threading.Thread(target=tab, args=(dev, stop, tabs, args.tab_interval)) for _ in range(args.tabs)]
+    threads.append(threading.Thread(target=probe, args=(dev, stop, user, args.probe_timeout)))
+
+    print(f"[load] {args.flooders} flooders, {args.tabs} tabs for {args.seconds:.0f} s ...", file=sys.stderr)
+    for t in threads:
+        t.daemon = True
+        t.start()
+    time.sleep(args.seconds)
+    stop.set()
+    for t in threads:
+        t.join(timeout=args.probe_timeout + 1)
+
+    try:
+        with urllib.request.urlopen(dev + "/api/debug", timeout=10) as resp:
+            admission = json.loads(resp.read()).get("admission", {})
+    except (urllib.error.URLError, OSError, ValueError):
+        admission = {}
+
+    probes = sum(user.codes.values())
+    failed = sum(n for code, n in user.codes.items() if code not in (200, 429))
+    result = {
+        "flood": {str(k): v for k, v in flood.codes.items()},
+        "tabs": {str(k): v for k, v in tabs.codes.items()},
+        "probe": {
+            "count": probes,
+            "failed": failed,
+            "limited": user.codes.get(429, 0),
+            "p50_ms": round(percentile(user.latencies, 50), 1),
+            "p95_ms": round(percentile(user.latencies, 95), 1),
+        },
+        "device_admission": admission,
+    }
+    if args.json:
+        print(json.dumps(result, indent=2))
+    else:
+        for name in ("flood", "tabs"):
+            codes = ", ".join(f"{k}: {v}" for k, v in sorted(result[name].items()))
+            print(f"{name:>6}  {codes or '-'}")
+        p = result["probe"]
+        print(f" probe  {p['count']} requests, {p['failed']} failed, {p['limited']} limited, "
+              f"p50 {p['p50_ms']} ms, p95 {p['p95_ms']} ms")
+        if admission:
+            print(f"device  {json.dumps(admission)}")
+
+    if probes == 0 or failed > args.max_probe_failures * probes:
+        print("[load] user probes failed under load", file=sys.stderr)
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
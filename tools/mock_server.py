@@ -0,0 +1,391 @@
+#!/usr/bin/env python3
+"""Local stand-in for the cloud services SugarClock talks to.
+
+Serves the Dexcom Share endpoints the firmware uses, Nightscout entries,
+the SugarClock custom-URL format and OpenWeatherMap current weather and
+3-hour forecast (with Cache-Control max-age like the real API), with
+injectable latency, errors, hangs, expired/null sessions and oversized
+payloads. Bodies of 256 bytes or more are gzipped when the client sends
+Accept-Encoding: gzip (turn off with --no-gzip). Point the clock at it with:
+
+    curl -X POST http://<clock>/api/config -d '{
+        "dexcom_base_url": "http://<this-host>:8080",
+        "weather_base_url": "http://<this-host>:8080",
+        "server_url": "http://<this-host>:8080/api/glucose"}'
+
+Faults can be set on the command line or changed at runtime:
+
+    curl -X POST http://localhost:8080/mock/config -d '{"latency_ms": 2000}'
+    curl -X POST http://localhost:8080/mock/config \\
+         -d '{"routes": {"dexcom_read": {"error_rate": 1.0, "error_code": 500}}}'
+    curl http://localhost:8080/mock/stats
+
+Route names: dexcom_auth, dexcom_login, dexcom_read, nightscout, glucose, weather, forecast.
+Standard library only.
+"""
+
+import argparse
+import gzip
+import json
+import math
+import random
+import threading
+import time
+import uuid
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, urlparse
+
+DEXCOM_PREFIX = "/ShareWebServices/Services"
+NULL_SESSION = "00000000-0000-0000-0000-000000000000"
+TRENDS = ["None", "DoubleUp", "SingleUp", "FortyFiveUp", "Flat",
+          "FortyFiveDown", "SingleDown", "DoubleDown"]
+NS_DIRECTIONS = {"DoubleUp": "DoubleUp", "SingleUp": "SingleUp", "FortyFiveUp": "FortyFiveUp",
+                 "Flat": "Flat", "FortyFiveDown": "FortyFiveDown", "SingleDown": "SingleDown",
+                 "DoubleDown": "DoubleDown"}
+
+# Fault knobs; each route may override any of them under "routes"
+DEFAULT_FAULTS = {
+    "latency_ms": 0,        # added before every response
+    "jitter_ms": 0,         # uniform +/- on top of latency
+    "error_rate": 0.0,      # probability of answering with error_code instead
+    "error_code": 500,
+    "hang_rate": 0.0,       # probability of never answering (client must time out)
+    "hang_ms": 30000,
+    "pad_bytes": 0,         # filler added to successful JSON bodies
+}
+
+
+class MockState:
+    def __init__(self, faults, base_mg_dl, swing_mg_dl, session_ttl_sec, null_session, weather_id):
+        self.lock = threading.Lock()
+        self.faults = dict(faults)
+        self.routes = {}
+        self.base_mg_dl = base_mg_dl
+        self.swing_mg_dl = swing_mg_dl
+        self.session_ttl_sec = session_ttl_sec
+        self.null_session = null_session
+        self.weather_id = weather_id
+        self.sessions = {}
+        self.started = time.time()
+        self.reset_stats()
+
+    def reset_stats(self):
+        self.stats = {}
+
+    def faults_for(self, route):
+        with self.lock:
+            f = dict(self.faults)
+            f.update(self.routes.get(route, {}))
+            return f
+
+    def record(self, route, status, elapsed_ms, size):
+        with self.lock:
+            s = self.stats.setdefault(route, {"count": 0, "errors": 0, "hangs": 0,
+                                              "total_ms": 0.0, "max_ms": 0.0, "bytes": 0})
+            s["count"] += 1
+            if status is None:
+                s["hangs"] += 1
+            elif status != 200:
+                s["errors"] += 1
+            s["total_ms"] += elapsed_ms
+            s["max_ms"] = max(s["max_ms"], elapsed_ms)
+            s["bytes"] += size
+
+    def apply_config(self, cfg):
+        with self.lock:
+            for key in DEFAULT_FAULTS:
+                if key in cfg:
+                    self.faults[key] = cfg[key]
+            for route, overrides in cfg.get("routes", {}).items():
+                if overrides is None:
+                    self.routes.pop(route, None)
+                else:
+                    self.routes.setdefault(route, {}).update(overrides)
+            for key in ("base_mg_dl", "swing_mg_dl", "session_ttl_sec", "null_session", "weather_id"):
+                if key in cfg:
+                    setattr(self, key, cfg[key])
+            if cfg.get("expire_sessions"):
+                self.sessions.clear()
+
+    def snapshot(self):
+        with self.lock:
+            return {"faults": self.faults, "routes": self.routes,
+                    "base_mg_dl": self.base_mg_dl, "swing_mg_dl": self.swing_mg_dl,
+                    "session_ttl_sec": self.session_ttl_sec, "null_session": self.null_session,
+                    "weather_id": self.weather_id, "sessions": len(self.sessions)}
+
+    # --- Synthetic data ---
+
+    def reading_at(self, t):
+        """Value and trend of the 5-minute reading covering wall time t."""
+        slot = int(t // 300) * 300
+        def value(ts):
+            return round(self.base_mg_dl + self.swing_mg_dl * math.sin(ts / (6 * 3600) * 2 * math.pi))
+        v, prev = value(slot), value(slot - 300)
+        d = v - prev
+        trend = ("DoubleUp" if d > 10 else "SingleUp" if d > 5 else "FortyFiveUp" if d > 2 else
+                 "DoubleDown" if d < -10 else "SingleDown" if d < -5 else "FortyFiveDown" if d < -2 else "Flat")
+        return slot, v, trend
+
+    def readings(self, count):
+        now = time.time()
+        return [self.reading_at(now - i * 300) for i in range(count)]
+
+
+class Handler(BaseHTTPRequestHandler):
+    server_version = "SugarClockMock/1.0"
+    protocol_version = "HTTP/1.1"
+
+    def log_message(self, fmt, *args):
+        if self.server.verbose:
+            super().log_message(fmt, *args)
+
+    @property
+    def state(self):
+        return self.server.state
+
+    def read_body(self):
+        length = int(self.headers.get("Content-Length") or 0)
+        return self.rfile.read(length) if length else b""
+
+    def send_json(self, route, status, obj, started, faults=None, pad=True, max_age=0):
+        if pad and faults and faults["pad_bytes"] > 0 and status == 200:
+            filler = "x" * int(faults["pad_bytes"])
+            if isinstance(obj, list):
+                for item in obj:
+                    item["Pad"] = filler
+            elif isinstance(obj, dict):
+                obj["pad"] = filler
+        body = obj if isinstance(obj, (bytes, bytearray)) else json.dumps(obj).encode()
+        gzipped = (self.server.gzip and len(body) >= 256
+                   and "gzip" in (self.headers.get("Accept-Encoding") or ""))
+        if gzipped:
+            body = gzip.compress(body)
+        self.send_response(status)
+        self.send_header("Content-Type", "application/json")
+        if gzipped:
+            self.send_header("Content-Encoding", "gzip")
+        self.send_header("Content-Length", str(len(body)))
+        if max_age:
+            self.send_header("Cache-Control", f"max-age={max_age}")
+        self.end_headers()
+        self.wfile.write(body)
+        if route:
+            self.state.record(route, status, (time.time() - started) * 1000, len(body))
+
+    def inject(self, route, started):
+        """Apply latency/hang/error faults. Returns the faults, or None if already answered."""
+        f = self.state.faults_for(route)
+        delay = f["latency_ms"] + random.uniform(-f["jitter_ms"], f["jitter_ms"])
+        if delay > 0:
+            time.sleep(delay / 1000)
+        if random.random() < f["hang_rate"]:
+            time.sleep(f["hang_ms"] / 1000)
+            self.state.record(route, None, (time.time() - started) * 1000, 0)
+            self.close_connection = True
+            return None
+        if random.random() < f["error_rate"]:
+            self.send_json(route, int(f["error_code"]),
+                           {"Code": "InjectedFault", "Message": "mock_server injected error"}, started)
+            return None
+        return f
+
+    # --- Routing ---
+
+    def do_GET(self):
+        started = time.time()
+        url = urlparse(self.path)
+        q = parse_qs(url.query)
+        if url.path == "/mock/stats":
+            with self.state.lock:
+                stats = {k: dict(v, avg_ms=round(v["total_ms"] / v["count"], 1) if v["count"] else 0)
+                         for k, v in self.state.stats.items()}
+            return self.send_json(None, 200, stats, started)
+        if url.path == "/mock/config":
+            return self.send_json(None, 200, self.state.snapshot(), started)
+        if url.path in ("/api/v1/entries.json", "/api/v1/entries/sgv.json", "/api/v1/entries/current.json"):
+            return self.nightscout(url.path, q, started)
+        if url.path == "/api/glucose":
+            return self.custom_glucose(started)
+        if url.path == "/data/2.5/weather":
+            return self.weather(q, started)
+        if url.path == "/data/2.5/forecast":
+            return self.forecast(q, started)
+        self.send_json(None, 404, {"error": "not found", "path": url.path}, started)
+
+    def do_POST(self):
+        started = time.time()
+        url = urlparse(self.path)
+        body = self.read_body()
+        if url.path == "/mock/config":
+            try:
+                self.state.apply_config(json.loads(body or b"{}"))
+            except ValueError:
+                return self.send_json(None, 400, {"error": "invalid JSON"}, started)
+            return self.send_json(None, 200, self.state.snapshot(), started)
+        if url.path == "/mock/reset-stats":
+            with self.state.lock:
+                self.state.reset_stats()
+            return self.send_json(None, 200, {"status": "ok"}, started)
+        if url.path == DEXCOM_PREFIX + "/General/AuthenticatePublisherAccount":
+            return self.dexcom_auth(body, started)
+        if url.path == DEXCOM_PREFIX + "/General/LoginPublisherAccountById":
+            return self.dexcom_login(body, started)
+        if url.path == DEXCOM_PREFIX + "/Publisher/ReadPublisherLatestGlucoseValues":
+            return self.dexcom_read(parse_qs(url.query), started)
+        self.send_json(None, 404, {"error": "not found", "path": url.path}, started)
+
+    # --- Dexcom Share ---
+
+    def dexcom_auth(self, body, started):
+        f = self.inject("dexcom_auth", started)
+        if f is None:
+            return
+        try:
+            req = json.loads(body or b"{}")
+        except ValueError:
+            req = {}
+        if not req.get("accountName") or not req.get("password"):
+            return self.send_json("dexcom_auth", 500, {"Code": "AccountPasswordInvalid"}, started)
+        account_id = str(uuid.uuid5(uuid.NAMESPACE_DNS, req["accountName"]))
+        self.send_json("dexcom_auth", 200, json.dumps(account_id).encode(), started)
+
+    def dexcom_login(self, body, started):
+        f = self.inject("dexcom_login", started)
+        if f is None:
+            return
+        if self.state.null_session:
+            return self.send_json("dexcom_login", 200, json.dumps(NULL_SESSION).encode(), started)
+        session = str(uuid.uuid4())
+        with self.state.lock:
+            self.state.sessions[session] = time.time()
+        self.send_json("dexcom_login", 200, json.dumps(session).encode(), started)
+
+    def dexcom_read(self, q, started):
+        f = self.inject("dexcom_read", started)
+        if f is None:
+            return
+        session = (q.get("sessionId") or [""])[0]
+        with self.state.lock:
+            created = self.state.sessions.get(session)
+            ttl = self.state.session_ttl_sec
+            if created is not None and ttl > 0 and time.time() - created > ttl:
+                del self.state.sessions[session]
+                created = None
+        if created is None:
+            return self.send_json("dexcom_read", 500,
+                                  {"Code": "SessionIdNotFound", "Message": "Session ID not found"}, started)
+        count = max(1, int((q.get("maxCount") or ["1"])[0]))
+        out = []
+        for ts, value, trend in self.state.readings(count):
+            ms = int(ts * 1000)
+            out.append({"WT": f"Date({ms})", "ST": f"Date({ms})", "DT": f"Date({ms}+0000)",
+                        "Value": value, "Trend": trend})
+        self.send_json("dexcom_read", 200, out, started, f)
+
+    # --- Nightscout and the SugarClock custom-URL format ---
+
+    def nightscout(self, path, q, started):
+        f = self.inject("nightscout", started)
+        if f is None:
+            return
+        count = 1 if path.endswith("current.json") else max(1, int((q.get("count") or ["10"])[0]))
+        out = []
+        for ts, value, trend in self.state.readings(count):
+            out.append({"type": "sgv", "sgv": value, "direction": NS_DIRECTIONS[trend],
+                        "date": int(ts * 1000),
+                        "dateString": time.strftime("%Y-%m-%dT%H:%M:%S.000Z", time.gmtime(ts))})
+        self.send_json("nightscout", 200, out, started, f)
+
+    def custom_glucose(self, started):
+        f = self.inject("glucose", started)
+        if f is None:
+            return
+        ts, value, trend = self.state.reading_at(time.time())
+        self.send_json("glucose", 200, {"glucose": value, "trend": trend, "timestamp": int(ts)}, started, f)
+
+    # --- OpenWeatherMap ---
+
+    def condition(self):
+        wid = int(self.state.weather_id)
+        main = ("Thunderstorm" if wid < 300 else "Drizzle" if wid < 400 else "Rain" if wid < 600 else
+                "Snow" if wid < 700 else "Clear" if wid == 800 else "Clouds")
+        return wid, main
+
+    @staticmethod
+    def temp_at(ts, imperial):
+        temp_c = 12 + 8 * math.sin(ts / 86400 * 2 * math.pi)
+        return round(temp_c * 9 / 5 + 32 if imperial else temp_c, 2)
+
+    def weather(self, q, started):
+        f = self.inject("weather", started)
+        if f is None:
+            return
+        if not (q.get("appid") or [""])[0]:
+            return self.send_json("weather", 401, {"cod": 401, "message": "Invalid API key."}, started)
+        imperial = (q.get("units") or ["metric"])[0] == "imperial"
+        wid, main = self.condition()
+        name = (q.get("q") or q.get("zip") or ["Mockville"])[0].split(",")[0]
+        self.send_json("weather", 200, {
+            "weather": [{"id": wid, "main": main, "description": main.lower()}],
+            "main": {"temp": self.temp_at(time.time(), imperial), "humidity": 55},
+            "wind": {"speed": round(6.0 / 0.44704 if imperial else 6.0, 2), "deg": 250},
+            "name": name, "cod": 200,
+        }, started, f, max_age=600)
+
+    def forecast(self, q, started):
+        f = self.inject("forecast", started)
+        if f is None:
+            return
+        if not (q.get("appid") or [""])[0]:
+            return self.send_json("forecast", 401, {"cod": 401, "message": "Invalid API key."}, started)
+        imperial = (q.get("units") or ["metric"])[0] == "imperial"
+        cnt = min(40, int((q.get("cnt") or ["40"])[0]))
+        wid, main = self.condition()
+        first = (int(time.time()) // 10800 + 1) * 10800
+        items = [{
+            "dt": first + i * 10800,
+            "main": {"temp": self.temp_at(first + i * 10800, imperial), "humidity": 55},
+            "weather": [{"id": wid, "main": main, "description": main.lower()}],
+            "wind": {"speed": round(6.0 / 0.44704 if imperial else 6.0, 2), "deg": 250},
+        } for i in range(cnt)]
+        self.send_json("forecast", 200, {"cod": "200", "cnt": cnt, "list": items}, started, f,
+                       max_age=10800)
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--host", default="0.0.0.0")
+    ap.add_argument("--port", type=int, default=8080)
+    ap.add_argument("--latency", type=float, default=0, help="ms added to every response")
+    ap.add_argument("--jitter", type=float, default=0, help="+/- ms on top of --latency")
+    ap.add_argument("--error-rate", type=float, default=0.0, help="probability of an injected error")
+    ap.add_argument("--error-code", type=int, default=500)
+    ap.add_argument("--hang-rate", type=float, default=0.0, help="probability of never answering")
+    ap.add_argument("--pad-bytes", type=int, default=0, help="filler added to successful bodies")
+    ap.add_argument("--session-ttl", type=int, default=0, help="Dexcom session lifetime in s (0 = forever)")
+    ap.add_argument("--null-session", action="store_true", help="Dexcom login returns the null GUID")
+    ap.add_argument("--glucose", type=int, default=120, help="baseline mg/dL")
+    ap.add_argument("--swing", type=int, default=40, help="sine amplitude mg/dL over 6 h")
+    ap.add_argument("--weather-id", type=int, default=500, help="OWM condition id to report")
+    ap.add_argument("--no-gzip", action="store_true", help="never compress, even if the client offers gzip")
+    ap.add_argument("-v", "--verbose", action="store_true")
+    args = ap.parse_args()
+
+    faults = dict(DEFAULT_FAULTS, latency_ms=args.latency, jitter_ms=args.jitter,
+                  error_rate=args.error_rate, error_code=args.error_code,
+                  hang_rate=args.hang_rate, pad_bytes=args.pad_bytes)
+    server = ThreadingHTTPServer((args.host, args.port), Handler)
+    server.daemon_threads = True
+    server.verbose = args.verbose
+    server.gzip = not args.no_gzip
+    server.state = MockState(faults, args.glucose, args.swing, args.session_ttl,
+                             args.null_session, args.weather_id)
+    print(f"mock_server listening on http://{args.host}:{args.port}")
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+"""Push a firmware, web UI bundle or LittleFS image to one or more clocks over WiFi.
+
+    pio run && pio run --target buildfs
+    python3 tools/ota_push.py .pio/build/esp32dev/firmware.bin 192.168.1.50 192.168.1.51
+    python3 tools/ota_push.py .pio/build/esp32dev/www.bin --target www 192.168.1.50
+    python3 tools/ota_push.py .pio/build/esp32dev/littlefs.bin --target filesystem 192.168.1.50
+
+The image is gzip-compressed for the transfer (the clock inflates it while
+writing) and sent with its SHA-256. For firmware the tool waits until each
+clock is back up on the other slot; with --confirm it also waits for the
+new build to pass its health check (otherwise it rolls back on its own).
+Standard library only.
+"""
+
+import argparse
+import gzip
+import hashlib
+import json
+import sys
+import time
+import urllib.error
+import urllib.request
+from concurrent.futures import ThreadPoolExecutor
+
+
+def get_json(url, timeout=5):
+    with urllib.request.urlopen(url, timeout=timeout) as resp:
+        return json.loads(resp.read())
+
+
+def wait_for(base, predicate, timeout):
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        try:
+            status = get_json(base + "/api/ota")
+            if predicate(status):
+                return status
+        except OSError:
+            pass  # restarting
+        time.sleep(2)
+    return None
+
+
+def push(host, payload, sha, target, confirm, timeout):
+    base = host if host.startswith("http") else "http://" + host
+    base = base.rstrip("/")
+    start = time.time()
+    try:
+        before = get_json(base + "/api/ota")
+        req = urllib.request.Request(
+            f"{base}/api/ota?target={target}&sha256={sha}", data=payload, method="POST",
+            headers={"Content-Type": "application/octet-stream"})
+        with urllib.request.urlopen(req, timeout=timeout) as resp:
+            result = json.loads(resp.read())
+    except urllib.error.HTTPError as e:
+        body = e.read().decode(errors="replace")
+        return host, False, f"HTTP {e.code}: {body}", time.time() - start
+    except OSError as e:
+        return host, False, str(e), time.time() - start
+    if not result.get("ok"):
+        return host, False, result.get("error", "update failed"), time.time() - start
+    upload_s = time.time() - start
+    time.sleep(3)  # the clock restarts shortly after answering
+
+    if target in ("filesystem", "www"):
+        up = wait_for(base, lambda s: True, timeout)
+        msg = f"uploaded in {upload_s:.1f}s" + ("" if up else ", not back up yet")
+        return host, up is not None, msg, time.time() - start
+
+    up = wait_for(base, lambda s: s.get("running") != before.get("running"), timeout)
+    if not up:
+        return host, False, f"uploaded in {upload_s:.1f}s but did not come back on the new slot", time.time() - start
+    msg = f"uploaded in {upload_s:.1f}s, running {up['running']}"
+    if confirm:
+        ok = wait_for(base, lambda s: not s.get("pending_verify"), timeout + 90)
+        if not ok or ok.get("running") != up.get("running"):
+            return host, False, msg + ", rolled back or never confirmed", time.time() - start
+        msg += ", confirmed"
+    return host, True, msg, time.time() - start
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("image", help="firmware.bin, www.bin or littlefs.bin (uncompressed)")
+    ap.add_argument("hosts", nargs="+", help="clock IPs or base URLs")
+    ap.add_argument("--target", choices=["firmware", "www", "filesystem"], default="firmware")
+    ap.add_argument("--no-gzip", action="store_true", help="send the image uncompressed")
+    ap.add_argument("--confirm", action="store_true", help="wait for the new firmware to be confirmed")
+    ap.add_argument("--parallel", type=int, default=4, help="clocks updated at once")
+    ap.add_argument("--timeout", type=int, default=120, help="seconds per step")
+    args = ap.parse_args()
+
+    with open(args.image, "rb") as f:
+        image = f.read()
+    sha = hashlib.sha256(image).hexdigest()
+    payload = image if args.no_gzip else gzip.compress(image, compresslevel=9)
+    print(f"{args.image}: {len(image)} bytes, {len(payload)} on the wire, sha256 {sha[:16]}...")
+
+    failed = 0
+    with ThreadPoolExecutor(max_workers=max(1, args.parallel)) as pool:
+        jobs = [pool.submit(push, h, payload, sha, args.target, args.confirm, args.timeout) for h in args.hosts]
+        for job in jobs:
+            host, ok, msg, elapsed = job.result()
+            print(f"  {'ok  ' if ok else 'FAIL'} {host:<20} {elapsed:6.1f}s  {msg}")
+            failed += 0 if ok else 1
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+"""End-to-end poll benchmark against tools/mock_server.py.
+
+Points a SugarClock at the mock, then for each latency level resets the
+device perf counters, lets it poll for a while and reports the device-side
+fetch latency and main-loop stall time next to what the mock served.
+The device config touched here is restored afterwards.
+
+    python3 tools/mock_server.py --port 8080 &
+    python3 tools/poll_bench.py --device 192.168.1.50 --mock http://192.168.1.20:8080 \\
+        --source dexcom --latency 0,500,2000,8000 --polls 8
+
+Standard library only.
+"""
+
+import argparse
+import json
+import sys
+import time
+import urllib.request
+
+TOUCHED_KEYS = ["data_source", "server_url", "dexcom_base_url", "dexcom_username",
+                "dexcom_password", "poll_interval", "weather_base_url"]
+
+
+def request(method, url, body=None, timeout=10):
+    data = json.dumps(body).encode() if body is not None else None
+    req = urllib.request.Request(url, data=data, method=method,
+                                 headers={"Content-Type": "application/json"})
+    with urllib.request.urlopen(req, timeout=timeout) as resp:
+        raw = resp.read()
+        return json.loads(raw) if raw else {}
+
+
+def configure_device(dev, mock, source, poll_sec):
+    cfg = {"poll_interval": poll_sec, "weather_base_url": mock}
+    if source == "dexcom":
+        cfg.update(data_source=1, dexcom_base_url=mock,
+                   dexcom_username="bench", dexcom_password="bench")
+    else:
+        cfg.update(data_source=0, server_url=mock + "/api/glucose")
+    request("POST", dev + "/api/config", cfg)
+
+
+def run_level(dev, mock, route, latency_ms, polls, poll_sec, extra_faults):
+    faults = dict(extra_faults, latency_ms=latency_ms)
+    request("POST", mock + "/mock/config", faults)
+    request("POST", mock + "/mock/reset-stats")
+    request("POST", dev + "/api/perf/reset")
+
+    # Wait for the requested number of polls, bounded by the worst case
+    deadline = time.time() + polls * (poll_sec + latency_ms / 1000 + 20)
+    perf = {}
+    while time.time() < deadline:
+        time.sleep(poll_sec / 2)
+        perf = request("GET", dev + "/api/debug").get("perf", {})
+        if perf.get("glucose", {}).get("count", 0) >= polls:
+            break
+
+    served = request("GET", mock + "/mock/stats").get(route, {})
+    g = perf.get("glucose", {})
+    return {
+        "latency_ms": latency_ms,
+        "polls": g.get("count", 0),
+        "failures": g.get("failures", 0),
+        "poll_avg_ms": g.get("avg_ms", 0),
+        "poll_max_ms": g.get("max_ms", 0),
+        "mock_avg_ms": served.get("avg_ms", 0),
+        "loop_avg_us": perf.get("loop_avg_us", 0),
+        "loop_max_ms": perf.get("loop_max_us", 0) / 1000,
+        "stalls": perf.get("loop_stalls", 0),
+    }
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--device", required=True, help="clock IP or base URL")
+    ap.add_argument("--mock", required=True, help="mock server base URL as seen from the clock")
+    ap.add_argument("--source", choices=["dexcom", "custom"], default="dexcom")
+    ap.add_argument("--latency", default="0,500,2000", help="comma-separated injected latencies (ms)")
+    ap.add_argument("--polls", type=int, default=5, help="polls to collect per level")
+    ap.add_argument("--poll-interval", type=int, default=15, help="device poll interval (s, min 15)")
+    ap.add_argument("--error-rate", type=float, default=0.0)
+    ap.add_argument("--pad-bytes", type=int, default=0)
+    ap.add_argument("--json", action="store_true", help="print results as JSON")
+    args = ap.parse_args()
+
+    dev = args.device if args.device.startswith("http") else "http://" + args.device
+    dev, mock = dev.rstrip("/"), args.mock.rstrip("/")
+    route = "dexcom_read" if args.source == "dexcom" else "glucose"
+    poll_sec = max(15, args.poll_interval)
+    extra = {"error_rate": args.error_rate, "pad_bytes": args.pad_bytes}
+
+    saved = request("GET", dev + "/api/config")
+    restore = {k: saved[k] for k in TOUCHED_KEYS if k in saved}
+    results = []
+    try:
+        configure_device(dev, mock, args.source, poll_sec)
+        for lat in [int(x) for x in args.latency.split(",") if x.strip()]:
+            print(f"[bench] latency {lat} ms ...", file=sys.stderr)
+            results.append(run_level(dev, mock, route, lat, args.polls, poll_sec, extra))
+    finally:
+        request("POST", dev + "/api/config", restore)
+        request("POST", mock + "/mock/config", {"latency_ms": 0, "error_rate": 0.0, "pad_bytes": 0})
+
+    if args.json:
+        print(json.dumps(results, indent=2))
+        return
+    cols = ["latency_ms", "polls", "failures", "poll_avg_ms", "poll_max_ms",
+            "mock_avg_ms", "loop_avg_us", "loop_max_ms", "stalls"]
+    print("  ".join(f"{c:>11}" for c in cols))
+    for r in results:
+        print("  ".join(f"{r[c]:>11.1f}" if isinstance(r[c], float) else f"{r[c]:>11}" for c in cols))
+
+
+if __name__ == "__main__":
+    main()
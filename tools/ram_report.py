@@ -0,0 +1,165 @@
+#!/usr/bin/env python3
+"""Flash and static DRAM use per module, from the linker map.
+
+Sums the input sections the linker placed in .dram0.data and .dram0.bss
+(RAM) and in .flash.text, .flash.rodata and .iram0.text (flash), and
+prints one row per object file (our sources) or library. Whatever is
+left of the DRAM segment after this is the heap the firmware starts with.
+
+Runs after every esp32dev build (extra_scripts in platformio.ini), or by
+hand on a map file:
+
+    python3 tools/ram_report.py .pio/build/esp32dev/firmware.map --top 25
+
+--diff compares against another map, e.g. what the glucose_only build
+saves over the full one:
+
+    python3 tools/ram_report.py .pio/build/glucose_only/firmware.map \\
+        --diff .pio/build/esp32dev/firmware.map
+
+Standard library only.
+"""
+
+import argparse
+import os
+import re
+import sys
+from collections import defaultdict
+
+# Output section -> column in the per-module usage
+SECTIONS = {
+    ".dram0.data": 0,
+    ".dram0.bss": 1,
+    ".flash.text": 2,
+    ".flash.rodata": 2,
+    ".iram0.text": 2,
+}
+
+SEGMENT_LINE = re.compile(r"^(dram0_0_seg)\s+(0x[0-9a-f]+)\s+(0x[0-9a-f]+)")
+
+
+def module_name(path):
+    path = path.strip()
+    archive = re.match(r"(.*\.a)\((.*)\)$", path)
+    if archive:
+        return os.path.basename(archive.group(1))
+    name = os.path.basename(path)
+    for ext in (".cpp.o", ".c.o", ".S.o", ".o"):
+        if name.endswith(ext):
+            return name[: -len(ext)]
+    return name
+
+
+def parse_map(lines):
+    usage = defaultdict(lambda: [0, 0, 0])   # module -> [data, bss, flash]
+    segment = None
+    current = None
+    for raw in lines:
+        line = raw.rstrip("\n")
+        seg = SEGMENT_LINE.match(line)
+        if seg and segment is None:
+            segment = int(seg.group(3), 16)
+            continue
+        if line and not line[0].isspace():
+            name = line.split()[0]
+            current = SECTIONS.get(name)
+            continue
+        if current is None:
+            continue
+        # " .bss.rx_buf  0x3ffc1a28  0x100 .pio/build/esp32dev/src/improv_serial.cpp.o"
+        # (long section names push address, size and file onto the next line)
+        tokens = line.split()
+        if tokens and (tokens[0].startswith(".") or tokens[0] == "COMMON"):
+            tokens = tokens[1:]
+        if len(tokens) < 3 or not tokens[0].startswith("0x") or not tokens[1].startswith("0x"):
+            continue
+        size = int(tokens[1], 16)
+        if size:
+            usage[module_name(" ".join(tokens[2:]))][current] += size
+    return usage, segment
+
+
+def load(map_path):
+    with open(map_path, encoding="utf-8", errors="replace") as f:
+        return parse_map(f)
+
+
+def report(map_path, top=20, out=sys.stdout):
+    usage, segment = load(map_path)
+    if not usage:
+        print(f"ram_report: no .dram0 sections in {map_path}", file=out)
+        return
+
+    rows = sorted(usage.items(), key=lambda kv: kv[1][0] + kv[1][1], reverse=True)
+    total_data = sum(v[0] for v in usage.values())
+    total_bss = sum(v[1] for v in usage.values())
+    total_flash = sum(v[2] for v in usage.values())
+    total = total_data + total_bss
+
+    print(f"\nStatic DRAM and flash by module ({map_path})", file=out)
+    print(f"{'module':<32}{'data':>8}{'bss':>8}{'ram':>8}{'flash':>9}", file=out)
+    for name, (data, bss, flash) in rows[:top]:
+        print(f"{name:<32}{data:>8}{bss:>8}{data + bss:>8}{flash:>9}", file=out)
+    rest = rows[top:]
+    if rest:
+        data = sum(v[0] for _, v in rest)
+        bss = sum(v[1] for _, v in rest)
+        flash = sum(v[2] for _, v in rest)
+        print(f"{f'({len(rest)} more)':<32}{data:>8}{bss:>8}{data + bss:>8}{flash:>9}", file=out)
+    print(f"{'total':<32}{total_data:>8}{total_bss:>8}{total:>8}{total_flash:>9}", file=out)
+    if segment:
+        print(f"dram0_0_seg {segment} bytes, {segment - total} left for heap "
+              f"({100.0 * total / segment:.1f}% static)", file=out)
+
+
+def diff(map_path, base_path, top=20, out=sys.stdout):
+    usage, _ = load(map_path)
+    base, _ = load(base_path)
+    deltas = {}
+    for name in set(usage) | set(base):
+        a = usage.get(name, [0, 0, 0])
+        b = base.get(name, [0, 0, 0])
+        ram = (a[0] + a[1]) - (b[0] + b[1])
+        flash = a[2] - b[2]
+        if ram or flash:
+            deltas[name] = (ram, flash)
+
+    rows = sorted(deltas.items(), key=lambda kv: abs(kv[1][0]) + abs(kv[1][1]), reverse=True)
+    print(f"\n{map_path} against {base_path} (negative = smaller)", file=out)
+    print(f"{'module':<32}{'ram':>8}{'flash':>9}", file=out)
+    for name, (ram, flash) in rows[:top]:
+        print(f"{name:<32}{ram:>+8}{flash:>+9}", file=out)
+    rest = rows[top:]
+    if rest:
+        ram = sum(v[0] for _, v in rest)
+        flash = sum(v[1] for _, v in rest)
+        print(f"{f'({len(rest)} more)':<32}{ram:>+8}{flash:>+9}", file=out)
+    ram = sum(v[0] for v in deltas.values())
+    flash = sum(v[1] for v in deltas.values())
+    print(f"{'total':<32}{ram:>+8}{flash:>+9}", file=out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("map", help="linker map file")
+    parser.add_argument("--top", type=int, default=20, help="rows to show")
+    parser.add_argument("--diff", metavar="BASE_MAP", help="show per-module change against another map")
+    args = parser.parse_args()
+    if args.diff:
+        diff(args.map, args.diff, args.top)
+    else:
+        report(args.map, args.top)
+
+
+if __name__ == "__main__":
+    main()
+else:
+    # Loaded by PlatformIO as an extra script
+    try:
+        Import("env")  # noqa: F821
+    except NameError:
+        env = None
+    if env is not None:
+        env.Append(LINKFLAGS=["-Wl,-Map,${BUILD_DIR}/firmware.map"])
+        env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf",
+                          lambda target, source, env: report(env.subst("$BUILD_DIR/firmware.map")))
@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+"""Pack data/www into the web UI bundle for the raw "www" partition.
+
+Each file is gzipped (when that makes it smaller) and stored behind a
+small index, so the clock can serve it straight from memory-mapped flash
+(src/www_bundle.cpp has the reader):
+
+    header  16 bytes   magic "WWWB", u16 version, u16 file count,
+                       u32 total length, u32 CRC-32 of everything after it
+    index   64 bytes   per file: path[48] (NUL-padded, "/index.html"),
+                       u32 offset, u32 length, u32 CRC-32 of the stored
+                       bytes (the ETag), u8 type, u8 flags (1 = gzip), u16 0
+    data               the files, each 4-byte aligned
+
+All integers little-endian. Runs after every esp32dev build (extra_scripts
+in platformio.ini), writing .pio/build/<env>/www.bin, or by hand:
+
+    python3 tools/www_pack.py data/www www.bin
+
+Flash it over WiFi (Device page, Web UI bundle; or tools/ota_push.py
+www.bin --target www <ip>) or with esptool at the partition's offset.
+Standard library only.
+"""
+
+import argparse
+import csv
+import gzip
+import os
+import struct
+import sys
+import zlib
+
+MAGIC = b"WWWB"
+VERSION = 1
+HEADER = struct.Struct("<4sHHII")
+ENTRY = struct.Struct("<48sIIIBBH")
+PATH_MAX = 48
+FLAG_GZIP = 0x01
+
+# Index into WWW_TYPES[] in src/www_bundle.cpp
+TYPES = {".html": 1, ".htm": 1, ".css": 2, ".js": 3, ".json": 4,
+         ".svg": 5, ".png": 6, ".ico": 7, ".txt": 8}
+
+PARTITION_LABEL = "www"
+
+
+def pack(src_dir):
+    files = []
+    for root, _, names in os.walk(src_dir):
+        for name in sorted(names):
+            if name.startswith("."):
+                continue
+            full = os.path.join(root, name)
+            path = "/" + os.path.relpath(full, src_dir).replace(os.sep, "/")
+            if len(path.encode()) >= PATH_MAX:
+                raise ValueError(f"{path}: path longer than {PATH_MAX - 1} bytes")
+            with open(full, "rb") as f:
+                raw = f.read()
+            # mtime=0 keeps the bundle (and its ETags) reproducible
+            packed = gzip.compress(raw, compresslevel=9, mtime=0)
+            flags = FLAG_GZIP
+            if len(packed) >= len(raw):
+                packed, flags = raw, 0
+            ftype = TYPES.get(os.path.splitext(name)[1].lower(), 0)
+            files.append((path, packed, ftype, flags, len(raw)))
+    files.sort()
+
+    offset = HEADER.size + ENTRY.size * len(files)
+    index, data = bytearray(), bytearray()
+    for path, packed, ftype, flags, _ in files:
+        pad = (-offset) % 4
+        data += b"\0" * pad
+        offset += pad
+        index += ENTRY.pack(path.encode(), offset, len(packed), zlib.crc32(packed), ftype, flags, 0)
+        data += packed
+        offset += len(packed)
+
+    body = bytes(index + data)
+    header = HEADER.pack(MAGIC, VERSION, len(files), HEADER.size + len(body), zlib.crc32(body))
+    return header + body, files
+
+
+def partition(csv_path, label=PARTITION_LABEL):
+    """(offset, size) of the labelled partition in a partition table CSV."""
+    with open(csv_path) as f:
+        rows = csv.reader(line for line in f if line.strip() and not line.lstrip().startswith("#"))
+        for row in rows:
+            cols = [c.strip() for c in row]
+            if cols and cols[0] == label:
+                return int(cols[3], 0), int(cols[4], 0)
+    return None
+
+
+def build(src_dir, out_path, csv_path=None, out=sys.stdout):
+    bundle, files = pack(src_dir)
+    with open(out_path, "wb") as f:
+        f.write(bundle)
+    raw = sum(f[4] for f in files)
+    print(f"{out_path}: {len(files)} files, {raw} bytes -> {len(bundle)} bytes", file=out)
+    part = partition(csv_path) if csv_path and os.path.exists(csv_path) else None
+    if part:
+        offset, size = part
+        print(f"  {PARTITION_LABEL} partition at 0x{offset:x}, {len(bundle) * 100 // size}% of {size} bytes", file=out)
+        if len(bundle) > size:
+            raise ValueError(f"bundle is {len(bundle)} bytes, the {PARTITION_LABEL} partition holds {size}")
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("src", nargs="?", default="data/www", help="web UI directory")
+    ap.add_argument("out", nargs="?", default="www.bin", help="bundle to write")
+    ap.add_argument("--partitions", default="partitions_custom.csv", help="partition table to check the size against")
+    args = ap.parse_args()
+    try:
+        build(args.src, args.out, args.partitions)
+    except ValueError as e:
+        sys.exit(f"www_pack: {e}")
+
+
+if __name__ == "__main__":
+    main()
+else:
+    # Loaded by PlatformIO as an extra script
+    try:
+        Import("env")  # noqa: F821
+    except NameError:
+        env = None
+    if env is not None:
+        def _pack(target, source, env):
+            project = env.subst("$PROJECT_DIR")
+            build(os.path.join(project, "data", "www"), env.subst("$BUILD_DIR/www.bin"),
+                  os.path.join(project, env.GetProjectOption("board_build.partitions", "partitions_custom.csv")))
+        env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", _pack)